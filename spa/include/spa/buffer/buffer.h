@@ -60,9 +60,9 @@ struct spa_type_data {
 static inline void spa_type_data_map(struct spa_type_map *map, struct spa_type_data *type)
 {
 	if (type->MemPtr == 0) {
-		type->MemPtr = spa_type_map_get_id(map, SPA_TYPE_DATA__MemPtr);
-		type->MemFd = spa_type_map_get_id(map, SPA_TYPE_DATA_FD__MemFd);
-		type->DmaBuf = spa_type_map_get_id(map, SPA_TYPE_DATA_FD__DmaBuf);
+		type->MemPtr = SPA_TYPE_ID_DATA_MemPtr;
+		type->MemFd = SPA_TYPE_ID_DATA_MemFd;
+		type->DmaBuf = SPA_TYPE_ID_DATA_DmaBuf;
 	}
 }
 
@@ -92,8 +92,8 @@ struct spa_type_meta {
 static inline void spa_type_meta_map(struct spa_type_map *map, struct spa_type_meta *type)
 {
 	if (type->Header == 0) {
-		type->Header = spa_type_map_get_id(map, SPA_TYPE_META__Header);
-		type->VideoCrop = spa_type_map_get_id(map, SPA_TYPE_META__VideoCrop);
+		type->Header = SPA_TYPE_ID_META_Header;
+		type->VideoCrop = SPA_TYPE_ID_META_VideoCrop;
 	}
 }
 
@@ -69,7 +69,7 @@ static inline int spa_graph_impl_need_input(void *data, struct spa_graph_node *n
 				pport->io->buffer_id, pready, prequired);
 
 		if (prequired > 0 && pready >= prequired) {
-			pnode->state = spa_node_process_output(pnode->implementation);
+			pnode->state = spa_graph_node_process(pnode, SPA_DIRECTION_OUTPUT);
 
 			spa_debug("peer %p processed out %d", pnode, pnode->state);
 			if (pnode->state == SPA_STATUS_HAVE_BUFFER)
@@ -117,7 +117,7 @@ static inline int spa_graph_impl_have_output(void *data, struct spa_graph_node *
 				pport->io->buffer_id, pready, prequired);
 
 		if (prequired > 0 && pready >= prequired) {
-			pnode->state = spa_node_process_input(pnode->implementation);
+			pnode->state = spa_graph_node_process(pnode, SPA_DIRECTION_INPUT);
 
 			spa_debug("peer %p processed in %d", pnode, pnode->state);
 			if (pnode->state == SPA_STATUS_HAVE_BUFFER)
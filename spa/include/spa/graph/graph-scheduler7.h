@@ -0,0 +1,627 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_GRAPH_SCHEDULER_PLAN_H__
+#define __SPA_GRAPH_SCHEDULER_PLAN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <spa/graph/graph-scheduler6.h>
+
+/*
+ * Scheduler with a precompiled execution plan.
+ *
+ * It implements the same push/pull semantics as graph-scheduler6.h but
+ * instead of recursing into the peers on every cycle, the graph is sorted
+ * topologically whenever the graph version changes and compiled into a flat
+ * array of nodes with their ports in dense arrays.
+ *
+ * have_output and need_input then become a sweep over the plan, forwards
+ * for push and backwards for pull. The sweep only visits the nodes that were
+ * reached from the nodes it started from, they are marked in a bitmap in
+ * plan order. Nodes that produce data while pulling or that need data while
+ * pushing are queued and handled in a next sweep.
+ *
+ * When the graph has a cycle or does not fit in the memory of the plan, the
+ * plan can not be made and the recursive scheduler is used instead.
+ *
+ * Only the nodes of the graph are in the plan. A node belongs to the graph
+ * when its graph field points to it, links to nodes of other graphs are
+ * ignored.
+ *
+ * The memory of the plan is given by the caller, this header does not
+ * allocate.
+ *
+ * An executor can be installed to run the sweeps on more than one thread.
+ * It must call spa_graph_plan_visit() for the nodes that the sweep can
+ * reach from \a first, after the dependencies of the node were visited.
+ */
+
+#define SPA_GRAPH_PLAN_PUSH	0
+#define SPA_GRAPH_PLAN_PULL	1
+
+struct spa_graph_plan_edge {
+	struct spa_graph_port *port;	/**< port of the node */
+	uint32_t peer;			/**< plan index of the peer node or SPA_ID_INVALID */
+};
+
+struct spa_graph_plan_node {
+	struct spa_graph_node *node;	/**< the graph node */
+	uint32_t edges[2];		/**< index of the first input and output edge */
+	uint32_t n_edges[2];		/**< number of input and output edges */
+	uint32_t start[2];		/**< push/pull sweep that starts from this node */
+	uint32_t reached[2];		/**< last push/pull sweep that reached this node */
+	uint32_t n_deps[2];		/**< number of linked push/pull dependencies */
+	int32_t pending;		/**< dependencies to visit, for the executor,
+				  *  -1 when the sweep can't reach the node */
+};
+
+struct spa_graph_plan;
+
+struct spa_graph_plan_executor {
+#define SPA_VERSION_GRAPH_PLAN_EXECUTOR	0
+	uint32_t version;
+
+	/** run a push or pull sweep, starting from the plan index \a first */
+	int (*sweep) (void *data, struct spa_graph_plan *plan, int direction,
+		      uint32_t sweep, uint32_t first);
+};
+
+struct spa_graph_plan {
+	struct spa_graph *graph;	/**< the graph to schedule */
+	uint32_t version;		/**< graph version the plan was made for */
+	bool compiled;			/**< plan was made */
+	bool valid;			/**< plan can be used, graph has no cycles */
+	bool running;			/**< a sweep is in progress */
+	bool parallel;			/**< the executor runs the sweep */
+
+	struct spa_graph_plan_node *nodes;	/**< nodes in topological order */
+	uint32_t n_nodes;
+	uint32_t max_nodes;
+	uint32_t *scratch;		/**< space for sorting, 2 * max_nodes */
+	uint32_t *active[2];		/**< nodes to visit in the push/pull sweep,
+					  *  one bit per plan index */
+
+	struct spa_graph_plan_edge *edges;
+	uint32_t n_edges;
+	uint32_t max_edges;
+
+	uint32_t sweep[2];		/**< current push/pull sweep */
+	uint32_t first[2];		/**< first plan index for the next push/pull sweep */
+	bool pending[2];		/**< a push/pull sweep is pending */
+
+	const struct spa_graph_plan_executor *executor;
+	void *executor_data;
+};
+
+/* words of the bitmap of active nodes */
+#define SPA_GRAPH_PLAN_ACTIVE_WORDS(n_nodes)	(((n_nodes) + 31) / 32)
+
+/** The memory needed for a plan of \a max_nodes nodes and \a max_edges edges */
+#define SPA_GRAPH_PLAN_MEM_SIZE(max_nodes,max_edges)				\
+	((max_nodes) * sizeof(struct spa_graph_plan_node) +			\
+	 (max_edges) * sizeof(struct spa_graph_plan_edge) +			\
+	 2 * (max_nodes) * sizeof(uint32_t) +					\
+	 2 * SPA_GRAPH_PLAN_ACTIVE_WORDS(max_nodes) * sizeof(uint32_t))
+
+/** Initialize a plan for \a graph
+ * \param mem memory of SPA_GRAPH_PLAN_MEM_SIZE(max_nodes, max_edges) bytes,
+ *	aligned for a pointer. It is owned by the caller and must stay valid
+ *	until the plan is cleared.
+ * \param max_nodes the maximum number of nodes in the plan
+ * \param max_edges the maximum number of edges, one for every linked port
+ */
+static inline void spa_graph_plan_init(struct spa_graph_plan *plan,
+				       struct spa_graph *graph,
+				       void *mem, uint32_t max_nodes, uint32_t max_edges)
+{
+	memset(plan, 0, sizeof(struct spa_graph_plan));
+	plan->graph = graph;
+	plan->first[SPA_GRAPH_PLAN_PUSH] = SPA_ID_INVALID;
+
+	plan->nodes = mem;
+	plan->max_nodes = max_nodes;
+	plan->edges = SPA_MEMBER(plan->nodes, max_nodes * sizeof(struct spa_graph_plan_node),
+				 struct spa_graph_plan_edge);
+	plan->max_edges = max_edges;
+	plan->scratch = SPA_MEMBER(plan->edges, max_edges * sizeof(struct spa_graph_plan_edge),
+				   uint32_t);
+	plan->active[SPA_GRAPH_PLAN_PUSH] = plan->scratch + 2 * max_nodes;
+	plan->active[SPA_GRAPH_PLAN_PULL] = plan->active[SPA_GRAPH_PLAN_PUSH] +
+		SPA_GRAPH_PLAN_ACTIVE_WORDS(max_nodes);
+}
+
+static inline void
+spa_graph_plan_set_executor(struct spa_graph_plan *plan,
+			    const struct spa_graph_plan_executor *executor,
+			    void *data)
+{
+	plan->executor = executor;
+	plan->executor_data = data;
+}
+
+/** Clear the plan, after this the memory of the plan can be freed */
+static inline void spa_graph_plan_clear(struct spa_graph_plan *plan)
+{
+	plan->nodes = NULL;
+	plan->scratch = NULL;
+	plan->active[SPA_GRAPH_PLAN_PUSH] = plan->active[SPA_GRAPH_PLAN_PULL] = NULL;
+	plan->edges = NULL;
+	plan->n_nodes = plan->max_nodes = 0;
+	plan->n_edges = plan->max_edges = 0;
+	plan->compiled = false;
+	plan->valid = false;
+}
+
+static inline uint32_t
+spa_graph_plan_find(struct spa_graph_plan *plan, struct spa_graph_node *node)
+{
+	uint32_t index = (uint32_t) (uintptr_t) node->scheduler_data;
+
+	if (index < plan->n_nodes && plan->nodes[index].node == node)
+		return index;
+	return SPA_ID_INVALID;
+}
+
+static inline int
+spa_graph_plan_add_node(struct spa_graph_plan *plan, struct spa_graph_node *node)
+{
+	struct spa_graph_plan_node *pn;
+
+	if (spa_graph_plan_find(plan, node) != SPA_ID_INVALID)
+		return 0;
+
+	if (plan->n_nodes == plan->max_nodes)
+		return -ENOSPC;
+
+	pn = &plan->nodes[plan->n_nodes];
+	memset(pn, 0, sizeof(struct spa_graph_plan_node));
+	pn->node = node;
+	node->scheduler_data = (void *) (uintptr_t) plan->n_nodes++;
+
+	return 0;
+}
+
+/* the peer node of a port when it belongs to the graph of the plan */
+static inline struct spa_graph_node *
+spa_graph_plan_peer_node(struct spa_graph_plan *plan, struct spa_graph_port *port)
+{
+	struct spa_graph_node *peer;
+
+	if (port->peer == NULL || (peer = port->peer->node) == NULL ||
+	    peer->graph != plan->graph)
+		return NULL;
+	return peer;
+}
+
+static inline int
+spa_graph_plan_add_edges(struct spa_graph_plan *plan, struct spa_graph_plan_node *pn,
+			 enum spa_direction direction)
+{
+	struct spa_graph_port *p;
+	struct spa_graph_node *peer;
+
+	pn->edges[direction] = plan->n_edges;
+	pn->n_edges[direction] = 0;
+
+	spa_list_for_each(p, &pn->node->ports[direction], link) {
+		struct spa_graph_plan_edge *e;
+
+		if (plan->n_edges == plan->max_edges)
+			return -ENOSPC;
+		e = &plan->edges[plan->n_edges++];
+		e->port = p;
+		e->peer = (peer = spa_graph_plan_peer_node(plan, p)) ?
+			spa_graph_plan_find(plan, peer) : SPA_ID_INVALID;
+		pn->n_edges[direction]++;
+		/* the inputs are what a push waits for, the outputs a pull */
+		if (e->peer != SPA_ID_INVALID)
+			pn->n_deps[direction == SPA_DIRECTION_INPUT ?
+				SPA_GRAPH_PLAN_PUSH : SPA_GRAPH_PLAN_PULL]++;
+	}
+	return 0;
+}
+
+/** Sort the graph topologically and make the plan. Nodes of the graph that are
+ * not in the node list of the graph but are linked to nodes in the list are
+ * added to the plan as well */
+static inline int spa_graph_plan_compile(struct spa_graph_plan *plan)
+{
+	struct spa_graph *graph = plan->graph;
+	struct spa_graph_node *n, *peer;
+	struct spa_graph_port *p;
+	uint32_t i, j, head, tail, *order, *degree;
+	int res, d;
+
+	plan->compiled = true;
+	plan->valid = false;
+	plan->version = graph->version;
+	plan->n_nodes = 0;
+	plan->n_edges = 0;
+	plan->pending[SPA_GRAPH_PLAN_PUSH] = plan->pending[SPA_GRAPH_PLAN_PULL] = false;
+	plan->first[SPA_GRAPH_PLAN_PUSH] = SPA_ID_INVALID;
+	plan->first[SPA_GRAPH_PLAN_PULL] = 0;
+	for (d = 0; d < 2; d++)
+		memset(plan->active[d], 0,
+		       SPA_GRAPH_PLAN_ACTIVE_WORDS(plan->max_nodes) * sizeof(uint32_t));
+
+	spa_list_for_each(n, &graph->nodes, link) {
+		if ((res = spa_graph_plan_add_node(plan, n)) < 0)
+			return res;
+	}
+	for (i = 0; i < plan->n_nodes; i++) {
+		for (d = 0; d < 2; d++) {
+			spa_list_for_each(p, &plan->nodes[i].node->ports[d], link) {
+				if ((peer = spa_graph_plan_peer_node(plan, p)) == NULL)
+					continue;
+				if ((res = spa_graph_plan_add_node(plan, peer)) < 0)
+					return res;
+			}
+		}
+	}
+
+	/* Kahn's algorithm, data flows from the output ports to the input ports */
+	order = plan->scratch;
+	degree = plan->scratch + plan->max_nodes;
+	for (i = 0, tail = 0; i < plan->n_nodes; i++) {
+		degree[i] = 0;
+		spa_list_for_each(p, &plan->nodes[i].node->ports[SPA_DIRECTION_INPUT], link) {
+			if (spa_graph_plan_peer_node(plan, p) != NULL)
+				degree[i]++;
+		}
+		if (degree[i] == 0)
+			order[tail++] = i;
+	}
+	for (head = 0; head < tail; head++) {
+		n = plan->nodes[order[head]].node;
+		spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
+			if ((peer = spa_graph_plan_peer_node(plan, p)) == NULL)
+				continue;
+			j = spa_graph_plan_find(plan, peer);
+			if (degree[j] > 0 && --degree[j] == 0)
+				order[tail++] = j;
+		}
+	}
+	if (tail < plan->n_nodes) {
+		spa_debug("plan %p: graph has a cycle", plan);
+		return 0;
+	}
+
+	/* permute the nodes in place into the sorted order, degree is reused
+	 * to mark the visited positions */
+	for (i = 0; i < plan->n_nodes; i++)
+		degree[i] = 0;
+	for (i = 0; i < plan->n_nodes; i++) {
+		if (degree[i])
+			continue;
+		n = plan->nodes[i].node;
+		for (j = i; order[j] != i; j = order[j]) {
+			plan->nodes[j].node = plan->nodes[order[j]].node;
+			degree[j] = 1;
+		}
+		plan->nodes[j].node = n;
+		degree[j] = 1;
+	}
+	for (i = 0; i < plan->n_nodes; i++)
+		plan->nodes[i].node->scheduler_data = (void *) (uintptr_t) i;
+
+	for (i = 0; i < plan->n_nodes; i++) {
+		if ((res = spa_graph_plan_add_edges(plan, &plan->nodes[i], SPA_DIRECTION_INPUT)) < 0 ||
+		    (res = spa_graph_plan_add_edges(plan, &plan->nodes[i], SPA_DIRECTION_OUTPUT)) < 0)
+			return res;
+	}
+	plan->valid = true;
+
+	spa_debug("plan %p: compiled %d nodes %d edges", plan, plan->n_nodes, plan->n_edges);
+	return 0;
+}
+
+static inline bool spa_graph_plan_ensure(struct spa_graph_plan *plan)
+{
+	if (!plan->running &&
+	    (!plan->compiled || plan->version != plan->graph->version)) {
+		int res;
+		if ((res = spa_graph_plan_compile(plan)) < 0) {
+			spa_debug("plan %p: can't make plan: %d", plan, res);
+			plan->valid = false;
+		}
+	}
+	return plan->valid;
+}
+
+/* mark a node reached by the sweep, the executor visits the nodes itself */
+static inline void
+spa_graph_plan_activate(struct spa_graph_plan *plan, uint32_t index, int sweep)
+{
+	if (!plan->parallel)
+		plan->active[sweep][index >> 5] |= 1u << (index & 31);
+}
+
+/* Can be called from the executor threads while a sweep is running, the
+ * atomic operations are only needed then */
+static inline void
+spa_graph_plan_request(struct spa_graph_plan *plan, uint32_t index, int sweep)
+{
+	uint32_t first;
+
+	plan->nodes[index].start[sweep] = plan->sweep[sweep] + 1;
+
+	if (!plan->parallel) {
+		plan->active[sweep][index >> 5] |= 1u << (index & 31);
+		first = plan->first[sweep];
+		if (sweep == SPA_GRAPH_PLAN_PUSH ? index < first : index > first)
+			plan->first[sweep] = index;
+		plan->pending[sweep] = true;
+		return;
+	}
+
+	__atomic_fetch_or(&plan->active[sweep][index >> 5], 1u << (index & 31), __ATOMIC_RELAXED);
+
+	first = __atomic_load_n(&plan->first[sweep], __ATOMIC_RELAXED);
+	while (sweep == SPA_GRAPH_PLAN_PUSH ? index < first : index > first) {
+		if (__atomic_compare_exchange_n(&plan->first[sweep], &first, index, false,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+	__atomic_store_n(&plan->pending[sweep], true, __ATOMIC_RELEASE);
+}
+
+/* what have_output does for one node */
+static inline void
+spa_graph_plan_push_outputs(struct spa_graph_plan *plan, struct spa_graph_plan_node *pn,
+			    uint32_t sweep)
+{
+	struct spa_graph_node *node = pn->node;
+	struct spa_graph_plan_edge *e = &plan->edges[pn->edges[SPA_DIRECTION_OUTPUT]];
+	uint32_t i, n_edges = pn->n_edges[SPA_DIRECTION_OUTPUT], required = 0;
+
+	for (i = 0; i < n_edges; i++) {
+		if (e[i].port->io->status == SPA_STATUS_HAVE_BUFFER &&
+		    !(e[i].port->flags & SPA_PORT_INFO_FLAG_OPTIONAL))
+			required++;
+	}
+	node->required[SPA_DIRECTION_OUTPUT] = required;
+	node->ready[SPA_DIRECTION_OUTPUT] = 0;
+
+	for (i = 0; i < n_edges; i++) {
+		struct spa_graph_port *pport = e[i].port->peer;
+		struct spa_graph_plan_node *ppn;
+
+		if (e[i].peer == SPA_ID_INVALID || pport == NULL ||
+		    (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		ppn = &plan->nodes[e[i].peer];
+		if (pport->io->status == SPA_STATUS_HAVE_BUFFER) {
+			if (plan->parallel)
+				__atomic_fetch_add(&ppn->node->ready[SPA_DIRECTION_INPUT], 1, __ATOMIC_RELAXED);
+			else
+				ppn->node->ready[SPA_DIRECTION_INPUT]++;
+		}
+		__atomic_store_n(&ppn->reached[SPA_GRAPH_PLAN_PUSH], sweep, __ATOMIC_RELAXED);
+		spa_graph_plan_activate(plan, e[i].peer, SPA_GRAPH_PLAN_PUSH);
+	}
+}
+
+/* what need_input does for one node */
+static inline void
+spa_graph_plan_pull_inputs(struct spa_graph_plan *plan, struct spa_graph_plan_node *pn,
+			   uint32_t sweep)
+{
+	struct spa_graph_node *node = pn->node;
+	struct spa_graph_plan_edge *e = &plan->edges[pn->edges[SPA_DIRECTION_INPUT]];
+	uint32_t i, n_edges = pn->n_edges[SPA_DIRECTION_INPUT], required = 0;
+
+	for (i = 0; i < n_edges; i++) {
+		if (e[i].port->io->status == SPA_STATUS_NEED_BUFFER)
+			required++;
+	}
+	node->required[SPA_DIRECTION_INPUT] = required;
+	node->ready[SPA_DIRECTION_INPUT] = 0;
+
+	for (i = 0; i < n_edges; i++) {
+		struct spa_graph_port *pport = e[i].port->peer;
+		struct spa_graph_plan_node *ppn;
+
+		if (e[i].peer == SPA_ID_INVALID || pport == NULL ||
+		    (pport->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+			continue;
+
+		ppn = &plan->nodes[e[i].peer];
+		if (pport->io->status == SPA_STATUS_NEED_BUFFER) {
+			if (plan->parallel)
+				__atomic_fetch_add(&ppn->node->ready[SPA_DIRECTION_OUTPUT], 1, __ATOMIC_RELAXED);
+			else
+				ppn->node->ready[SPA_DIRECTION_OUTPUT]++;
+		}
+		__atomic_store_n(&ppn->reached[SPA_GRAPH_PLAN_PULL], sweep, __ATOMIC_RELAXED);
+		spa_graph_plan_activate(plan, e[i].peer, SPA_GRAPH_PLAN_PULL);
+	}
+}
+
+/** Visit one node in a push or pull sweep. When the sweep starts from the node
+ * or when the node was reached and has all the data it needs, the node is
+ * processed and the sweep continues to its peers. */
+static inline void
+spa_graph_plan_visit(struct spa_graph_plan *plan, uint32_t index, int direction, uint32_t sweep)
+{
+	struct spa_graph_plan_node *pn = &plan->nodes[index];
+	struct spa_graph_node *n = pn->node;
+
+	if (direction == SPA_GRAPH_PLAN_PUSH) {
+		if (pn->start[SPA_GRAPH_PLAN_PUSH] != sweep) {
+			if (__atomic_load_n(&pn->reached[SPA_GRAPH_PLAN_PUSH], __ATOMIC_RELAXED) != sweep ||
+			    n->required[SPA_DIRECTION_INPUT] == 0 ||
+			    n->ready[SPA_DIRECTION_INPUT] < n->required[SPA_DIRECTION_INPUT])
+				return;
+
+			n->state = spa_graph_node_process(n, SPA_DIRECTION_INPUT);
+			spa_debug("plan %p: node %p processed in %d", plan, n, n->state);
+
+			if (n->state == SPA_STATUS_NEED_BUFFER)
+				spa_graph_plan_request(plan, index, SPA_GRAPH_PLAN_PULL);
+			if (n->state != SPA_STATUS_HAVE_BUFFER)
+				return;
+		}
+		spa_graph_plan_push_outputs(plan, pn, sweep);
+	} else {
+		if (pn->start[SPA_GRAPH_PLAN_PULL] != sweep) {
+			if (__atomic_load_n(&pn->reached[SPA_GRAPH_PLAN_PULL], __ATOMIC_RELAXED) != sweep ||
+			    n->required[SPA_DIRECTION_OUTPUT] == 0 ||
+			    n->ready[SPA_DIRECTION_OUTPUT] < n->required[SPA_DIRECTION_OUTPUT])
+				return;
+
+			n->state = spa_graph_node_process(n, SPA_DIRECTION_OUTPUT);
+			spa_debug("plan %p: node %p processed out %d", plan, n, n->state);
+
+			if (n->state == SPA_STATUS_HAVE_BUFFER)
+				spa_graph_plan_request(plan, index, SPA_GRAPH_PLAN_PUSH);
+			if (n->state != SPA_STATUS_NEED_BUFFER)
+				return;
+		}
+		spa_graph_plan_pull_inputs(plan, pn, sweep);
+	}
+}
+
+/* let the executor run the sweep, the marks of the nodes it starts from are
+ * not needed then */
+static inline bool
+spa_graph_plan_execute(struct spa_graph_plan *plan, int direction, uint32_t sweep, uint32_t first)
+{
+	int res;
+
+	if (plan->executor == NULL)
+		return false;
+
+	plan->parallel = true;
+	res = plan->executor->sweep(plan->executor_data, plan, direction, sweep, first);
+	plan->parallel = false;
+
+	if (res == 0)
+		memset(plan->active[direction], 0,
+		       SPA_GRAPH_PLAN_ACTIVE_WORDS(plan->n_nodes) * sizeof(uint32_t));
+	return res == 0;
+}
+
+/* The marked nodes are visited in plan order. A visit marks the peers that
+ * come after it, the word of the bitmap is read again after each visit. */
+static inline void spa_graph_plan_push(struct spa_graph_plan *plan)
+{
+	uint32_t w, i, bits, first, sweep = ++plan->sweep[SPA_GRAPH_PLAN_PUSH];
+	uint32_t *active = plan->active[SPA_GRAPH_PLAN_PUSH];
+
+	first = plan->first[SPA_GRAPH_PLAN_PUSH];
+	plan->first[SPA_GRAPH_PLAN_PUSH] = SPA_ID_INVALID;
+	__atomic_store_n(&plan->pending[SPA_GRAPH_PLAN_PUSH], false, __ATOMIC_RELEASE);
+
+	if (spa_graph_plan_execute(plan, SPA_GRAPH_PLAN_PUSH, sweep, first))
+		return;
+
+	for (w = first >> 5; w < SPA_GRAPH_PLAN_ACTIVE_WORDS(plan->n_nodes); w++) {
+		while ((bits = active[w]) != 0) {
+			i = __builtin_ctz(bits);
+			active[w] = bits & ~(1u << i);
+			spa_graph_plan_visit(plan, (w << 5) + i, SPA_GRAPH_PLAN_PUSH, sweep);
+		}
+	}
+}
+
+static inline void spa_graph_plan_pull(struct spa_graph_plan *plan)
+{
+	uint32_t w, i, bits, first, sweep = ++plan->sweep[SPA_GRAPH_PLAN_PULL];
+	uint32_t *active = plan->active[SPA_GRAPH_PLAN_PULL];
+
+	first = plan->first[SPA_GRAPH_PLAN_PULL];
+	plan->first[SPA_GRAPH_PLAN_PULL] = 0;
+	__atomic_store_n(&plan->pending[SPA_GRAPH_PLAN_PULL], false, __ATOMIC_RELEASE);
+
+	if (spa_graph_plan_execute(plan, SPA_GRAPH_PLAN_PULL, sweep, first))
+		return;
+
+	for (w = (first >> 5) + 1; w-- > 0;) {
+		while ((bits = active[w]) != 0) {
+			i = 31 - __builtin_clz(bits);
+			active[w] = bits & ~(1u << i);
+			spa_graph_plan_visit(plan, (w << 5) + i, SPA_GRAPH_PLAN_PULL, sweep);
+		}
+	}
+}
+
+static inline int spa_graph_plan_run(struct spa_graph_plan *plan)
+{
+	/* requests made while running are picked up by the loop below */
+	if (plan->running)
+		return 0;
+
+	plan->running = true;
+	while (plan->pending[SPA_GRAPH_PLAN_PUSH] || plan->pending[SPA_GRAPH_PLAN_PULL]) {
+		if (plan->pending[SPA_GRAPH_PLAN_PUSH])
+			spa_graph_plan_push(plan);
+		if (plan->pending[SPA_GRAPH_PLAN_PULL])
+			spa_graph_plan_pull(plan);
+	}
+	plan->running = false;
+
+	return 0;
+}
+
+static inline int spa_graph_plan_need_input(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_plan *plan = data;
+	uint32_t index;
+
+	if (!spa_graph_plan_ensure(plan) ||
+	    (index = spa_graph_plan_find(plan, node)) == SPA_ID_INVALID)
+		return spa_graph_impl_need_input(data, node);
+
+	spa_debug("plan %p: node %p start pull", plan, node);
+	spa_graph_plan_request(plan, index, SPA_GRAPH_PLAN_PULL);
+	return spa_graph_plan_run(plan);
+}
+
+static inline int spa_graph_plan_have_output(void *data, struct spa_graph_node *node)
+{
+	struct spa_graph_plan *plan = data;
+	uint32_t index;
+
+	if (!spa_graph_plan_ensure(plan) ||
+	    (index = spa_graph_plan_find(plan, node)) == SPA_ID_INVALID)
+		return spa_graph_impl_have_output(data, node);
+
+	spa_debug("plan %p: node %p start push", plan, node);
+	spa_graph_plan_request(plan, index, SPA_GRAPH_PLAN_PUSH);
+	return spa_graph_plan_run(plan);
+}
+
+static const struct spa_graph_callbacks spa_graph_impl_plan = {
+	SPA_VERSION_GRAPH_CALLBACKS,
+	.need_input = spa_graph_plan_need_input,
+	.have_output = spa_graph_plan_have_output,
+};
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_GRAPH_SCHEDULER_PLAN_H__ */
@@ -24,6 +24,9 @@
 extern "C" {
 #endif
 
+#include <errno.h>
+#include <time.h>
+
 #include <spa/utils/defs.h>
 #include <spa/utils/list.h>
 #include <spa/node/node.h>
@@ -49,12 +52,30 @@ struct spa_graph {
 	struct spa_list nodes;
 	const struct spa_graph_callbacks *callbacks;
 	void *callbacks_data;
+	uint32_t version;		/**< incremented when nodes, ports or links change */
 };
 
 #define spa_graph_need_input(g,n)	((g)->callbacks->need_input((g)->callbacks_data, (n)))
 #define spa_graph_have_output(g,n)	((g)->callbacks->have_output((g)->callbacks_data, (n)))
 #define spa_graph_reuse_buffer(g,n,p,i)	((g)->callbacks->reuse_buffer((g)->callbacks_data, (n),(p),(i)))
 
+/**
+ * Timing of a node. When a node has one, the schedulers update it every
+ * time the node processes. Readers in other threads or processes should
+ * use spa_graph_node_timing_read() to get a consistent copy.
+ */
+struct spa_graph_node_timing {
+	uint32_t seq;			/**< odd while the timing is updated */
+	uint32_t xruns;			/**< number of xruns */
+	uint64_t signal_time;		/**< when the node was ready to process */
+	uint64_t awake_time;		/**< when the node started to process */
+	uint64_t finish_time;		/**< when the node finished processing */
+	uint64_t cycles;		/**< number of times the node processed */
+	uint64_t min_time;		/**< shortest process time */
+	uint64_t max_time;		/**< longest process time */
+	uint64_t total_time;		/**< total process time */
+};
+
 struct spa_graph_node {
 	struct spa_list link;		/**< link in graph nodes list */
 	struct spa_graph *graph;	/**< owner graph */
@@ -67,6 +88,8 @@ struct spa_graph_node {
 	int state;			/**< state of the node */
 	struct spa_node *implementation;/**< node implementation */
 	void *scheduler_data;		/**< scheduler private data */
+	struct spa_graph_node_timing *timing;	/**< timing of the node or NULL */
+	uint64_t signal_time;		/**< when the node was made ready, for the timing */
 };
 
 struct spa_graph_port {
@@ -84,6 +107,7 @@ struct spa_graph_port {
 static inline void spa_graph_init(struct spa_graph *graph)
 {
 	spa_list_init(&graph->nodes);
+	graph->version = 0;
 }
 
 static inline void
@@ -100,9 +124,12 @@ spa_graph_node_init(struct spa_graph_node *node)
 {
 	spa_list_init(&node->ports[SPA_DIRECTION_INPUT]);
 	spa_list_init(&node->ports[SPA_DIRECTION_OUTPUT]);
+	node->graph = NULL;
 	node->flags = 0;
 	node->required[SPA_DIRECTION_INPUT] = node->ready[SPA_DIRECTION_INPUT] = 0;
 	node->required[SPA_DIRECTION_OUTPUT] = node->ready[SPA_DIRECTION_OUTPUT] = 0;
+	node->timing = NULL;
+	node->signal_time = 0;
 	spa_debug("node %p init", node);
 }
 
@@ -113,6 +140,118 @@ spa_graph_node_set_implementation(struct spa_graph_node *node,
 	node->implementation = implementation;
 }
 
+static inline uint64_t spa_graph_get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_TIME(&now);
+}
+
+/** Remember when \a node was made ready when it has a timing */
+static inline void spa_graph_node_signal(struct spa_graph_node *node)
+{
+	if (SPA_UNLIKELY(node->timing != NULL))
+		node->signal_time = spa_graph_get_time();
+}
+
+static inline void
+spa_graph_node_timing_update(struct spa_graph_node_timing *t, uint64_t signal,
+			     uint64_t awake, uint64_t finish, bool xrun)
+{
+	uint64_t elapsed = finish - awake;
+	uint32_t seq = t->seq;
+
+	__atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	t->signal_time = signal;
+	t->awake_time = awake;
+	t->finish_time = finish;
+	if (t->cycles == 0 || elapsed < t->min_time)
+		t->min_time = elapsed;
+	if (elapsed > t->max_time)
+		t->max_time = elapsed;
+	t->total_time += elapsed;
+	t->cycles++;
+	if (xrun)
+		t->xruns++;
+
+	__atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/** Count an xrun that was reported by the node outside of the timing update */
+static inline void spa_graph_node_timing_xrun(struct spa_graph_node_timing *t)
+{
+	uint32_t seq = t->seq;
+
+	__atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	t->xruns++;
+	__atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/** number of times spa_graph_node_timing_read() tries to read the timing */
+#define SPA_GRAPH_NODE_TIMING_READ_RETRIES	1024
+
+/**
+ * Get a consistent copy of a timing that is updated by another thread
+ *
+ * \param t a timing
+ * \param copy the copy of \a t
+ * \return 0 on success or -EBUSY when the timing was updated during
+ *	all the tries, the writer may have died in the middle of an update
+ */
+static inline int
+spa_graph_node_timing_read(const struct spa_graph_node_timing *t,
+			   struct spa_graph_node_timing *copy)
+{
+	uint32_t seq, retries;
+
+	for (retries = 0; retries < SPA_GRAPH_NODE_TIMING_READ_RETRIES; retries++) {
+		if ((seq = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE)) & 1)
+			continue;
+		memcpy(copy, t, sizeof(*copy));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&t->seq, __ATOMIC_RELAXED) == seq)
+			return 0;
+	}
+	return -EBUSY;
+}
+
+/**
+ * Let \a node process its input or output and update its timing.
+ * A node that fails to process counts as an xrun.
+ *
+ * \param node a spa_graph_node
+ * \param direction SPA_DIRECTION_INPUT to process input, else output
+ * \return the result of the process function
+ */
+static inline int
+spa_graph_node_process(struct spa_graph_node *node, enum spa_direction direction)
+{
+	struct spa_graph_node_timing *t = node->timing;
+	uint64_t signal, awake;
+	int res;
+
+	if (SPA_LIKELY(t == NULL)) {
+		return direction == SPA_DIRECTION_INPUT ?
+			spa_node_process_input(node->implementation) :
+			spa_node_process_output(node->implementation);
+	}
+
+	awake = spa_graph_get_time();
+	res = direction == SPA_DIRECTION_INPUT ?
+		spa_node_process_input(node->implementation) :
+		spa_node_process_output(node->implementation);
+
+	signal = node->signal_time ? node->signal_time : awake;
+	node->signal_time = 0;
+	spa_graph_node_timing_update(t, signal, awake, spa_graph_get_time(), res < 0);
+
+	return res;
+}
+
 static inline void
 spa_graph_node_add(struct spa_graph *graph,
 		   struct spa_graph_node *node)
@@ -121,6 +260,7 @@ spa_graph_node_add(struct spa_graph *graph,
 	node->state = SPA_STATUS_OK;
 	node->ready_link.next = NULL;
 	spa_list_append(&graph->nodes, &node->link);
+	graph->version++;
 	spa_debug("node %p add", node);
 }
 
@@ -132,6 +272,7 @@ spa_graph_port_init(struct spa_graph_port *port,
 		    struct spa_io_buffers *io)
 {
 	spa_debug("port %p init type %d id %d", port, direction, port_id);
+	port->node = NULL;
 	port->direction = direction;
 	port->port_id = port_id;
 	port->flags = flags;
@@ -147,6 +288,8 @@ spa_graph_port_add(struct spa_graph_node *node,
 	spa_list_append(&node->ports[port->direction], &port->link);
 	if (!(port->flags & SPA_PORT_INFO_FLAG_OPTIONAL))
 		node->required[port->direction]++;
+	if (node->graph)
+		node->graph->version++;
 }
 
 static inline void spa_graph_node_remove(struct spa_graph_node *node)
@@ -155,6 +298,7 @@ static inline void spa_graph_node_remove(struct spa_graph_node *node)
 	spa_list_remove(&node->link);
 	if (node->ready_link.next)
 		spa_list_remove(&node->ready_link);
+	node->graph->version++;
 }
 
 static inline void spa_graph_port_remove(struct spa_graph_port *port)
@@ -165,6 +309,14 @@ static inline void spa_graph_port_remove(struct spa_graph_port *port)
 	    port->node->required[port->direction] > 0) {
 		port->node->required[port->direction]--;
 	}
+	if (port->node->graph)
+		port->node->graph->version++;
+}
+
+static inline void spa_graph_port_changed(struct spa_graph_port *port)
+{
+	if (port->node && port->node->graph)
+		port->node->graph->version++;
 }
 
 static inline void
@@ -173,6 +325,8 @@ spa_graph_port_link(struct spa_graph_port *out, struct spa_graph_port *in)
 	spa_debug("port %p link to %p", out, in);
 	out->peer = in;
 	in->peer = out;
+	spa_graph_port_changed(out);
+	spa_graph_port_changed(in);
 }
 
 static inline void
@@ -180,6 +334,8 @@ spa_graph_port_unlink(struct spa_graph_port *port)
 {
 	spa_debug("port %p unlink from %p", port, port->peer);
 	if (port->peer) {
+		spa_graph_port_changed(port->peer);
+		spa_graph_port_changed(port);
 		port->peer->peer = NULL;
 		port->peer = NULL;
 	}
@@ -78,9 +78,9 @@ struct spa_type_io {
 static inline void spa_type_io_map(struct spa_type_map *map, struct spa_type_io *type)
 {
 	if (type->Buffers == 0) {
-		type->Buffers = spa_type_map_get_id(map, SPA_TYPE_IO__Buffers);
-		type->ControlRange = spa_type_map_get_id(map, SPA_TYPE_IO_CONTROL__Range);
-		type->Prop = spa_type_map_get_id(map, SPA_TYPE_IO__Prop);
+		type->Buffers = SPA_TYPE_ID_IO_Buffers;
+		type->ControlRange = SPA_TYPE_ID_IO_ControlRange;
+		type->Prop = SPA_TYPE_ID_IO_Prop;
 	}
 }
 
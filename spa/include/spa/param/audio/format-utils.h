@@ -41,12 +41,12 @@ static inline void
 spa_type_format_audio_map(struct spa_type_map *map, struct spa_type_format_audio *type)
 {
 	if (type->format == 0) {
-		type->format = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__format);
-		type->flags = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__flags);
-		type->layout = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__layout);
-		type->rate = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__rate);
-		type->channels = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__channels);
-		type->channel_mask = spa_type_map_get_id(map, SPA_TYPE_FORMAT_AUDIO__channelMask);
+		type->format = SPA_TYPE_ID_FORMAT_AUDIO_format;
+		type->flags = SPA_TYPE_ID_FORMAT_AUDIO_flags;
+		type->layout = SPA_TYPE_ID_FORMAT_AUDIO_layout;
+		type->rate = SPA_TYPE_ID_FORMAT_AUDIO_rate;
+		type->channels = SPA_TYPE_ID_FORMAT_AUDIO_channels;
+		type->channel_mask = SPA_TYPE_ID_FORMAT_AUDIO_channel_mask;
 	}
 }
 
@@ -75,40 +75,40 @@ spa_type_audio_format_map(struct spa_type_map *map, struct spa_type_audio_format
 {
 	if (type->ENCODED == 0) {
 		type->UNKNOWN = 0;
-		type->ENCODED = spa_type_map_get_id(map, SPA_TYPE_AUDIO_FORMAT__ENCODED);
+		type->ENCODED = SPA_TYPE_ID_AUDIO_FORMAT_ENCODED;
 
-		type->S8 = spa_type_map_get_id(map, SPA_TYPE_AUDIO_FORMAT__S8);
-		type->U8 = spa_type_map_get_id(map, SPA_TYPE_AUDIO_FORMAT__U8);
+		type->S8 = SPA_TYPE_ID_AUDIO_FORMAT_S8;
+		type->U8 = SPA_TYPE_ID_AUDIO_FORMAT_U8;
 
-		type->S16 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S16"));
-		type->U16 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U16"));
-		type->S24_32 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S24_32"));
-		type->U24_32 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U24_32"));
-		type->S32 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S32"));
-		type->U32 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U32"));
-		type->S24 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S24"));
-		type->U24 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U24"));
-		type->S20 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S20"));
-		type->U20 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U20"));
-		type->S18 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("S18"));
-		type->U18 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("U18"));
-		type->F32 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("F32"));
-		type->F64 = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_NE("F64"));
+		type->S16 = SPA_TYPE_ID_AUDIO_FORMAT_S16;
+		type->U16 = SPA_TYPE_ID_AUDIO_FORMAT_U16;
+		type->S24_32 = SPA_TYPE_ID_AUDIO_FORMAT_S24_32;
+		type->U24_32 = SPA_TYPE_ID_AUDIO_FORMAT_U24_32;
+		type->S32 = SPA_TYPE_ID_AUDIO_FORMAT_S32;
+		type->U32 = SPA_TYPE_ID_AUDIO_FORMAT_U32;
+		type->S24 = SPA_TYPE_ID_AUDIO_FORMAT_S24;
+		type->U24 = SPA_TYPE_ID_AUDIO_FORMAT_U24;
+		type->S20 = SPA_TYPE_ID_AUDIO_FORMAT_S20;
+		type->U20 = SPA_TYPE_ID_AUDIO_FORMAT_U20;
+		type->S18 = SPA_TYPE_ID_AUDIO_FORMAT_S18;
+		type->U18 = SPA_TYPE_ID_AUDIO_FORMAT_U18;
+		type->F32 = SPA_TYPE_ID_AUDIO_FORMAT_F32;
+		type->F64 = SPA_TYPE_ID_AUDIO_FORMAT_F64;
 
-		type->S16_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S16"));
-		type->U16_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U16"));
-		type->S24_32_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S24_32"));
-		type->U24_32_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U24_32"));
-		type->S32_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S32"));
-		type->U32_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U32"));
-		type->S24_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S24"));
-		type->U24_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U24"));
-		type->S20_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S20"));
-		type->U20_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U20"));
-		type->S18_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("S18"));
-		type->U18_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("U18"));
-		type->F32_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("F32"));
-		type->F64_OE = spa_type_map_get_id(map, _SPA_TYPE_AUDIO_FORMAT_OE("F64"));
+		type->S16_OE = SPA_TYPE_ID_AUDIO_FORMAT_S16_OE;
+		type->U16_OE = SPA_TYPE_ID_AUDIO_FORMAT_U16_OE;
+		type->S24_32_OE = SPA_TYPE_ID_AUDIO_FORMAT_S24_32_OE;
+		type->U24_32_OE = SPA_TYPE_ID_AUDIO_FORMAT_U24_32_OE;
+		type->S32_OE = SPA_TYPE_ID_AUDIO_FORMAT_S32_OE;
+		type->U32_OE = SPA_TYPE_ID_AUDIO_FORMAT_U32_OE;
+		type->S24_OE = SPA_TYPE_ID_AUDIO_FORMAT_S24_OE;
+		type->U24_OE = SPA_TYPE_ID_AUDIO_FORMAT_U24_OE;
+		type->S20_OE = SPA_TYPE_ID_AUDIO_FORMAT_S20_OE;
+		type->U20_OE = SPA_TYPE_ID_AUDIO_FORMAT_U20_OE;
+		type->S18_OE = SPA_TYPE_ID_AUDIO_FORMAT_S18_OE;
+		type->U18_OE = SPA_TYPE_ID_AUDIO_FORMAT_U18_OE;
+		type->F32_OE = SPA_TYPE_ID_AUDIO_FORMAT_F32_OE;
+		type->F64_OE = SPA_TYPE_ID_AUDIO_FORMAT_F64_OE;
 	}
 }
 
@@ -49,11 +49,11 @@ spa_type_param_buffers_map(struct spa_type_map *map,
 			   struct spa_type_param_buffers *type)
 {
 	if (type->Buffers == 0) {
-		type->Buffers = spa_type_map_get_id(map, SPA_TYPE_PARAM__Buffers);
-		type->size = spa_type_map_get_id(map, SPA_TYPE_PARAM_BUFFERS__size);
-		type->stride = spa_type_map_get_id(map, SPA_TYPE_PARAM_BUFFERS__stride);
-		type->buffers = spa_type_map_get_id(map, SPA_TYPE_PARAM_BUFFERS__buffers);
-		type->align = spa_type_map_get_id(map, SPA_TYPE_PARAM_BUFFERS__align);
+		type->Buffers = SPA_TYPE_ID_PARAM_BUFFERS_Buffers;
+		type->size = SPA_TYPE_ID_PARAM_BUFFERS_size;
+		type->stride = SPA_TYPE_ID_PARAM_BUFFERS_stride;
+		type->buffers = SPA_TYPE_ID_PARAM_BUFFERS_buffers;
+		type->align = SPA_TYPE_ID_PARAM_BUFFERS_align;
 	}
 }
 
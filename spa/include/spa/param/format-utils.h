@@ -42,11 +42,11 @@ static inline void
 spa_type_media_type_map(struct spa_type_map *map, struct spa_type_media_type *type)
 {
 	if (type->audio == 0) {
-		type->audio = spa_type_map_get_id(map, SPA_TYPE_MEDIA_TYPE__audio);
-		type->video = spa_type_map_get_id(map, SPA_TYPE_MEDIA_TYPE__video);
-		type->image = spa_type_map_get_id(map, SPA_TYPE_MEDIA_TYPE__image);
-		type->binary = spa_type_map_get_id(map, SPA_TYPE_MEDIA_TYPE__binary);
-		type->stream = spa_type_map_get_id(map, SPA_TYPE_MEDIA_TYPE__stream);
+		type->audio = SPA_TYPE_ID_MEDIA_TYPE_audio;
+		type->video = SPA_TYPE_ID_MEDIA_TYPE_video;
+		type->image = SPA_TYPE_ID_MEDIA_TYPE_image;
+		type->binary = SPA_TYPE_ID_MEDIA_TYPE_binary;
+		type->stream = SPA_TYPE_ID_MEDIA_TYPE_stream;
 	}
 }
 
@@ -58,7 +58,7 @@ static inline void
 spa_type_media_subtype_map(struct spa_type_map *map, struct spa_type_media_subtype *type)
 {
 	if (type->raw == 0) {
-		type->raw = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__raw);
+		type->raw = SPA_TYPE_ID_MEDIA_SUBTYPE_raw;
 	}
 }
 
@@ -84,20 +84,20 @@ spa_type_media_subtype_video_map(struct spa_type_map *map,
 				 struct spa_type_media_subtype_video *type)
 {
 	if (type->h264 == 0) {
-		type->h264 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__h264);
-		type->mjpg = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mjpg);
-		type->dv = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__dv);
-		type->mpegts = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mpegts);
-		type->h263 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__h263);
-		type->mpeg1 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mpeg1);
-		type->mpeg2 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mpeg2);
-		type->mpeg4 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mpeg4);
-		type->xvid = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__xvid);
-		type->vc1 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__vc1);
-		type->vp8 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__vp8);
-		type->vp9 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__vp9);
-		type->jpeg = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__jpeg);
-		type->bayer = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__bayer);
+		type->h264 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h264;
+		type->mjpg = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mjpg;
+		type->dv = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_dv;
+		type->mpegts = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpegts;
+		type->h263 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h263;
+		type->mpeg1 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg1;
+		type->mpeg2 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg2;
+		type->mpeg4 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg4;
+		type->xvid = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_xvid;
+		type->vc1 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vc1;
+		type->vp8 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp8;
+		type->vp9 = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp9;
+		type->jpeg = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_jpeg;
+		type->bayer = SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_bayer;
 	}
 }
 
@@ -122,19 +122,19 @@ spa_type_media_subtype_audio_map(struct spa_type_map *map,
 				 struct spa_type_media_subtype_audio *type)
 {
 	if (type->mp3 == 0) {
-		type->mp3 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__mp3);
-		type->aac = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__aac);
-		type->vorbis = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__vorbis);
-		type->wma = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__wma);
-		type->ra = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__ra);
-		type->sbc = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__sbc);
-		type->adpcm = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__adpcm);
-		type->g723 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__g723);
-		type->g726 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__g726);
-		type->g729 = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__g729);
-		type->amr = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__amr);
-		type->gsm = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__gsm);
-		type->midi = spa_type_map_get_id(map, SPA_TYPE_MEDIA_SUBTYPE__midi);
+		type->mp3 = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_mp3;
+		type->aac = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_aac;
+		type->vorbis = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_vorbis;
+		type->wma = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_wma;
+		type->ra = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_ra;
+		type->sbc = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_sbc;
+		type->adpcm = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_adpcm;
+		type->g723 = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g723;
+		type->g726 = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g726;
+		type->g729 = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g729;
+		type->amr = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_amr;
+		type->gsm = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_gsm;
+		type->midi = SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_midi;
 	}
 }
 
@@ -73,15 +73,15 @@ spa_type_param_io_map(struct spa_type_map *map,
 		      struct spa_type_param_io *type)
 {
 	if (type->id == 0) {
-		type->id = spa_type_map_get_id(map, SPA_TYPE_PARAM_IO__id);
-		type->size = spa_type_map_get_id(map, SPA_TYPE_PARAM_IO__size);
-		type->idBuffers = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID_IO__Buffers);
-		type->Buffers = spa_type_map_get_id(map, SPA_TYPE_PARAM_IO__Buffers);
-		type->idControl = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID_IO__Control);
-		type->Control = spa_type_map_get_id(map, SPA_TYPE_PARAM_IO__Control);
-		type->idPropsIn = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID_IO_PROPS__In);
-		type->idPropsOut = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID_IO_PROPS__Out);
-		type->Prop = spa_type_map_get_id(map, SPA_TYPE_PARAM_IO__Prop);
+		type->id = SPA_TYPE_ID_PARAM_IO_id;
+		type->size = SPA_TYPE_ID_PARAM_IO_size;
+		type->idBuffers = SPA_TYPE_ID_PARAM_IO_idBuffers;
+		type->Buffers = SPA_TYPE_ID_PARAM_IO_Buffers;
+		type->idControl = SPA_TYPE_ID_PARAM_IO_idControl;
+		type->Control = SPA_TYPE_ID_PARAM_IO_Control;
+		type->idPropsIn = SPA_TYPE_ID_PARAM_IO_idPropsIn;
+		type->idPropsOut = SPA_TYPE_ID_PARAM_IO_idPropsOut;
+		type->Prop = SPA_TYPE_ID_PARAM_IO_Prop;
 	}
 }
 
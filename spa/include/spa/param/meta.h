@@ -46,16 +46,9 @@ spa_type_param_meta_map(struct spa_type_map *map,
 			struct spa_type_param_meta *type)
 {
 	if (type->Meta == 0) {
-		size_t i;
-#define OFF(n) offsetof(struct spa_type_param_meta, n)
-		static struct { off_t offset; const char *type; } tab[] = {
-			{ OFF(Meta), SPA_TYPE_PARAM__Meta },
-			{ OFF(type), SPA_TYPE_PARAM_META__type },
-			{ OFF(size), SPA_TYPE_PARAM_META__size },
-		};
-#undef OFF
-		for (i = 0; i < SPA_N_ELEMENTS(tab); i++)
-			*SPA_MEMBER(type, tab[i].offset, uint32_t) = spa_type_map_get_id(map, tab[i].type);
+		type->Meta = SPA_TYPE_ID_PARAM_META_Meta;
+		type->type = SPA_TYPE_ID_PARAM_META_type;
+		type->size = SPA_TYPE_ID_PARAM_META_size;
 	}
 }
 
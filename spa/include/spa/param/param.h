@@ -108,20 +108,20 @@ spa_type_param_map(struct spa_type_map *map,
 		   struct spa_type_param *type)
 {
         if (type->idList == 0) {
-                type->idList = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__List);
-                type->List = spa_type_map_get_id(map, SPA_TYPE_PARAM__List);
-                type->listId = spa_type_map_get_id(map, SPA_TYPE_PARAM_LIST__id);
-                type->idPropInfo = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__PropInfo);
-                type->PropInfo = spa_type_map_get_id(map, SPA_TYPE_PARAM__PropInfo);
-		type->propId = spa_type_map_get_id(map, SPA_TYPE_PARAM_PROP_INFO__id);
-		type->propName = spa_type_map_get_id(map, SPA_TYPE_PARAM_PROP_INFO__name);
-		type->propType = spa_type_map_get_id(map, SPA_TYPE_PARAM_PROP_INFO__type);
-		type->propLabels = spa_type_map_get_id(map, SPA_TYPE_PARAM_PROP_INFO__labels);
-                type->idProps = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__Props);
-                type->idEnumFormat = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__EnumFormat);
-                type->idFormat = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__Format);
-                type->idBuffers = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__Buffers);
-                type->idMeta = spa_type_map_get_id(map, SPA_TYPE_PARAM_ID__Meta);
+                type->idList = SPA_TYPE_ID_PARAM_idList;
+                type->List = SPA_TYPE_ID_PARAM_List;
+                type->listId = SPA_TYPE_ID_PARAM_listId;
+                type->idPropInfo = SPA_TYPE_ID_PARAM_idPropInfo;
+                type->PropInfo = SPA_TYPE_ID_PARAM_PropInfo;
+		type->propId = SPA_TYPE_ID_PARAM_propId;
+		type->propName = SPA_TYPE_ID_PARAM_propName;
+		type->propType = SPA_TYPE_ID_PARAM_propType;
+		type->propLabels = SPA_TYPE_ID_PARAM_propLabels;
+                type->idProps = SPA_TYPE_ID_PARAM_idProps;
+                type->idEnumFormat = SPA_TYPE_ID_PARAM_idEnumFormat;
+                type->idFormat = SPA_TYPE_ID_PARAM_idFormat;
+                type->idBuffers = SPA_TYPE_ID_PARAM_idBuffers;
+                type->idMeta = SPA_TYPE_ID_PARAM_idMeta;
         }
 }
 
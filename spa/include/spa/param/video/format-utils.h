@@ -54,24 +54,24 @@ static inline void
 spa_type_format_video_map(struct spa_type_map *map, struct spa_type_format_video *type)
 {
 	if (type->format == 0) {
-		type->format = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__format);
-		type->size = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__size);
-		type->framerate = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__framerate);
-		type->max_framerate = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__maxFramerate);
-		type->views = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__views);
-		type->interlace_mode = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__interlaceMode);
-		type->pixel_aspect_ratio = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__pixelAspectRatio);
-		type->multiview_mode = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__multiviewMode);
-		type->multiview_flags = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__multiviewFlags);
-		type->chroma_site = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__chromaSite);
-		type->color_range = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__colorRange);
-		type->color_matrix = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__colorMatrix);
-		type->transfer_function = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__transferFunction);
-		type->color_primaries = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__colorPrimaries);
-		type->profile = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__profile);
-		type->level = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__level);
-		type->stream_format = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__streamFormat);
-		type->alignment = spa_type_map_get_id(map, SPA_TYPE_FORMAT_VIDEO__alignment);
+		type->format = SPA_TYPE_ID_FORMAT_VIDEO_format;
+		type->size = SPA_TYPE_ID_FORMAT_VIDEO_size;
+		type->framerate = SPA_TYPE_ID_FORMAT_VIDEO_framerate;
+		type->max_framerate = SPA_TYPE_ID_FORMAT_VIDEO_max_framerate;
+		type->views = SPA_TYPE_ID_FORMAT_VIDEO_views;
+		type->interlace_mode = SPA_TYPE_ID_FORMAT_VIDEO_interlace_mode;
+		type->pixel_aspect_ratio = SPA_TYPE_ID_FORMAT_VIDEO_pixel_aspect_ratio;
+		type->multiview_mode = SPA_TYPE_ID_FORMAT_VIDEO_multiview_mode;
+		type->multiview_flags = SPA_TYPE_ID_FORMAT_VIDEO_multiview_flags;
+		type->chroma_site = SPA_TYPE_ID_FORMAT_VIDEO_chroma_site;
+		type->color_range = SPA_TYPE_ID_FORMAT_VIDEO_color_range;
+		type->color_matrix = SPA_TYPE_ID_FORMAT_VIDEO_color_matrix;
+		type->transfer_function = SPA_TYPE_ID_FORMAT_VIDEO_transfer_function;
+		type->color_primaries = SPA_TYPE_ID_FORMAT_VIDEO_color_primaries;
+		type->profile = SPA_TYPE_ID_FORMAT_VIDEO_profile;
+		type->level = SPA_TYPE_ID_FORMAT_VIDEO_level;
+		type->stream_format = SPA_TYPE_ID_FORMAT_VIDEO_stream_format;
+		type->alignment = SPA_TYPE_ID_FORMAT_VIDEO_alignment;
 	}
 }
 
@@ -113,83 +113,83 @@ spa_type_video_format_map(struct spa_type_map *map, struct spa_type_video_format
 {
 	if (type->ENCODED == 0) {
 		type->UNKNOWN = 0;
-		type->ENCODED = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__ENCODED);
-		type->I420 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I420);
-		type->YV12 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__YV12);
-		type->YUY2 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__YUY2);
-		type->UYVY = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__UYVY);
-		type->AYUV = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__AYUV);
-		type->RGBx = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGBx);
-		type->BGRx = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__BGRx);
-		type->xRGB = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__xRGB);
-		type->xBGR = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__xBGR);
-		type->RGBA = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGBA);
-		type->BGRA = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__BGRA);
-		type->ARGB = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__ARGB);
-		type->ABGR = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__ABGR);
-		type->RGB = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGB);
-		type->BGR = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__BGR);
-		type->Y41B = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y41B);
-		type->Y42B = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y42B);
-		type->YVYU = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__YVYU);
-		type->Y444 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y444);
-		type->v210 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__v210);
-		type->v216 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__v216);
-		type->NV12 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV12);
-		type->NV21 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV21);
-		type->GRAY8 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GRAY8);
-		type->GRAY16_BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GRAY16_BE);
-		type->GRAY16_LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GRAY16_LE);
-		type->v308 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__v308);
-		type->RGB16 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGB16);
-		type->BGR16 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__BGR16);
-		type->RGB15 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGB15);
-		type->BGR15 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__BGR15);
-		type->UYVP = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__UYVP);
-		type->A420 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A420);
-		type->RGB8P = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__RGB8P);
-		type->YUV9 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__YUV9);
-		type->YVU9 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__YVU9);
-		type->IYU1 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__IYU1);
-		type->ARGB64 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__ARGB64);
-		type->AYUV64 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__AYUV64);
-		type->r210 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__r210);
-		type->I420_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I420_10BE);
-		type->I420_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I420_10LE);
-		type->I422_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I422_10BE);
-		type->I422_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I422_10LE);
-		type->Y444_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y444_10BE);
-		type->Y444_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y444_10LE);
-		type->GBR = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBR);
-		type->GBR_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBR_10BE);
-		type->GBR_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBR_10LE);
-		type->NV16 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV16);
-		type->NV24 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV24);
-		type->NV12_64Z32 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV12_64Z32);
-		type->A420_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A420_10BE);
-		type->A420_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A420_10LE);
-		type->A422_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A422_10BE);
-		type->A422_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A422_10LE);
-		type->A444_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A444_10BE);
-		type->A444_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__A444_10LE);
-		type->NV61 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__NV61);
-		type->P010_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__P010_10BE);
-		type->P010_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__P010_10LE);
-		type->IYU2 = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__IYU2);
-		type->VYUY = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__VYUY);
-		type->GBRA = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBRA);
-		type->GBRA_10BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBRA_10BE);
-		type->GBRA_10LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBRA_10LE);
-		type->GBR_12BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBR_12BE);
-		type->GBR_12LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBR_12LE);
-		type->GBRA_12BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBRA_12BE);
-		type->GBRA_12LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__GBRA_12LE);
-		type->I420_12BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I420_12BE);
-		type->I420_12LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I420_12LE);
-		type->I422_12BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I422_12BE);
-		type->I422_12LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__I422_12LE);
-		type->Y444_12BE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y444_12BE);
-		type->Y444_12LE = spa_type_map_get_id(map, SPA_TYPE_VIDEO_FORMAT__Y444_12LE);
+		type->ENCODED = SPA_TYPE_ID_VIDEO_FORMAT_ENCODED;
+		type->I420 = SPA_TYPE_ID_VIDEO_FORMAT_I420;
+		type->YV12 = SPA_TYPE_ID_VIDEO_FORMAT_YV12;
+		type->YUY2 = SPA_TYPE_ID_VIDEO_FORMAT_YUY2;
+		type->UYVY = SPA_TYPE_ID_VIDEO_FORMAT_UYVY;
+		type->AYUV = SPA_TYPE_ID_VIDEO_FORMAT_AYUV;
+		type->RGBx = SPA_TYPE_ID_VIDEO_FORMAT_RGBx;
+		type->BGRx = SPA_TYPE_ID_VIDEO_FORMAT_BGRx;
+		type->xRGB = SPA_TYPE_ID_VIDEO_FORMAT_xRGB;
+		type->xBGR = SPA_TYPE_ID_VIDEO_FORMAT_xBGR;
+		type->RGBA = SPA_TYPE_ID_VIDEO_FORMAT_RGBA;
+		type->BGRA = SPA_TYPE_ID_VIDEO_FORMAT_BGRA;
+		type->ARGB = SPA_TYPE_ID_VIDEO_FORMAT_ARGB;
+		type->ABGR = SPA_TYPE_ID_VIDEO_FORMAT_ABGR;
+		type->RGB = SPA_TYPE_ID_VIDEO_FORMAT_RGB;
+		type->BGR = SPA_TYPE_ID_VIDEO_FORMAT_BGR;
+		type->Y41B = SPA_TYPE_ID_VIDEO_FORMAT_Y41B;
+		type->Y42B = SPA_TYPE_ID_VIDEO_FORMAT_Y42B;
+		type->YVYU = SPA_TYPE_ID_VIDEO_FORMAT_YVYU;
+		type->Y444 = SPA_TYPE_ID_VIDEO_FORMAT_Y444;
+		type->v210 = SPA_TYPE_ID_VIDEO_FORMAT_v210;
+		type->v216 = SPA_TYPE_ID_VIDEO_FORMAT_v216;
+		type->NV12 = SPA_TYPE_ID_VIDEO_FORMAT_NV12;
+		type->NV21 = SPA_TYPE_ID_VIDEO_FORMAT_NV21;
+		type->GRAY8 = SPA_TYPE_ID_VIDEO_FORMAT_GRAY8;
+		type->GRAY16_BE = SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_BE;
+		type->GRAY16_LE = SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_LE;
+		type->v308 = SPA_TYPE_ID_VIDEO_FORMAT_v308;
+		type->RGB16 = SPA_TYPE_ID_VIDEO_FORMAT_RGB16;
+		type->BGR16 = SPA_TYPE_ID_VIDEO_FORMAT_BGR16;
+		type->RGB15 = SPA_TYPE_ID_VIDEO_FORMAT_RGB15;
+		type->BGR15 = SPA_TYPE_ID_VIDEO_FORMAT_BGR15;
+		type->UYVP = SPA_TYPE_ID_VIDEO_FORMAT_UYVP;
+		type->A420 = SPA_TYPE_ID_VIDEO_FORMAT_A420;
+		type->RGB8P = SPA_TYPE_ID_VIDEO_FORMAT_RGB8P;
+		type->YUV9 = SPA_TYPE_ID_VIDEO_FORMAT_YUV9;
+		type->YVU9 = SPA_TYPE_ID_VIDEO_FORMAT_YVU9;
+		type->IYU1 = SPA_TYPE_ID_VIDEO_FORMAT_IYU1;
+		type->ARGB64 = SPA_TYPE_ID_VIDEO_FORMAT_ARGB64;
+		type->AYUV64 = SPA_TYPE_ID_VIDEO_FORMAT_AYUV64;
+		type->r210 = SPA_TYPE_ID_VIDEO_FORMAT_r210;
+		type->I420_10BE = SPA_TYPE_ID_VIDEO_FORMAT_I420_10BE;
+		type->I420_10LE = SPA_TYPE_ID_VIDEO_FORMAT_I420_10LE;
+		type->I422_10BE = SPA_TYPE_ID_VIDEO_FORMAT_I422_10BE;
+		type->I422_10LE = SPA_TYPE_ID_VIDEO_FORMAT_I422_10LE;
+		type->Y444_10BE = SPA_TYPE_ID_VIDEO_FORMAT_Y444_10BE;
+		type->Y444_10LE = SPA_TYPE_ID_VIDEO_FORMAT_Y444_10LE;
+		type->GBR = SPA_TYPE_ID_VIDEO_FORMAT_GBR;
+		type->GBR_10BE = SPA_TYPE_ID_VIDEO_FORMAT_GBR_10BE;
+		type->GBR_10LE = SPA_TYPE_ID_VIDEO_FORMAT_GBR_10LE;
+		type->NV16 = SPA_TYPE_ID_VIDEO_FORMAT_NV16;
+		type->NV24 = SPA_TYPE_ID_VIDEO_FORMAT_NV24;
+		type->NV12_64Z32 = SPA_TYPE_ID_VIDEO_FORMAT_NV12_64Z32;
+		type->A420_10BE = SPA_TYPE_ID_VIDEO_FORMAT_A420_10BE;
+		type->A420_10LE = SPA_TYPE_ID_VIDEO_FORMAT_A420_10LE;
+		type->A422_10BE = SPA_TYPE_ID_VIDEO_FORMAT_A422_10BE;
+		type->A422_10LE = SPA_TYPE_ID_VIDEO_FORMAT_A422_10LE;
+		type->A444_10BE = SPA_TYPE_ID_VIDEO_FORMAT_A444_10BE;
+		type->A444_10LE = SPA_TYPE_ID_VIDEO_FORMAT_A444_10LE;
+		type->NV61 = SPA_TYPE_ID_VIDEO_FORMAT_NV61;
+		type->P010_10BE = SPA_TYPE_ID_VIDEO_FORMAT_P010_10BE;
+		type->P010_10LE = SPA_TYPE_ID_VIDEO_FORMAT_P010_10LE;
+		type->IYU2 = SPA_TYPE_ID_VIDEO_FORMAT_IYU2;
+		type->VYUY = SPA_TYPE_ID_VIDEO_FORMAT_VYUY;
+		type->GBRA = SPA_TYPE_ID_VIDEO_FORMAT_GBRA;
+		type->GBRA_10BE = SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10BE;
+		type->GBRA_10LE = SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10LE;
+		type->GBR_12BE = SPA_TYPE_ID_VIDEO_FORMAT_GBR_12BE;
+		type->GBR_12LE = SPA_TYPE_ID_VIDEO_FORMAT_GBR_12LE;
+		type->GBRA_12BE = SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12BE;
+		type->GBRA_12LE = SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12LE;
+		type->I420_12BE = SPA_TYPE_ID_VIDEO_FORMAT_I420_12BE;
+		type->I420_12LE = SPA_TYPE_ID_VIDEO_FORMAT_I420_12LE;
+		type->I422_12BE = SPA_TYPE_ID_VIDEO_FORMAT_I422_12BE;
+		type->I422_12LE = SPA_TYPE_ID_VIDEO_FORMAT_I422_12LE;
+		type->Y444_12BE = SPA_TYPE_ID_VIDEO_FORMAT_Y444_12BE;
+		type->Y444_12LE = SPA_TYPE_ID_VIDEO_FORMAT_Y444_12LE;
 	}
 }
 
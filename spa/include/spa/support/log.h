@@ -27,6 +27,10 @@ extern "C" {
 #define SPA_TYPE__Log		SPA_TYPE_INTERFACE_BASE "Log"
 #define SPA_TYPE_LOG_BASE	SPA_TYPE__Log ":"
 
+/** how trace messages are logged, "binary" records the format and the
+ * arguments and leaves the formatting to another thread */
+#define SPA_LOG_PROP_TRACE	"log.trace"
+
 #include <stdarg.h>
 
 #include <spa/utils/defs.h>
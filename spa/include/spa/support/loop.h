@@ -158,7 +158,7 @@ typedef void (*spa_source_signal_func_t) (void *data, int signal_number);
 struct spa_loop_utils {
 	/* the version of this structure. This can be used to expand this
 	 * structure in the future */
-#define SPA_VERSION_LOOP_UTILS	0
+#define SPA_VERSION_LOOP_UTILS	1
 	uint32_t version;
 
 	struct spa_source *(*add_io) (struct spa_loop_utils *utils,
@@ -178,6 +178,9 @@ struct spa_loop_utils {
 					 spa_source_event_func_t func, void *data);
 	void (*signal_event) (struct spa_source *source);
 
+	/** add a timer. Timers can share a kernel timer and expire
+	 * up to a millisecond late, use add_precise_timer when that is
+	 * not acceptable */
 	struct spa_source *(*add_timer) (struct spa_loop_utils *utils,
 					 spa_source_timer_func_t func, void *data);
 	int (*update_timer) (struct spa_source *source,
@@ -192,6 +195,10 @@ struct spa_loop_utils {
 	 * should only be called when the loop is not running or from the
 	 * context of the running loop */
 	void (*destroy_source) (struct spa_source *source);
+
+	/** add a timer with its own kernel timer. since version 1 */
+	struct spa_source *(*add_precise_timer) (struct spa_loop_utils *utils,
+						 spa_source_timer_func_t func, void *data);
 };
 
 #define spa_loop_utils_add_io(l,...)		(l)->add_io(l,__VA_ARGS__)
@@ -204,6 +211,10 @@ struct spa_loop_utils {
 #define spa_loop_utils_update_timer(l,...)	(l)->update_timer(__VA_ARGS__)
 #define spa_loop_utils_add_signal(l,...)	(l)->add_signal(l,__VA_ARGS__)
 #define spa_loop_utils_destroy_source(l,...)	(l)->destroy_source(__VA_ARGS__)
+/* a version 0 utils has no precise timer, use a normal timer there */
+#define spa_loop_utils_add_precise_timer(l,...)			\
+	((l)->version < 1 ? (l)->add_timer(l,__VA_ARGS__) :	\
+			    (l)->add_precise_timer(l,__VA_ARGS__))
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -24,61 +24,336 @@
 extern "C" {
 #endif
 
+#include <string.h>
+
+#include <spa/utils/hash.h>
 #include <spa/support/type-map.h>
+#include <spa/param/props.h>
+#include <spa/param/format-utils.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/buffers.h>
+#include <spa/param/meta.h>
+#include <spa/param/io.h>
+#include <spa/node/io.h>
+#include <spa/buffer/buffer.h>
+
+/** The strings of the static types, indexed with enum spa_type_static_id */
+static const char * const spa_type_map_static[SPA_TYPE_ID_STATIC_LAST] = {
+	[SPA_TYPE_ID_TypeMap] = SPA_TYPE__TypeMap,
+	[SPA_TYPE_ID_Format] = SPA_TYPE__Format,
+	[SPA_TYPE_ID_Props] = SPA_TYPE__Props,
+
+	[SPA_TYPE_ID_MEDIA_TYPE_audio] = SPA_TYPE_MEDIA_TYPE__audio,
+	[SPA_TYPE_ID_MEDIA_TYPE_video] = SPA_TYPE_MEDIA_TYPE__video,
+	[SPA_TYPE_ID_MEDIA_TYPE_image] = SPA_TYPE_MEDIA_TYPE__image,
+	[SPA_TYPE_ID_MEDIA_TYPE_binary] = SPA_TYPE_MEDIA_TYPE__binary,
+	[SPA_TYPE_ID_MEDIA_TYPE_stream] = SPA_TYPE_MEDIA_TYPE__stream,
+
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_raw] = SPA_TYPE_MEDIA_SUBTYPE__raw,
+
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h264] = SPA_TYPE_MEDIA_SUBTYPE__h264,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mjpg] = SPA_TYPE_MEDIA_SUBTYPE__mjpg,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_dv] = SPA_TYPE_MEDIA_SUBTYPE__dv,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpegts] = SPA_TYPE_MEDIA_SUBTYPE__mpegts,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h263] = SPA_TYPE_MEDIA_SUBTYPE__h263,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg1] = SPA_TYPE_MEDIA_SUBTYPE__mpeg1,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg2] = SPA_TYPE_MEDIA_SUBTYPE__mpeg2,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg4] = SPA_TYPE_MEDIA_SUBTYPE__mpeg4,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_xvid] = SPA_TYPE_MEDIA_SUBTYPE__xvid,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vc1] = SPA_TYPE_MEDIA_SUBTYPE__vc1,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp8] = SPA_TYPE_MEDIA_SUBTYPE__vp8,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp9] = SPA_TYPE_MEDIA_SUBTYPE__vp9,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_jpeg] = SPA_TYPE_MEDIA_SUBTYPE__jpeg,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_bayer] = SPA_TYPE_MEDIA_SUBTYPE__bayer,
+
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_mp3] = SPA_TYPE_MEDIA_SUBTYPE__mp3,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_aac] = SPA_TYPE_MEDIA_SUBTYPE__aac,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_vorbis] = SPA_TYPE_MEDIA_SUBTYPE__vorbis,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_wma] = SPA_TYPE_MEDIA_SUBTYPE__wma,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_ra] = SPA_TYPE_MEDIA_SUBTYPE__ra,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_sbc] = SPA_TYPE_MEDIA_SUBTYPE__sbc,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_adpcm] = SPA_TYPE_MEDIA_SUBTYPE__adpcm,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g723] = SPA_TYPE_MEDIA_SUBTYPE__g723,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g726] = SPA_TYPE_MEDIA_SUBTYPE__g726,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g729] = SPA_TYPE_MEDIA_SUBTYPE__g729,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_amr] = SPA_TYPE_MEDIA_SUBTYPE__amr,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_gsm] = SPA_TYPE_MEDIA_SUBTYPE__gsm,
+	[SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_midi] = SPA_TYPE_MEDIA_SUBTYPE__midi,
+
+	[SPA_TYPE_ID_FORMAT_AUDIO_format] = SPA_TYPE_FORMAT_AUDIO__format,
+	[SPA_TYPE_ID_FORMAT_AUDIO_flags] = SPA_TYPE_FORMAT_AUDIO__flags,
+	[SPA_TYPE_ID_FORMAT_AUDIO_layout] = SPA_TYPE_FORMAT_AUDIO__layout,
+	[SPA_TYPE_ID_FORMAT_AUDIO_rate] = SPA_TYPE_FORMAT_AUDIO__rate,
+	[SPA_TYPE_ID_FORMAT_AUDIO_channels] = SPA_TYPE_FORMAT_AUDIO__channels,
+	[SPA_TYPE_ID_FORMAT_AUDIO_channel_mask] = SPA_TYPE_FORMAT_AUDIO__channelMask,
+
+	[SPA_TYPE_ID_AUDIO_FORMAT_ENCODED] = SPA_TYPE_AUDIO_FORMAT__ENCODED,
+	[SPA_TYPE_ID_AUDIO_FORMAT_S8] = SPA_TYPE_AUDIO_FORMAT__S8,
+	[SPA_TYPE_ID_AUDIO_FORMAT_U8] = SPA_TYPE_AUDIO_FORMAT__U8,
+	[SPA_TYPE_ID_AUDIO_FORMAT_S16] = _SPA_TYPE_AUDIO_FORMAT_NE("S16"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U16] = _SPA_TYPE_AUDIO_FORMAT_NE("U16"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S24_32] = _SPA_TYPE_AUDIO_FORMAT_NE("S24_32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U24_32] = _SPA_TYPE_AUDIO_FORMAT_NE("U24_32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S32] = _SPA_TYPE_AUDIO_FORMAT_NE("S32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U32] = _SPA_TYPE_AUDIO_FORMAT_NE("U32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S24] = _SPA_TYPE_AUDIO_FORMAT_NE("S24"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U24] = _SPA_TYPE_AUDIO_FORMAT_NE("U24"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S20] = _SPA_TYPE_AUDIO_FORMAT_NE("S20"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U20] = _SPA_TYPE_AUDIO_FORMAT_NE("U20"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S18] = _SPA_TYPE_AUDIO_FORMAT_NE("S18"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U18] = _SPA_TYPE_AUDIO_FORMAT_NE("U18"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_F32] = _SPA_TYPE_AUDIO_FORMAT_NE("F32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_F64] = _SPA_TYPE_AUDIO_FORMAT_NE("F64"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S16_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S16"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U16_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U16"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S24_32_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S24_32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U24_32_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U24_32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S32_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U32_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S24_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S24"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U24_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U24"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S20_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S20"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U20_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U20"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_S18_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("S18"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_U18_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("U18"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_F32_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("F32"),
+	[SPA_TYPE_ID_AUDIO_FORMAT_F64_OE] = _SPA_TYPE_AUDIO_FORMAT_OE("F64"),
+
+	[SPA_TYPE_ID_FORMAT_VIDEO_format] = SPA_TYPE_FORMAT_VIDEO__format,
+	[SPA_TYPE_ID_FORMAT_VIDEO_size] = SPA_TYPE_FORMAT_VIDEO__size,
+	[SPA_TYPE_ID_FORMAT_VIDEO_framerate] = SPA_TYPE_FORMAT_VIDEO__framerate,
+	[SPA_TYPE_ID_FORMAT_VIDEO_max_framerate] = SPA_TYPE_FORMAT_VIDEO__maxFramerate,
+	[SPA_TYPE_ID_FORMAT_VIDEO_views] = SPA_TYPE_FORMAT_VIDEO__views,
+	[SPA_TYPE_ID_FORMAT_VIDEO_interlace_mode] = SPA_TYPE_FORMAT_VIDEO__interlaceMode,
+	[SPA_TYPE_ID_FORMAT_VIDEO_pixel_aspect_ratio] = SPA_TYPE_FORMAT_VIDEO__pixelAspectRatio,
+	[SPA_TYPE_ID_FORMAT_VIDEO_multiview_mode] = SPA_TYPE_FORMAT_VIDEO__multiviewMode,
+	[SPA_TYPE_ID_FORMAT_VIDEO_multiview_flags] = SPA_TYPE_FORMAT_VIDEO__multiviewFlags,
+	[SPA_TYPE_ID_FORMAT_VIDEO_chroma_site] = SPA_TYPE_FORMAT_VIDEO__chromaSite,
+	[SPA_TYPE_ID_FORMAT_VIDEO_color_range] = SPA_TYPE_FORMAT_VIDEO__colorRange,
+	[SPA_TYPE_ID_FORMAT_VIDEO_color_matrix] = SPA_TYPE_FORMAT_VIDEO__colorMatrix,
+	[SPA_TYPE_ID_FORMAT_VIDEO_transfer_function] = SPA_TYPE_FORMAT_VIDEO__transferFunction,
+	[SPA_TYPE_ID_FORMAT_VIDEO_color_primaries] = SPA_TYPE_FORMAT_VIDEO__colorPrimaries,
+	[SPA_TYPE_ID_FORMAT_VIDEO_profile] = SPA_TYPE_FORMAT_VIDEO__profile,
+	[SPA_TYPE_ID_FORMAT_VIDEO_level] = SPA_TYPE_FORMAT_VIDEO__level,
+	[SPA_TYPE_ID_FORMAT_VIDEO_stream_format] = SPA_TYPE_FORMAT_VIDEO__streamFormat,
+	[SPA_TYPE_ID_FORMAT_VIDEO_alignment] = SPA_TYPE_FORMAT_VIDEO__alignment,
+
+	[SPA_TYPE_ID_VIDEO_FORMAT_ENCODED] = SPA_TYPE_VIDEO_FORMAT__ENCODED,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I420] = SPA_TYPE_VIDEO_FORMAT__I420,
+	[SPA_TYPE_ID_VIDEO_FORMAT_YV12] = SPA_TYPE_VIDEO_FORMAT__YV12,
+	[SPA_TYPE_ID_VIDEO_FORMAT_YUY2] = SPA_TYPE_VIDEO_FORMAT__YUY2,
+	[SPA_TYPE_ID_VIDEO_FORMAT_UYVY] = SPA_TYPE_VIDEO_FORMAT__UYVY,
+	[SPA_TYPE_ID_VIDEO_FORMAT_AYUV] = SPA_TYPE_VIDEO_FORMAT__AYUV,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGBx] = SPA_TYPE_VIDEO_FORMAT__RGBx,
+	[SPA_TYPE_ID_VIDEO_FORMAT_BGRx] = SPA_TYPE_VIDEO_FORMAT__BGRx,
+	[SPA_TYPE_ID_VIDEO_FORMAT_xRGB] = SPA_TYPE_VIDEO_FORMAT__xRGB,
+	[SPA_TYPE_ID_VIDEO_FORMAT_xBGR] = SPA_TYPE_VIDEO_FORMAT__xBGR,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGBA] = SPA_TYPE_VIDEO_FORMAT__RGBA,
+	[SPA_TYPE_ID_VIDEO_FORMAT_BGRA] = SPA_TYPE_VIDEO_FORMAT__BGRA,
+	[SPA_TYPE_ID_VIDEO_FORMAT_ARGB] = SPA_TYPE_VIDEO_FORMAT__ARGB,
+	[SPA_TYPE_ID_VIDEO_FORMAT_ABGR] = SPA_TYPE_VIDEO_FORMAT__ABGR,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGB] = SPA_TYPE_VIDEO_FORMAT__RGB,
+	[SPA_TYPE_ID_VIDEO_FORMAT_BGR] = SPA_TYPE_VIDEO_FORMAT__BGR,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y41B] = SPA_TYPE_VIDEO_FORMAT__Y41B,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y42B] = SPA_TYPE_VIDEO_FORMAT__Y42B,
+	[SPA_TYPE_ID_VIDEO_FORMAT_YVYU] = SPA_TYPE_VIDEO_FORMAT__YVYU,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y444] = SPA_TYPE_VIDEO_FORMAT__Y444,
+	[SPA_TYPE_ID_VIDEO_FORMAT_v210] = SPA_TYPE_VIDEO_FORMAT__v210,
+	[SPA_TYPE_ID_VIDEO_FORMAT_v216] = SPA_TYPE_VIDEO_FORMAT__v216,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV12] = SPA_TYPE_VIDEO_FORMAT__NV12,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV21] = SPA_TYPE_VIDEO_FORMAT__NV21,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GRAY8] = SPA_TYPE_VIDEO_FORMAT__GRAY8,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_BE] = SPA_TYPE_VIDEO_FORMAT__GRAY16_BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_LE] = SPA_TYPE_VIDEO_FORMAT__GRAY16_LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_v308] = SPA_TYPE_VIDEO_FORMAT__v308,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGB16] = SPA_TYPE_VIDEO_FORMAT__RGB16,
+	[SPA_TYPE_ID_VIDEO_FORMAT_BGR16] = SPA_TYPE_VIDEO_FORMAT__BGR16,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGB15] = SPA_TYPE_VIDEO_FORMAT__RGB15,
+	[SPA_TYPE_ID_VIDEO_FORMAT_BGR15] = SPA_TYPE_VIDEO_FORMAT__BGR15,
+	[SPA_TYPE_ID_VIDEO_FORMAT_UYVP] = SPA_TYPE_VIDEO_FORMAT__UYVP,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A420] = SPA_TYPE_VIDEO_FORMAT__A420,
+	[SPA_TYPE_ID_VIDEO_FORMAT_RGB8P] = SPA_TYPE_VIDEO_FORMAT__RGB8P,
+	[SPA_TYPE_ID_VIDEO_FORMAT_YUV9] = SPA_TYPE_VIDEO_FORMAT__YUV9,
+	[SPA_TYPE_ID_VIDEO_FORMAT_YVU9] = SPA_TYPE_VIDEO_FORMAT__YVU9,
+	[SPA_TYPE_ID_VIDEO_FORMAT_IYU1] = SPA_TYPE_VIDEO_FORMAT__IYU1,
+	[SPA_TYPE_ID_VIDEO_FORMAT_ARGB64] = SPA_TYPE_VIDEO_FORMAT__ARGB64,
+	[SPA_TYPE_ID_VIDEO_FORMAT_AYUV64] = SPA_TYPE_VIDEO_FORMAT__AYUV64,
+	[SPA_TYPE_ID_VIDEO_FORMAT_r210] = SPA_TYPE_VIDEO_FORMAT__r210,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I420_10BE] = SPA_TYPE_VIDEO_FORMAT__I420_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I420_10LE] = SPA_TYPE_VIDEO_FORMAT__I420_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I422_10BE] = SPA_TYPE_VIDEO_FORMAT__I422_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I422_10LE] = SPA_TYPE_VIDEO_FORMAT__I422_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y444_10BE] = SPA_TYPE_VIDEO_FORMAT__Y444_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y444_10LE] = SPA_TYPE_VIDEO_FORMAT__Y444_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBR] = SPA_TYPE_VIDEO_FORMAT__GBR,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBR_10BE] = SPA_TYPE_VIDEO_FORMAT__GBR_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBR_10LE] = SPA_TYPE_VIDEO_FORMAT__GBR_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV16] = SPA_TYPE_VIDEO_FORMAT__NV16,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV24] = SPA_TYPE_VIDEO_FORMAT__NV24,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV12_64Z32] = SPA_TYPE_VIDEO_FORMAT__NV12_64Z32,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A420_10BE] = SPA_TYPE_VIDEO_FORMAT__A420_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A420_10LE] = SPA_TYPE_VIDEO_FORMAT__A420_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A422_10BE] = SPA_TYPE_VIDEO_FORMAT__A422_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A422_10LE] = SPA_TYPE_VIDEO_FORMAT__A422_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A444_10BE] = SPA_TYPE_VIDEO_FORMAT__A444_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_A444_10LE] = SPA_TYPE_VIDEO_FORMAT__A444_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_NV61] = SPA_TYPE_VIDEO_FORMAT__NV61,
+	[SPA_TYPE_ID_VIDEO_FORMAT_P010_10BE] = SPA_TYPE_VIDEO_FORMAT__P010_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_P010_10LE] = SPA_TYPE_VIDEO_FORMAT__P010_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_IYU2] = SPA_TYPE_VIDEO_FORMAT__IYU2,
+	[SPA_TYPE_ID_VIDEO_FORMAT_VYUY] = SPA_TYPE_VIDEO_FORMAT__VYUY,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBRA] = SPA_TYPE_VIDEO_FORMAT__GBRA,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10BE] = SPA_TYPE_VIDEO_FORMAT__GBRA_10BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10LE] = SPA_TYPE_VIDEO_FORMAT__GBRA_10LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBR_12BE] = SPA_TYPE_VIDEO_FORMAT__GBR_12BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBR_12LE] = SPA_TYPE_VIDEO_FORMAT__GBR_12LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12BE] = SPA_TYPE_VIDEO_FORMAT__GBRA_12BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12LE] = SPA_TYPE_VIDEO_FORMAT__GBRA_12LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I420_12BE] = SPA_TYPE_VIDEO_FORMAT__I420_12BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I420_12LE] = SPA_TYPE_VIDEO_FORMAT__I420_12LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I422_12BE] = SPA_TYPE_VIDEO_FORMAT__I422_12BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_I422_12LE] = SPA_TYPE_VIDEO_FORMAT__I422_12LE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y444_12BE] = SPA_TYPE_VIDEO_FORMAT__Y444_12BE,
+	[SPA_TYPE_ID_VIDEO_FORMAT_Y444_12LE] = SPA_TYPE_VIDEO_FORMAT__Y444_12LE,
+
+	[SPA_TYPE_ID_PARAM_idList] = SPA_TYPE_PARAM_ID__List,
+	[SPA_TYPE_ID_PARAM_List] = SPA_TYPE_PARAM__List,
+	[SPA_TYPE_ID_PARAM_listId] = SPA_TYPE_PARAM_LIST__id,
+	[SPA_TYPE_ID_PARAM_idPropInfo] = SPA_TYPE_PARAM_ID__PropInfo,
+	[SPA_TYPE_ID_PARAM_PropInfo] = SPA_TYPE_PARAM__PropInfo,
+	[SPA_TYPE_ID_PARAM_propId] = SPA_TYPE_PARAM_PROP_INFO__id,
+	[SPA_TYPE_ID_PARAM_propName] = SPA_TYPE_PARAM_PROP_INFO__name,
+	[SPA_TYPE_ID_PARAM_propType] = SPA_TYPE_PARAM_PROP_INFO__type,
+	[SPA_TYPE_ID_PARAM_propLabels] = SPA_TYPE_PARAM_PROP_INFO__labels,
+	[SPA_TYPE_ID_PARAM_idProps] = SPA_TYPE_PARAM_ID__Props,
+	[SPA_TYPE_ID_PARAM_idEnumFormat] = SPA_TYPE_PARAM_ID__EnumFormat,
+	[SPA_TYPE_ID_PARAM_idFormat] = SPA_TYPE_PARAM_ID__Format,
+	[SPA_TYPE_ID_PARAM_idBuffers] = SPA_TYPE_PARAM_ID__Buffers,
+	[SPA_TYPE_ID_PARAM_idMeta] = SPA_TYPE_PARAM_ID__Meta,
+
+	[SPA_TYPE_ID_PARAM_BUFFERS_Buffers] = SPA_TYPE_PARAM__Buffers,
+	[SPA_TYPE_ID_PARAM_BUFFERS_size] = SPA_TYPE_PARAM_BUFFERS__size,
+	[SPA_TYPE_ID_PARAM_BUFFERS_stride] = SPA_TYPE_PARAM_BUFFERS__stride,
+	[SPA_TYPE_ID_PARAM_BUFFERS_buffers] = SPA_TYPE_PARAM_BUFFERS__buffers,
+	[SPA_TYPE_ID_PARAM_BUFFERS_align] = SPA_TYPE_PARAM_BUFFERS__align,
+
+	[SPA_TYPE_ID_PARAM_IO_id] = SPA_TYPE_PARAM_IO__id,
+	[SPA_TYPE_ID_PARAM_IO_size] = SPA_TYPE_PARAM_IO__size,
+	[SPA_TYPE_ID_PARAM_IO_idBuffers] = SPA_TYPE_PARAM_ID_IO__Buffers,
+	[SPA_TYPE_ID_PARAM_IO_Buffers] = SPA_TYPE_PARAM_IO__Buffers,
+	[SPA_TYPE_ID_PARAM_IO_idControl] = SPA_TYPE_PARAM_ID_IO__Control,
+	[SPA_TYPE_ID_PARAM_IO_Control] = SPA_TYPE_PARAM_IO__Control,
+	[SPA_TYPE_ID_PARAM_IO_idPropsIn] = SPA_TYPE_PARAM_ID_IO_PROPS__In,
+	[SPA_TYPE_ID_PARAM_IO_idPropsOut] = SPA_TYPE_PARAM_ID_IO_PROPS__Out,
+	[SPA_TYPE_ID_PARAM_IO_Prop] = SPA_TYPE_PARAM_IO__Prop,
+
+	[SPA_TYPE_ID_PARAM_META_Meta] = SPA_TYPE_PARAM__Meta,
+	[SPA_TYPE_ID_PARAM_META_type] = SPA_TYPE_PARAM_META__type,
+	[SPA_TYPE_ID_PARAM_META_size] = SPA_TYPE_PARAM_META__size,
 
+	[SPA_TYPE_ID_IO_Buffers] = SPA_TYPE_IO__Buffers,
+	[SPA_TYPE_ID_IO_ControlRange] = SPA_TYPE_IO_CONTROL__Range,
+	[SPA_TYPE_ID_IO_Prop] = SPA_TYPE_IO__Prop,
+
+	[SPA_TYPE_ID_META_Header] = SPA_TYPE_META__Header,
+	[SPA_TYPE_ID_META_VideoCrop] = SPA_TYPE_META__VideoCrop,
+
+	[SPA_TYPE_ID_DATA_MemPtr] = SPA_TYPE_DATA__MemPtr,
+	[SPA_TYPE_ID_DATA_MemFd] = SPA_TYPE_DATA_FD__MemFd,
+	[SPA_TYPE_ID_DATA_DmaBuf] = SPA_TYPE_DATA_FD__DmaBuf,
+};
+
+/* the types are in types[0..n_types-1], the index is an open addressing hash
+ * table of 2 * max_types entries with the type id + 1, 0 marks an empty slot */
 struct spa_type_map_impl_data {
 	struct spa_type_map map;
 	unsigned int n_types;
+	unsigned int max_types;
+	uint32_t *index;
 	char *types[1];
 };
 
+static inline uint32_t
+spa_type_map_impl_add (struct spa_type_map_impl_data *impl, const char *type)
+{
+	uint32_t i, id, size = impl->max_types * 2;
+
+	i = spa_hash_string(type) % size;
+	while ((id = impl->index[i]) != 0) {
+		if (strcmp(impl->types[id - 1], type) == 0)
+			return id - 1;
+		if (++i == size)
+			i = 0;
+	}
+	if (impl->n_types >= impl->max_types)
+		return SPA_ID_INVALID;
+
+	id = impl->n_types++;
+	impl->types[id] = (char *) type;
+	impl->index[i] = id + 1;
+
+	return id;
+}
+
 static inline uint32_t
 spa_type_map_impl_get_id (struct spa_type_map *map, const char *type)
 {
 	struct spa_type_map_impl_data *impl = (struct spa_type_map_impl_data *) map;
-	uint32_t i = 0;
 
-	for (i = 1; i <= impl->n_types; i++) {
-		if (strcmp(impl->types[i], type) == 0)
-			return i;
+	if (type == NULL)
+		return SPA_ID_INVALID;
+
+	if (impl->n_types == 0) {
+		uint32_t i;
+		for (i = 0; i < SPA_TYPE_ID_STATIC_LAST; i++)
+			spa_type_map_impl_add(impl, spa_type_map_static[i]);
 	}
-	impl->types[i] = (char *) type;
-	impl->n_types++;
-        return i;
+	return spa_type_map_impl_add(impl, type);
 }
 
 static inline const char *
 spa_type_map_impl_get_type (const struct spa_type_map *map, uint32_t id)
 {
 	struct spa_type_map_impl_data *impl = (struct spa_type_map_impl_data *) map;
-        if (id <= impl->n_types)
-                return impl->types[id];
-        return NULL;
+	if (id < impl->n_types)
+		return impl->types[id];
+	if (id < SPA_TYPE_ID_STATIC_LAST)
+		return spa_type_map_static[id];
+	return NULL;
 }
 
 static inline size_t spa_type_map_impl_get_size (const struct spa_type_map *map)
 {
 	struct spa_type_map_impl_data *impl = (struct spa_type_map_impl_data *) map;
-	return impl->n_types;
+	return SPA_MAX(impl->n_types, (unsigned int) SPA_TYPE_ID_STATIC_LAST);
 }
 
+/* the static types are added first and take up the first
+ * SPA_TYPE_ID_STATIC_LAST slots, a smaller map fails to compile on the
+ * negative bitfield width */
 #define SPA_TYPE_MAP_IMPL_DEFINE(name,maxtypes)	\
 struct  {					\
 	struct spa_type_map map;		\
 	unsigned int n_types;			\
+	unsigned int max_types;			\
+	uint32_t *index;			\
 	char *types[maxtypes];			\
+	uint32_t index_data[2 * (maxtypes)];	\
+	unsigned int : ((maxtypes) > SPA_TYPE_ID_STATIC_LAST ? 0 : -1); \
 } name
 
-#define SPA_TYPE_MAP_IMPL_INIT			\
+#define SPA_TYPE_MAP_IMPL_INIT(name,maxtypes)	\
 	{ { SPA_VERSION_TYPE_MAP,		\
 	    NULL,				\
 	    spa_type_map_impl_get_id,		\
 	    spa_type_map_impl_get_type,		\
 	    spa_type_map_impl_get_size,},	\
-	  0, { NULL, } }
+	  0, maxtypes, name.index_data,		\
+	  { NULL, }, { 0, } }
 
 #define SPA_TYPE_MAP_IMPL(name,maxtypes)		\
-	SPA_TYPE_MAP_IMPL_DEFINE(name,maxtypes) = SPA_TYPE_MAP_IMPL_INIT
+	SPA_TYPE_MAP_IMPL_DEFINE(name,maxtypes) = SPA_TYPE_MAP_IMPL_INIT(name,maxtypes)
 
 #ifdef __cplusplus
 }  /* extern "C" */
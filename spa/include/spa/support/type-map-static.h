@@ -0,0 +1,283 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_TYPE_MAP_STATIC_H__
+#define __SPA_TYPE_MAP_STATIC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The ids of the static types.
+ *
+ * A type map registers the static types first, in this order, so that
+ * they have the same id in every process. The type helpers use these
+ * ids without looking up the type strings. Other types are registered
+ * dynamically and get an id after the static types.
+ */
+enum spa_type_static_id {
+	SPA_TYPE_ID_TypeMap = 0,
+	SPA_TYPE_ID_Format,
+	SPA_TYPE_ID_Props,
+
+	/* struct spa_type_media_type */
+	SPA_TYPE_ID_MEDIA_TYPE_audio,
+	SPA_TYPE_ID_MEDIA_TYPE_video,
+	SPA_TYPE_ID_MEDIA_TYPE_image,
+	SPA_TYPE_ID_MEDIA_TYPE_binary,
+	SPA_TYPE_ID_MEDIA_TYPE_stream,
+
+	/* struct spa_type_media_subtype */
+	SPA_TYPE_ID_MEDIA_SUBTYPE_raw,
+
+	/* struct spa_type_media_subtype_video */
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h264,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mjpg,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_dv,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpegts,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_h263,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg1,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg2,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_mpeg4,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_xvid,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vc1,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp8,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_vp9,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_jpeg,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_VIDEO_bayer,
+
+	/* struct spa_type_media_subtype_audio */
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_mp3,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_aac,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_vorbis,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_wma,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_ra,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_sbc,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_adpcm,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g723,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g726,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_g729,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_amr,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_gsm,
+	SPA_TYPE_ID_MEDIA_SUBTYPE_AUDIO_midi,
+
+	/* struct spa_type_format_audio */
+	SPA_TYPE_ID_FORMAT_AUDIO_format,
+	SPA_TYPE_ID_FORMAT_AUDIO_flags,
+	SPA_TYPE_ID_FORMAT_AUDIO_layout,
+	SPA_TYPE_ID_FORMAT_AUDIO_rate,
+	SPA_TYPE_ID_FORMAT_AUDIO_channels,
+	SPA_TYPE_ID_FORMAT_AUDIO_channel_mask,
+
+	/* struct spa_type_audio_format */
+	SPA_TYPE_ID_AUDIO_FORMAT_ENCODED,
+	SPA_TYPE_ID_AUDIO_FORMAT_S8,
+	SPA_TYPE_ID_AUDIO_FORMAT_U8,
+	SPA_TYPE_ID_AUDIO_FORMAT_S16,
+	SPA_TYPE_ID_AUDIO_FORMAT_U16,
+	SPA_TYPE_ID_AUDIO_FORMAT_S24_32,
+	SPA_TYPE_ID_AUDIO_FORMAT_U24_32,
+	SPA_TYPE_ID_AUDIO_FORMAT_S32,
+	SPA_TYPE_ID_AUDIO_FORMAT_U32,
+	SPA_TYPE_ID_AUDIO_FORMAT_S24,
+	SPA_TYPE_ID_AUDIO_FORMAT_U24,
+	SPA_TYPE_ID_AUDIO_FORMAT_S20,
+	SPA_TYPE_ID_AUDIO_FORMAT_U20,
+	SPA_TYPE_ID_AUDIO_FORMAT_S18,
+	SPA_TYPE_ID_AUDIO_FORMAT_U18,
+	SPA_TYPE_ID_AUDIO_FORMAT_F32,
+	SPA_TYPE_ID_AUDIO_FORMAT_F64,
+	SPA_TYPE_ID_AUDIO_FORMAT_S16_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U16_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_S24_32_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U24_32_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_S32_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U32_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_S24_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U24_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_S20_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U20_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_S18_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_U18_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_F32_OE,
+	SPA_TYPE_ID_AUDIO_FORMAT_F64_OE,
+
+	/* struct spa_type_format_video */
+	SPA_TYPE_ID_FORMAT_VIDEO_format,
+	SPA_TYPE_ID_FORMAT_VIDEO_size,
+	SPA_TYPE_ID_FORMAT_VIDEO_framerate,
+	SPA_TYPE_ID_FORMAT_VIDEO_max_framerate,
+	SPA_TYPE_ID_FORMAT_VIDEO_views,
+	SPA_TYPE_ID_FORMAT_VIDEO_interlace_mode,
+	SPA_TYPE_ID_FORMAT_VIDEO_pixel_aspect_ratio,
+	SPA_TYPE_ID_FORMAT_VIDEO_multiview_mode,
+	SPA_TYPE_ID_FORMAT_VIDEO_multiview_flags,
+	SPA_TYPE_ID_FORMAT_VIDEO_chroma_site,
+	SPA_TYPE_ID_FORMAT_VIDEO_color_range,
+	SPA_TYPE_ID_FORMAT_VIDEO_color_matrix,
+	SPA_TYPE_ID_FORMAT_VIDEO_transfer_function,
+	SPA_TYPE_ID_FORMAT_VIDEO_color_primaries,
+	SPA_TYPE_ID_FORMAT_VIDEO_profile,
+	SPA_TYPE_ID_FORMAT_VIDEO_level,
+	SPA_TYPE_ID_FORMAT_VIDEO_stream_format,
+	SPA_TYPE_ID_FORMAT_VIDEO_alignment,
+
+	/* struct spa_type_video_format */
+	SPA_TYPE_ID_VIDEO_FORMAT_ENCODED,
+	SPA_TYPE_ID_VIDEO_FORMAT_I420,
+	SPA_TYPE_ID_VIDEO_FORMAT_YV12,
+	SPA_TYPE_ID_VIDEO_FORMAT_YUY2,
+	SPA_TYPE_ID_VIDEO_FORMAT_UYVY,
+	SPA_TYPE_ID_VIDEO_FORMAT_AYUV,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGBx,
+	SPA_TYPE_ID_VIDEO_FORMAT_BGRx,
+	SPA_TYPE_ID_VIDEO_FORMAT_xRGB,
+	SPA_TYPE_ID_VIDEO_FORMAT_xBGR,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGBA,
+	SPA_TYPE_ID_VIDEO_FORMAT_BGRA,
+	SPA_TYPE_ID_VIDEO_FORMAT_ARGB,
+	SPA_TYPE_ID_VIDEO_FORMAT_ABGR,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGB,
+	SPA_TYPE_ID_VIDEO_FORMAT_BGR,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y41B,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y42B,
+	SPA_TYPE_ID_VIDEO_FORMAT_YVYU,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y444,
+	SPA_TYPE_ID_VIDEO_FORMAT_v210,
+	SPA_TYPE_ID_VIDEO_FORMAT_v216,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV12,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV21,
+	SPA_TYPE_ID_VIDEO_FORMAT_GRAY8,
+	SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GRAY16_LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_v308,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGB16,
+	SPA_TYPE_ID_VIDEO_FORMAT_BGR16,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGB15,
+	SPA_TYPE_ID_VIDEO_FORMAT_BGR15,
+	SPA_TYPE_ID_VIDEO_FORMAT_UYVP,
+	SPA_TYPE_ID_VIDEO_FORMAT_A420,
+	SPA_TYPE_ID_VIDEO_FORMAT_RGB8P,
+	SPA_TYPE_ID_VIDEO_FORMAT_YUV9,
+	SPA_TYPE_ID_VIDEO_FORMAT_YVU9,
+	SPA_TYPE_ID_VIDEO_FORMAT_IYU1,
+	SPA_TYPE_ID_VIDEO_FORMAT_ARGB64,
+	SPA_TYPE_ID_VIDEO_FORMAT_AYUV64,
+	SPA_TYPE_ID_VIDEO_FORMAT_r210,
+	SPA_TYPE_ID_VIDEO_FORMAT_I420_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I420_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I422_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I422_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y444_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y444_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBR,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBR_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBR_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV16,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV24,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV12_64Z32,
+	SPA_TYPE_ID_VIDEO_FORMAT_A420_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_A420_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_A422_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_A422_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_A444_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_A444_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_NV61,
+	SPA_TYPE_ID_VIDEO_FORMAT_P010_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_P010_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_IYU2,
+	SPA_TYPE_ID_VIDEO_FORMAT_VYUY,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBRA,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBRA_10LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBR_12BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBR_12LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_GBRA_12LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I420_12BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I420_12LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I422_12BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_I422_12LE,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y444_12BE,
+	SPA_TYPE_ID_VIDEO_FORMAT_Y444_12LE,
+
+	/* struct spa_type_param */
+	SPA_TYPE_ID_PARAM_idList,
+	SPA_TYPE_ID_PARAM_List,
+	SPA_TYPE_ID_PARAM_listId,
+	SPA_TYPE_ID_PARAM_idPropInfo,
+	SPA_TYPE_ID_PARAM_PropInfo,
+	SPA_TYPE_ID_PARAM_propId,
+	SPA_TYPE_ID_PARAM_propName,
+	SPA_TYPE_ID_PARAM_propType,
+	SPA_TYPE_ID_PARAM_propLabels,
+	SPA_TYPE_ID_PARAM_idProps,
+	SPA_TYPE_ID_PARAM_idEnumFormat,
+	SPA_TYPE_ID_PARAM_idFormat,
+	SPA_TYPE_ID_PARAM_idBuffers,
+	SPA_TYPE_ID_PARAM_idMeta,
+
+	/* struct spa_type_param_buffers */
+	SPA_TYPE_ID_PARAM_BUFFERS_Buffers,
+	SPA_TYPE_ID_PARAM_BUFFERS_size,
+	SPA_TYPE_ID_PARAM_BUFFERS_stride,
+	SPA_TYPE_ID_PARAM_BUFFERS_buffers,
+	SPA_TYPE_ID_PARAM_BUFFERS_align,
+
+	/* struct spa_type_param_io */
+	SPA_TYPE_ID_PARAM_IO_id,
+	SPA_TYPE_ID_PARAM_IO_size,
+	SPA_TYPE_ID_PARAM_IO_idBuffers,
+	SPA_TYPE_ID_PARAM_IO_Buffers,
+	SPA_TYPE_ID_PARAM_IO_idControl,
+	SPA_TYPE_ID_PARAM_IO_Control,
+	SPA_TYPE_ID_PARAM_IO_idPropsIn,
+	SPA_TYPE_ID_PARAM_IO_idPropsOut,
+	SPA_TYPE_ID_PARAM_IO_Prop,
+
+	/* struct spa_type_param_meta */
+	SPA_TYPE_ID_PARAM_META_Meta,
+	SPA_TYPE_ID_PARAM_META_type,
+	SPA_TYPE_ID_PARAM_META_size,
+
+	/* struct spa_type_io */
+	SPA_TYPE_ID_IO_Buffers,
+	SPA_TYPE_ID_IO_ControlRange,
+	SPA_TYPE_ID_IO_Prop,
+
+	/* struct spa_type_meta */
+	SPA_TYPE_ID_META_Header,
+	SPA_TYPE_ID_META_VideoCrop,
+
+	/* struct spa_type_data */
+	SPA_TYPE_ID_DATA_MemPtr,
+	SPA_TYPE_ID_DATA_MemFd,
+	SPA_TYPE_ID_DATA_DmaBuf,
+
+	SPA_TYPE_ID_STATIC_LAST,
+};
+
+/** check if \a id is a static type id */
+#define spa_type_is_static(id)	((id) < SPA_TYPE_ID_STATIC_LAST)
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_TYPE_MAP_STATIC_H__ */
@@ -26,11 +26,15 @@ extern "C" {
 
 #include <spa/utils/defs.h>
 #include <spa/utils/type.h>
+#include <spa/support/type-map-static.h>
 
 #define SPA_TYPE__TypeMap		SPA_TYPE_INTERFACE_BASE "TypeMap"
 
 /**
  * Maps between string types and their type id
+ *
+ * The first ids are the static types of enum spa_type_static_id,
+ * see spa_type_map_static in type-map-impl.h.
  */
 struct spa_type_map {
 	/** the version of this structure. This can be used to expand this
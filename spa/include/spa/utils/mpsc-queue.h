@@ -0,0 +1,146 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_MPSC_QUEUE_H__
+#define __SPA_MPSC_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/utils/defs.h>
+
+/**
+ * A bounded multi producer, single consumer queue.
+ *
+ * The queue manages the indexes of a number of slots, the slots themselves
+ * are kept by the user in an array of the same size. Each slot has a
+ * sequence number that tells if the slot is free for the producer that
+ * claimed the index or filled for the consumer.
+ */
+struct spa_mpsc_queue {
+	uint32_t *seqs;		/*< the sequence number of each slot */
+	uint32_t n_slots;	/*< number of slots, a power of 2 */
+	uint32_t writeindex;	/*< the next index to claim for writing */
+	uint32_t readindex;	/*< the next index to read */
+};
+
+/**
+ * Initialize a spa_mpsc_queue with \a n_slots slots
+ *
+ * \param queue a spa_mpsc_queue
+ * \param seqs memory for \a n_slots sequence numbers
+ * \param n_slots number of slots, must be a power of 2
+ */
+static inline void spa_mpsc_queue_init(struct spa_mpsc_queue *queue,
+				       uint32_t *seqs, uint32_t n_slots)
+{
+	uint32_t i;
+
+	queue->seqs = seqs;
+	queue->n_slots = n_slots;
+	queue->writeindex = 0;
+	queue->readindex = 0;
+	for (i = 0; i < n_slots; i++)
+		seqs[i] = i;
+}
+
+/**
+ * Claim a slot for writing. Can be called from multiple threads.
+ *
+ * \param queue a spa_mpsc_queue
+ * \param index the claimed index, should be taken modulo the number of
+ *         slots to get the slot
+ * \return true when a slot was claimed, false when the queue is full
+ */
+static inline bool spa_mpsc_queue_get_write_index(struct spa_mpsc_queue *queue, uint32_t *index)
+{
+	uint32_t pos = __atomic_load_n(&queue->writeindex, __ATOMIC_RELAXED);
+
+	while (true) {
+		uint32_t seq = __atomic_load_n(&queue->seqs[pos & (queue->n_slots - 1)],
+					       __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t) (seq - pos);
+
+		if (diff == 0) {
+			/* slot is free, on failure pos is updated with the new index */
+			if (__atomic_compare_exchange_n(&queue->writeindex, &pos, pos + 1, true,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				*index = pos;
+				return true;
+			}
+		} else if (diff < 0) {
+			/* slot was not read yet */
+			return false;
+		} else {
+			pos = __atomic_load_n(&queue->writeindex, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/**
+ * Make the slot at \a index available for reading
+ *
+ * \param queue a spa_mpsc_queue
+ * \param index an index from spa_mpsc_queue_get_write_index()
+ */
+static inline void spa_mpsc_queue_write_update(struct spa_mpsc_queue *queue, uint32_t index)
+{
+	__atomic_store_n(&queue->seqs[index & (queue->n_slots - 1)], index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the next slot to read. Must only be called from one thread.
+ *
+ * \param queue a spa_mpsc_queue
+ * \param index the index to read, should be taken modulo the number of
+ *         slots to get the slot
+ * \return true when a slot can be read, false when the queue is empty or
+ *         the next slot is still being written
+ */
+static inline bool spa_mpsc_queue_get_read_index(struct spa_mpsc_queue *queue, uint32_t *index)
+{
+	uint32_t pos = queue->readindex;
+	uint32_t seq = __atomic_load_n(&queue->seqs[pos & (queue->n_slots - 1)], __ATOMIC_ACQUIRE);
+
+	if ((int32_t) (seq - (pos + 1)) < 0)
+		return false;
+
+	*index = pos;
+	return true;
+}
+
+/**
+ * Release the slot at \a index to the producers
+ *
+ * \param queue a spa_mpsc_queue
+ * \param index an index from spa_mpsc_queue_get_read_index()
+ */
+static inline void spa_mpsc_queue_read_update(struct spa_mpsc_queue *queue, uint32_t index)
+{
+	queue->readindex = index + 1;
+	__atomic_store_n(&queue->seqs[index & (queue->n_slots - 1)],
+			 index + queue->n_slots, __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* __SPA_MPSC_QUEUE_H__ */
@@ -499,6 +499,42 @@ static int alsa_try_resume(struct state *state)
 	return res;
 }
 
+/* recover from an xrun and tell the host how late we were */
+static int alsa_recover_xrun(struct state *state, snd_pcm_status_t *status)
+{
+	snd_htimestamp_t now, trigger;
+	struct spa_event_node_xrun event;
+	int64_t delay;
+	int res;
+
+	snd_pcm_status_get_htstamp(status, &now);
+	snd_pcm_status_get_trigger_htstamp(status, &trigger);
+	delay = SPA_TIMESPEC_TO_TIME(&now) - SPA_TIMESPEC_TO_TIME(&trigger);
+
+	spa_log_warn(state->log, "xrun of %"PRIi64" usec", delay / 1000);
+
+	if (state->callbacks && state->callbacks->event) {
+		event = SPA_EVENT_NODE_XRUN_INIT(state->type.event_node.Xrun,
+				state->stream == SND_PCM_STREAM_PLAYBACK ?
+					SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT, 0,
+				SPA_TIMESPEC_TO_TIME(&trigger), delay);
+		state->callbacks->event(state->callbacks_data, (struct spa_event *) &event);
+	}
+
+	if ((res = snd_pcm_prepare(state->hndl)) < 0) {
+		spa_log_error(state->log, "xrun, failed to prepare %s", snd_strerror(res));
+		return res;
+	}
+	if (state->stream == SND_PCM_STREAM_PLAYBACK) {
+		/* started again when the buffer is filled */
+		state->alsa_started = false;
+	} else if ((res = snd_pcm_start(state->hndl)) < 0) {
+		spa_log_error(state->log, "xrun, failed to start %s", snd_strerror(res));
+		return res;
+	}
+	return 0;
+}
+
 static void alsa_on_playback_timeout_event(struct spa_source *source)
 {
 	uint64_t exp;
@@ -521,6 +557,15 @@ static void alsa_on_playback_timeout_event(struct spa_source *source)
 		return;
 	}
 
+	if (snd_pcm_status_get_state(status) == SND_PCM_STATE_XRUN) {
+		if ((res = alsa_recover_xrun(state, status)) < 0)
+			return;
+		if ((res = snd_pcm_status(hndl, status)) < 0) {
+			spa_log_error(state->log, "snd_pcm_status error: %s", snd_strerror(res));
+			return;
+		}
+	}
+
 	avail = snd_pcm_status_get_avail(status);
 	snd_pcm_status_get_htstamp(status, &state->now);
 
@@ -611,6 +656,15 @@ static void alsa_on_capture_timeout_event(struct spa_source *source)
 		return;
 	}
 
+	if (snd_pcm_status_get_state(status) == SND_PCM_STATE_XRUN) {
+		if ((res = alsa_recover_xrun(state, status)) < 0)
+			return;
+		if ((res = snd_pcm_status(hndl, status)) < 0) {
+			spa_log_error(state->log, "snd_pcm_status error: %s", snd_strerror(res));
+			return;
+		}
+	}
+
 	avail = snd_pcm_status_get_avail(status);
 	snd_pcm_status_get_htstamp(status, &htstamp);
 
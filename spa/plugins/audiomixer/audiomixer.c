@@ -20,12 +20,14 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include <spa/support/log.h>
 #include <spa/support/type-map.h>
 #include <spa/utils/list.h>
 #include <spa/node/node.h>
 #include <spa/node/io.h>
+#include <spa/node/event.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/buffers.h>
 #include <spa/param/meta.h>
@@ -39,6 +41,11 @@
 #define MAX_BUFFERS     64
 #define MAX_PORTS       128
 
+/* size of the output block that is mixed from all inputs before moving on
+ * to the next one, small enough to keep the block in L1 while the inputs
+ * are streamed through it */
+#define MIX_BLOCK_SIZE	4096
+
 #define PORT_DEFAULT_VOLUME	1.0
 #define PORT_DEFAULT_MUTE	false
 
@@ -81,6 +88,16 @@ struct port {
 
 	struct spa_list queue;
 	size_t queued_bytes;
+	bool underrun;			/* no data in the last cycle */
+};
+
+/* an input that contributes to the current output, with the ring buffer
+ * wrap-around already resolved into two contiguous segments */
+struct mix_input {
+	const void *src[2];
+	uint32_t len1;
+	double volume;
+	bool scale;
 };
 
 struct type {
@@ -97,6 +114,7 @@ struct type {
 	struct spa_type_format_audio format_audio;
 	struct spa_type_audio_format audio_format;
 	struct spa_type_command_node command_node;
+	struct spa_type_event_node event_node;
 	struct spa_type_meta meta;
 	struct spa_type_data data;
 	struct spa_type_param_buffers param_buffers;
@@ -119,6 +137,7 @@ static inline void init_type(struct type *type, struct spa_type_map *map)
 	spa_type_format_audio_map(map, &type->format_audio);
 	spa_type_audio_format_map(map, &type->audio_format);
 	spa_type_command_node_map(map, &type->command_node);
+	spa_type_event_node_map(map, &type->event_node);
 	spa_type_meta_map(map, &type->meta);
 	spa_type_data_map(map, &type->data);
 	spa_type_param_buffers_map(map, &type->param_buffers);
@@ -155,6 +174,8 @@ struct impl {
 	mix_scale_func_t copy_scale;
 	mix_scale_func_t add_scale;
 
+	struct mix_input inputs[MAX_PORTS];
+
 	bool started;
 };
 
@@ -817,77 +838,147 @@ impl_node_port_send_command(struct spa_node *node,
 }
 
 static inline void
-add_port_data(struct impl *this, void *out, size_t outsize, struct port *port, int layer)
+mix_segment(struct impl *this, void *dst, const struct mix_input *in,
+	    uint32_t pos, uint32_t size, bool first)
+{
+	const void *src;
+
+	if (pos < in->len1)
+		src = SPA_MEMBER(in->src[0], pos, void);
+	else
+		src = SPA_MEMBER(in->src[1], pos - in->len1, void);
+
+	if (in->scale) {
+		if (first)
+			this->copy_scale(dst, src, in->volume, size);
+		else
+			this->add_scale(dst, src, in->volume, size);
+	} else {
+		if (first)
+			this->copy(dst, src, size);
+		else
+			this->add(dst, src, size);
+	}
+}
+
+static inline void
+mix_block(struct impl *this, void *dst, const struct mix_input *in,
+	  uint32_t pos, uint32_t size, bool first)
+{
+	uint32_t len;
+
+	if (pos < in->len1 && pos + size > in->len1) {
+		len = in->len1 - pos;
+		mix_segment(this, dst, in, pos, len, first);
+		mix_segment(this, SPA_MEMBER(dst, len, void), in, pos + len, size - len, first);
+	} else {
+		mix_segment(this, dst, in, pos, size, first);
+	}
+}
+
+static void
+mix_inputs(struct impl *this, void *dst[2], uint32_t len1, uint32_t n_bytes, uint32_t n_inputs)
+{
+	uint32_t i, pos, size;
+	void *d;
+
+	for (pos = 0; pos < n_bytes; pos += size) {
+		size = SPA_MIN(n_bytes - pos, MIX_BLOCK_SIZE);
+		if (pos < len1) {
+			size = SPA_MIN(size, len1 - pos);
+			d = SPA_MEMBER(dst[0], pos, void);
+		} else {
+			d = SPA_MEMBER(dst[1], pos - len1, void);
+		}
+
+		if (n_inputs == 0) {
+			this->clear(d, size);
+			continue;
+		}
+		for (i = 0; i < n_inputs; i++)
+			mix_block(this, d, &this->inputs[i], pos, size, i == 0);
+	}
+}
+
+static inline bool
+get_port_input(struct impl *this, struct port *port, size_t n_bytes, struct mix_input *in)
 {
-	size_t insize;
 	struct buffer *b;
-	uint32_t index, offset, len1, len2, maxsize;
 	struct spa_data *d;
-	void *data;
+	uint32_t index, offset, maxsize, insize;
 	double volume = *port->io_volume;
 	bool mute = *port->io_mute;
 
-	b = spa_list_first(&port->queue, struct buffer, link);
+	if (volume < 0.001 || mute)
+		return false;
 
+	b = spa_list_first(&port->queue, struct buffer, link);
 	d = b->outbuf->datas;
 
 	maxsize = d[0].maxsize;
-	data = d[0].data;
-
 	insize = SPA_MIN(d[0].chunk->size, maxsize);
-	outsize = SPA_MIN(outsize, insize);
 
 	index = d[0].chunk->offset + (insize - port->queued_bytes);
 	offset = index % maxsize;
 
-	len1 = SPA_MIN(outsize, maxsize - offset);
-	len2 = outsize - len1;
-
-	if (volume < 0.001 || mute) {
-		/* silence, for the first layer clear, otherwise do nothing */
-		if (layer == 0) {
-			this->clear(out, len1);
-			if (len2 > 0)
-				this->clear(out + len1, len2);
-		}
-	}
-	else if (volume < 0.999 || volume > 1.001) {
-		mix_scale_func_t mix = layer == 0 ? this->copy_scale : this->add_scale;
+	in->src[0] = SPA_MEMBER(d[0].data, offset, void);
+	in->src[1] = d[0].data;
+	in->len1 = SPA_MIN(n_bytes, maxsize - offset);
+	in->volume = volume;
+	in->scale = volume < 0.999 || volume > 1.001;
 
-		mix(out, SPA_MEMBER(data, offset, void), volume, len1);
-		if (len2 > 0)
-			mix(out + len1, data, volume, len2);
-	}
-	else {
-		mix_func_t mix = layer == 0 ? this->copy : this->add;
+	return true;
+}
 
-		mix(out, SPA_MEMBER(data, offset, void), len1);
-		if (len2 > 0)
-			mix(out + len1, data, len2);
-	}
+static inline void
+consume_port_data(struct impl *this, struct port *port, size_t n_bytes)
+{
+	struct buffer *b = spa_list_first(&port->queue, struct buffer, link);
 
-	port->queued_bytes -= outsize;
+	port->queued_bytes -= n_bytes;
 
 	if (port->queued_bytes == 0) {
 		spa_log_trace(this->log, NAME " %p: return buffer %d on port %p %zd",
-			      this, b->outbuf->id, port, outsize);
+			      this, b->outbuf->id, port, n_bytes);
 		port->io->buffer_id = b->outbuf->id;
 		spa_list_remove(&b->link);
 		b->outstanding = true;
 	} else {
 		spa_log_trace(this->log, NAME " %p: keeping buffer %d on port %p %zd %zd",
-			      this, b->outbuf->id, port, port->queued_bytes, outsize);
+			      this, b->outbuf->id, port, port->queued_bytes, n_bytes);
+	}
+}
+
+static void emit_underrun(struct impl *this, struct port *port, uint32_t port_id)
+{
+	struct spa_event_node_xrun event;
+	struct timespec now;
+
+	/* only warn when the underrun starts, the xruns are counted */
+	if (!port->underrun) {
+		spa_log_warn(this->log, NAME " %p: underrun stream %d", this, port_id);
+		port->underrun = true;
+	}
+
+	if (this->callbacks && this->callbacks->event) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		event = SPA_EVENT_NODE_XRUN_INIT(this->type.event_node.Xrun,
+				SPA_DIRECTION_INPUT, port_id,
+				SPA_TIMESPEC_TO_TIME(&now), 0);
+		this->callbacks->event(this->user_data, (struct spa_event *) &event);
 	}
 }
 
 static int mix_output(struct impl *this, size_t n_bytes)
 {
 	struct buffer *outbuf;
-	int i, layer;
+	int i;
+	uint32_t n_inputs;
 	struct port *outport;
 	struct spa_io_buffers *outio;
 	struct spa_data *od;
 	uint32_t avail, index, maxsize, len1, len2, offset;
+	void *dst[2];
 
 	outport = GET_OUT_PORT(this, 0);
 	outio = outport->io;
@@ -915,21 +1006,34 @@ static int mix_output(struct impl *this, size_t n_bytes)
 	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd %d %d %d",
 		      this, outbuf->outbuf->id, n_bytes, offset, len1, len2);
 
-	for (layer = 0, i = 0; i < this->last_port; i++) {
+	/* collect all inputs first so that the output is only written once */
+	for (n_inputs = 0, i = 0; i < this->last_port; i++) {
 		struct port *in_port = GET_IN_PORT(this, i);
 
 		if (in_port->io == NULL || in_port->n_buffers == 0)
 			continue;
 
 		if (in_port->queued_bytes == 0) {
-			spa_log_warn(this->log, NAME " %p: underrun stream %d", this, i);
+			emit_underrun(this, in_port, i);
 			continue;
 		}
+		in_port->underrun = false;
+		if (get_port_input(this, in_port, n_bytes, &this->inputs[n_inputs]))
+			n_inputs++;
+	}
+
+	dst[0] = SPA_MEMBER(od[0].data, offset, void);
+	dst[1] = od[0].data;
+	mix_inputs(this, dst, len1, n_bytes, n_inputs);
+
+	for (i = 0; i < this->last_port; i++) {
+		struct port *in_port = GET_IN_PORT(this, i);
+
+		if (in_port->io == NULL || in_port->n_buffers == 0 ||
+		    in_port->queued_bytes == 0)
+			continue;
 
-		add_port_data(this, SPA_MEMBER(od[0].data, offset, void), len1, in_port, layer);
-		if (len2 > 0)
-			add_port_data(this, od[0].data, len2, in_port, layer);
-		layer++;
+		consume_port_data(this, in_port, n_bytes);
 	}
 
 	od[0].chunk->offset = index;
@@ -0,0 +1,218 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <immintrin.h>
+
+#include "mix-ops.h"
+
+/* same as the SSE2 versions, with twice the lanes. unpack and pack operate
+ * per 128 bit lane so the sample order is preserved. */
+#define S16_SCALE_SHIFT	11
+#define S16_SCALE_MAX	(INT16_MAX >> S16_SCALE_SHIFT)
+
+static inline __m256i
+scale_s16(__m256i in, __m256i v, __m256i *hi)
+{
+	__m256i l, h;
+
+	l = _mm256_mullo_epi16(in, v);
+	h = _mm256_mulhi_epi16(in, v);
+	*hi = _mm256_srai_epi32(_mm256_unpackhi_epi16(l, h), S16_SCALE_SHIFT);
+	return _mm256_srai_epi32(_mm256_unpacklo_epi16(l, h), S16_SCALE_SHIFT);
+}
+
+void
+audiomixer_add_s16_avx2(void *dst, const void *src, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m256i in;
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		in = _mm256_loadu_si256((const __m256i *) &s[n]);
+		in = _mm256_adds_epi16(in, _mm256_loadu_si256((const __m256i *) &d[n]));
+		_mm256_storeu_si256((__m256i *) &d[n], in);
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = d[n] + s[n];
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_add_f32_avx2(void *dst, const void *src, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m256 in;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		in = _mm256_loadu_ps(&s[n]);
+		in = _mm256_add_ps(in, _mm256_loadu_ps(&d[n]));
+		_mm256_storeu_ps(&d[n], in);
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n];
+}
+
+void
+audiomixer_copy_scale_s16_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << S16_SCALE_SHIFT), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m256i vs, lo, hi;
+
+	if (scale >= S16_SCALE_MAX || scale <= -S16_SCALE_MAX) {
+		audiomixer_copy_scale_s16_c(dst, src, scale, n_bytes);
+		return;
+	}
+	vs = _mm256_set1_epi16(v);
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		lo = scale_s16(_mm256_loadu_si256((const __m256i *) &s[n]), vs, &hi);
+		_mm256_storeu_si256((__m256i *) &d[n], _mm256_packs_epi32(lo, hi));
+	}
+	for (; n < n_samples; n++) {
+		t = (s[n] * v) >> S16_SCALE_SHIFT;
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_copy_scale_f32_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m256 vs = _mm256_set1_ps(v);
+
+	for (n = 0; n + 8 <= n_samples; n += 8)
+		_mm256_storeu_ps(&d[n], _mm256_mul_ps(_mm256_loadu_ps(&s[n]), vs));
+	for (; n < n_samples; n++)
+		d[n] = s[n] * v;
+}
+
+void
+audiomixer_add_scale_s16_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << S16_SCALE_SHIFT), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m256i vs, in, lo, hi;
+
+	if (scale >= S16_SCALE_MAX || scale <= -S16_SCALE_MAX) {
+		audiomixer_add_scale_s16_c(dst, src, scale, n_bytes);
+		return;
+	}
+	vs = _mm256_set1_epi16(v);
+
+	for (n = 0; n + 16 <= n_samples; n += 16) {
+		lo = scale_s16(_mm256_loadu_si256((const __m256i *) &s[n]), vs, &hi);
+		/* sign extend the destination to 32 bits and accumulate */
+		in = _mm256_loadu_si256((const __m256i *) &d[n]);
+		lo = _mm256_add_epi32(lo, _mm256_srai_epi32(_mm256_unpacklo_epi16(in, in), 16));
+		hi = _mm256_add_epi32(hi, _mm256_srai_epi32(_mm256_unpackhi_epi16(in, in), 16));
+		_mm256_storeu_si256((__m256i *) &d[n], _mm256_packs_epi32(lo, hi));
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + ((s[n] * v) >> S16_SCALE_SHIFT);
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_add_scale_f32_avx2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m256 vs = _mm256_set1_ps(v), in;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		in = _mm256_mul_ps(_mm256_loadu_ps(&s[n]), vs);
+		_mm256_storeu_ps(&d[n], _mm256_add_ps(in, _mm256_loadu_ps(&d[n])));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n] * v;
+}
+
+void
+audiomixer_add_s16_i_avx2(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_s16_avx2(dst, src, n_bytes);
+	else
+		audiomixer_add_s16_i_c(dst, dst_stride, src, src_stride, n_bytes);
+}
+
+void
+audiomixer_add_f32_i_avx2(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_f32_avx2(dst, src, n_bytes);
+	else
+		audiomixer_add_f32_i_c(dst, dst_stride, src, src_stride, n_bytes);
+}
+
+void
+audiomixer_copy_scale_s16_i_avx2(void *dst, int dst_stride, const void *src, int src_stride,
+		      const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_copy_scale_s16_avx2(dst, src, scale, n_bytes);
+	else
+		audiomixer_copy_scale_s16_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_copy_scale_f32_i_avx2(void *dst, int dst_stride, const void *src, int src_stride,
+		      const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_copy_scale_f32_avx2(dst, src, scale, n_bytes);
+	else
+		audiomixer_copy_scale_f32_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_add_scale_s16_i_avx2(void *dst, int dst_stride, const void *src, int src_stride,
+		     const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_scale_s16_avx2(dst, src, scale, n_bytes);
+	else
+		audiomixer_add_scale_s16_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_add_scale_f32_i_avx2(void *dst, int dst_stride, const void *src, int src_stride,
+		     const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_scale_f32_avx2(dst, src, scale, n_bytes);
+	else
+		audiomixer_add_scale_f32_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
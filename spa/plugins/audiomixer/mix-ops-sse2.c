@@ -0,0 +1,218 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <emmintrin.h>
+
+#include "mix-ops.h"
+
+/* scale factors are applied in Q11 fixed point, like the C versions. The
+ * 16 bit multiplies below only work when the factor fits in 16 bits. */
+#define S16_SCALE_SHIFT	11
+#define S16_SCALE_MAX	(INT16_MAX >> S16_SCALE_SHIFT)
+
+static inline __m128i
+scale_s16(__m128i in, __m128i v, __m128i *hi)
+{
+	__m128i l, h;
+
+	l = _mm_mullo_epi16(in, v);
+	h = _mm_mulhi_epi16(in, v);
+	*hi = _mm_srai_epi32(_mm_unpackhi_epi16(l, h), S16_SCALE_SHIFT);
+	return _mm_srai_epi32(_mm_unpacklo_epi16(l, h), S16_SCALE_SHIFT);
+}
+
+void
+audiomixer_add_s16_sse2(void *dst, const void *src, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m128i in;
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		in = _mm_loadu_si128((const __m128i *) &s[n]);
+		in = _mm_adds_epi16(in, _mm_loadu_si128((const __m128i *) &d[n]));
+		_mm_storeu_si128((__m128i *) &d[n], in);
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = d[n] + s[n];
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_add_f32_sse2(void *dst, const void *src, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m128 in;
+
+	for (n = 0; n + 4 <= n_samples; n += 4) {
+		in = _mm_loadu_ps(&s[n]);
+		in = _mm_add_ps(in, _mm_loadu_ps(&d[n]));
+		_mm_storeu_ps(&d[n], in);
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n];
+}
+
+void
+audiomixer_copy_scale_s16_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << S16_SCALE_SHIFT), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m128i vs, lo, hi;
+
+	if (scale >= S16_SCALE_MAX || scale <= -S16_SCALE_MAX) {
+		audiomixer_copy_scale_s16_c(dst, src, scale, n_bytes);
+		return;
+	}
+	vs = _mm_set1_epi16(v);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		lo = scale_s16(_mm_loadu_si128((const __m128i *) &s[n]), vs, &hi);
+		_mm_storeu_si128((__m128i *) &d[n], _mm_packs_epi32(lo, hi));
+	}
+	for (; n < n_samples; n++) {
+		t = (s[n] * v) >> S16_SCALE_SHIFT;
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_copy_scale_f32_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m128 vs = _mm_set1_ps(v);
+
+	for (n = 0; n + 4 <= n_samples; n += 4)
+		_mm_storeu_ps(&d[n], _mm_mul_ps(_mm_loadu_ps(&s[n]), vs));
+	for (; n < n_samples; n++)
+		d[n] = s[n] * v;
+}
+
+void
+audiomixer_add_scale_s16_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const int16_t *s = src;
+	int16_t *d = dst;
+	int32_t v = scale * (1 << S16_SCALE_SHIFT), t;
+	int n, n_samples = n_bytes / sizeof(int16_t);
+	__m128i vs, in, lo, hi;
+
+	if (scale >= S16_SCALE_MAX || scale <= -S16_SCALE_MAX) {
+		audiomixer_add_scale_s16_c(dst, src, scale, n_bytes);
+		return;
+	}
+	vs = _mm_set1_epi16(v);
+
+	for (n = 0; n + 8 <= n_samples; n += 8) {
+		lo = scale_s16(_mm_loadu_si128((const __m128i *) &s[n]), vs, &hi);
+		/* sign extend the destination to 32 bits and accumulate */
+		in = _mm_loadu_si128((const __m128i *) &d[n]);
+		lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16));
+		hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16));
+		_mm_storeu_si128((__m128i *) &d[n], _mm_packs_epi32(lo, hi));
+	}
+	for (; n < n_samples; n++) {
+		t = d[n] + ((s[n] * v) >> S16_SCALE_SHIFT);
+		d[n] = SPA_CLAMP(t, INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+audiomixer_add_scale_f32_sse2(void *dst, const void *src, const double scale, int n_bytes)
+{
+	const float *s = src;
+	float *d = dst;
+	float v = scale;
+	int n, n_samples = n_bytes / sizeof(float);
+	__m128 vs = _mm_set1_ps(v), in;
+
+	for (n = 0; n + 4 <= n_samples; n += 4) {
+		in = _mm_mul_ps(_mm_loadu_ps(&s[n]), vs);
+		_mm_storeu_ps(&d[n], _mm_add_ps(in, _mm_loadu_ps(&d[n])));
+	}
+	for (; n < n_samples; n++)
+		d[n] += s[n] * v;
+}
+
+void
+audiomixer_add_s16_i_sse2(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_s16_sse2(dst, src, n_bytes);
+	else
+		audiomixer_add_s16_i_c(dst, dst_stride, src, src_stride, n_bytes);
+}
+
+void
+audiomixer_add_f32_i_sse2(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_f32_sse2(dst, src, n_bytes);
+	else
+		audiomixer_add_f32_i_c(dst, dst_stride, src, src_stride, n_bytes);
+}
+
+void
+audiomixer_copy_scale_s16_i_sse2(void *dst, int dst_stride, const void *src, int src_stride,
+		      const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_copy_scale_s16_sse2(dst, src, scale, n_bytes);
+	else
+		audiomixer_copy_scale_s16_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_copy_scale_f32_i_sse2(void *dst, int dst_stride, const void *src, int src_stride,
+		      const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_copy_scale_f32_sse2(dst, src, scale, n_bytes);
+	else
+		audiomixer_copy_scale_f32_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_add_scale_s16_i_sse2(void *dst, int dst_stride, const void *src, int src_stride,
+		     const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_scale_s16_sse2(dst, src, scale, n_bytes);
+	else
+		audiomixer_add_scale_s16_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
+
+void
+audiomixer_add_scale_f32_i_sse2(void *dst, int dst_stride, const void *src, int src_stride,
+		     const double scale, int n_bytes)
+{
+	if (dst_stride == 1 && src_stride == 1)
+		audiomixer_add_scale_f32_sse2(dst, src, scale, n_bytes);
+	else
+		audiomixer_add_scale_f32_i_c(dst, dst_stride, src, src_stride, scale, n_bytes);
+}
@@ -19,32 +19,32 @@
 
 #include "mix-ops.h"
 
-static void
-clear_s16(void *dst, int n_bytes)
+void
+audiomixer_clear_s16_c(void *dst, int n_bytes)
 {
 	memset(dst, 0, n_bytes);
 }
 
-static void
-clear_f32(void *dst, int n_bytes)
+void
+audiomixer_clear_f32_c(void *dst, int n_bytes)
 {
 	memset(dst, 0, n_bytes);
 }
 
-static void
-copy_s16(void *dst, const void *src, int n_bytes)
+void
+audiomixer_copy_s16_c(void *dst, const void *src, int n_bytes)
 {
 	memcpy(dst, src, n_bytes);
 }
 
-static void
-copy_f32(void *dst, const void *src, int n_bytes)
+void
+audiomixer_copy_f32_c(void *dst, const void *src, int n_bytes)
 {
 	memcpy(dst, src, n_bytes);
 }
 
-static void
-add_s16(void *dst, const void *src, int n_bytes)
+void
+audiomixer_add_s16_c(void *dst, const void *src, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -59,8 +59,8 @@ add_s16(void *dst, const void *src, int n_bytes)
 	}
 }
 
-static void
-add_f32(void *dst, const void *src, int n_bytes)
+void
+audiomixer_add_f32_c(void *dst, const void *src, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -73,11 +73,11 @@ add_f32(void *dst, const void *src, int n_bytes)
 	}
 }
 
-static void
-copy_scale_s16(void *dst, const void *src, const double scale, int n_bytes)
+void
+audiomixer_copy_scale_s16_c(void *dst, const void *src, const double scale, int n_bytes)
 {
 	const int16_t *s = src;
-	int16_t *d = dst;;
+	int16_t *d = dst;
 	int32_t v = scale * (1 << 11), t;
 
 	n_bytes /= sizeof(int16_t);
@@ -89,8 +89,8 @@ copy_scale_s16(void *dst, const void *src, const double scale, int n_bytes)
 	}
 }
 
-static void
-copy_scale_f32(void *dst, const void *src, const double scale, int n_bytes)
+void
+audiomixer_copy_scale_f32_c(void *dst, const void *src, const double scale, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -104,8 +104,8 @@ copy_scale_f32(void *dst, const void *src, const double scale, int n_bytes)
 	}
 }
 
-static void
-add_scale_s16(void *dst, const void *src, const double scale, int n_bytes)
+void
+audiomixer_add_scale_s16_c(void *dst, const void *src, const double scale, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -120,8 +120,8 @@ add_scale_s16(void *dst, const void *src, const double scale, int n_bytes)
 	}
 }
 
-static void
-add_scale_f32(void *dst, const void *src, const double scale, int n_bytes)
+void
+audiomixer_add_scale_f32_c(void *dst, const void *src, const double scale, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -135,8 +135,8 @@ add_scale_f32(void *dst, const void *src, const double scale, int n_bytes)
 	}
 }
 
-static void
-copy_s16_i(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+void
+audiomixer_copy_s16_i_c(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -149,8 +149,8 @@ copy_s16_i(void *dst, int dst_stride, const void *src, int src_stride, int n_byt
 	}
 }
 
-static void
-copy_f32_i(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+void
+audiomixer_copy_f32_i_c(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -163,8 +163,8 @@ copy_f32_i(void *dst, int dst_stride, const void *src, int src_stride, int n_byt
 	}
 }
 
-static void
-add_s16_i(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+void
+audiomixer_add_s16_i_c(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -179,8 +179,8 @@ add_s16_i(void *dst, int dst_stride, const void *src, int src_stride, int n_byte
 	}
 }
 
-static void
-add_f32_i(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
+void
+audiomixer_add_f32_i_c(void *dst, int dst_stride, const void *src, int src_stride, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -193,8 +193,8 @@ add_f32_i(void *dst, int dst_stride, const void *src, int src_stride, int n_byte
 	}
 }
 
-static void
-copy_scale_s16_i(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
+void
+audiomixer_copy_scale_s16_i_c(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -209,8 +209,8 @@ copy_scale_s16_i(void *dst, int dst_stride, const void *src, int src_stride, con
 	}
 }
 
-static void
-copy_scale_f32_i(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
+void
+audiomixer_copy_scale_f32_i_c(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -224,8 +224,8 @@ copy_scale_f32_i(void *dst, int dst_stride, const void *src, int src_stride, con
 	}
 }
 
-static void
-add_scale_s16_i(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
+void
+audiomixer_add_scale_s16_i_c(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
 {
 	const int16_t *s = src;
 	int16_t *d = dst;
@@ -240,8 +240,8 @@ add_scale_s16_i(void *dst, int dst_stride, const void *src, int src_stride, cons
 	}
 }
 
-static void
-add_scale_f32_i(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
+void
+audiomixer_add_scale_f32_i_c(void *dst, int dst_stride, const void *src, int src_stride, const double scale, int n_bytes)
 {
 	const float *s = src;
 	float *d = dst;
@@ -257,22 +257,59 @@ add_scale_f32_i(void *dst, int dst_stride, const void *src, int src_stride, cons
 
 void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops)
 {
-	ops->clear[FMT_S16] = clear_s16;
-	ops->clear[FMT_F32] = clear_f32;
-	ops->copy[FMT_S16] = copy_s16;
-	ops->copy[FMT_F32] = copy_f32;
-        ops->add[FMT_S16] = add_s16;
-        ops->add[FMT_F32] = add_f32;
-        ops->copy_scale[FMT_S16] = copy_scale_s16;
-        ops->copy_scale[FMT_F32] = copy_scale_f32;
-        ops->add_scale[FMT_S16] = add_scale_s16;
-        ops->add_scale[FMT_F32] = add_scale_f32;
-        ops->copy_i[FMT_S16] = copy_s16_i;
-        ops->copy_i[FMT_F32] = copy_f32_i;
-        ops->add_i[FMT_S16] = add_s16_i;
-        ops->add_i[FMT_F32] = add_f32_i;
-        ops->copy_scale_i[FMT_S16] = copy_scale_s16_i;
-        ops->copy_scale_i[FMT_F32] = copy_scale_f32_i;
-        ops->add_scale_i[FMT_S16] = add_scale_s16_i;
-        ops->add_scale_i[FMT_F32] = add_scale_f32_i;
+	ops->clear[FMT_S16] = audiomixer_clear_s16_c;
+	ops->clear[FMT_F32] = audiomixer_clear_f32_c;
+	ops->copy[FMT_S16] = audiomixer_copy_s16_c;
+	ops->copy[FMT_F32] = audiomixer_copy_f32_c;
+	ops->add[FMT_S16] = audiomixer_add_s16_c;
+	ops->add[FMT_F32] = audiomixer_add_f32_c;
+	ops->copy_scale[FMT_S16] = audiomixer_copy_scale_s16_c;
+	ops->copy_scale[FMT_F32] = audiomixer_copy_scale_f32_c;
+	ops->add_scale[FMT_S16] = audiomixer_add_scale_s16_c;
+	ops->add_scale[FMT_F32] = audiomixer_add_scale_f32_c;
+	ops->copy_i[FMT_S16] = audiomixer_copy_s16_i_c;
+	ops->copy_i[FMT_F32] = audiomixer_copy_f32_i_c;
+	ops->add_i[FMT_S16] = audiomixer_add_s16_i_c;
+	ops->add_i[FMT_F32] = audiomixer_add_f32_i_c;
+	ops->copy_scale_i[FMT_S16] = audiomixer_copy_scale_s16_i_c;
+	ops->copy_scale_i[FMT_F32] = audiomixer_copy_scale_f32_i_c;
+	ops->add_scale_i[FMT_S16] = audiomixer_add_scale_s16_i_c;
+	ops->add_scale_i[FMT_F32] = audiomixer_add_scale_f32_i_c;
+
+	/* clear and copy are left to memset/memcpy, which the C library
+	 * already vectorizes, the optimized variants only replace the
+	 * arithmetic ops. Later entries override earlier ones so that the
+	 * widest supported instruction set wins. */
+#if defined (HAVE_SSE2)
+	if (__builtin_cpu_supports("sse2")) {
+		ops->add[FMT_S16] = audiomixer_add_s16_sse2;
+		ops->add[FMT_F32] = audiomixer_add_f32_sse2;
+		ops->copy_scale[FMT_S16] = audiomixer_copy_scale_s16_sse2;
+		ops->copy_scale[FMT_F32] = audiomixer_copy_scale_f32_sse2;
+		ops->add_scale[FMT_S16] = audiomixer_add_scale_s16_sse2;
+		ops->add_scale[FMT_F32] = audiomixer_add_scale_f32_sse2;
+		ops->add_i[FMT_S16] = audiomixer_add_s16_i_sse2;
+		ops->add_i[FMT_F32] = audiomixer_add_f32_i_sse2;
+		ops->copy_scale_i[FMT_S16] = audiomixer_copy_scale_s16_i_sse2;
+		ops->copy_scale_i[FMT_F32] = audiomixer_copy_scale_f32_i_sse2;
+		ops->add_scale_i[FMT_S16] = audiomixer_add_scale_s16_i_sse2;
+		ops->add_scale_i[FMT_F32] = audiomixer_add_scale_f32_i_sse2;
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		ops->add[FMT_S16] = audiomixer_add_s16_avx2;
+		ops->add[FMT_F32] = audiomixer_add_f32_avx2;
+		ops->copy_scale[FMT_S16] = audiomixer_copy_scale_s16_avx2;
+		ops->copy_scale[FMT_F32] = audiomixer_copy_scale_f32_avx2;
+		ops->add_scale[FMT_S16] = audiomixer_add_scale_s16_avx2;
+		ops->add_scale[FMT_F32] = audiomixer_add_scale_f32_avx2;
+		ops->add_i[FMT_S16] = audiomixer_add_s16_i_avx2;
+		ops->add_i[FMT_F32] = audiomixer_add_f32_i_avx2;
+		ops->copy_scale_i[FMT_S16] = audiomixer_copy_scale_s16_i_avx2;
+		ops->copy_scale_i[FMT_F32] = audiomixer_copy_scale_f32_i_avx2;
+		ops->add_scale_i[FMT_S16] = audiomixer_add_scale_s16_i_avx2;
+		ops->add_scale_i[FMT_F32] = audiomixer_add_scale_f32_i_avx2;
+	}
+#endif
 }
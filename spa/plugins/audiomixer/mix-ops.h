@@ -49,3 +49,63 @@ struct spa_audiomixer_ops {
 };
 
 void spa_audiomixer_get_ops(struct spa_audiomixer_ops *ops);
+
+/* the ops are shared between the objects of the plugin only */
+#define MIX_INTERNAL	__attribute__((visibility("hidden")))
+
+#define DEFINE_MIX_FUNC(name,arch) \
+	MIX_INTERNAL void audiomixer_##name##_##arch(void *dst, const void *src, int n_bytes)
+#define DEFINE_MIX_SCALE_FUNC(name,arch) \
+	MIX_INTERNAL void audiomixer_##name##_##arch(void *dst, const void *src, \
+			const double scale, int n_bytes)
+#define DEFINE_MIX_I_FUNC(name,arch) \
+	MIX_INTERNAL void audiomixer_##name##_##arch(void *dst, int dst_stride, \
+			const void *src, int src_stride, int n_bytes)
+#define DEFINE_MIX_SCALE_I_FUNC(name,arch) \
+	MIX_INTERNAL void audiomixer_##name##_##arch(void *dst, int dst_stride, \
+			const void *src, int src_stride, const double scale, int n_bytes)
+
+/* reference implementations */
+MIX_INTERNAL void audiomixer_clear_s16_c(void *dst, int n_bytes);
+MIX_INTERNAL void audiomixer_clear_f32_c(void *dst, int n_bytes);
+DEFINE_MIX_FUNC(copy_s16, c);
+DEFINE_MIX_FUNC(copy_f32, c);
+DEFINE_MIX_FUNC(add_s16, c);
+DEFINE_MIX_FUNC(add_f32, c);
+DEFINE_MIX_SCALE_FUNC(copy_scale_s16, c);
+DEFINE_MIX_SCALE_FUNC(copy_scale_f32, c);
+DEFINE_MIX_SCALE_FUNC(add_scale_s16, c);
+DEFINE_MIX_SCALE_FUNC(add_scale_f32, c);
+DEFINE_MIX_I_FUNC(copy_s16_i, c);
+DEFINE_MIX_I_FUNC(copy_f32_i, c);
+DEFINE_MIX_I_FUNC(add_s16_i, c);
+DEFINE_MIX_I_FUNC(add_f32_i, c);
+DEFINE_MIX_SCALE_I_FUNC(copy_scale_s16_i, c);
+DEFINE_MIX_SCALE_I_FUNC(copy_scale_f32_i, c);
+DEFINE_MIX_SCALE_I_FUNC(add_scale_s16_i, c);
+DEFINE_MIX_SCALE_I_FUNC(add_scale_f32_i, c);
+
+/* vectorized implementations, selected at runtime in spa_audiomixer_get_ops()
+ * when the CPU supports them. The interleaved variants only vectorize the
+ * common dst_stride == src_stride == 1 case and fall back to the reference
+ * implementation otherwise. */
+#define DEFINE_MIX_SIMD_FUNCS(arch)				\
+	DEFINE_MIX_FUNC(add_s16, arch);				\
+	DEFINE_MIX_FUNC(add_f32, arch);				\
+	DEFINE_MIX_SCALE_FUNC(copy_scale_s16, arch);		\
+	DEFINE_MIX_SCALE_FUNC(copy_scale_f32, arch);		\
+	DEFINE_MIX_SCALE_FUNC(add_scale_s16, arch);		\
+	DEFINE_MIX_SCALE_FUNC(add_scale_f32, arch);		\
+	DEFINE_MIX_I_FUNC(add_s16_i, arch);			\
+	DEFINE_MIX_I_FUNC(add_f32_i, arch);			\
+	DEFINE_MIX_SCALE_I_FUNC(copy_scale_s16_i, arch);	\
+	DEFINE_MIX_SCALE_I_FUNC(copy_scale_f32_i, arch);	\
+	DEFINE_MIX_SCALE_I_FUNC(add_scale_s16_i, arch);		\
+	DEFINE_MIX_SCALE_I_FUNC(add_scale_f32_i, arch)
+
+#if defined (HAVE_SSE2)
+DEFINE_MIX_SIMD_FUNCS(sse2);
+#endif
+#if defined (HAVE_AVX2)
+DEFINE_MIX_SIMD_FUNCS(avx2);
+#endif
@@ -0,0 +1,171 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "mix-ops.h"
+
+/* checks that the vectorized ops give the same bits as the reference ops */
+
+#define MAX_SAMPLES	67
+#define MAX_STRIDE	2
+#define BUF_SIZE	(MAX_SAMPLES * MAX_STRIDE)
+
+enum op_kind {
+	OP_MIX,
+	OP_SCALE,
+	OP_MIX_I,
+	OP_SCALE_I,
+};
+
+struct op {
+	const char *name;
+	enum op_kind kind;
+	int fmt;
+	void *ref;
+	void *simd;
+};
+
+#define OP(k,n,f,arch)	{ #n, k, f, audiomixer_##n##_c, audiomixer_##n##_##arch }
+
+#define SIMD_OPS(arch) {							\
+	OP(OP_MIX, add_s16, FMT_S16, arch),					\
+	OP(OP_MIX, add_f32, FMT_F32, arch),					\
+	OP(OP_SCALE, copy_scale_s16, FMT_S16, arch),				\
+	OP(OP_SCALE, copy_scale_f32, FMT_F32, arch),				\
+	OP(OP_SCALE, add_scale_s16, FMT_S16, arch),				\
+	OP(OP_SCALE, add_scale_f32, FMT_F32, arch),				\
+	OP(OP_MIX_I, add_s16_i, FMT_S16, arch),					\
+	OP(OP_MIX_I, add_f32_i, FMT_F32, arch),					\
+	OP(OP_SCALE_I, copy_scale_s16_i, FMT_S16, arch),			\
+	OP(OP_SCALE_I, copy_scale_f32_i, FMT_F32, arch),			\
+	OP(OP_SCALE_I, add_scale_s16_i, FMT_S16, arch),				\
+	OP(OP_SCALE_I, add_scale_f32_i, FMT_F32, arch),				\
+}
+
+static const double scales[] = { 0.0, 0.25, 0.5, 1.0, 1.5, -0.75, 3.9, 16.5 };
+
+static void fill(void *data, int fmt, int n_samples)
+{
+	int i;
+
+	for (i = 0; i < n_samples; i++) {
+		if (fmt == FMT_S16) {
+			/* include the extremes to test the saturation */
+			switch (rand() % 8) {
+			case 0:
+				((int16_t *) data)[i] = INT16_MAX;
+				break;
+			case 1:
+				((int16_t *) data)[i] = INT16_MIN;
+				break;
+			default:
+				((int16_t *) data)[i] = rand();
+				break;
+			}
+		} else {
+			((float *) data)[i] = (rand() / (float) RAND_MAX) * 2.0f - 1.0f;
+		}
+	}
+}
+
+static int run_op(const char *arch, const struct op *op)
+{
+	float src[BUF_SIZE], ref[BUF_SIZE], dst[BUF_SIZE], init[BUF_SIZE];
+	int size = op->fmt == FMT_S16 ? sizeof(int16_t) : sizeof(float);
+	int n_samples, stride, n_strides, s, n_scales, n_bytes;
+
+	n_strides = op->kind == OP_MIX_I || op->kind == OP_SCALE_I ? MAX_STRIDE : 1;
+	n_scales = op->kind == OP_SCALE || op->kind == OP_SCALE_I ? SPA_N_ELEMENTS(scales) : 1;
+
+	for (n_samples = 0; n_samples <= MAX_SAMPLES; n_samples++) {
+		n_bytes = n_samples * size;
+		for (stride = 1; stride <= n_strides; stride++) {
+			for (s = 0; s < n_scales; s++) {
+				fill(src, op->fmt, BUF_SIZE);
+				fill(init, op->fmt, BUF_SIZE);
+				memcpy(ref, init, BUF_SIZE * size);
+				memcpy(dst, init, BUF_SIZE * size);
+
+				switch (op->kind) {
+				case OP_MIX:
+					((mix_func_t) op->ref)(ref, src, n_bytes);
+					((mix_func_t) op->simd)(dst, src, n_bytes);
+					break;
+				case OP_SCALE:
+					((mix_scale_func_t) op->ref)(ref, src, scales[s], n_bytes);
+					((mix_scale_func_t) op->simd)(dst, src, scales[s], n_bytes);
+					break;
+				case OP_MIX_I:
+					((mix_i_func_t) op->ref)(ref, stride, src, stride, n_bytes);
+					((mix_i_func_t) op->simd)(dst, stride, src, stride, n_bytes);
+					break;
+				case OP_SCALE_I:
+					((mix_scale_i_func_t) op->ref)(ref, stride, src, stride,
+								      scales[s], n_bytes);
+					((mix_scale_i_func_t) op->simd)(dst, stride, src, stride,
+								       scales[s], n_bytes);
+					break;
+				}
+				if (memcmp(ref, dst, BUF_SIZE * size) != 0) {
+					printf("%s %s: differs, %d samples, stride %d, scale %f\n",
+					       op->name, arch, n_samples, stride,
+					       n_scales > 1 ? scales[s] : 1.0);
+					return -1;
+				}
+			}
+		}
+	}
+	printf("%s %s: ok\n", op->name, arch);
+	return 0;
+}
+
+static int run_ops(const char *arch, const struct op *ops, int n_ops)
+{
+	int i, res = 0;
+
+	for (i = 0; i < n_ops; i++)
+		if (run_op(arch, &ops[i]) < 0)
+			res = -1;
+	return res;
+}
+
+int main(int argc, char *argv[])
+{
+	int res = 0;
+
+	srand(4711);
+
+#if defined (HAVE_SSE2)
+	if (__builtin_cpu_supports("sse2")) {
+		static const struct op ops[] = SIMD_OPS(sse2);
+		if (run_ops("sse2", ops, SPA_N_ELEMENTS(ops)) < 0)
+			res = -1;
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		static const struct op ops[] = SIMD_OPS(avx2);
+		if (run_ops("avx2", ops, SPA_N_ELEMENTS(ops)) < 0)
+			res = -1;
+	}
+#endif
+	return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -22,13 +22,20 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <spa/support/type-map.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
 #include <spa/support/plugin.h>
 #include <spa/utils/ringbuffer.h>
+#include <spa/utils/list.h>
 
 #define NAME "logger"
 
@@ -36,6 +43,16 @@
 
 #define TRACE_BUFFER (16*1024)
 
+/* binary trace records are kept in a ring per thread */
+#define TRACE_RING_SIZE		(64*1024)
+#define TRACE_MAX_ARGS		16
+#define TRACE_MAX_STRING	128
+#define TRACE_MAX_FORMAT	256
+#define TRACE_MAX_RECORD	(sizeof(struct trace_record) +				\
+				 2 * (TRACE_MAX_STRING + 8) + (TRACE_MAX_FORMAT + 8) +	\
+				 TRACE_MAX_ARGS * (TRACE_MAX_STRING + 8))
+#define TRACE_FLUSH_MSEC	100
+
 struct type {
 	uint32_t log;
 };
@@ -45,6 +62,47 @@ static inline void init_type(struct type *type, struct spa_type_map *map)
 	type->log = spa_type_map_get_id(map, SPA_TYPE__Log);
 }
 
+enum trace_arg {
+	TRACE_ARG_NONE,		/* no argument, for %% */
+	TRACE_ARG_INVALID,	/* can't be recorded */
+	TRACE_ARG_INT,
+	TRACE_ARG_LONG,
+	TRACE_ARG_LLONG,
+	TRACE_ARG_SIZE,
+	TRACE_ARG_INTMAX,
+	TRACE_ARG_DOUBLE,
+	TRACE_ARG_LDOUBLE,
+	TRACE_ARG_POINTER,
+	TRACE_ARG_STRING,
+};
+
+/* a trace message, followed by the file name, the function, the format
+ * and the raw arguments. The strings are copied because the code that
+ * logged can be unloaded before the record is formatted. The arguments
+ * are aligned to 8 bytes, strings are copied with their length in front.
+ * A formatted record has the message in place of the format. */
+struct trace_record {
+	uint32_t size;			/* size of the record and the arguments */
+	int32_t line;
+	uint64_t time;			/* CLOCK_MONOTONIC in nanoseconds */
+	uint32_t formatted;		/* the message was formatted already */
+	uint32_t padding;
+};
+
+#define TRACE_RING_DEAD		(1 << 0)	/* the thread exited */
+#define TRACE_RING_ORPHAN	(1 << 1)	/* the logger was cleared */
+
+/* the ring of a thread, freed by the reader or, when the logger is gone,
+ * by the thread when it exits */
+struct trace_ring {
+	struct spa_list link;
+	pid_t tid;
+	uint32_t state;			/* TRACE_RING_* flags */
+	uint32_t dropped;		/* records that did not fit */
+	struct spa_ringbuffer rb;
+	uint8_t data[TRACE_RING_SIZE];
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_log log;
@@ -57,8 +115,360 @@ struct impl {
 
 	bool have_source;
 	struct spa_source source;
+
+	bool binary;			/* record trace messages without formatting */
+	pthread_key_t ring_key;
+	pthread_mutex_t lock;		/* protects ring_list */
+	struct spa_list ring_list;
+	bool need_wakeup;		/* the reader is waiting for the eventfd */
+	bool have_thread;		/* no main loop, the thread reads the rings */
+	bool running;
+	pthread_t thread;
 };
 
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* parse the conversion after a '%' in a printf format. Returns the end of the
+ * conversion and stores the number of '*' and the type of the argument. */
+static const char *parse_conversion(const char *p, int *stars, enum trace_arg *arg)
+{
+	int longs = 0, shorts = 0;
+	char size = 0;
+
+	*stars = 0;
+
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+	if (*p == '*') {
+		(*stars)++;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9')
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			(*stars)++;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9')
+			p++;
+	}
+	for (;; p++) {
+		if (*p == 'l')
+			longs++;
+		else if (*p == 'h')
+			shorts++;
+		else if (*p == 'z' || *p == 't' || *p == 'j' || *p == 'L' || *p == 'q')
+			size = *p;
+		else
+			break;
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		if (size == 'z' || size == 't')
+			*arg = TRACE_ARG_SIZE;
+		else if (size == 'j')
+			*arg = TRACE_ARG_INTMAX;
+		else if (longs > 1 || size == 'q' || size == 'L')
+			*arg = TRACE_ARG_LLONG;
+		else if (longs == 1)
+			*arg = TRACE_ARG_LONG;
+		else
+			*arg = TRACE_ARG_INT;
+		break;
+	case 'c':
+		*arg = longs ? TRACE_ARG_INVALID : TRACE_ARG_INT;
+		break;
+	case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+		*arg = size == 'L' ? TRACE_ARG_LDOUBLE : TRACE_ARG_DOUBLE;
+		break;
+	case 's':
+		*arg = longs ? TRACE_ARG_INVALID : TRACE_ARG_STRING;
+		break;
+	case 'p':
+		*arg = TRACE_ARG_POINTER;
+		break;
+	case '%':
+		*arg = *stars ? TRACE_ARG_INVALID : TRACE_ARG_NONE;
+		break;
+	default:
+		*arg = TRACE_ARG_INVALID;
+		return *p ? p + 1 : p;
+	}
+	return p + 1;
+}
+
+#define TRACE_PUT(ptr,type,val)				\
+({							\
+	*(type *) (ptr) = (val);			\
+	(ptr) += SPA_ROUND_UP_N(sizeof(type), 8);	\
+})
+
+static inline uint8_t *trace_put_string(uint8_t *p, const char *str, uint32_t max)
+{
+	uint32_t len = strnlen(str, max - 1);
+
+	*(uint32_t *) p = len;
+	memcpy(p + sizeof(uint32_t), str, len);
+	p[sizeof(uint32_t) + len] = '\0';
+	return p + SPA_ROUND_UP_N(sizeof(uint32_t) + len + 1, 8);
+}
+
+static inline const char *trace_get_string(const uint8_t **p)
+{
+	const char *str = (const char *) *p + sizeof(uint32_t);
+
+	*p += SPA_ROUND_UP_N(sizeof(uint32_t) + *(const uint32_t *) *p + 1, 8);
+	return str;
+}
+
+/* copy the arguments of fmt to the record, returns the end of the record or
+ * NULL when the format can't be recorded */
+static uint8_t *trace_encode(uint8_t *p, const char *fmt, va_list args)
+{
+	uint32_t n_args = 0;
+	enum trace_arg arg;
+	int i, stars;
+
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		fmt = parse_conversion(fmt + 1, &stars, &arg);
+
+		if (arg == TRACE_ARG_INVALID || n_args + stars >= TRACE_MAX_ARGS)
+			return NULL;
+
+		for (i = 0; i < stars; i++)
+			TRACE_PUT(p, int, va_arg(args, int));
+		n_args += stars + 1;
+
+		switch (arg) {
+		case TRACE_ARG_INT:
+			TRACE_PUT(p, int, va_arg(args, int));
+			break;
+		case TRACE_ARG_LONG:
+			TRACE_PUT(p, long, va_arg(args, long));
+			break;
+		case TRACE_ARG_LLONG:
+			TRACE_PUT(p, long long, va_arg(args, long long));
+			break;
+		case TRACE_ARG_SIZE:
+			TRACE_PUT(p, size_t, va_arg(args, size_t));
+			break;
+		case TRACE_ARG_INTMAX:
+			TRACE_PUT(p, intmax_t, va_arg(args, intmax_t));
+			break;
+		case TRACE_ARG_DOUBLE:
+			TRACE_PUT(p, double, va_arg(args, double));
+			break;
+		case TRACE_ARG_LDOUBLE:
+			TRACE_PUT(p, long double, va_arg(args, long double));
+			break;
+		case TRACE_ARG_POINTER:
+			TRACE_PUT(p, void *, va_arg(args, void *));
+			break;
+		case TRACE_ARG_STRING:
+		{
+			const char *str = va_arg(args, const char *);
+
+			p = trace_put_string(p, str ? str : "(null)", TRACE_MAX_STRING);
+			break;
+		}
+		default:
+			n_args--;
+			break;
+		}
+	}
+	return p;
+}
+
+#define TRACE_GET(ptr,type)				\
+({							\
+	type _val = *(type *) (ptr);			\
+	(ptr) += SPA_ROUND_UP_N(sizeof(type), 8);	\
+	_val;						\
+})
+
+/* format the message of a record into text, \a p points to the format */
+static void trace_decode(const struct trace_record *rec, const uint8_t *p,
+			 char *text, size_t size)
+{
+	const char *fmt = trace_get_string(&p), *start;
+	char spec[64];
+	size_t len = 0;
+	enum trace_arg arg;
+	int i, res, stars;
+
+	if (rec->formatted) {
+		snprintf(text, size, "%s", fmt);
+		return;
+	}
+
+	text[0] = '\0';
+	while (*fmt && len < size - 1) {
+		if (*fmt != '%') {
+			start = fmt;
+			if ((fmt = strchr(fmt, '%')) == NULL)
+				fmt = start + strlen(start);
+			res = snprintf(text + len, size - len, "%.*s", (int) (fmt - start), start);
+			len += SPA_MIN((size_t) res, size - len - 1);
+			continue;
+		}
+
+		/* copy the conversion and put the width and precision in
+		 * place of the stars */
+		start = fmt;
+		fmt = parse_conversion(fmt + 1, &stars, &arg);
+		for (i = 0; start < fmt && i < (int) sizeof(spec) - 12; start++) {
+			if (*start == '*')
+				i += sprintf(spec + i, "%d", TRACE_GET(p, int));
+			else
+				spec[i++] = *start;
+		}
+		spec[i] = '\0';
+
+		switch (arg) {
+		case TRACE_ARG_INT:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, int));
+			break;
+		case TRACE_ARG_LONG:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, long));
+			break;
+		case TRACE_ARG_LLONG:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, long long));
+			break;
+		case TRACE_ARG_SIZE:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, size_t));
+			break;
+		case TRACE_ARG_INTMAX:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, intmax_t));
+			break;
+		case TRACE_ARG_DOUBLE:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, double));
+			break;
+		case TRACE_ARG_LDOUBLE:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, long double));
+			break;
+		case TRACE_ARG_POINTER:
+			res = snprintf(text + len, size - len, spec, TRACE_GET(p, void *));
+			break;
+		case TRACE_ARG_STRING:
+			res = snprintf(text + len, size - len, spec, trace_get_string(&p));
+			break;
+		default:
+			res = snprintf(text + len, size - len, "%%");
+			break;
+		}
+		if (res > 0)
+			len += SPA_MIN((size_t) res, size - len - 1);
+	}
+}
+
+static void trace_ring_free(void *data)
+{
+	struct trace_ring *ring = data;
+	/* the reader frees the ring when it is empty, unless it is gone */
+	if (__atomic_fetch_or(&ring->state, TRACE_RING_DEAD, __ATOMIC_ACQ_REL) & TRACE_RING_ORPHAN)
+		munmap(ring, sizeof(struct trace_ring));
+}
+
+static struct trace_ring *trace_ring_new(struct impl *impl)
+{
+	struct trace_ring *ring;
+
+	ring = mmap(NULL, sizeof(struct trace_ring), PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED)
+		return NULL;
+
+	/* don't take page faults when writing from a realtime thread */
+	mlock(ring, sizeof(struct trace_ring));
+
+	ring->tid = syscall(SYS_gettid);
+	spa_ringbuffer_init(&ring->rb);
+
+	pthread_mutex_lock(&impl->lock);
+	spa_list_append(&impl->ring_list, &ring->link);
+	pthread_mutex_unlock(&impl->lock);
+
+	pthread_setspecific(impl->ring_key, ring);
+
+	return ring;
+}
+
+/* record a trace message without formatting it. The first message of a
+ * thread allocates the ring of the thread. */
+static void
+trace_record(struct impl *impl, const char *file, int line, const char *func,
+	     const char *fmt, va_list args)
+{
+	struct trace_ring *ring;
+	struct trace_record *rec;
+	uint8_t buffer[TRACE_MAX_RECORD] __attribute__ ((aligned(8))), *p, *end;
+	const char *base;
+	uint32_t index, size;
+	int32_t filled;
+	uint64_t count = 1;
+	va_list copy;
+
+	if ((ring = pthread_getspecific(impl->ring_key)) == NULL &&
+	    (ring = trace_ring_new(impl)) == NULL)
+		return;
+
+	rec = (struct trace_record *) buffer;
+	rec->time = get_time_ns();
+	rec->line = line;
+	rec->formatted = false;
+
+	base = strrchr(file, '/');
+	p = trace_put_string(buffer + sizeof(struct trace_record),
+			     base ? base + 1 : file, TRACE_MAX_STRING);
+	p = trace_put_string(p, func, TRACE_MAX_STRING);
+
+	end = NULL;
+	if (strnlen(fmt, TRACE_MAX_FORMAT) < TRACE_MAX_FORMAT) {
+		va_copy(copy, args);
+		end = trace_encode(trace_put_string(p, fmt, TRACE_MAX_FORMAT), fmt, copy);
+		va_end(copy);
+	}
+	if (SPA_UNLIKELY(end == NULL)) {
+		/* not something we can decode later, format it now */
+		char text[TRACE_MAX_FORMAT];
+
+		vsnprintf(text, sizeof(text), fmt, args);
+		rec->formatted = true;
+		end = trace_put_string(p, text, TRACE_MAX_FORMAT);
+	}
+	rec->size = size = SPA_ROUND_UP_N(end - buffer, 8);
+
+	filled = spa_ringbuffer_get_write_index(&ring->rb, &index);
+	if (filled < 0 || filled + size > TRACE_RING_SIZE) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	spa_ringbuffer_write_data(&ring->rb, ring->data, TRACE_RING_SIZE,
+				  index & (TRACE_RING_SIZE - 1), buffer, size);
+	spa_ringbuffer_write_update(&ring->rb, index + size);
+
+	/* only wake up the reader when it is waiting. Our own thread also
+	 * wakes up periodically so it is only woken up when the ring fills up */
+	if (impl->have_thread && filled + size < TRACE_RING_SIZE / 2)
+		return;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&impl->need_wakeup, __ATOMIC_RELAXED) &&
+	    __atomic_exchange_n(&impl->need_wakeup, false, __ATOMIC_RELAXED)) {
+		if (write(impl->source.fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+			fprintf(stderr, "error signaling eventfd: %s\n", strerror(errno));
+	}
+}
+
 static void
 impl_log_logv(struct spa_log *log,
 	      enum spa_log_level level,
@@ -74,6 +484,11 @@ impl_log_logv(struct spa_log *log,
 	int size;
 	bool do_trace;
 
+	if (level == SPA_LOG_LEVEL_TRACE && impl->binary) {
+		trace_record(impl, file, line, func, fmt, args);
+		return;
+	}
+
 	if ((do_trace = (level == SPA_LOG_LEVEL_TRACE && impl->have_source)))
 		level++;
 
@@ -111,6 +526,83 @@ impl_log_log(struct spa_log *log,
 	va_end(args);
 }
 
+/* format the records of all threads, must be called from one thread */
+static void flush_trace_rings(struct impl *impl)
+{
+	struct trace_ring *ring, *t;
+	uint8_t buffer[TRACE_MAX_RECORD] __attribute__ ((aligned(8)));
+	struct trace_record *rec = (struct trace_record *) buffer;
+	const uint8_t *p;
+	const char *file, *func;
+	char text[1024];
+	int32_t avail;
+	uint32_t index, dropped;
+	bool dead;
+
+	pthread_mutex_lock(&impl->lock);
+	spa_list_for_each_safe(ring, t, &impl->ring_list, link) {
+		dead = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) & TRACE_RING_DEAD;
+
+		while ((avail = spa_ringbuffer_get_read_index(&ring->rb, &index)) > 0) {
+			uint32_t offset = index & (TRACE_RING_SIZE - 1);
+
+			spa_ringbuffer_read_data(&ring->rb, ring->data, TRACE_RING_SIZE,
+						 offset, buffer, sizeof(uint32_t));
+			spa_ringbuffer_read_data(&ring->rb, ring->data, TRACE_RING_SIZE,
+						 offset, buffer, rec->size);
+			spa_ringbuffer_read_update(&ring->rb, index + rec->size);
+
+			p = (const uint8_t *) (rec + 1);
+			file = trace_get_string(&p);
+			func = trace_get_string(&p);
+			trace_decode(rec, p, text, sizeof(text));
+			fprintf(stderr, "[T][%"PRIu64".%06"PRIu64"][%d][%s:%i %s()] %s\n",
+				rec->time / 1000000000, (rec->time % 1000000000) / 1000,
+				ring->tid, file, rec->line, func, text);
+		}
+		if ((dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED)) > 0)
+			fprintf(stderr, "[W][logger] %u trace messages of thread %d dropped\n",
+				dropped, ring->tid);
+
+		if (dead) {
+			spa_list_remove(&ring->link);
+			munmap(ring, sizeof(struct trace_ring));
+		}
+	}
+	pthread_mutex_unlock(&impl->lock);
+}
+
+static void flush_trace(struct impl *impl)
+{
+	flush_trace_rings(impl);
+
+	/* ask for a wakeup and look once more for records that were written
+	 * before the writers could see the flag */
+	__atomic_store_n(&impl->need_wakeup, true, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	flush_trace_rings(impl);
+}
+
+static void *trace_thread(void *data)
+{
+	struct impl *impl = data;
+	struct pollfd pfd = { impl->source.fd, POLLIN, 0 };
+	uint64_t count;
+
+	while (__atomic_load_n(&impl->running, __ATOMIC_RELAXED)) {
+		int res;
+
+		if ((res = poll(&pfd, 1, TRACE_FLUSH_MSEC)) < 0 && errno != EINTR)
+			break;
+		if (res > 0 && read(pfd.fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+			fprintf(stderr, "failed to read event fd: %s", strerror(errno));
+
+		flush_trace(impl);
+	}
+	return NULL;
+}
+
 static void on_trace_event(struct spa_source *source)
 {
 	struct impl *impl = source->data;
@@ -121,6 +613,9 @@ static void on_trace_event(struct spa_source *source)
 	if (read(source->fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
 		fprintf(stderr, "failed to read event fd: %s", strerror(errno));
 
+	if (impl->binary)
+		flush_trace(impl);
+
 	while ((avail = spa_ringbuffer_get_read_index(&impl->trace_rb, &index)) > 0) {
 		uint32_t offset, first;
 
@@ -172,11 +667,37 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	if (this->have_thread) {
+		uint64_t count = 1;
+
+		__atomic_store_n(&this->running, false, __ATOMIC_RELAXED);
+		if (write(this->source.fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+			fprintf(stderr, "error signaling eventfd: %s\n", strerror(errno));
+		pthread_join(this->thread, NULL);
+		close(this->source.fd);
+		this->have_thread = false;
+	}
 	if (this->have_source) {
 		spa_loop_remove_source(this->source.loop, &this->source);
 		close(this->source.fd);
 		this->have_source = false;
 	}
+	if (this->binary) {
+		struct trace_ring *ring, *t;
+
+		/* format what is left. The threads that are still alive can
+		 * write to their rings until they exit and free them then,
+		 * the key is kept so that its destructor still runs */
+		flush_trace_rings(this);
+		spa_list_for_each_safe(ring, t, &this->ring_list, link) {
+			spa_list_remove(&ring->link);
+			if (__atomic_fetch_or(&ring->state, TRACE_RING_ORPHAN,
+					      __ATOMIC_ACQ_REL) & TRACE_RING_DEAD)
+				munmap(ring, sizeof(struct trace_ring));
+		}
+		pthread_mutex_destroy(&this->lock);
+		this->binary = false;
+	}
 	return 0;
 }
 
@@ -190,6 +711,7 @@ impl_init(const struct spa_handle_factory *factory,
 	struct impl *this;
 	uint32_t i;
 	struct spa_loop *loop = NULL;
+	const char *str;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -213,6 +735,15 @@ impl_init(const struct spa_handle_factory *factory,
 	}
 	init_type(&this->type, this->map);
 
+	if (info && (str = spa_dict_lookup(info, SPA_LOG_PROP_TRACE)) &&
+	    strcmp(str, "binary") == 0) {
+		this->binary = true;
+		this->need_wakeup = true;
+		spa_list_init(&this->ring_list);
+		pthread_mutex_init(&this->lock, NULL);
+		pthread_key_create(&this->ring_key, trace_ring_free);
+	}
+
 	if (loop) {
 		this->source.func = on_trace_event;
 		this->source.data = this;
@@ -221,6 +752,18 @@ impl_init(const struct spa_handle_factory *factory,
 		this->source.rmask = 0;
 		spa_loop_add_source(loop, &this->source);
 		this->have_source = true;
+	} else if (this->binary) {
+		/* without a main loop, a thread of our own formats the records */
+		this->source.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		this->running = true;
+		if (pthread_create(&this->thread, NULL, trace_thread, this) == 0)
+			this->have_thread = true;
+		else {
+			close(this->source.fd);
+			pthread_key_delete(this->ring_key);
+			pthread_mutex_destroy(&this->lock);
+			this->binary = false;
+		}
 	}
 
 	spa_ringbuffer_init(&this->trace_rb);
@@ -0,0 +1,203 @@
+/* Simple Plugin API
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPA_LOOP_INVOKE_H__
+#define __SPA_LOOP_INVOKE_H__
+
+#include <errno.h>
+#include <semaphore.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include <spa/support/loop.h>
+#include <spa/support/log.h>
+#include <spa/utils/mpsc-queue.h>
+
+/* the queue of invoke items, shared by the loop implementations */
+
+#define INVOKE_QUEUE_SLOTS	256
+#define INVOKE_INLINE_SIZE	64
+#define INVOKE_LARGE_SLOTS	8	/* max 32 */
+#define INVOKE_LARGE_SIZE	4096
+
+/** \cond */
+
+struct invoke_ack {
+	sem_t sem;
+	int res;
+};
+
+struct invoke_item {
+	spa_invoke_func_t func;
+	uint32_t seq;
+	const void *data;
+	size_t size;
+	void *user_data;
+	struct invoke_ack *ack;		/* for blocking invoke */
+	int32_t large;			/* index of the large buffer with the data or -1 */
+	uint8_t inline_data[INVOKE_INLINE_SIZE];
+};
+
+struct invoke_queue {
+	struct spa_mpsc_queue queue;
+	int32_t space;			/* bumped when items are handled, futex */
+	int32_t waiting;		/* blocking callers waiting for space */
+	uint32_t large_free;		/* bitmask of the free large buffers */
+	uint32_t seqs[INVOKE_QUEUE_SLOTS];
+	struct invoke_item items[INVOKE_QUEUE_SLOTS];
+	uint8_t large[INVOKE_LARGE_SLOTS][INVOKE_LARGE_SIZE];
+};
+
+/** \endcond */
+
+static inline void invoke_queue_init(struct invoke_queue *queue)
+{
+	spa_mpsc_queue_init(&queue->queue, queue->seqs, INVOKE_QUEUE_SLOTS);
+	queue->space = 0;
+	queue->waiting = 0;
+	queue->large_free = (1u << INVOKE_LARGE_SLOTS) - 1;
+}
+
+/* take a free large buffer for the data of a non-blocking invoke, the
+ * callers can be realtime threads so nothing is allocated */
+static inline int32_t invoke_queue_get_large(struct invoke_queue *queue)
+{
+	uint32_t mask = __atomic_load_n(&queue->large_free, __ATOMIC_ACQUIRE);
+
+	while (mask != 0) {
+		int32_t i = __builtin_ctz(mask);
+
+		if (__atomic_compare_exchange_n(&queue->large_free, &mask, mask & ~(1u << i),
+						false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return i;
+	}
+	return -1;
+}
+
+static inline void invoke_queue_put_large(struct invoke_queue *queue, int32_t i)
+{
+	__atomic_fetch_or(&queue->large_free, 1u << i, __ATOMIC_RELEASE);
+}
+
+/* sleep until the loop handled some items, the items in the full queue
+ * already woke up the loop */
+static inline void invoke_queue_wait_space(struct invoke_queue *queue, int32_t space)
+{
+	__atomic_add_fetch(&queue->waiting, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &queue->space, FUTEX_WAIT_PRIVATE, space, NULL, NULL, 0);
+	__atomic_sub_fetch(&queue->waiting, 1, __ATOMIC_SEQ_CST);
+}
+
+/* queue an invoke item, can be called from any thread. When \a ack is
+ * given, the caller must wait for it to be posted. */
+static inline int invoke_queue_push(struct invoke_queue *queue, struct spa_log *log,
+				    spa_invoke_func_t func, uint32_t seq,
+				    const void *data, size_t size,
+				    void *user_data, struct invoke_ack *ack)
+{
+	struct invoke_item *item;
+	uint32_t index;
+	int32_t large = -1;
+
+	/* a blocking caller waits until the item is handled so the data
+	 * doesn't need to be copied */
+	if (ack == NULL && size > INVOKE_INLINE_SIZE) {
+		if (size > INVOKE_LARGE_SIZE) {
+			spa_log_warn(log, "invoke queue %p: data too large %zd", queue, size);
+			return -ENOSPC;
+		}
+		if ((large = invoke_queue_get_large(queue)) < 0) {
+			spa_log_warn(log, "invoke queue %p: no space for data", queue);
+			return -EPIPE;
+		}
+		memcpy(queue->large[large], data, size);
+	}
+
+	while (true) {
+		int32_t space = __atomic_load_n(&queue->space, __ATOMIC_SEQ_CST);
+
+		if (spa_mpsc_queue_get_write_index(&queue->queue, &index))
+			break;
+
+		if (ack == NULL) {
+			spa_log_warn(log, "invoke queue %p: queue full", queue);
+			if (large >= 0)
+				invoke_queue_put_large(queue, large);
+			return -EPIPE;
+		}
+		invoke_queue_wait_space(queue, space);
+	}
+
+	item = &queue->items[index & (INVOKE_QUEUE_SLOTS - 1)];
+	item->func = func;
+	item->seq = seq;
+	item->size = size;
+	item->user_data = user_data;
+	item->ack = ack;
+	item->large = large;
+
+	if (large >= 0)
+		item->data = queue->large[large];
+	else if (size > INVOKE_INLINE_SIZE)
+		item->data = data;
+	else {
+		memcpy(item->inline_data, data, size);
+		item->data = item->inline_data;
+	}
+
+	spa_mpsc_queue_write_update(&queue->queue, index);
+
+	return 0;
+}
+
+/* call the queued items, must be called from the loop thread */
+static inline void invoke_queue_process(struct invoke_queue *queue, struct spa_loop *loop)
+{
+	uint32_t index;
+	bool handled = false;
+
+	while (spa_mpsc_queue_get_read_index(&queue->queue, &index)) {
+		struct invoke_item *item = &queue->items[index & (INVOKE_QUEUE_SLOTS - 1)];
+		struct invoke_ack *ack = item->ack;
+		int res;
+
+		res = item->func(loop, true, item->seq, item->data, item->size,
+				 item->user_data);
+		if (item->large >= 0)
+			invoke_queue_put_large(queue, item->large);
+
+		spa_mpsc_queue_read_update(&queue->queue, index);
+		handled = true;
+
+		if (ack) {
+			ack->res = res;
+			sem_post(&ack->sem);
+		}
+	}
+	if (handled) {
+		__atomic_add_fetch(&queue->space, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&queue->waiting, __ATOMIC_SEQ_CST) > 0)
+			syscall(SYS_futex, &queue->space, FUTEX_WAKE_PRIVATE, INT32_MAX,
+				NULL, NULL, 0);
+	}
+}
+
+#endif /* __SPA_LOOP_INVOKE_H__ */
@@ -0,0 +1,1248 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <pthread.h>
+
+#include <linux/io_uring.h>
+
+#include <spa/support/loop.h>
+#include <spa/support/log.h>
+#include <spa/support/type-map.h>
+#include <spa/support/plugin.h>
+#include <spa/utils/list.h>
+
+#include "loop-invoke.h"
+
+#define NAME "loop-uring"
+
+#define RING_ENTRIES	256
+#define MAX_COMPLETIONS	64
+
+#define NSEC_PER_SEC	1000000000ull
+
+/** \cond */
+
+struct type {
+	uint32_t loop;
+	uint32_t loop_control;
+	uint32_t loop_utils;
+};
+
+static inline void init_type(struct type *type, struct spa_type_map *map)
+{
+	type->loop = spa_type_map_get_id(map, SPA_TYPE__Loop);
+	type->loop_control = spa_type_map_get_id(map, SPA_TYPE__LoopControl);
+	type->loop_utils = spa_type_map_get_id(map, SPA_TYPE__LoopUtils);
+}
+
+struct ring {
+	int fd;
+
+	void *ptr;
+	size_t size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	unsigned sqe_tail;		/* our copy of the tail */
+
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+enum request_type {
+	REQUEST_POLL,
+	REQUEST_EVENT,
+	REQUEST_TIMER,
+	REQUEST_SIGNAL,
+};
+
+/* an operation on the ring, the user_data of the submission. There is at
+ * most one operation in flight for each request. The operations to cancel
+ * or update a request have no request and their completion is ignored. */
+struct request {
+	struct spa_list link;
+	enum request_type type;
+	struct spa_source *source;	/* NULL when removed */
+	bool armed;			/* operation in flight */
+	int res;			/* result of the completion */
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_loop loop;
+	struct spa_loop_control control;
+	struct spa_loop_utils utils;
+
+        struct spa_log *log;
+        struct type type;
+        struct spa_type_map *map;
+
+	struct spa_list source_list;
+	struct spa_list destroy_list;
+	struct spa_list idle_list;
+	struct spa_list poll_list;	/* poll requests of the fd sources */
+	struct spa_list dead_list;	/* removed poll requests */
+	struct spa_hook_list hooks_list;
+
+	struct ring ring;
+	pthread_mutex_t lock;		/* protects the submission queue */
+	pthread_t thread;
+
+	struct spa_source *wakeup;
+
+	struct invoke_queue queue;
+};
+
+struct source_impl {
+	struct spa_source source;
+
+	struct impl *impl;
+	struct spa_list link;
+	struct spa_list idle_link;
+
+	struct request req;
+
+	bool close;
+	union {
+		spa_source_io_func_t io;
+		spa_source_idle_func_t idle;
+		spa_source_event_func_t event;
+		spa_source_timer_func_t timer;
+		spa_source_signal_func_t signal;
+	} func;
+	int signal_number;
+	bool enabled;
+
+	union {
+		uint64_t count;
+		struct signalfd_siginfo signal_info;
+	} buffer;
+
+	uint64_t deadline;		/* next expiration of the timer or 0 */
+	uint64_t interval;
+	struct __kernel_timespec ts;
+};
+/** \endcond */
+
+static inline uint32_t spa_io_to_poll(enum spa_io mask)
+{
+	uint32_t events = 0;
+
+	if (mask & SPA_IO_IN)
+		events |= POLLIN;
+	if (mask & SPA_IO_OUT)
+		events |= POLLOUT;
+	if (mask & SPA_IO_ERR)
+		events |= POLLERR;
+	if (mask & SPA_IO_HUP)
+		events |= POLLHUP;
+
+	return events;
+}
+
+static inline enum spa_io spa_poll_to_io(uint32_t events)
+{
+	enum spa_io mask = 0;
+
+	if (events & POLLIN)
+		mask |= SPA_IO_IN;
+	if (events & POLLOUT)
+		mask |= SPA_IO_OUT;
+	if (events & POLLHUP)
+		mask |= SPA_IO_HUP;
+	if (events & POLLERR)
+		mask |= SPA_IO_ERR;
+
+	return mask;
+}
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static inline uint64_t timespec_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static inline int ring_enter(struct ring *ring, unsigned to_submit, unsigned min_complete,
+			     unsigned flags, struct io_uring_getevents_arg *arg)
+{
+	return syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+		       flags, arg, arg ? sizeof(*arg) : 0);
+}
+
+/* check that the kernel can update polls and timeouts. There are no
+ * feature flags for those, older kernels fail the update of an unknown
+ * request with -EINVAL instead of -ENOENT */
+static int ring_probe(struct ring *ring)
+{
+	struct __kernel_timespec ts = { 0, 0 };
+	struct io_uring_sqe *sqe;
+	unsigned i, index, head;
+	int res = 0;
+
+	for (i = 0; i < 2; i++) {
+		index = ring->sqe_tail & *ring->sq_mask;
+		sqe = &ring->sqes[index];
+		spa_zero(*sqe);
+		sqe->fd = -1;
+		sqe->addr = 1;
+		sqe->user_data = 1;
+		if (i == 0) {
+			sqe->opcode = IORING_OP_POLL_REMOVE;
+			sqe->len = IORING_POLL_UPDATE_EVENTS;
+		} else {
+			sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+			sqe->addr2 = (uintptr_t) &ts;
+			sqe->timeout_flags = IORING_TIMEOUT_UPDATE;
+		}
+		ring->sq_array[index] = index;
+		ring->sqe_tail++;
+	}
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+	if (ring_enter(ring, 2, 2, IORING_ENTER_GETEVENTS, NULL) < 0)
+		return -errno;
+
+	head = *ring->cq_head;
+	for (i = 0; i < 2; i++, head++) {
+		if (ring->cqes[head & *ring->cq_mask].res == -EINVAL)
+			res = -ENOTSUP;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+	return res;
+}
+
+static int ring_init(struct ring *ring, unsigned entries)
+{
+	struct io_uring_params p;
+	size_t sq_size, cq_size;
+	int res;
+
+	spa_zero(p);
+	if ((ring->fd = syscall(__NR_io_uring_setup, entries, &p)) < 0)
+		return -errno;
+
+	/* we need one mapping for both rings, the wait with a timeout
+	 * and no dropped completions */
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP) ||
+	    !(p.features & IORING_FEAT_EXT_ARG) ||
+	    !(p.features & IORING_FEAT_NODROP)) {
+		res = -ENOTSUP;
+		goto error_close;
+	}
+
+	sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->size = SPA_MAX(sq_size, cq_size);
+
+	ring->ptr = mmap(NULL, ring->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->ptr == MAP_FAILED) {
+		res = -errno;
+		goto error_close;
+	}
+
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		res = -errno;
+		goto error_unmap;
+	}
+
+	ring->sq_head = SPA_MEMBER(ring->ptr, p.sq_off.head, unsigned);
+	ring->sq_tail = SPA_MEMBER(ring->ptr, p.sq_off.tail, unsigned);
+	ring->sq_mask = SPA_MEMBER(ring->ptr, p.sq_off.ring_mask, unsigned);
+	ring->sq_array = SPA_MEMBER(ring->ptr, p.sq_off.array, unsigned);
+	ring->sq_entries = p.sq_entries;
+	ring->sqe_tail = *ring->sq_tail;
+
+	ring->cq_head = SPA_MEMBER(ring->ptr, p.cq_off.head, unsigned);
+	ring->cq_tail = SPA_MEMBER(ring->ptr, p.cq_off.tail, unsigned);
+	ring->cq_mask = SPA_MEMBER(ring->ptr, p.cq_off.ring_mask, unsigned);
+	ring->cqes = SPA_MEMBER(ring->ptr, p.cq_off.cqes, struct io_uring_cqe);
+
+	if ((res = ring_probe(ring)) < 0)
+		goto error_unmap_sqes;
+
+	return 0;
+
+      error_unmap_sqes:
+	munmap(ring->sqes, ring->sqes_size);
+      error_unmap:
+	munmap(ring->ptr, ring->size);
+      error_close:
+	close(ring->fd);
+	return res;
+}
+
+static void ring_clear(struct ring *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	munmap(ring->ptr, ring->size);
+	close(ring->fd);
+}
+
+/* number of queued submissions, called with the lock */
+static inline unsigned ring_queued(struct ring *ring)
+{
+	return ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/* get a free submission entry, called with the lock */
+static struct io_uring_sqe *get_sqe(struct impl *impl)
+{
+	struct ring *ring = &impl->ring;
+	struct io_uring_sqe *sqe;
+
+	if (ring_queued(ring) >= ring->sq_entries) {
+		/* full, flush the queued entries */
+		if (ring_enter(ring, ring_queued(ring), 0, 0, NULL) < 0 ||
+		    ring_queued(ring) >= ring->sq_entries) {
+			spa_log_error(impl->log, NAME " %p: submission queue full", impl);
+			return NULL;
+		}
+	}
+	sqe = &ring->sqes[ring->sqe_tail & *ring->sq_mask];
+	spa_zero(*sqe);
+	return sqe;
+}
+
+/* make the prepared entry visible, called with the lock. The loop thread
+ * submits the entries when it waits for events, other threads submit
+ * right away. */
+static void queue_sqe(struct impl *impl)
+{
+	struct ring *ring = &impl->ring;
+	unsigned index = ring->sqe_tail & *ring->sq_mask;
+
+	ring->sq_array[index] = index;
+	ring->sqe_tail++;
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+	if (!pthread_equal(impl->thread, pthread_self())) {
+		if (ring_enter(ring, ring_queued(ring), 0, 0, NULL) < 0)
+			spa_log_warn(impl->log, NAME " %p: failed to submit: %s",
+				     impl, strerror(errno));
+	}
+}
+
+static int submit_poll(struct impl *impl, struct request *req)
+{
+	struct io_uring_sqe *sqe;
+	int res = 0;
+
+	pthread_mutex_lock(&impl->lock);
+	if ((sqe = get_sqe(impl)) == NULL) {
+		res = -EBUSY;
+		goto done;
+	}
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = req->source->fd;
+	sqe->poll32_events = spa_io_to_poll(req->source->mask);
+	sqe->user_data = (uintptr_t) req;
+	req->armed = true;
+	queue_sqe(impl);
+      done:
+	pthread_mutex_unlock(&impl->lock);
+	return res;
+}
+
+/* the event and signal fds are blocking, the read stays in flight until
+ * the fd is signaled and the data arrives with the completion */
+static int submit_read(struct impl *impl, struct source_impl *s, void *data, size_t size)
+{
+	struct io_uring_sqe *sqe;
+	int res = 0;
+
+	pthread_mutex_lock(&impl->lock);
+	if ((sqe = get_sqe(impl)) == NULL) {
+		res = -EBUSY;
+		goto done;
+	}
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = s->source.fd;
+	sqe->addr = (uintptr_t) data;
+	sqe->len = size;
+	sqe->off = -1;
+	sqe->user_data = (uintptr_t) &s->req;
+	s->req.armed = true;
+	queue_sqe(impl);
+      done:
+	pthread_mutex_unlock(&impl->lock);
+	return res;
+}
+
+static inline int submit_read_event(struct impl *impl, struct source_impl *s)
+{
+	return submit_read(impl, s, &s->buffer.count, sizeof(uint64_t));
+}
+
+static inline int submit_read_signal(struct impl *impl, struct source_impl *s)
+{
+	return submit_read(impl, s, &s->buffer.signal_info, sizeof(struct signalfd_siginfo));
+}
+
+static int submit_timeout(struct impl *impl, struct source_impl *s, bool update)
+{
+	struct io_uring_sqe *sqe;
+	int res = 0;
+
+	s->ts.tv_sec = s->deadline / NSEC_PER_SEC;
+	s->ts.tv_nsec = s->deadline % NSEC_PER_SEC;
+
+	pthread_mutex_lock(&impl->lock);
+	if ((sqe = get_sqe(impl)) == NULL) {
+		res = -EBUSY;
+		goto done;
+	}
+	if (update) {
+		/* change the expiration of the timeout in flight, when it
+		 * already expired the completion rearms it */
+		sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+		sqe->addr = (uintptr_t) &s->req;
+		sqe->addr2 = (uintptr_t) &s->ts;
+		sqe->timeout_flags = IORING_TIMEOUT_UPDATE | IORING_TIMEOUT_ABS;
+	} else {
+		sqe->opcode = IORING_OP_TIMEOUT;
+		sqe->addr = (uintptr_t) &s->ts;
+		sqe->len = 1;
+		sqe->timeout_flags = IORING_TIMEOUT_ABS;
+		sqe->user_data = (uintptr_t) &s->req;
+		s->req.armed = true;
+	}
+	queue_sqe(impl);
+      done:
+	pthread_mutex_unlock(&impl->lock);
+	return res;
+}
+
+static void submit_cancel(struct impl *impl, struct request *req)
+{
+	struct io_uring_sqe *sqe;
+
+	pthread_mutex_lock(&impl->lock);
+	if ((sqe = get_sqe(impl)) != NULL) {
+		switch (req->type) {
+		case REQUEST_POLL:
+			sqe->opcode = IORING_OP_POLL_REMOVE;
+			break;
+		case REQUEST_TIMER:
+			sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+			break;
+		default:
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			break;
+		}
+		sqe->addr = (uintptr_t) req;
+		queue_sqe(impl);
+	}
+	pthread_mutex_unlock(&impl->lock);
+}
+
+static struct request *find_poll_request(struct impl *impl, struct spa_source *source)
+{
+	struct request *req;
+
+	spa_list_for_each(req, &impl->poll_list, link) {
+		if (req->source == source)
+			return req;
+	}
+	return NULL;
+}
+
+static int loop_add_source(struct spa_loop *loop, struct spa_source *source)
+{
+	struct impl *impl = SPA_CONTAINER_OF(loop, struct impl, loop);
+	struct request *req;
+
+	source->loop = loop;
+
+	if (source->fd != -1) {
+		req = calloc(1, sizeof(struct request));
+		if (req == NULL)
+			return -errno;
+
+		req->type = REQUEST_POLL;
+		req->source = source;
+		spa_list_append(&impl->poll_list, &req->link);
+
+		return submit_poll(impl, req);
+	}
+	return 0;
+}
+
+static int loop_update_source(struct spa_source *source)
+{
+	struct spa_loop *loop = source->loop;
+	struct impl *impl = SPA_CONTAINER_OF(loop, struct impl, loop);
+	struct io_uring_sqe *sqe;
+	struct request *req;
+	int res = 0;
+
+	if (source->fd == -1 || (req = find_poll_request(impl, source)) == NULL)
+		return 0;
+
+	/* a poll that completed is rearmed with the new mask */
+	if (!req->armed)
+		return 0;
+
+	pthread_mutex_lock(&impl->lock);
+	if ((sqe = get_sqe(impl)) == NULL) {
+		res = -EBUSY;
+		goto done;
+	}
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->addr = (uintptr_t) req;
+	sqe->len = IORING_POLL_UPDATE_EVENTS;
+	sqe->poll32_events = spa_io_to_poll(source->mask);
+	queue_sqe(impl);
+      done:
+	pthread_mutex_unlock(&impl->lock);
+	return res;
+}
+
+static void loop_remove_source(struct spa_source *source)
+{
+	struct spa_loop *loop = source->loop;
+	struct impl *impl = SPA_CONTAINER_OF(loop, struct impl, loop);
+	struct request *req;
+
+	if (source->fd != -1 && (req = find_poll_request(impl, source)) != NULL) {
+		/* the request is freed when the poll in flight completes */
+		req->source = NULL;
+		spa_list_remove(&req->link);
+		spa_list_append(&impl->dead_list, &req->link);
+		if (req->armed)
+			submit_cancel(impl, req);
+	}
+	source->loop = NULL;
+}
+
+static int
+loop_invoke(struct spa_loop *loop,
+	    spa_invoke_func_t func,
+	    uint32_t seq,
+	    const void *data,
+	    size_t size,
+	    bool block,
+	    void *user_data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(loop, struct impl, loop);
+	bool in_thread = pthread_equal(impl->thread, pthread_self());
+	struct invoke_ack ack;
+	int res;
+
+	if (in_thread)
+		return func(loop, false, seq, data, size, user_data);
+
+	if (block)
+		sem_init(&ack.sem, 0, 0);
+
+	if ((res = invoke_queue_push(&impl->queue, impl->log, func, seq, data, size,
+				     user_data, block ? &ack : NULL)) < 0) {
+		if (block)
+			sem_destroy(&ack.sem);
+		return res;
+	}
+
+	spa_loop_utils_signal_event(&impl->utils, impl->wakeup);
+
+	if (block) {
+		spa_loop_control_hook_before(&impl->hooks_list);
+
+		while (sem_wait(&ack.sem) < 0 && errno == EINTR);
+
+		spa_loop_control_hook_after(&impl->hooks_list);
+
+		sem_destroy(&ack.sem);
+		res = ack.res;
+	}
+	else {
+		if (seq != SPA_ID_INVALID)
+			res = SPA_RESULT_RETURN_ASYNC(seq);
+		else
+			res = 0;
+	}
+	return res;
+}
+
+static void wakeup_func(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	invoke_queue_process(&impl->queue, &impl->loop);
+}
+
+static int loop_get_fd(struct spa_loop_control *ctrl)
+{
+	struct impl *impl = SPA_CONTAINER_OF(ctrl, struct impl, control);
+
+	return impl->ring.fd;
+}
+
+static void
+loop_add_hooks(struct spa_loop_control *ctrl,
+	       struct spa_hook *hook,
+	       const struct spa_loop_control_hooks *hooks,
+	       void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(ctrl, struct impl, control);
+
+	spa_hook_list_append(&impl->hooks_list, hook, hooks, data);
+}
+
+static void loop_enter(struct spa_loop_control *ctrl)
+{
+	struct impl *impl = SPA_CONTAINER_OF(ctrl, struct impl, control);
+	impl->thread = pthread_self();
+}
+
+static void loop_leave(struct spa_loop_control *ctrl)
+{
+	struct impl *impl = SPA_CONTAINER_OF(ctrl, struct impl, control);
+	impl->thread = 0;
+}
+
+static void process_destroy(struct impl *impl)
+{
+	struct source_impl *source, *tmp;
+	struct request *req, *treq;
+
+	/* sources with an operation in flight are freed when it completes */
+	spa_list_for_each_safe(source, tmp, &impl->destroy_list, link) {
+		if (!source->req.armed) {
+			spa_list_remove(&source->link);
+			free(source);
+		}
+	}
+	spa_list_for_each_safe(req, treq, &impl->dead_list, link) {
+		if (!req->armed) {
+			spa_list_remove(&req->link);
+			free(req);
+		}
+	}
+}
+
+static void complete_poll(struct impl *impl, struct request *req)
+{
+	struct spa_source *s = req->source;
+
+	if (req->res < 0) {
+		if (req->res != -ECANCELED)
+			spa_log_warn(impl->log, NAME " %p: poll on fd %d failed: %s",
+				     impl, s->fd, strerror(-req->res));
+		return;
+	}
+	if (s->rmask)
+		s->func(s);
+
+	/* the source can be removed or updated in the callback */
+	if (req->source == s && !req->armed)
+		submit_poll(impl, req);
+}
+
+/* the completion of a read carries the data, a short read or an error
+ * is logged and the read is queued again */
+static bool complete_read(struct impl *impl, struct source_impl *s, size_t size)
+{
+	if (s->req.res == -ECANCELED)
+		return false;
+	if (s->req.res < 0)
+		spa_log_warn(impl->log, NAME " %p: failed to read fd %d: %s",
+			     &s->source, s->source.fd, strerror(-s->req.res));
+	else if ((size_t) s->req.res != size)
+		spa_log_warn(impl->log, NAME " %p: short read on fd %d: %d",
+			     &s->source, s->source.fd, s->req.res);
+	return s->req.res == (int) size;
+}
+
+/* an fd that fails to read would fail again, don't queue a new read then */
+static inline bool read_again(struct source_impl *s)
+{
+	return s->req.res >= 0 || s->req.res == -EINTR || s->req.res == -EAGAIN;
+}
+
+static void complete_event(struct impl *impl, struct source_impl *s)
+{
+	bool ok = complete_read(impl, s, sizeof(uint64_t));
+	uint64_t count = s->buffer.count;
+
+	/* queue the next read before the callback, it can destroy the source */
+	if (read_again(s))
+		submit_read_event(impl, s);
+	if (ok)
+		s->func.event(s->source.data, count);
+}
+
+static void complete_signal(struct impl *impl, struct source_impl *s)
+{
+	bool ok = complete_read(impl, s, sizeof(struct signalfd_siginfo));
+
+	if (read_again(s))
+		submit_read_signal(impl, s);
+	if (ok)
+		s->func.signal(s->source.data, s->signal_number);
+}
+
+static void complete_timer(struct impl *impl, struct source_impl *s)
+{
+	uint64_t now, expirations = 1;
+
+	if (s->req.res != -ETIME && s->req.res != -ECANCELED)
+		spa_log_warn(impl->log, NAME " %p: timeout failed: %s",
+			     &s->source, strerror(-s->req.res));
+
+	/* disarmed */
+	if (s->deadline == 0)
+		return;
+
+	/* cancelled or expired before an update, wait for the new deadline */
+	now = get_time_ns();
+	if (s->req.res != -ETIME || now < s->deadline) {
+		submit_timeout(impl, s, false);
+		return;
+	}
+
+	if (s->interval > 0) {
+		s->deadline += s->interval;
+		while (s->deadline <= now) {
+			s->deadline += s->interval;
+			expirations++;
+		}
+		submit_timeout(impl, s, false);
+	} else
+		s->deadline = 0;
+
+	s->func.timer(s->source.data, expirations);
+}
+
+static void complete_request(struct impl *impl, struct request *req)
+{
+	struct source_impl *s;
+
+	if (req->source == NULL)
+		return;
+
+	if (req->type == REQUEST_POLL) {
+		complete_poll(impl, req);
+		return;
+	}
+
+	s = SPA_CONTAINER_OF(req, struct source_impl, req);
+	switch (req->type) {
+	case REQUEST_EVENT:
+		complete_event(impl, s);
+		break;
+	case REQUEST_SIGNAL:
+		complete_signal(impl, s);
+		break;
+	case REQUEST_TIMER:
+		complete_timer(impl, s);
+		break;
+	default:
+		break;
+	}
+}
+
+static int loop_iterate(struct spa_loop_control *ctrl, int timeout)
+{
+	struct impl *impl = SPA_CONTAINER_OF(ctrl, struct impl, control);
+	struct ring *ring = &impl->ring;
+	struct request *reqs[MAX_COMPLETIONS];
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	struct source_impl *source, *tmp;
+	unsigned head, tail, to_submit;
+	int i, n_reqs, res, save_errno = 0;
+
+	/* enabled idle sources are dispatched in each iteration */
+	if (!spa_list_is_empty(&impl->idle_list))
+		timeout = 0;
+
+	spa_zero(arg);
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		arg.ts = (uintptr_t) &ts;
+	}
+
+	spa_loop_control_hook_before(&impl->hooks_list);
+
+	/* submit the queued entries and wait in one call */
+	pthread_mutex_lock(&impl->lock);
+	to_submit = ring_queued(ring);
+	pthread_mutex_unlock(&impl->lock);
+
+	if (SPA_UNLIKELY((res = ring_enter(ring, to_submit, 1,
+					   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+					   &arg)) < 0))
+		save_errno = errno;
+
+	spa_loop_control_hook_after(&impl->hooks_list);
+
+	if (SPA_UNLIKELY(res < 0 && save_errno != ETIME))
+		return save_errno;
+
+	/* first we collect all the completions and set the rmasks, then
+	 * call the callbacks. The reason is that some callback might also want
+	 * to look at other sources it manages and can then reset the rmask
+	 * to suppress the callback */
+	head = *ring->cq_head;
+	tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	for (n_reqs = 0; head != tail && n_reqs < MAX_COMPLETIONS; head++) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		struct request *req = (struct request *) (uintptr_t) cqe->user_data;
+
+		if (req == NULL)
+			continue;
+
+		req->armed = false;
+		req->res = cqe->res;
+		if (req->type == REQUEST_POLL && req->source)
+			req->source->rmask = cqe->res > 0 ? spa_poll_to_io(cqe->res) : 0;
+
+		reqs[n_reqs++] = req;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+	for (i = 0; i < n_reqs; i++)
+		complete_request(impl, reqs[i]);
+
+	spa_list_for_each_safe(source, tmp, &impl->idle_list, idle_link)
+		source->func.idle(source->source.data);
+
+	process_destroy(impl);
+
+	return 0;
+}
+
+static void source_io_func(struct spa_source *source)
+{
+	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
+	impl->func.io(source->data, source->fd, source->rmask);
+}
+
+static struct source_impl *new_source(struct impl *impl, int fd, bool close,
+				      enum request_type type, void *data)
+{
+	struct source_impl *source;
+
+	source = calloc(1, sizeof(struct source_impl));
+	if (source == NULL)
+		return NULL;
+
+	source->source.loop = &impl->loop;
+	source->source.data = data;
+	source->source.fd = fd;
+	source->impl = impl;
+	source->close = close;
+	source->req.type = type;
+	source->req.source = &source->source;
+	spa_list_init(&source->idle_link);
+
+	spa_list_insert(&impl->source_list, &source->link);
+
+	return source;
+}
+
+static struct spa_source *loop_add_io(struct spa_loop_utils *utils,
+				      int fd,
+				      enum spa_io mask,
+				      bool close, spa_source_io_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+
+	source = new_source(impl, fd, close, REQUEST_POLL, data);
+	if (source == NULL)
+		return NULL;
+
+	source->source.func = source_io_func;
+	source->source.mask = mask;
+	source->func.io = func;
+
+	spa_loop_add_source(&impl->loop, &source->source);
+
+	return &source->source;
+}
+
+static int loop_update_io(struct spa_source *source, enum spa_io mask)
+{
+	source->mask = mask;
+	return spa_loop_update_source(source->loop, source);
+}
+
+static struct spa_source *loop_add_idle(struct spa_loop_utils *utils,
+					bool enabled, spa_source_idle_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+
+	source = new_source(impl, -1, false, REQUEST_POLL, data);
+	if (source == NULL)
+		return NULL;
+
+	source->func.idle = func;
+
+	if (enabled)
+		spa_loop_utils_enable_idle(&impl->utils, &source->source, true);
+
+	return &source->source;
+}
+
+static void loop_enable_idle(struct spa_source *source, bool enabled)
+{
+	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
+
+	if (enabled && !impl->enabled)
+		spa_list_append(&impl->impl->idle_list, &impl->idle_link);
+	else if (!enabled && impl->enabled) {
+		spa_list_remove(&impl->idle_link);
+		spa_list_init(&impl->idle_link);
+	}
+	impl->enabled = enabled;
+}
+
+static struct spa_source *loop_add_event(struct spa_loop_utils *utils,
+					 spa_source_event_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+
+	source = new_source(impl, eventfd(0, EFD_CLOEXEC), true,
+			    REQUEST_EVENT, data);
+	if (source == NULL)
+		return NULL;
+
+	source->source.mask = SPA_IO_IN;
+	source->func.event = func;
+
+	submit_read_event(impl, source);
+
+	return &source->source;
+}
+
+static void loop_signal_event(struct spa_source *source)
+{
+	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
+	uint64_t count = 1;
+
+	if (write(source->fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+		spa_log_warn(impl->impl->log, NAME " %p: failed to write event fd %d: %s",
+				source, source->fd, strerror(errno));
+}
+
+static struct spa_source *loop_add_timer(struct spa_loop_utils *utils,
+					 spa_source_timer_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+
+	/* timers are timeouts on the ring, they have no fd and are all
+	 * precise */
+	source = new_source(impl, -1, false, REQUEST_TIMER, data);
+	if (source == NULL)
+		return NULL;
+
+	source->func.timer = func;
+
+	return &source->source;
+}
+
+static int
+loop_update_timer(struct spa_source *source,
+		  struct timespec *value, struct timespec *interval, bool absolute)
+{
+	struct source_impl *s = SPA_CONTAINER_OF(source, struct source_impl, source);
+	struct impl *impl = s->impl;
+	uint64_t deadline = 0;
+
+	if (value) {
+		deadline = timespec_to_ns(value);
+		if (!absolute && deadline > 0)
+			deadline += get_time_ns();
+	} else if (interval) {
+		deadline = timespec_to_ns(interval);
+	}
+	s->deadline = deadline;
+	s->interval = interval ? timespec_to_ns(interval) : 0;
+
+	if (deadline == 0) {
+		if (s->req.armed)
+			submit_cancel(impl, &s->req);
+		return 0;
+	}
+	return submit_timeout(impl, s, s->req.armed);
+}
+
+static struct spa_source *loop_add_signal(struct spa_loop_utils *utils,
+					  int signal_number,
+					  spa_source_signal_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+	sigset_t mask;
+	int fd;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, signal_number);
+	fd = signalfd(-1, &mask, SFD_CLOEXEC);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	source = new_source(impl, fd, true, REQUEST_SIGNAL, data);
+	if (source == NULL)
+		return NULL;
+
+	source->source.mask = SPA_IO_IN;
+	source->func.signal = func;
+	source->signal_number = signal_number;
+
+	submit_read_signal(impl, source);
+
+	return &source->source;
+}
+
+static void loop_destroy_source(struct spa_source *source)
+{
+	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
+
+	spa_list_remove(&impl->link);
+
+	if (impl->enabled)
+		spa_list_remove(&impl->idle_link);
+
+	if (impl->req.type == REQUEST_POLL) {
+		if (source->loop)
+			spa_loop_remove_source(source->loop, source);
+	} else {
+		impl->req.source = NULL;
+		if (impl->req.armed)
+			submit_cancel(impl->impl, &impl->req);
+		source->loop = NULL;
+	}
+
+	if (source->fd != -1 && impl->close) {
+		close(source->fd);
+		source->fd = -1;
+	}
+	spa_list_insert(&impl->impl->destroy_list, &impl->link);
+}
+
+static const struct spa_loop impl_loop = {
+	SPA_VERSION_LOOP,
+	loop_add_source,
+	loop_update_source,
+	loop_remove_source,
+	loop_invoke,
+};
+
+static const struct spa_loop_control impl_loop_control = {
+	SPA_VERSION_LOOP_CONTROL,
+	loop_get_fd,
+	loop_add_hooks,
+	loop_enter,
+	loop_leave,
+	loop_iterate,
+};
+
+static const struct spa_loop_utils impl_loop_utils = {
+	SPA_VERSION_LOOP_UTILS,
+	loop_add_io,
+	loop_update_io,
+	loop_add_idle,
+	loop_enable_idle,
+	loop_add_event,
+	loop_signal_event,
+	loop_add_timer,
+	loop_update_timer,
+	loop_add_signal,
+	loop_destroy_source,
+	loop_add_timer,
+};
+
+static int impl_get_interface(struct spa_handle *handle, uint32_t interface_id, void **interface)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	if (interface_id == impl->type.loop)
+		*interface = &impl->loop;
+	else if (interface_id == impl->type.loop_control)
+		*interface = &impl->control;
+	else if (interface_id == impl->type.loop_utils)
+		*interface = &impl->utils;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *impl;
+	struct source_impl *source, *tmp;
+	struct request *req, *treq;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	spa_list_for_each_safe(source, tmp, &impl->source_list, link)
+		loop_destroy_source(&source->source);
+
+	/* closing the ring cancels the operations in flight */
+	ring_clear(&impl->ring);
+
+	spa_list_for_each_safe(source, tmp, &impl->destroy_list, link)
+		free(source);
+	spa_list_for_each_safe(req, treq, &impl->dead_list, link)
+		free(req);
+	spa_list_for_each_safe(req, treq, &impl->poll_list, link)
+		free(req);
+
+	pthread_mutex_destroy(&impl->lock);
+
+	return 0;
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *impl;
+	uint32_t i;
+	int res;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	impl = (struct impl *) handle;
+	impl->loop = impl_loop;
+	impl->control = impl_loop_control;
+	impl->utils = impl_loop_utils;
+
+	for (i = 0; i < n_support; i++) {
+		if (strcmp(support[i].type, SPA_TYPE__TypeMap) == 0)
+			impl->map = support[i].data;
+		else if (strcmp(support[i].type, SPA_TYPE__Log) == 0)
+			impl->log = support[i].data;
+	}
+	if (impl->map == NULL) {
+		spa_log_error(impl->log, NAME " %p: a type-map is needed", impl);
+		return -EINVAL;
+	}
+	init_type(&impl->type, impl->map);
+
+	if ((res = ring_init(&impl->ring, RING_ENTRIES)) < 0) {
+		spa_log_error(impl->log, NAME " %p: can't create ring: %s",
+			      impl, strerror(-res));
+		return res;
+	}
+
+	spa_list_init(&impl->source_list);
+	spa_list_init(&impl->destroy_list);
+	spa_list_init(&impl->idle_list);
+	spa_list_init(&impl->poll_list);
+	spa_list_init(&impl->dead_list);
+	spa_hook_list_init(&impl->hooks_list);
+	pthread_mutex_init(&impl->lock, NULL);
+
+	invoke_queue_init(&impl->queue);
+
+	impl->wakeup = spa_loop_utils_add_event(&impl->utils, wakeup_func, impl);
+
+	spa_log_debug(impl->log, NAME " %p: initialized", impl);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE__Loop,},
+	{SPA_TYPE__LoopControl,},
+	{SPA_TYPE__LoopUtils,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	if (*index >= SPA_N_ELEMENTS(impl_interfaces))
+		return 0;
+
+	*info = &impl_interfaces[(*index)++];
+	return 1;
+}
+
+static const struct spa_handle_factory loop_uring_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	NAME,
+	NULL,
+	sizeof(struct impl),
+	impl_init,
+	impl_enum_interface_info
+};
+
+int spa_handle_factory_register(const struct spa_handle_factory *factory);
+
+static void reg(void) __attribute__ ((constructor));
+static void reg(void)
+{
+	spa_handle_factory_register(&loop_uring_factory);
+}
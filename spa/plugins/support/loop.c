@@ -28,30 +28,30 @@
 #include <sys/eventfd.h>
 #include <sys/signalfd.h>
 #include <pthread.h>
+#include <time.h>
 
 #include <spa/support/loop.h>
 #include <spa/support/log.h>
 #include <spa/support/type-map.h>
 #include <spa/support/plugin.h>
 #include <spa/utils/list.h>
-#include <spa/utils/ringbuffer.h>
+
+#include "loop-invoke.h"
 
 #define NAME "loop"
 
-#define DATAS_SIZE (4096 * 8)
+/* the timer wheel has WHEEL_LEVELS levels of WHEEL_SIZE slots. A slot on
+ * level 0 holds the timers of one tick, a slot on level n holds the timers
+ * of WHEEL_SIZE^n ticks. */
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS	6
+#define WHEEL_TICK_NS	1000000ull
 
-/** \cond */
+#define NSEC_PER_SEC	1000000000ull
 
-struct invoke_item {
-	size_t item_size;
-	spa_invoke_func_t func;
-	uint32_t seq;
-	void *data;
-	size_t size;
-	bool block;
-	void *user_data;
-	int res;
-};
+/** \cond */
 
 struct type {
 	uint32_t loop;
@@ -68,6 +68,16 @@ static inline void init_type(struct type *type, struct spa_type_map *map)
 	type->loop_utils = spa_type_map_get_id(map, SPA_TYPE__LoopUtils);
 }
 
+struct wheel {
+	uint64_t now;					/* next tick to process */
+	uint64_t next;					/* tick the timer is armed for */
+	uint32_t n_timers;				/* number of queued timers */
+	bool dispatching;
+	uint64_t pending[WHEEL_LEVELS];			/* bitmap of non-empty slots */
+	struct spa_list slots[WHEEL_LEVELS][WHEEL_SIZE];
+	struct spa_source *timer;
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_loop loop;
@@ -86,10 +96,10 @@ struct impl {
 	pthread_t thread;
 
 	struct spa_source *wakeup;
-	int ack_fd;
 
-	struct spa_ringbuffer buffer;
-	uint8_t buffer_data[DATAS_SIZE];
+	struct invoke_queue queue;
+
+	struct wheel wheel;
 };
 
 struct source_impl {
@@ -108,6 +118,15 @@ struct source_impl {
 	} func;
 	int signal_number;
 	bool enabled;
+
+	bool wheel;			/* timer on the wheel */
+	bool queued;			/* in a slot of the wheel */
+	bool expired;			/* on the expired list of wheel_run */
+	uint8_t level;
+	uint8_t slot;
+	struct spa_list wheel_link;
+	uint64_t expires;		/* in ticks */
+	uint64_t interval;		/* in ticks, 0 for a one shot timer */
 };
 /** \endcond */
 
@@ -202,70 +221,39 @@ loop_invoke(struct spa_loop *loop,
 {
 	struct impl *impl = SPA_CONTAINER_OF(loop, struct impl, loop);
 	bool in_thread = pthread_equal(impl->thread, pthread_self());
-	struct invoke_item *item;
+	struct invoke_ack ack;
 	int res;
 
-	if (in_thread) {
-		res = func(loop, false, seq, data, size, user_data);
-	} else {
-		int32_t filled, avail;
-		uint32_t idx, offset, l0;
-
-		filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-		if (filled < 0 || filled > DATAS_SIZE) {
-			spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
-			return -EPIPE;
-		}
-		avail = DATAS_SIZE - filled;
-		if (avail < sizeof(struct invoke_item)) {
-			spa_log_warn(impl->log, NAME " %p: queue full %d", impl, avail);
-			return -EPIPE;
-		}
-		offset = idx & (DATAS_SIZE - 1);
-
-		l0 = DATAS_SIZE - offset;
-
-		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
-		item->func = func;
-		item->seq = seq;
-		item->size = size;
-		item->block = block;
-		item->user_data = user_data;
-
-		if (l0 > sizeof(struct invoke_item) + size) {
-			item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
-			item->item_size = sizeof(struct invoke_item) + size;
-			if (l0 < sizeof(struct invoke_item) + item->item_size)
-				item->item_size = l0;
-		} else {
-			item->data = impl->buffer_data;
-			item->item_size = l0 + size;
-		}
-		memcpy(item->data, data, size);
+	if (in_thread)
+		return func(loop, false, seq, data, size, user_data);
 
-		spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
+	if (block)
+		sem_init(&ack.sem, 0, 0);
 
-		spa_loop_utils_signal_event(&impl->utils, impl->wakeup);
+	if ((res = invoke_queue_push(&impl->queue, impl->log, func, seq, data, size,
+				     user_data, block ? &ack : NULL)) < 0) {
+		if (block)
+			sem_destroy(&ack.sem);
+		return res;
+	}
 
-		if (block) {
-			uint64_t count = 1;
+	spa_loop_utils_signal_event(&impl->utils, impl->wakeup);
 
-			spa_loop_control_hook_before(&impl->hooks_list);
+	if (block) {
+		spa_loop_control_hook_before(&impl->hooks_list);
 
-			if (read(impl->ack_fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
-				spa_log_warn(impl->log, NAME " %p: failed to read event fd: %s",
-						impl, strerror(errno));
+		while (sem_wait(&ack.sem) < 0 && errno == EINTR);
 
-			spa_loop_control_hook_after(&impl->hooks_list);
+		spa_loop_control_hook_after(&impl->hooks_list);
 
-			res = item->res;
-		}
-		else {
-			if (seq != SPA_ID_INVALID)
-				res = SPA_RESULT_RETURN_ASYNC(seq);
-			else
-				res = 0;
-		}
+		sem_destroy(&ack.sem);
+		res = ack.res;
+	}
+	else {
+		if (seq != SPA_ID_INVALID)
+			res = SPA_RESULT_RETURN_ASYNC(seq);
+		else
+			res = 0;
 	}
 	return res;
 }
@@ -273,21 +261,7 @@ loop_invoke(struct spa_loop *loop,
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
-	uint32_t index;
-	while (spa_ringbuffer_get_read_index(&impl->buffer, &index) > 0) {
-		struct invoke_item *item =
-		    SPA_MEMBER(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		item->res = item->func(&impl->loop, true, item->seq, item->data, item->size,
-			   item->user_data);
-		spa_ringbuffer_read_update(&impl->buffer, index + item->item_size);
-
-		if (item->block) {
-			uint64_t count = 1;
-			if (write(impl->ack_fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
-				spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
-						impl, strerror(errno));
-		}
-	}
+	invoke_queue_process(&impl->queue, &impl->loop);
 }
 
 static int loop_get_fd(struct spa_loop_control *ctrl)
@@ -516,8 +490,8 @@ static void source_timer_func(struct spa_source *source)
 	impl->func.timer(source->data, expirations);
 }
 
-static struct spa_source *loop_add_timer(struct spa_loop_utils *utils,
-					 spa_source_timer_func_t func, void *data)
+static struct spa_source *loop_add_precise_timer(struct spa_loop_utils *utils,
+						 spa_source_timer_func_t func, void *data)
 {
 	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
 	struct source_impl *source;
@@ -542,9 +516,8 @@ static struct spa_source *loop_add_timer(struct spa_loop_utils *utils,
 	return &source->source;
 }
 
-static int
-loop_update_timer(struct spa_source *source,
-		  struct timespec *value, struct timespec *interval, bool absolute)
+static int update_precise_timer(struct spa_source *source,
+				struct timespec *value, struct timespec *interval, bool absolute)
 {
 	struct itimerspec its;
 	int flags = 0;
@@ -567,6 +540,272 @@ loop_update_timer(struct spa_source *source,
 	return 0;
 }
 
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static inline uint64_t timespec_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+/* ticks are rounded up so that a timer never expires early */
+static inline uint64_t ns_to_ticks(uint64_t ns)
+{
+	return (ns + WHEEL_TICK_NS - 1) / WHEEL_TICK_NS;
+}
+
+static void wheel_insert(struct wheel *w, struct source_impl *s)
+{
+	uint64_t expires, delta;
+	uint32_t level = 0;
+
+	expires = SPA_MAX(s->expires, w->now);
+	delta = expires - w->now;
+
+	while (level < WHEEL_LEVELS - 1 &&
+	       delta >= (1ull << (WHEEL_BITS * (level + 1))))
+		level++;
+
+	/* timers past the last level are cascaded down again when their
+	 * slot comes around */
+	if (delta >= (1ull << (WHEEL_BITS * WHEEL_LEVELS)))
+		expires = w->now + (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+	s->level = level;
+	s->slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	spa_list_append(&w->slots[level][s->slot], &s->wheel_link);
+	w->pending[level] |= 1ull << s->slot;
+	s->queued = true;
+	s->expired = false;
+	w->n_timers++;
+}
+
+static void wheel_remove(struct wheel *w, struct source_impl *s)
+{
+	if (!s->queued)
+		return;
+
+	spa_list_remove(&s->wheel_link);
+	/* an expired timer is not in its slot anymore, the slot can hold
+	 * new timers already */
+	if (!s->expired && spa_list_is_empty(&w->slots[s->level][s->slot]))
+		w->pending[s->level] &= ~(1ull << s->slot);
+	s->queued = false;
+	s->expired = false;
+	w->n_timers--;
+}
+
+/* the first tick at or after now where a non-empty slot is handled */
+static uint64_t wheel_next(struct wheel *w)
+{
+	uint64_t next = UINT64_MAX;
+	uint32_t level;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		uint32_t shift = WHEEL_BITS * level;
+		uint64_t pending = w->pending[level], start, block, later;
+
+		if (pending == 0)
+			continue;
+
+		/* the first block of this level that starts at or after now */
+		start = (w->now + (1ull << shift) - 1) >> shift;
+		later = pending & (~0ull << (start & WHEEL_MASK));
+		if (later)
+			block = (start & ~(uint64_t) WHEEL_MASK) + __builtin_ctzll(later);
+		else
+			block = (start | WHEEL_MASK) + 1 + __builtin_ctzll(pending);
+
+		next = SPA_MIN(next, block << shift);
+	}
+	return next;
+}
+
+static void wheel_arm(struct impl *impl)
+{
+	struct wheel *w = &impl->wheel;
+	struct timespec value;
+	uint64_t next;
+
+	if (w->dispatching || w->timer == NULL)
+		return;
+
+	if ((next = wheel_next(w)) == w->next)
+		return;
+
+	w->next = next;
+	if (next == UINT64_MAX) {
+		value.tv_sec = value.tv_nsec = 0;
+	} else {
+		next *= WHEEL_TICK_NS;
+		value.tv_sec = next / NSEC_PER_SEC;
+		value.tv_nsec = next % NSEC_PER_SEC;
+	}
+	update_precise_timer(w->timer, &value, NULL, true);
+}
+
+/* handle all ticks up to and including target */
+static void wheel_run(struct wheel *w, uint64_t target)
+{
+	struct spa_list expired;
+	struct source_impl *s;
+	uint64_t tick;
+	int32_t level;
+
+	while ((tick = wheel_next(w)) <= target) {
+		w->now = tick;
+
+		/* move the timers of the blocks that start at this tick to the
+		 * lower levels */
+		for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+			uint32_t shift = WHEEL_BITS * level, slot;
+			struct spa_list *list;
+
+			if (tick & ((1ull << shift) - 1))
+				continue;
+
+			slot = (tick >> shift) & WHEEL_MASK;
+			list = &w->slots[level][slot];
+			while (!spa_list_is_empty(list)) {
+				s = spa_list_first(list, struct source_impl, wheel_link);
+				wheel_remove(w, s);
+				wheel_insert(w, s);
+			}
+		}
+
+		w->now = tick + 1;
+
+		/* the tick can be for a cascade only */
+		if (!(w->pending[0] & (1ull << (tick & WHEEL_MASK))))
+			continue;
+
+		spa_list_init(&expired);
+		spa_list_insert_list(&expired, &w->slots[0][tick & WHEEL_MASK]);
+		spa_list_init(&w->slots[0][tick & WHEEL_MASK]);
+		w->pending[0] &= ~(1ull << (tick & WHEEL_MASK));
+		spa_list_for_each(s, &expired, wheel_link)
+			s->expired = true;
+
+		/* the callbacks can update or destroy any timer */
+		while (!spa_list_is_empty(&expired)) {
+			uint64_t expirations = 1;
+
+			s = spa_list_first(&expired, struct source_impl, wheel_link);
+			wheel_remove(w, s);
+
+			if (s->interval) {
+				expirations += (target - s->expires) / s->interval;
+				s->expires += expirations * s->interval;
+				wheel_insert(w, s);
+			}
+			s->func.timer(s->source.data, expirations);
+		}
+	}
+	w->now = SPA_MAX(w->now, target + 1);
+}
+
+static void wheel_timeout(void *data, uint64_t expirations)
+{
+	struct impl *impl = data;
+	struct wheel *w = &impl->wheel;
+
+	/* the timer is not armed anymore */
+	w->next = UINT64_MAX;
+
+	w->dispatching = true;
+	wheel_run(w, get_time_ns() / WHEEL_TICK_NS);
+	w->dispatching = false;
+
+	wheel_arm(impl);
+}
+
+static void wheel_init(struct impl *impl)
+{
+	struct wheel *w = &impl->wheel;
+	uint32_t i, j;
+
+	w->next = UINT64_MAX;
+	for (i = 0; i < WHEEL_LEVELS; i++)
+		for (j = 0; j < WHEEL_SIZE; j++)
+			spa_list_init(&w->slots[i][j]);
+
+	w->timer = loop_add_precise_timer(&impl->utils, wheel_timeout, impl);
+}
+
+static struct spa_source *loop_add_timer(struct spa_loop_utils *utils,
+					 spa_source_timer_func_t func, void *data)
+{
+	struct impl *impl = SPA_CONTAINER_OF(utils, struct impl, utils);
+	struct source_impl *source;
+
+	source = calloc(1, sizeof(struct source_impl));
+	if (source == NULL)
+		return NULL;
+
+	source->source.loop = &impl->loop;
+	source->source.data = data;
+	source->source.fd = -1;
+	source->impl = impl;
+	source->func.timer = func;
+	source->wheel = true;
+
+	spa_list_insert(&impl->source_list, &source->link);
+
+	return &source->source;
+}
+
+static int update_wheel_timer(struct source_impl *source,
+			      struct timespec *value, struct timespec *interval, bool absolute)
+{
+	struct impl *impl = source->impl;
+	struct wheel *w = &impl->wheel;
+	uint64_t expires;
+
+	wheel_remove(w, source);
+
+	if (value) {
+		expires = timespec_to_ns(value);
+	} else if (interval) {
+		expires = timespec_to_ns(interval);
+		absolute = true;
+	} else
+		expires = 0;
+
+	if (expires != 0) {
+		uint64_t now = get_time_ns();
+
+		/* an empty wheel has not been advanced, move it to the current tick */
+		if (w->n_timers == 0 && !w->dispatching)
+			w->now = now / WHEEL_TICK_NS;
+		if (!absolute)
+			expires += now;
+
+		source->expires = ns_to_ticks(expires);
+		source->interval = interval ? ns_to_ticks(timespec_to_ns(interval)) : 0;
+		wheel_insert(w, source);
+	}
+	wheel_arm(impl);
+
+	return 0;
+}
+
+static int
+loop_update_timer(struct spa_source *source,
+		  struct timespec *value, struct timespec *interval, bool absolute)
+{
+	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
+
+	if (impl->wheel)
+		return update_wheel_timer(impl, value, interval, absolute);
+	else
+		return update_precise_timer(source, value, interval, absolute);
+}
+
 static void source_signal_func(struct spa_source *source)
 {
 	struct source_impl *impl = SPA_CONTAINER_OF(source, struct source_impl, source);
@@ -621,6 +860,11 @@ static void loop_destroy_source(struct spa_source *source)
 
 	spa_list_remove(&impl->link);
 
+	if (impl->wheel) {
+		wheel_remove(&impl->impl->wheel, impl);
+		wheel_arm(impl->impl);
+	}
+
 	if (source->loop)
 		spa_loop_remove_source(source->loop, source);
 
@@ -660,6 +904,7 @@ static const struct spa_loop_utils impl_loop_utils = {
 	loop_update_timer,
 	loop_add_signal,
 	loop_destroy_source,
+	loop_add_precise_timer,
 };
 
 static int impl_get_interface(struct spa_handle *handle, uint32_t interface_id, void **interface)
@@ -692,12 +937,14 @@ static int impl_clear(struct spa_handle *handle)
 
 	impl = (struct impl *) handle;
 
+	loop_destroy_source(impl->wheel.timer);
+	impl->wheel.timer = NULL;
+
 	spa_list_for_each_safe(source, tmp, &impl->source_list, link)
 		loop_destroy_source(&source->source);
 
 	process_destroy(impl);
 
-	close(impl->ack_fd);
 	close(impl->epoll_fd);
 
 	return 0;
@@ -744,10 +991,10 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
 
-	spa_ringbuffer_init(&impl->buffer);
+	invoke_queue_init(&impl->queue);
+	wheel_init(impl);
 
 	impl->wakeup = spa_loop_utils_add_event(&impl->utils, wakeup_func, impl);
-	impl->ack_fd = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
 
 	spa_log_debug(impl->log, NAME " %p: initialized", impl);
 
@@ -24,7 +24,9 @@
 #include <stdio.h>
 #include <sys/eventfd.h>
 
+#include <spa/utils/hash.h>
 #include <spa/support/type-map.h>
+#include <spa/support/type-map-impl.h>
 #include <spa/support/plugin.h>
 
 #define NAME "mapper"
@@ -52,6 +54,10 @@ struct impl {
 
 	struct array types;
 	struct array strings;
+	struct array hashes;		/**< hash of each type */
+
+	uint32_t *index;		/**< open addressing table of id + 1, 0 is empty */
+	uint32_t index_size;		/**< power of 2 */
 };
 
 static inline void * alloc_size(struct array *array, size_t size, size_t extend)
@@ -66,22 +72,55 @@ static inline void * alloc_size(struct array *array, size_t size, size_t extend)
 	return res;
 }
 
+static int grow_index(struct impl *impl, uint32_t size)
+{
+	uint32_t i, j, n_types = impl->types.size / sizeof(off_t), *index;
+	uint32_t *hashes = impl->hashes.data;
+
+	if ((index = calloc(size, sizeof(uint32_t))) == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < n_types; i++) {
+		for (j = hashes[i] & (size - 1); index[j] != 0; j = (j + 1) & (size - 1));
+		index[j] = i + 1;
+	}
+	free(impl->index);
+	impl->index = index;
+	impl->index_size = size;
+
+	return 0;
+}
+
 static uint32_t
 impl_type_map_get_id(struct spa_type_map *map, const char *type)
 {
 	struct impl *impl = SPA_CONTAINER_OF(map, struct impl, map);
-	uint32_t i, len;
+	uint32_t i, j, len, hash, n_types, *h;
 	void *p;
-	off_t o, *off;
+	off_t *off;
 
 	if (type == NULL)
 		return SPA_ID_INVALID;
 
-	for (i = 0; i < impl->types.size / sizeof(off_t); i++) {
-		o = ((off_t *)impl->types.data)[i];
-		if (strcmp(SPA_MEMBER(impl->strings.data, o, char), type) == 0)
+	hash = spa_hash_string(type);
+
+	for (j = hash & (impl->index_size - 1); (i = impl->index[j]) != 0;
+	     j = (j + 1) & (impl->index_size - 1)) {
+		off_t o = ((off_t *)impl->types.data)[--i];
+		if (((uint32_t *)impl->hashes.data)[i] == hash &&
+		    strcmp(SPA_MEMBER(impl->strings.data, o, char), type) == 0)
 			return i;
 	}
+
+	/* keep the table at most half full */
+	n_types = impl->types.size / sizeof(off_t);
+	if ((n_types + 1) * 2 > impl->index_size) {
+		if (grow_index(impl, impl->index_size * 2) < 0)
+			return SPA_ID_INVALID;
+		for (j = hash & (impl->index_size - 1); impl->index[j] != 0;
+		     j = (j + 1) & (impl->index_size - 1));
+	}
+
 	len = strlen(type);
 	p = alloc_size(&impl->strings, len+1, 1024);
 	memcpy(p, type, len + 1);
@@ -90,6 +129,11 @@ impl_type_map_get_id(struct spa_type_map *map, const char *type)
 	*off = SPA_PTRDIFF(p, impl->strings.data);
 	i = SPA_PTRDIFF(off, impl->types.data) / sizeof(off_t);
 
+	h = alloc_size(&impl->hashes, sizeof(uint32_t), 64);
+	*h = hash;
+
+	impl->index[j] = i + 1;
+
 	return i;
 
 }
@@ -150,6 +194,8 @@ static int impl_clear(struct spa_handle *handle)
 		free(impl->types.data);
 	if (impl->strings.data)
 		free(impl->strings.data);
+	free(impl->hashes.data);
+	free(impl->index);
 
 	return 0;
 }
@@ -162,6 +208,7 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *impl;
+	uint32_t i;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -173,6 +220,13 @@ impl_init(const struct spa_handle_factory *factory,
 
 	impl->map = impl_type_map;
 
+	if (grow_index(impl, 512) < 0)
+		return -ENOMEM;
+
+	/* the static types get the same id in every process */
+	for (i = 0; i < SPA_TYPE_ID_STATIC_LAST; i++)
+		impl_type_map_get_id(&impl->map, spa_type_map_static[i]);
+
 	init_type(&impl->type, &impl->map);
 
 	return 0;
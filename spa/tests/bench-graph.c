@@ -0,0 +1,1048 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Benchmark of a graph scheduler with synthetic topologies.
+ *
+ * The graphs are made of fakesrc, audiomixer and fakesink nodes. When an
+ * output is consumed by more than one node, a tee is placed after it, like
+ * the tee of the pipewire ports. Every node spins for the configured busy
+ * time before it processes.
+ *
+ * A cycle pulls all the sinks that did not consume a buffer yet in the
+ * cycle. The duration of every cycle is measured and the results are
+ * printed as one JSON object per line on stdout. The status is ok when
+ * all sinks consumed a buffer in every cycle, stalled when some did not,
+ * and runaway, timeout or crashed when the scheduler could not run the
+ * topology.
+ *
+ * The scheduler is selected at compile time with SCHEDULER.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <spa/support/log-impl.h>
+#include <spa/support/type-map-impl.h>
+#include <spa/support/plugin.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/param/param.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/format-utils.h>
+#include <spa/graph/graph.h>
+
+#ifndef SCHEDULER
+#define SCHEDULER	1
+#endif
+
+#if SCHEDULER == 1
+#include <spa/graph/graph-scheduler1.h>
+#define SCHEDULER_NAME	"1"
+#elif SCHEDULER == 3
+#include <spa/graph/graph-scheduler3.h>
+#define SCHEDULER_NAME	"3"
+#elif SCHEDULER == 6
+#include <spa/graph/graph-scheduler6.h>
+#define SCHEDULER_NAME	"6"
+#elif SCHEDULER == 7
+#include <spa/graph/graph-scheduler7.h>
+#define SCHEDULER_NAME	"plan"
+#else
+#error "unsupported SCHEDULER"
+#endif
+
+#ifndef PACKAGE_VERSION
+#define PACKAGE_VERSION	"unknown"
+#endif
+
+#define DEFAULT_PLUGINS	"build/spa/plugins"
+#define DEFAULT_CYCLES	10000
+#define DEFAULT_QUANTUM	256
+#define DEFAULT_NODES	64
+#define DEFAULT_DAG	500
+#define DEFAULT_TIMEOUT	60
+#define WARMUP_CYCLES	100
+
+#define MAX_NODES	4096
+#define MAX_EDGES	(MAX_NODES * 4)
+#define MAX_MIX_INPUTS	128
+#define DAG_MIX_INPUTS	3
+#define N_BUFFERS	2
+#define RATE		48000
+
+static SPA_TYPE_MAP_IMPL(default_map, 4096);
+static SPA_LOG_IMPL(default_log);
+
+struct type {
+	uint32_t node;
+	uint32_t format;
+	struct spa_type_io io;
+	struct spa_type_param param;
+	struct spa_type_meta meta;
+	struct spa_type_data data;
+	struct spa_type_media_type media_type;
+	struct spa_type_media_subtype media_subtype;
+	struct spa_type_format_audio format_audio;
+	struct spa_type_audio_format audio_format;
+	struct spa_type_command_node command_node;
+};
+
+static inline void init_type(struct type *type, struct spa_type_map *map)
+{
+	type->node = spa_type_map_get_id(map, SPA_TYPE__Node);
+	type->format = spa_type_map_get_id(map, SPA_TYPE__Format);
+	spa_type_io_map(map, &type->io);
+	spa_type_param_map(map, &type->param);
+	spa_type_meta_map(map, &type->meta);
+	spa_type_data_map(map, &type->data);
+	spa_type_media_type_map(map, &type->media_type);
+	spa_type_media_subtype_map(map, &type->media_subtype);
+	spa_type_format_audio_map(map, &type->format_audio);
+	spa_type_audio_format_map(map, &type->audio_format);
+	spa_type_command_node_map(map, &type->command_node);
+}
+
+struct buffer {
+	struct spa_buffer buffer;
+	struct spa_meta metas[1];
+	struct spa_meta_header header;
+	struct spa_data datas[1];
+	struct spa_chunk chunks[1];
+};
+
+enum node_kind {
+	NODE_SOURCE,
+	NODE_MIXER,
+	NODE_SINK,
+	NODE_TEE,
+};
+
+struct data;
+
+struct node {
+	struct data *data;
+	enum node_kind kind;
+
+	struct spa_handle *handle;
+	struct spa_node *node;		/**< plugin node, NULL for a tee */
+	struct spa_node impl;		/**< what the graph processes */
+	struct spa_graph_node gnode;
+
+	uint32_t n_inputs;		/**< linked input ports */
+	uint32_t n_outputs;		/**< linked output ports */
+	uint32_t n_consumers;		/**< consumers in the topology */
+	struct node *tee;		/**< tee of the output or NULL */
+	struct node *owner;		/**< node with the buffers of the output */
+
+	struct spa_buffer *bufs[N_BUFFERS];
+	struct buffer buffers[N_BUFFERS];
+	void *mem;
+
+	uint32_t cycle;			/**< last cycle the sink consumed a buffer */
+};
+
+struct edge {
+	struct node *out;
+	struct node *in;
+};
+
+struct link {
+	struct spa_io_buffers io;
+	struct spa_graph_port out;
+	struct spa_graph_port in;
+};
+
+struct data {
+	struct spa_type_map *map;
+	struct spa_log *log;
+	struct type type;
+
+	struct spa_support support[2];
+	uint32_t n_support;
+
+	void *hnd_test;
+	void *hnd_mixer;
+
+	uint32_t cycles;
+	uint64_t busy_ns;
+	uint32_t quantum;
+	uint32_t n_nodes;
+	uint32_t n_dag;
+	uint64_t seed;
+	uint64_t rand;
+	uint32_t timeout;
+
+	const char *topology;
+
+	struct spa_graph graph;
+#if SCHEDULER == 1 || SCHEDULER == 6
+	struct spa_graph_data graph_data;
+#elif SCHEDULER == 7
+	struct spa_graph_plan plan;
+	void *plan_mem;
+#endif
+
+	struct node *nodes[MAX_NODES];
+	uint32_t n_graph_nodes;
+	struct edge edges[MAX_EDGES];
+	uint32_t n_edges;
+	struct link *links[MAX_EDGES];
+	uint32_t n_links;
+	struct node *sinks[MAX_NODES];
+	uint32_t n_sinks;
+
+	uint32_t cycle;
+	uint64_t *times;
+	uint64_t n_process;		/**< nodes processed in the cycle */
+	uint64_t max_process;
+};
+
+static inline uint64_t get_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_TIME(&now);
+}
+
+/* xorshift, the graphs are the same for a seed on every platform */
+static uint32_t random_next(struct data *data)
+{
+	uint64_t x = data->rand;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	data->rand = x;
+	return x >> 32;
+}
+
+static void busy_work(uint64_t ns)
+{
+	uint64_t end;
+
+	if (ns == 0)
+		return;
+	end = get_time() + ns;
+	while (get_time() < end);
+}
+
+static void print_status(struct data *data, const char *status)
+{
+	printf("{ \"version\": \"%s\", \"scheduler\": \"%s\", \"topology\": \"%s\", "
+	       "\"status\": \"%s\" }\n", PACKAGE_VERSION, SCHEDULER_NAME, data->topology, status);
+	fflush(stdout);
+}
+
+/* some schedulers never finish a cycle of some graphs, the benchmark of
+ * the topology is stopped when a cycle processes too many nodes */
+static void process_node(struct node *n)
+{
+	struct data *data = n->data;
+
+	if (++data->n_process > data->max_process) {
+		print_status(data, "runaway");
+		_exit(0);
+	}
+	if (n->node)
+		busy_work(data->busy_ns);
+}
+
+static int node_process_input(struct spa_node *impl)
+{
+	struct node *n = SPA_CONTAINER_OF(impl, struct node, impl);
+	int res;
+
+	process_node(n);
+	res = spa_node_process_input(n->node);
+
+	/* like a device sink, it needs the next buffer in the next cycle */
+	if (n->kind == NODE_SINK && res == SPA_STATUS_NEED_BUFFER) {
+		n->cycle = n->data->cycle;
+		res = SPA_STATUS_OK;
+	}
+	return res;
+}
+
+static int node_process_output(struct spa_node *impl)
+{
+	struct node *n = SPA_CONTAINER_OF(impl, struct node, impl);
+
+	process_node(n);
+	return spa_node_process_output(n->node);
+}
+
+/* without need_input, a sink consumes the buffer when it processes and
+ * fails when there is none */
+static const struct spa_node_callbacks sink_callbacks = {
+	SPA_VERSION_NODE_CALLBACKS,
+};
+
+static const struct spa_node bench_node = {
+	SPA_VERSION_NODE,
+	NULL,
+	.process_input = node_process_input,
+	.process_output = node_process_output,
+};
+
+/* same as the tee of the pipewire ports */
+static int tee_process_input(struct spa_node *impl)
+{
+	struct node *n = SPA_CONTAINER_OF(impl, struct node, impl);
+	struct spa_graph_port *p, *in;
+	struct spa_io_buffers *io;
+
+	process_node(n);
+
+	in = spa_list_first(&n->gnode.ports[SPA_DIRECTION_INPUT], struct spa_graph_port, link);
+	io = in->io;
+
+	spa_list_for_each(p, &n->gnode.ports[SPA_DIRECTION_OUTPUT], link)
+		*p->io = *io;
+	io->buffer_id = SPA_ID_INVALID;
+
+	return io->status;
+}
+
+static int tee_process_output(struct spa_node *impl)
+{
+	struct node *n = SPA_CONTAINER_OF(impl, struct node, impl);
+	struct spa_graph_port *p, *in;
+	struct spa_io_buffers *io;
+
+	process_node(n);
+
+	in = spa_list_first(&n->gnode.ports[SPA_DIRECTION_INPUT], struct spa_graph_port, link);
+	io = in->io;
+
+	spa_list_for_each(p, &n->gnode.ports[SPA_DIRECTION_OUTPUT], link)
+		*io = *p->io;
+
+	return io->status;
+}
+
+static const struct spa_node tee_node = {
+	SPA_VERSION_NODE,
+	NULL,
+	.process_input = tee_process_input,
+	.process_output = tee_process_output,
+};
+
+static void init_buffers(struct data *data, struct node *n, size_t size)
+{
+	int i;
+
+	n->mem = calloc(N_BUFFERS, size);
+
+	for (i = 0; i < N_BUFFERS; i++) {
+		struct buffer *b = &n->buffers[i];
+		n->bufs[i] = &b->buffer;
+
+		b->buffer.id = i;
+		b->buffer.metas = b->metas;
+		b->buffer.n_metas = 1;
+		b->buffer.datas = b->datas;
+		b->buffer.n_datas = 1;
+
+		b->header.flags = 0;
+		b->header.seq = 0;
+		b->header.pts = 0;
+		b->header.dts_offset = 0;
+		b->metas[0].type = data->type.meta.Header;
+		b->metas[0].data = &b->header;
+		b->metas[0].size = sizeof(b->header);
+
+		b->datas[0].type = data->type.data.MemPtr;
+		b->datas[0].flags = 0;
+		b->datas[0].fd = -1;
+		b->datas[0].mapoffset = 0;
+		b->datas[0].maxsize = size;
+		b->datas[0].data = SPA_MEMBER(n->mem, i * size, void);
+		b->datas[0].chunk = &b->chunks[0];
+		b->datas[0].chunk->offset = 0;
+		b->datas[0].chunk->size = size;
+		b->datas[0].chunk->stride = 0;
+	}
+}
+
+static int make_handle(struct data *data, struct node *n, void *hnd, const char *name)
+{
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	uint32_t i;
+	void *iface;
+	int res;
+
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		fprintf(stderr, "can't find enum function\n");
+		return -ENOENT;
+	}
+
+	for (i = 0;;) {
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			if (res != 0)
+				fprintf(stderr, "can't enumerate factories: %s\n", spa_strerror(res));
+			break;
+		}
+		if (strcmp(factory->name, name))
+			continue;
+
+		n->handle = calloc(1, factory->size);
+		if ((res = spa_handle_factory_init(factory, n->handle, NULL,
+						   data->support, data->n_support)) < 0) {
+			fprintf(stderr, "can't make %s instance: %s\n", name, spa_strerror(res));
+			return res;
+		}
+		if ((res = spa_handle_get_interface(n->handle, data->type.node, &iface)) < 0) {
+			fprintf(stderr, "can't get node interface: %s\n", spa_strerror(res));
+			return res;
+		}
+		n->node = iface;
+		return 0;
+	}
+	fprintf(stderr, "can't find factory %s\n", name);
+	return -ENOENT;
+}
+
+static struct node *add_node(struct data *data, enum node_kind kind)
+{
+	struct node *n;
+	int res = 0;
+
+	if (data->n_graph_nodes >= MAX_NODES)
+		return NULL;
+
+	n = calloc(1, sizeof(struct node));
+	n->data = data;
+	n->kind = kind;
+	n->owner = n;
+
+	switch (kind) {
+	case NODE_SOURCE:
+		res = make_handle(data, n, data->hnd_test, "fakesrc");
+		break;
+	case NODE_MIXER:
+		res = make_handle(data, n, data->hnd_mixer, "audiomixer");
+		break;
+	case NODE_SINK:
+		if ((res = make_handle(data, n, data->hnd_test, "fakesink")) >= 0)
+			res = spa_node_set_callbacks(n->node, &sink_callbacks, n);
+		data->sinks[data->n_sinks++] = n;
+		break;
+	case NODE_TEE:
+		break;
+	}
+	n->impl = kind == NODE_TEE ? tee_node : bench_node;
+
+	spa_graph_node_init(&n->gnode);
+	spa_graph_node_set_implementation(&n->gnode, &n->impl);
+	spa_graph_node_add(&data->graph, &n->gnode);
+
+	data->nodes[data->n_graph_nodes++] = n;
+
+	if (res < 0)
+		return NULL;
+
+	return n;
+}
+
+static int add_edge(struct data *data, struct node *out, struct node *in)
+{
+	if (data->n_edges >= MAX_EDGES)
+		return -ENOSPC;
+
+	data->edges[data->n_edges].out = out;
+	data->edges[data->n_edges].in = in;
+	data->n_edges++;
+	out->n_consumers++;
+
+	return 0;
+}
+
+static int set_format(struct data *data, struct node *n, enum spa_direction direction,
+		      uint32_t port_id)
+{
+	struct type *t = &data->type;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *format;
+
+	format = spa_pod_builder_object(&b,
+		0, t->format,
+		"I", t->media_type.audio,
+		"I", t->media_subtype.raw,
+		":", t->format_audio.format,   "I", t->audio_format.F32,
+		":", t->format_audio.layout,   "i", SPA_AUDIO_LAYOUT_INTERLEAVED,
+		":", t->format_audio.rate,     "i", RATE,
+		":", t->format_audio.channels, "i", 1);
+
+	return spa_node_port_set_param(n->node, direction, port_id,
+				       t->param.idFormat, 0, format);
+}
+
+static int link_nodes(struct data *data, struct node *out, struct node *in)
+{
+	struct link *l;
+	uint32_t in_port = in->n_inputs++;
+	int res;
+
+	if (data->n_links >= MAX_EDGES)
+		return -ENOSPC;
+
+	l = calloc(1, sizeof(struct link));
+	data->links[data->n_links++] = l;
+
+	l->io = SPA_IO_BUFFERS_INIT;
+	l->io.status = SPA_STATUS_NEED_BUFFER;
+
+	spa_graph_port_init(&l->out, SPA_DIRECTION_OUTPUT, out->n_outputs++, 0, &l->io);
+	spa_graph_port_add(&out->gnode, &l->out);
+	spa_graph_port_init(&l->in, SPA_DIRECTION_INPUT, in_port, 0, &l->io);
+	spa_graph_port_add(&in->gnode, &l->in);
+	spa_graph_port_link(&l->out, &l->in);
+
+	if (out->node) {
+		if ((res = spa_node_port_set_io(out->node, SPA_DIRECTION_OUTPUT, 0,
+						data->type.io.Buffers, &l->io, sizeof(l->io))) < 0)
+			return res;
+	}
+	if (in->node) {
+		if ((res = spa_node_port_set_io(in->node, SPA_DIRECTION_INPUT, in_port,
+						data->type.io.Buffers, &l->io, sizeof(l->io))) < 0)
+			return res;
+		if ((res = spa_node_port_use_buffers(in->node, SPA_DIRECTION_INPUT, in_port,
+						     out->owner->bufs, N_BUFFERS)) < 0)
+			return res;
+	}
+	return 0;
+}
+
+/* instantiate the ports, tees and links of the topology */
+static int build_graph(struct data *data)
+{
+	struct spa_command cmd = SPA_COMMAND_INIT(data->type.command_node.Start);
+	uint32_t i, j, n_nodes = data->n_graph_nodes;
+	int res;
+
+	for (i = 0; i < n_nodes; i++) {
+		struct node *n = data->nodes[i];
+		uint32_t n_inputs = 0;
+
+		for (j = 0; j < data->n_edges; j++)
+			if (data->edges[j].in == n)
+				n_inputs++;
+
+		if (n->kind == NODE_MIXER) {
+			for (j = 0; j < n_inputs; j++) {
+				if ((res = spa_node_add_port(n->node, SPA_DIRECTION_INPUT, j)) < 0)
+					return res;
+				if ((res = set_format(data, n, SPA_DIRECTION_INPUT, j)) < 0)
+					return res;
+			}
+		}
+		else if (n->kind == NODE_SINK) {
+			if ((res = set_format(data, n, SPA_DIRECTION_INPUT, 0)) < 0)
+				return res;
+		}
+
+		if (n->kind == NODE_SOURCE || n->kind == NODE_MIXER) {
+			if ((res = set_format(data, n, SPA_DIRECTION_OUTPUT, 0)) < 0)
+				return res;
+			init_buffers(data, n, data->quantum * sizeof(float));
+			if ((res = spa_node_port_use_buffers(n->node, SPA_DIRECTION_OUTPUT, 0,
+							     n->bufs, N_BUFFERS)) < 0)
+				return res;
+		}
+
+		if (n->n_consumers > 1) {
+			if ((n->tee = add_node(data, NODE_TEE)) == NULL)
+				return -ENOSPC;
+			n->tee->owner = n;
+			if ((res = link_nodes(data, n, n->tee)) < 0)
+				return res;
+		}
+	}
+
+	for (i = 0; i < data->n_edges; i++) {
+		struct edge *e = &data->edges[i];
+		if ((res = link_nodes(data, e->out->tee ? e->out->tee : e->out, e->in)) < 0)
+			return res;
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		struct node *n = data->nodes[i];
+		if ((res = spa_node_send_command(n->node, &cmd)) < 0)
+			return res;
+	}
+	return 0;
+}
+
+static void clear_graph(struct data *data)
+{
+	struct spa_command cmd = SPA_COMMAND_INIT(data->type.command_node.Pause);
+	uint32_t i;
+
+	for (i = 0; i < data->n_graph_nodes; i++) {
+		struct node *n = data->nodes[i];
+
+		if (n->node)
+			spa_node_send_command(n->node, &cmd);
+		if (n->handle) {
+			spa_handle_clear(n->handle);
+			free(n->handle);
+		}
+		free(n->mem);
+		free(n);
+	}
+	for (i = 0; i < data->n_links; i++)
+		free(data->links[i]);
+
+	data->n_graph_nodes = 0;
+	data->n_edges = 0;
+	data->n_links = 0;
+	data->n_sinks = 0;
+}
+
+/* fakesrc -> audiomixer -> ... -> audiomixer -> fakesink */
+static int make_chain(struct data *data)
+{
+	struct node *prev, *n;
+	uint32_t i;
+
+	if ((prev = add_node(data, NODE_SOURCE)) == NULL)
+		return -EIO;
+
+	for (i = 2; i < data->n_nodes; i++) {
+		if ((n = add_node(data, NODE_MIXER)) == NULL)
+			return -EIO;
+		add_edge(data, prev, n);
+		prev = n;
+	}
+	if ((n = add_node(data, NODE_SINK)) == NULL)
+		return -EIO;
+	add_edge(data, prev, n);
+
+	return 0;
+}
+
+/* fakesrc * n -> audiomixer -> fakesink */
+static int make_fan_in(struct data *data)
+{
+	struct node *mix, *n;
+	uint32_t i, n_sources;
+
+	n_sources = SPA_CLAMP(data->n_nodes, 3u, MAX_MIX_INPUTS + 2u) - 2;
+
+	if ((mix = add_node(data, NODE_MIXER)) == NULL)
+		return -EIO;
+
+	for (i = 0; i < n_sources; i++) {
+		if ((n = add_node(data, NODE_SOURCE)) == NULL)
+			return -EIO;
+		add_edge(data, n, mix);
+	}
+	if ((n = add_node(data, NODE_SINK)) == NULL)
+		return -EIO;
+	add_edge(data, mix, n);
+
+	return 0;
+}
+
+/* fakesrc -> tee -> fakesink * n */
+static int make_fan_out(struct data *data)
+{
+	struct node *src, *n;
+	uint32_t i;
+
+	if ((src = add_node(data, NODE_SOURCE)) == NULL)
+		return -EIO;
+
+	for (i = 1; i < SPA_MAX(data->n_nodes, 2u); i++) {
+		if ((n = add_node(data, NODE_SINK)) == NULL)
+			return -EIO;
+		add_edge(data, src, n);
+	}
+	return 0;
+}
+
+/* pick a producer, the ones that are not consumed yet first */
+static struct node *pick_producer(struct data *data, struct node **producers,
+				  uint32_t n_producers, uint32_t *n_free)
+{
+	uint32_t i;
+	struct node *n;
+
+	if (*n_free > 0) {
+		i = random_next(data) % *n_free;
+		n = producers[i];
+		producers[i] = producers[*n_free - 1];
+		producers[*n_free - 1] = n;
+		(*n_free)--;
+	} else {
+		n = producers[random_next(data) % n_producers];
+	}
+	return n;
+}
+
+/* random DAG of sources, mixers with 1 to 3 inputs and sinks. Producers
+ * are at the start of the array, the first n_free of them are not
+ * consumed yet. */
+static int make_dag(struct data *data)
+{
+	struct node **producers, *n, *in[DAG_MIX_INPUTS];
+	uint32_t i, j, k, n_inputs, n_producers = 0, n_free = 0;
+	uint32_t n_total, n_sources, n_sinks, n_mixers;
+	int res = 0;
+
+	n_total = SPA_MAX(data->n_dag, 3u);
+	n_sources = SPA_MAX(n_total / 8, 1u);
+	n_sinks = SPA_MAX(n_total / 8, 1u);
+	n_mixers = n_total - n_sources - n_sinks;
+
+	producers = calloc(n_sources + n_mixers, sizeof(struct node *));
+
+	for (i = 0; i < n_sources; i++) {
+		if ((n = add_node(data, NODE_SOURCE)) == NULL)
+			goto error;
+		producers[n_producers++] = n;
+		n_free++;
+	}
+	for (i = 0; i < n_mixers; i++) {
+		if ((n = add_node(data, NODE_MIXER)) == NULL)
+			goto error;
+
+		n_inputs = SPA_MIN(1 + random_next(data) % DAG_MIX_INPUTS, n_producers);
+		for (j = 0; j < n_inputs; j++) {
+			do {
+				in[j] = pick_producer(data, producers, n_producers, &n_free);
+				for (k = 0; k < j && in[k] != in[j]; k++);
+			} while (k < j);
+			add_edge(data, in[j], n);
+		}
+
+		/* the new mixer is not consumed yet */
+		producers[n_producers] = producers[n_free];
+		producers[n_free] = n;
+		n_producers++;
+		n_free++;
+	}
+	for (i = 0; i < n_sinks || n_free > 0; i++) {
+		if ((n = add_node(data, NODE_SINK)) == NULL)
+			goto error;
+		add_edge(data, pick_producer(data, producers, n_producers, &n_free), n);
+	}
+	free(producers);
+	return 0;
+
+      error:
+	res = -EIO;
+	free(producers);
+	return res;
+}
+
+static int compare_time(const void *a, const void *b)
+{
+	uint64_t ta = *(const uint64_t *) a, tb = *(const uint64_t *) b;
+	return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+static uint64_t percentile(const uint64_t *times, uint32_t n, uint32_t permille)
+{
+	uint64_t idx = ((uint64_t) n * permille + 999) / 1000;
+	return times[idx > 0 ? idx - 1 : 0];
+}
+
+static void init_scheduler(struct data *data)
+{
+	spa_graph_init(&data->graph);
+#if SCHEDULER == 1 || SCHEDULER == 6
+	spa_graph_data_init(&data->graph_data, &data->graph);
+	spa_graph_set_callbacks(&data->graph, &spa_graph_impl_default, &data->graph_data);
+#elif SCHEDULER == 7
+	data->plan_mem = malloc(SPA_GRAPH_PLAN_MEM_SIZE(MAX_NODES, 2 * MAX_EDGES));
+	spa_graph_plan_init(&data->plan, &data->graph, data->plan_mem,
+			    MAX_NODES, 2 * MAX_EDGES);
+	spa_graph_set_callbacks(&data->graph, &spa_graph_impl_plan, &data->plan);
+#else
+	spa_graph_set_callbacks(&data->graph, &spa_graph_impl_default, NULL);
+#endif
+}
+
+static void clear_scheduler(struct data *data)
+{
+#if SCHEDULER == 7
+	spa_graph_plan_clear(&data->plan);
+	free(data->plan_mem);
+#endif
+}
+
+static void run_topology(struct data *data, int (*make) (struct data *data))
+{
+	uint32_t i, j, n_nodes = 0, n_tees = 0, total;
+	uint64_t start, sum = 0, missed = 0;
+	int res;
+
+	init_scheduler(data);
+	data->rand = data->seed ? data->seed : 1;
+
+	if ((res = make(data)) < 0 || (res = build_graph(data)) < 0) {
+		fprintf(stderr, "can't make %s graph: %s\n", data->topology, spa_strerror(res));
+		print_status(data, "error");
+		goto done;
+	}
+
+	for (i = 0; i < data->n_graph_nodes; i++) {
+		if (data->nodes[i]->kind == NODE_TEE)
+			n_tees++;
+		else
+			n_nodes++;
+	}
+	/* a cycle normally processes every node once or twice */
+	data->max_process = 16 * (uint64_t) data->n_graph_nodes + 1024;
+
+	total = WARMUP_CYCLES + data->cycles;
+	for (i = 0; i < total; i++) {
+		data->cycle = i + 1;
+		data->n_process = 0;
+
+		start = get_time();
+		for (j = 0; j < data->n_sinks; j++) {
+			struct node *n = data->sinks[j];
+			if (n->cycle != data->cycle)
+				spa_graph_need_input(&data->graph, &n->gnode);
+		}
+		if (i < WARMUP_CYCLES)
+			continue;
+
+		data->times[i - WARMUP_CYCLES] = get_time() - start;
+
+		for (j = 0; j < data->n_sinks; j++)
+			if (data->sinks[j]->cycle != data->cycle)
+				missed++;
+	}
+
+	for (i = 0; i < data->cycles; i++)
+		sum += data->times[i];
+	qsort(data->times, data->cycles, sizeof(uint64_t), compare_time);
+
+	printf("{ \"version\": \"%s\", \"scheduler\": \"%s\", \"topology\": \"%s\", "
+	       "\"nodes\": %u, \"tees\": %u, \"sinks\": %u, \"cycles\": %u, "
+	       "\"busy_ns\": %"PRIu64", \"quantum\": %u, \"seed\": %"PRIu64", "
+	       "\"ns_per_cycle\": %.1f, \"min_ns\": %"PRIu64", \"p50_ns\": %"PRIu64", "
+	       "\"p90_ns\": %"PRIu64", \"p99_ns\": %"PRIu64", \"p999_ns\": %"PRIu64", "
+	       "\"max_ns\": %"PRIu64", \"jitter_ns\": %"PRIu64", "
+	       "\"missed\": %"PRIu64", \"status\": \"%s\" }\n",
+	       PACKAGE_VERSION, SCHEDULER_NAME, data->topology,
+	       n_nodes, n_tees, data->n_sinks, data->cycles,
+	       data->busy_ns, data->quantum, data->seed,
+	       (double) sum / data->cycles, data->times[0],
+	       percentile(data->times, data->cycles, 500),
+	       percentile(data->times, data->cycles, 900),
+	       percentile(data->times, data->cycles, 990),
+	       percentile(data->times, data->cycles, 999),
+	       data->times[data->cycles - 1],
+	       percentile(data->times, data->cycles, 990) -
+	       percentile(data->times, data->cycles, 500),
+	       missed, missed ? "stalled" : "ok");
+	fflush(stdout);
+
+      done:
+	clear_graph(data);
+	clear_scheduler(data);
+}
+
+/* a topology runs in a child so that a scheduler that hangs or crashes
+ * is reported and the other topologies still run */
+static int bench_topology(struct data *data, const char *name, int (*make) (struct data *data))
+{
+	pid_t pid;
+	int status;
+
+	data->topology = name;
+
+	fflush(stdout);
+	if ((pid = fork()) < 0) {
+		fprintf(stderr, "can't fork: %m\n");
+		return -errno;
+	}
+	if (pid == 0) {
+		alarm(data->timeout);
+		run_topology(data, make);
+		_exit(0);
+	}
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return -errno;
+	}
+	if (WIFSIGNALED(status)) {
+		print_status(data, WTERMSIG(status) == SIGALRM ? "timeout" : "crashed");
+		return -EIO;
+	}
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	int (*make) (struct data *data);
+} topologies[] = {
+	{ "chain", make_chain },
+	{ "fan-in", make_fan_in },
+	{ "fan-out", make_fan_out },
+	{ "dag", make_dag },
+};
+
+static void show_help(const char *name)
+{
+	fprintf(stdout, "%s [options] [topology...]\n"
+		"  -h, --help                            Show this help\n"
+		"  -p, --plugins                         Directory with the spa plugins (default %s)\n"
+		"  -c, --cycles                          Number of measured cycles (default %d)\n"
+		"  -b, --busy                            Busy time of a node in ns (default 0)\n"
+		"  -q, --quantum                         Samples in a buffer (default %d)\n"
+		"  -n, --nodes                           Nodes in chain, fan-in and fan-out (default %d)\n"
+		"  -d, --dag-nodes                       Nodes in the random DAG (default %d)\n"
+		"  -s, --seed                            Seed of the random DAG (default 1)\n"
+		"  -t, --timeout                         Seconds before a topology is stopped (default %d)\n\n"
+		"Topologies: chain, fan-in, fan-out, dag (default all)\n",
+		name, DEFAULT_PLUGINS, DEFAULT_CYCLES, DEFAULT_QUANTUM,
+		DEFAULT_NODES, DEFAULT_DAG, DEFAULT_TIMEOUT);
+}
+
+static void *load_plugin(const char *dir, const char *lib)
+{
+	char path[PATH_MAX];
+	void *hnd;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, lib);
+	if ((hnd = dlopen(path, RTLD_NOW)) == NULL)
+		fprintf(stderr, "can't load %s: %s\n", path, dlerror());
+	return hnd;
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { NULL };
+	const char *plugins = DEFAULT_PLUGINS, *str;
+	uint32_t i;
+	int c, res = 0;
+	static const struct option long_options[] = {
+		{ "help",	no_argument,		NULL, 'h' },
+		{ "plugins",	required_argument,	NULL, 'p' },
+		{ "cycles",	required_argument,	NULL, 'c' },
+		{ "busy",	required_argument,	NULL, 'b' },
+		{ "quantum",	required_argument,	NULL, 'q' },
+		{ "nodes",	required_argument,	NULL, 'n' },
+		{ "dag-nodes",	required_argument,	NULL, 'd' },
+		{ "seed",	required_argument,	NULL, 's' },
+		{ "timeout",	required_argument,	NULL, 't' },
+		{ NULL, 0, NULL, 0}
+	};
+
+	data.cycles = DEFAULT_CYCLES;
+	data.quantum = DEFAULT_QUANTUM;
+	data.n_nodes = DEFAULT_NODES;
+	data.n_dag = DEFAULT_DAG;
+	data.seed = 1;
+	data.timeout = DEFAULT_TIMEOUT;
+
+	while ((c = getopt_long(argc, argv, "hp:c:b:q:n:d:s:t:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		case 'p':
+			plugins = optarg;
+			break;
+		case 'c':
+			data.cycles = SPA_MAX(atoi(optarg), 1);
+			break;
+		case 'b':
+			data.busy_ns = strtoull(optarg, NULL, 10);
+			break;
+		case 'q':
+			data.quantum = SPA_MAX(atoi(optarg), 1);
+			break;
+		case 'n':
+			data.n_nodes = SPA_CLAMP(atoi(optarg), 2, MAX_NODES / 2);
+			break;
+		case 'd':
+			data.n_dag = SPA_CLAMP(atoi(optarg), 3, MAX_NODES / 2);
+			break;
+		case 's':
+			data.seed = strtoull(optarg, NULL, 10);
+			break;
+		case 't':
+			data.timeout = SPA_MAX(atoi(optarg), 0);
+			break;
+		default:
+			show_help(argv[0]);
+			return -1;
+		}
+	}
+
+	data.map = &default_map.map;
+	data.log = &default_log.log;
+
+	/* logging in the cycles would be measured too */
+	data.log->level = SPA_LOG_LEVEL_NONE;
+	if ((str = getenv("SPA_DEBUG")))
+		data.log->level = atoi(str);
+
+	data.support[0].type = SPA_TYPE__TypeMap;
+	data.support[0].data = data.map;
+	data.support[1].type = SPA_TYPE__Log;
+	data.support[1].data = data.log;
+	data.n_support = 2;
+
+	init_type(&data.type, data.map);
+
+	if ((data.hnd_test = load_plugin(plugins, "test/libspa-test.so")) == NULL ||
+	    (data.hnd_mixer = load_plugin(plugins, "audiomixer/libspa-audiomixer.so")) == NULL)
+		return -1;
+
+	data.times = calloc(data.cycles, sizeof(uint64_t));
+
+	for (i = 0; i < SPA_N_ELEMENTS(topologies); i++) {
+		int j;
+
+		for (j = optind; j < argc; j++)
+			if (strcmp(argv[j], topologies[i].name) == 0)
+				break;
+		if (optind < argc && j == argc)
+			continue;
+
+		if (bench_topology(&data, topologies[i].name, topologies[i].make) < 0)
+			res = -1;
+	}
+
+	free(data.times);
+	dlclose(data.hnd_mixer);
+	dlclose(data.hnd_test);
+
+	return res;
+}
@@ -0,0 +1,327 @@
+/* Spa
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <spa/support/log-impl.h>
+#include <spa/support/loop.h>
+#include <spa/support/type-map-impl.h>
+#include <spa/support/plugin.h>
+
+#define DEFAULT_LIB	"build/spa/plugins/support/libspa-support.so"
+#define DURATION_NS	1000000000ull
+#define TIMER_INTERVAL	50000
+#define N_TIMERS	1024
+
+static SPA_TYPE_MAP_IMPL(default_map, 4096);
+static SPA_LOG_IMPL(default_log);
+
+struct data {
+	struct spa_support support[2];
+	uint32_t n_support;
+
+	struct spa_loop *loop;
+	struct spa_loop_control *control;
+	struct spa_loop_utils *utils;
+
+	bool running;
+	uint64_t wakeups;
+	uint64_t expirations;
+
+	struct spa_source *source;
+	struct spa_source *timers[N_TIMERS];
+	int fds[2];
+};
+
+static uint64_t get_clock_ns(clockid_t clock_id)
+{
+	struct timespec now;
+
+	clock_gettime(clock_id, &now);
+	return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static uint64_t get_time_ns(void)
+{
+	return get_clock_ns(CLOCK_MONOTONIC);
+}
+
+static struct spa_handle *make_loop(struct data *data, spa_handle_factory_enum_func_t enum_func,
+				    const char *name)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	struct spa_type_map *map = data->support[0].data;
+	void *iface;
+	uint32_t i;
+	int res;
+
+	for (i = 0;;) {
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			printf("can't find factory %s\n", name);
+			return NULL;
+		}
+		if (strcmp(factory->name, name) == 0)
+			break;
+	}
+
+	handle = calloc(1, factory->size);
+	if ((res = spa_handle_factory_init(factory, handle, NULL,
+					   data->support, data->n_support)) < 0) {
+		printf("can't make %s instance: %s\n", name, spa_strerror(res));
+		free(handle);
+		return NULL;
+	}
+	spa_handle_get_interface(handle, spa_type_map_get_id(map, SPA_TYPE__Loop), &iface);
+	data->loop = iface;
+	spa_handle_get_interface(handle, spa_type_map_get_id(map, SPA_TYPE__LoopControl), &iface);
+	data->control = iface;
+	spa_handle_get_interface(handle, spa_type_map_get_id(map, SPA_TYPE__LoopUtils), &iface);
+	data->utils = iface;
+
+	return handle;
+}
+
+static void run_loop(struct data *data, const char *test)
+{
+	uint64_t start, elapsed, cpu;
+
+	data->wakeups = data->expirations = 0;
+	data->running = true;
+
+	spa_loop_control_enter(data->control);
+	cpu = get_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	start = get_time_ns();
+	while (data->running) {
+		spa_loop_control_iterate(data->control, 100);
+		if (get_time_ns() - start >= DURATION_NS)
+			data->running = false;
+	}
+	elapsed = get_time_ns() - start;
+	cpu = get_clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+	spa_loop_control_leave(data->control);
+
+	printf("  %-8s %10.0f wakeups/s %8.0f ns/wakeup", test, data->wakeups * 1e9 / elapsed,
+			data->wakeups ? (double) cpu / data->wakeups : 0.0);
+	if (data->expirations)
+		printf(" %10"PRIu64" expirations", data->expirations);
+	printf("\n");
+}
+
+/* an event that signals itself again, measures the loop overhead */
+static void on_event(void *user_data, uint64_t count)
+{
+	struct data *data = user_data;
+
+	data->wakeups++;
+	spa_loop_utils_signal_event(data->utils, data->source);
+}
+
+static void bench_event(struct data *data)
+{
+	data->source = spa_loop_utils_add_event(data->utils, on_event, data);
+	spa_loop_utils_signal_event(data->utils, data->source);
+	run_loop(data, "event");
+	spa_loop_utils_destroy_source(data->utils, data->source);
+}
+
+/* a periodic precise timer with a short interval */
+static void on_timeout(void *user_data, uint64_t expirations)
+{
+	struct data *data = user_data;
+
+	data->wakeups++;
+	data->expirations += expirations;
+}
+
+static void bench_timer(struct data *data)
+{
+	struct timespec value, interval;
+
+	data->source = spa_loop_utils_add_precise_timer(data->utils, on_timeout, data);
+	value.tv_sec = interval.tv_sec = 0;
+	value.tv_nsec = interval.tv_nsec = TIMER_INTERVAL;
+	spa_loop_utils_update_timer(data->utils, data->source, &value, &interval, false);
+	run_loop(data, "timer");
+	spa_loop_utils_destroy_source(data->utils, data->source);
+}
+
+/* many periodic timers with intervals between 1 and 64 milliseconds that
+ * are rearmed on each expiration, like timeouts that keep being pushed back */
+static void on_timers_timeout(void *user_data, uint64_t expirations)
+{
+	struct data *data = user_data;
+	struct timespec value, interval;
+	struct spa_source *timer = data->timers[data->wakeups++ % N_TIMERS];
+
+	value.tv_sec = interval.tv_sec = 0;
+	value.tv_nsec = interval.tv_nsec = ((data->wakeups % 64) + 1) * 1000000;
+	spa_loop_utils_update_timer(data->utils, timer, &value, &interval, false);
+	data->expirations += expirations;
+}
+
+static void bench_timers(struct data *data)
+{
+	struct timespec value, interval;
+	uint32_t i;
+
+	for (i = 0; i < N_TIMERS; i++) {
+		data->timers[i] = spa_loop_utils_add_timer(data->utils, on_timers_timeout, data);
+		value.tv_sec = interval.tv_sec = 0;
+		value.tv_nsec = interval.tv_nsec = ((i % 64) + 1) * 1000000;
+		spa_loop_utils_update_timer(data->utils, data->timers[i], &value, &interval, false);
+	}
+	run_loop(data, "timers");
+	for (i = 0; i < N_TIMERS; i++)
+		spa_loop_utils_destroy_source(data->utils, data->timers[i]);
+}
+
+/* ping pong between an io source on the loop and another thread */
+static void on_io(void *user_data, int fd, enum spa_io mask)
+{
+	struct data *data = user_data;
+	uint64_t count;
+
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		return;
+
+	data->wakeups++;
+	count = 1;
+	if (write(data->fds[1], &count, sizeof(count)) != sizeof(count))
+		perror("write");
+}
+
+static void *pong_thread(void *user_data)
+{
+	struct data *data = user_data;
+	uint64_t count = 1;
+
+	while (__atomic_load_n(&data->running, __ATOMIC_RELAXED)) {
+		if (write(data->fds[0], &count, sizeof(count)) != sizeof(count))
+			break;
+		if (read(data->fds[1], &count, sizeof(count)) != sizeof(count))
+			break;
+	}
+	return NULL;
+}
+
+static void bench_io(struct data *data)
+{
+	pthread_t thread;
+	uint64_t count = 1;
+
+	data->fds[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	data->fds[1] = eventfd(0, EFD_CLOEXEC);
+	data->source = spa_loop_utils_add_io(data->utils, data->fds[0], SPA_IO_IN,
+					     true, on_io, data);
+
+	data->running = true;
+	pthread_create(&thread, NULL, pong_thread, data);
+	run_loop(data, "io");
+
+	/* unblock the thread */
+	if (write(data->fds[1], &count, sizeof(count)) != sizeof(count))
+		perror("write");
+	pthread_join(thread, NULL);
+
+	spa_loop_utils_destroy_source(data->utils, data->source);
+	close(data->fds[1]);
+}
+
+/* blocking invoke from another thread */
+static int do_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+		     const void *d, size_t size, void *user_data)
+{
+	struct data *data = user_data;
+	data->wakeups++;
+	return 0;
+}
+
+static void *invoke_thread(void *user_data)
+{
+	struct data *data = user_data;
+
+	while (__atomic_load_n(&data->running, __ATOMIC_RELAXED))
+		spa_loop_invoke(data->loop, do_invoke, 0, NULL, 0, true, data);
+	return NULL;
+}
+
+static void bench_invoke(struct data *data)
+{
+	pthread_t thread;
+
+	data->running = true;
+	pthread_create(&thread, NULL, invoke_thread, data);
+	run_loop(data, "invoke");
+
+	/* handle the last invoke */
+	spa_loop_control_enter(data->control);
+	spa_loop_control_iterate(data->control, 100);
+	spa_loop_control_leave(data->control);
+	pthread_join(thread, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { { { NULL, }, }, };
+	const char *lib = argc > 1 ? argv[1] : DEFAULT_LIB;
+	const char *names[] = { "loop", "loop-uring" };
+	spa_handle_factory_enum_func_t enum_func;
+	void *hnd;
+	uint32_t i;
+
+	data.support[0] = SPA_SUPPORT_INIT(SPA_TYPE__TypeMap, &default_map.map);
+	data.support[1] = SPA_SUPPORT_INIT(SPA_TYPE__Log, &default_log.log);
+	data.n_support = 2;
+
+	if ((hnd = dlopen(lib, RTLD_NOW)) == NULL) {
+		printf("can't load %s: %s\n", lib, dlerror());
+		return -1;
+	}
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		printf("can't find enum function\n");
+		return -1;
+	}
+
+	for (i = 0; i < SPA_N_ELEMENTS(names); i++) {
+		struct spa_handle *handle;
+
+		if ((handle = make_loop(&data, enum_func, names[i])) == NULL)
+			continue;
+
+		printf("%s:\n", names[i]);
+		bench_event(&data);
+		bench_timer(&data);
+		bench_timers(&data);
+		bench_io(&data);
+		bench_invoke(&data);
+
+		spa_handle_clear(handle);
+		free(handle);
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#include <spa/utils/mpsc-queue.h>
+
+#define MAX_WRITERS 64
+
+struct item {
+	uint32_t writer;
+	uint32_t value;
+};
+
+struct spa_mpsc_queue queue;
+uint32_t n_slots;
+uint32_t *seqs;
+struct item *items;
+
+uint32_t n_writers;
+uint64_t n_full;
+
+static void *reader_start(void *arg)
+{
+	uint32_t expected[MAX_WRITERS] = { 0, };
+	unsigned long j = 0, nfailures = 0;
+
+	printf("reader started on cpu: %d\n", sched_getcpu());
+
+	while (1) {
+		uint32_t index;
+		struct item *item;
+
+		if (!spa_mpsc_queue_get_read_index(&queue, &index)) {
+			sched_yield();
+			continue;
+		}
+
+		item = &items[index & (n_slots - 1)];
+
+		if (item->writer >= n_writers || item->value != expected[item->writer]) {
+			nfailures++;
+			printf("failure in item %lu from writer %u: %u != %u - "
+			       "probability: %lu/%lu = %.3f per million\n",
+			       j, item->writer, item->value,
+			       item->writer < n_writers ? expected[item->writer] : 0,
+			       nfailures, j, (float) nfailures / (j + 1) * 1000000);
+		}
+		if (item->writer < n_writers)
+			expected[item->writer] = item->value + 1;
+		j++;
+
+		spa_mpsc_queue_read_update(&queue, index);
+
+		if ((j % (1 << 24)) == 0)
+			printf("%lu items, %lu failures, %lu full\n", j, nfailures,
+			       (unsigned long) __atomic_load_n(&n_full, __ATOMIC_RELAXED));
+	}
+
+	return NULL;
+}
+
+static void *writer_start(void *arg)
+{
+	uint32_t id = (uint32_t) (uintptr_t) arg, value = 0;
+
+	printf("writer %u started on cpu: %d\n", id, sched_getcpu());
+
+	while (1) {
+		uint32_t index;
+		struct item *item;
+
+		if (!spa_mpsc_queue_get_write_index(&queue, &index)) {
+			__atomic_add_fetch(&n_full, 1, __ATOMIC_RELAXED);
+			sched_yield();
+			continue;
+		}
+
+		item = &items[index & (n_slots - 1)];
+		item->writer = id;
+		item->value = value++;
+
+		spa_mpsc_queue_write_update(&queue, index);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	pthread_t reader_thread, writer_threads[MAX_WRITERS];
+	uint32_t i;
+
+	printf("starting mpsc queue stress test\n");
+
+	if (argc < 3) {
+		printf("usage: %s <slots> <writers>\n", argv[0]);
+		return -1;
+	}
+
+	sscanf(argv[1], "%u", &n_slots);
+	sscanf(argv[2], "%u", &n_writers);
+
+	if (n_slots == 0 || (n_slots & (n_slots - 1)) != 0) {
+		printf("number of slots must be a power of 2\n");
+		return -1;
+	}
+	if (n_writers == 0 || n_writers > MAX_WRITERS) {
+		printf("number of writers must be between 1 and %d\n", MAX_WRITERS);
+		return -1;
+	}
+
+	printf("queue slots: %u\n", n_slots);
+	printf("writers: %u\n", n_writers);
+
+	seqs = malloc(n_slots * sizeof(uint32_t));
+	items = malloc(n_slots * sizeof(struct item));
+	spa_mpsc_queue_init(&queue, seqs, n_slots);
+
+	pthread_create(&reader_thread, NULL, reader_start, NULL);
+	for (i = 0; i < n_writers; i++)
+		pthread_create(&writer_threads[i], NULL, writer_start, (void *) (uintptr_t) i);
+
+	while (1)
+		sleep(1);
+
+	return 0;
+}
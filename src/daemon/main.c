@@ -29,6 +29,7 @@
 #include "daemon-config.h"
 
 static const char *daemon_name = "pipewire-0";
+static const char *quantum = NULL;
 
 static void do_quit(void *data, int signal_number)
 {
@@ -41,7 +42,9 @@ static void show_help(const char *name)
 	fprintf(stdout, "%s [options]\n"
              "  -h, --help                            Show this help\n"
              "  -v, --version                         Show version\n"
-             "  -n, --name                            Daemon name (Default %s)\n",
+             "  -n, --name                            Daemon name (Default %s)\n"
+             "  -q, --quantum                         Schedule the graph from a timer\n"
+             "                                        with this quantum (Default none)\n",
 	     name,
 	     daemon_name);
 }
@@ -57,13 +60,14 @@ int main(int argc, char *argv[])
 		{"help",	0, NULL, 'h'},
 		{"version",	0, NULL, 'v'},
 		{"name",	1, NULL, 'n'},
+		{"quantum",	1, NULL, 'q'},
 		{NULL,		0, NULL, 0}
 	};
 	char c;
 
 	pw_init(&argc, &argv);
 
-	while ((c = getopt_long(argc, argv, "hvn:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hvn:q:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h' :
 			show_help(argv[0]);
@@ -80,6 +84,9 @@ int main(int argc, char *argv[])
 			daemon_name = optarg;
 			fprintf(stdout, "set name %s\n", daemon_name);
 			break;
+		case 'q' :
+			quantum = optarg;
+			break;
 		default:
 			return -1;
 		}
@@ -94,7 +101,11 @@ int main(int argc, char *argv[])
 	}
 
 	props = pw_properties_new(PW_CORE_PROP_NAME, daemon_name,
-				  PW_CORE_PROP_DAEMON, "1", NULL);
+				  PW_CORE_PROP_DAEMON, "1",
+				  PW_CORE_PROP_PROFILER, "1024",
+				  PW_CORE_PROP_RATE, "48000", NULL);
+	if (quantum)
+		pw_properties_set(props, PW_CORE_PROP_QUANTUM, quantum);
 
 	loop = pw_main_loop_new(props);
 	pw_loop_add_signal(pw_main_loop_get_loop(loop), SIGINT, do_quit, loop);
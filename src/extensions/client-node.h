@@ -24,6 +24,9 @@
 extern "C" {
 #endif
 
+#include <errno.h>
+#include <time.h>
+
 #include <spa/utils/defs.h>
 #include <spa/param/param.h>
 #include <spa/node/node.h>
@@ -38,7 +41,11 @@ struct pw_client_node_proxy;
 
 struct pw_client_node_message;
 
-/** Shared structure between client and server \memberof pw_client_node */
+/** Shared structure between client and server \memberof pw_client_node
+ *
+ * The area is followed by the io of the input and output ports and by the
+ * two message ringbuffers. Transports of version 1 have a
+ * \ref pw_client_node_area_ext between the area and the port io. */
 struct pw_client_node_area {
 	uint32_t max_input_ports;	/**< max input ports of the node */
 	uint32_t n_input_ports;		/**< number of input ports of the node */
@@ -46,6 +53,44 @@ struct pw_client_node_area {
 	uint32_t n_output_ports;	/**< number of output ports of the node */
 };
 
+/** Activation record in the transport area \memberof pw_client_node
+ *
+ * There is one activation record for each side of the transport. The
+ * sender of messages increments the status of the receiver. Only when
+ * the receiver was idle, it is woken up with a futex wake when it is
+ * blocked in pw_client_node_transport_wait() or with a write on the
+ * eventfd otherwise. The futex is only used when both sides have a
+ * transport of version 1 or newer. */
+struct pw_client_node_activation {
+	uint32_t status;		/**< number of signals since the last wakeup */
+	uint32_t waiting;		/**< receiver is blocked in a futex wait on status */
+};
+
+/** Part of the area of version 1 transports \memberof pw_client_node */
+struct pw_client_node_area_ext {
+	uint32_t buffer_size;		/**< size of each message ringbuffer, power of 2 */
+	uint32_t padding;
+	struct pw_client_node_activation activation[2];	/**< of the server and the client */
+};
+
+/** Property with the transport version of the client. Clients without it
+ * get a transport of version 0, with ringbuffers of 4096 bytes and only
+ * eventfd wakeups. \memberof pw_client_node */
+#define PW_CLIENT_NODE_PROP_TRANSPORT_VERSION	"pipewire.client.transport-version"
+
+/** Transport statistics \memberof pw_client_node_transport
+ *
+ * The counters are updated with atomic operations from the data thread,
+ * use pw_client_node_transport_get_stats() to read them from other threads. */
+struct pw_client_node_transport_stats {
+	uint64_t sent;		/**< messages added */
+	uint64_t flushes;	/**< flushes of queued messages */
+	uint64_t signals;	/**< flushes that needed to wake up the peer */
+	uint64_t wakeups;	/**< times the peer woke us up */
+	uint64_t received;	/**< messages received */
+	uint64_t overflows;	/**< messages dropped because the ringbuffer was full */
+};
+
 /** \class pw_client_node_transport
  *
  * \brief Transport object
@@ -55,13 +100,21 @@ struct pw_client_node_area {
  * lockfree way.
  */
 struct pw_client_node_transport {
+#define PW_VERSION_CLIENT_NODE_TRANSPORT	1	/**< peer can be woken with a futex */
+	uint32_t version;			/**< version supported by both sides */
 	struct pw_client_node_area *area;	/**< the transport area */
+	uint32_t buffer_size;			/**< size of each message ringbuffer */
 	struct spa_io_buffers *inputs;		/**< array of buffer input io */
 	struct spa_io_buffers *outputs;		/**< array of buffer output io */
 	void *input_data;			/**< input memory for ringbuffer */
 	struct spa_ringbuffer *input_buffer;	/**< ringbuffer for input memory */
 	void *output_data;			/**< output memory for ringbuffer */
 	struct spa_ringbuffer *output_buffer;	/**< ringbuffer for output memory */
+	struct pw_client_node_activation *input_activation;	/**< activation of this side */
+	struct pw_client_node_activation *output_activation;	/**< activation of the peer */
+	uint32_t queued;			/**< messages added since the last flush */
+	struct pw_client_node_transport_stats *stats;	/**< transport statistics, the transports
+							  *  of a node can share them */
 
 	/** Destroy a transport
 	 * \param trans a transport to destroy
@@ -100,12 +153,95 @@ struct pw_client_node_transport {
 	 * Use this function after \ref next_message().
 	 */
 	int (*parse_message) (struct pw_client_node_transport *trans, void *message);
+
+	/** Wake up the peer after adding messages
+	 * \param trans the transport
+	 * \param fd the eventfd of the peer, used when the peer is not waiting
+	 *		on the futex
+	 * \return 0 on success, < 0 on error
+	 *
+	 * No syscall is made when the peer was already signaled and did not
+	 * handle the messages yet.
+	 */
+	int (*signal) (struct pw_client_node_transport *trans, int fd);
+
+	/** Block until the peer signals
+	 * \param trans the transport
+	 * \param timeout relative timeout or NULL to wait forever
+	 * \return the number of signals, -ETIMEDOUT when the timeout expired
+	 *	or -ENOTSUP when the peer can't wake us with the futex
+	 *
+	 * The peer wakes up the thread with the futex directly instead of
+	 * with a write on the eventfd. The signals are acknowledged.
+	 */
+	int (*wait) (struct pw_client_node_transport *trans, const struct timespec *timeout);
 };
 
 #define pw_client_node_transport_destroy(t)		((t)->destroy((t)))
 #define pw_client_node_transport_add_message(t,m)	((t)->add_message((t), (m)))
 #define pw_client_node_transport_next_message(t,m)	((t)->next_message((t), (m)))
 #define pw_client_node_transport_parse_message(t,m)	((t)->parse_message((t), (m)))
+#define pw_client_node_transport_signal(t,f)		((t)->signal((t), (f)))
+#define pw_client_node_transport_wait(t,to)		((t)->wait((t), (to)))
+
+/** Wake up the peer when messages were added since the last flush
+ * \param trans the transport
+ * \param fd the eventfd of the peer
+ * \return 0 on success, < 0 on error
+ *
+ * Use this to send all the messages of a cycle with one wakeup.
+ * \memberof pw_client_node_transport
+ */
+static inline int
+pw_client_node_transport_flush(struct pw_client_node_transport *trans, int fd)
+{
+	if (__atomic_exchange_n(&trans->queued, 0, __ATOMIC_SEQ_CST) == 0)
+		return 0;
+
+	__atomic_fetch_add(&trans->stats->flushes, 1, __ATOMIC_RELAXED);
+	return pw_client_node_transport_signal(trans, fd);
+}
+
+/** Acknowledge the signals of the peer
+ * \param trans the transport
+ * \return the number of signals since the last call
+ *
+ * Call this before reading the messages with
+ * pw_client_node_transport_next_message(). Messages added after this
+ * call will signal again.
+ * \memberof pw_client_node_transport
+ */
+static inline uint32_t
+pw_client_node_transport_acknowledge(struct pw_client_node_transport *trans)
+{
+	uint32_t status = __atomic_exchange_n(&trans->input_activation->status, 0, __ATOMIC_SEQ_CST);
+
+	/* a version 0 peer only writes the eventfd */
+	if (status > 0 || trans->version < 1)
+		__atomic_fetch_add(&trans->stats->wakeups, 1, __ATOMIC_RELAXED);
+	return status;
+}
+
+/** Read the statistics of a transport
+ * \param trans the transport
+ * \param[out] stats the statistics
+ *
+ * Can be called from any thread.
+ * \memberof pw_client_node_transport
+ */
+static inline void
+pw_client_node_transport_get_stats(struct pw_client_node_transport *trans,
+				   struct pw_client_node_transport_stats *stats)
+{
+	const struct pw_client_node_transport_stats *s = trans->stats;
+
+	stats->sent = __atomic_load_n(&s->sent, __ATOMIC_RELAXED);
+	stats->flushes = __atomic_load_n(&s->flushes, __ATOMIC_RELAXED);
+	stats->signals = __atomic_load_n(&s->signals, __ATOMIC_RELAXED);
+	stats->wakeups = __atomic_load_n(&s->wakeups, __ATOMIC_RELAXED);
+	stats->received = __atomic_load_n(&s->received, __ATOMIC_RELAXED);
+	stats->overflows = __atomic_load_n(&s->overflows, __ATOMIC_RELAXED);
+}
 
 enum pw_client_node_message_type {
 	PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT,		/*< signal that the node has output */
@@ -113,6 +249,7 @@ enum pw_client_node_message_type {
 	PW_CLIENT_NODE_MESSAGE_PROCESS_INPUT,		/*< instruct the node to process input */
 	PW_CLIENT_NODE_MESSAGE_PROCESS_OUTPUT,		/*< instruct the node output is processed */
 	PW_CLIENT_NODE_MESSAGE_PORT_REUSE_BUFFER,	/*< reuse a buffer */
+	PW_CLIENT_NODE_MESSAGE_TRANSPORT_SWITCHED,	/*< the client uses the new transport */
 };
 
 struct pw_client_node_message_body {
@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <dlfcn.h>
@@ -47,6 +48,9 @@
 
 #define MAX_BUFFERS      64
 
+/* space for the messages that don't fit in the transport until it grew */
+#define OVERFLOW_SIZE    4096
+
 #define CHECK_IN_PORT_ID(this,d,p)       ((d) == SPA_DIRECTION_INPUT && (p) < MAX_INPUTS)
 #define CHECK_OUT_PORT_ID(this,d,p)      ((d) == SPA_DIRECTION_OUTPUT && (p) < MAX_OUTPUTS)
 #define CHECK_PORT_ID(this,d,p)          (CHECK_IN_PORT_ID(this,d,p) || CHECK_OUT_PORT_ID(this,d,p))
@@ -135,9 +139,23 @@ struct impl {
 	struct node node;
 
 	struct pw_client_node_transport *transport;
+	struct pw_client_node_transport *old_transport;	/**< used by the client until it
+							  *  switched to the new transport */
+	struct pw_client_node_transport *dead_transport;	/**< old transport to free in
+								  *  the main loop */
+	uint32_t transport_version;		/**< transport version of the client */
+	uint32_t buffer_size;			/**< requested size of the ringbuffers */
+	struct spa_source *grow_event;		/**< signaled when the transport overflows and
+						  *  when the old transport can be freed */
+	bool grow_pending;			/**< until the client switched to the bigger
+						  *  transport */
+	uint8_t overflow[OVERFLOW_SIZE];	/**< messages to send on the new transport */
+	uint32_t overflow_size;
+	struct pw_client_node_transport_stats stats;	/**< shared by all transports */
 
 	struct spa_hook node_listener;
 	struct spa_hook resource_listener;
+	struct spa_hook loop_hook;
 
 	struct pw_array mems;
 
@@ -264,12 +282,52 @@ static int impl_node_set_param(struct spa_node *node, uint32_t id, uint32_t flag
 	return SPA_RESULT_RETURN_ASYNC(this->seq++);
 }
 
+static inline void send_message(struct impl *impl, struct pw_client_node_message *message)
+{
+	uint32_t size = SPA_POD_SIZE(message);
+
+	/* keep the order, nothing goes on the transport while there are
+	 * messages waiting for the bigger one */
+	if (impl->overflow_size == 0 &&
+	    pw_client_node_transport_add_message(impl->transport, message) == 0)
+		return;
+
+	/* version 0 clients can't switch to a bigger transport */
+	if (impl->transport_version < 1 ||
+	    impl->buffer_size >= pw_client_node_transport_buffer_size(0, 0, UINT32_MAX) ||
+	    impl->overflow_size + size > OVERFLOW_SIZE) {
+		__atomic_fetch_add(&impl->stats.overflows, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	/* can be a message of the overflow that is sent again */
+	memmove(&impl->overflow[impl->overflow_size], message, size);
+	impl->overflow_size += size;
+
+	if (!__atomic_load_n(&impl->grow_pending, __ATOMIC_ACQUIRE)) {
+		__atomic_store_n(&impl->grow_pending, true, __ATOMIC_RELEASE);
+		pw_loop_signal_event(impl->core->main_loop, impl->grow_event);
+	}
+}
+
+/* send the messages that did not fit on the old transport */
+static void send_overflow(struct impl *impl)
+{
+	uint32_t offset = 0, size = impl->overflow_size;
+
+	impl->overflow_size = 0;
+	while (offset < size) {
+		struct pw_client_node_message *m = (struct pw_client_node_message *) &impl->overflow[offset];
+		offset += SPA_POD_SIZE(m);
+		send_message(impl, m);
+	}
+}
+
 static inline void do_flush(struct node *this)
 {
-	uint64_t cmd = 1;
-	if (write(this->writefd, &cmd, 8) != 8)
-		spa_log_warn(this->log, "node %p: error flushing : %s", this, strerror(errno));
+	int res;
 
+	if ((res = pw_client_node_transport_flush(this->impl->transport, this->writefd)) < 0)
+		spa_log_warn(this->log, "node %p: error flushing : %s", this, spa_strerror(res));
 }
 
 static int impl_node_send_command(struct spa_node *node, const struct spa_command *command)
@@ -586,6 +644,26 @@ impl_node_port_set_param(struct spa_node *node,
 	return SPA_RESULT_RETURN_ASYNC(this->seq++);
 }
 
+/* Let the io of the port live in the shared transport area. The graph then
+ * reads and writes the io of the client directly and nothing needs to be
+ * copied when the client is scheduled. */
+static void port_use_transport_io(struct pw_client_node_transport *trans, struct pw_port *port)
+{
+	struct spa_io_buffers *io;
+
+	if (port->direction == PW_DIRECTION_INPUT) {
+		if (port->port_id >= trans->area->max_input_ports)
+			return;
+		io = &trans->inputs[port->port_id];
+	} else {
+		if (port->port_id >= trans->area->max_output_ports)
+			return;
+		io = &trans->outputs[port->port_id];
+	}
+	*io = *port->rt.port.io;
+	port->rt.port.io = port->rt.mix_port.io = io;
+}
+
 static int
 impl_node_port_set_io(struct spa_node *node,
 		      enum spa_direction direction,
@@ -613,6 +691,17 @@ impl_node_port_set_io(struct spa_node *node,
 	if (!CHECK_PORT(this, direction, port_id))
 		return -EINVAL;
 
+	if (id == t->io.Buffers) {
+		struct pw_port *port;
+
+		/* the buffers io is placed in the transport, this is done for
+		 * all ports when the transport is made */
+		if (impl->transport &&
+		    (port = pw_node_find_port(impl->this.node, direction, port_id)) != NULL)
+			port_use_transport_io(impl->transport, port);
+		return 0;
+	}
+
 	if (data) {
 		if ((mem = pw_memblock_find(data)) == NULL)
 			return -EINVAL;
@@ -798,9 +887,8 @@ impl_node_port_reuse_buffer(struct spa_node *node, uint32_t port_id, uint32_t bu
 
 	spa_log_trace(this->log, "reuse buffer %d", buffer_id);
 
-	pw_client_node_transport_add_message(impl->transport, (struct pw_client_node_message *)
+	send_message(impl, (struct pw_client_node_message *)
 			&PW_CLIENT_NODE_MESSAGE_PORT_REUSE_BUFFER_INIT(port_id, buffer_id));
-	do_flush(this);
 
 	return 0;
 }
@@ -851,20 +939,17 @@ static int impl_node_process_input(struct spa_node *node)
 		res = SPA_STATUS_NEED_BUFFER;
 	}
 	else {
-		spa_list_for_each(p, &n->ports[SPA_DIRECTION_INPUT], link) {
-			struct spa_io_buffers *io = p->io;
-
-			pw_log_trace("set io status to %d %d", io->status, io->buffer_id);
-			impl->transport->inputs[p->port_id] = *io;
-
+		/* the io of the ports is in the transport, the client reads it
+		 * directly */
+		if (!client_reuse) {
 			/* explicitly recycle buffers when the client is not going to do it */
-			if (!client_reuse && (pp = p->peer))
-		                spa_node_port_reuse_buffer(pp->node->implementation,
-						pp->port_id, io->buffer_id);
+			spa_list_for_each(p, &n->ports[SPA_DIRECTION_INPUT], link) {
+				if ((pp = p->peer))
+			                spa_node_port_reuse_buffer(pp->node->implementation,
+							pp->port_id, p->io->buffer_id);
+			}
 		}
-		pw_client_node_transport_add_message(impl->transport,
-			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_PROCESS_INPUT));
-		do_flush(this);
+		send_message(impl, &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_PROCESS_INPUT));
 
 		impl->input_ready--;
 		res = SPA_STATUS_OK;
@@ -876,37 +961,19 @@ static int impl_node_process_output(struct spa_node *node)
 {
 	struct node *this;
 	struct impl *impl;
-	struct spa_graph_node *n;
-	struct spa_graph_port *p;
 
 	this = SPA_CONTAINER_OF(node, struct node, node);
 	impl = this->impl;
-	n = &impl->this.node->rt.node;
-
-	if (impl->out_pending)
-		goto done;
 
 	impl->out_pending = true;
 
-	spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
-		struct spa_io_buffers *io = p->io;
-
-		impl->transport->outputs[p->port_id] = *io;
-
-		pw_log_trace("%d %d -> %d %d", io->status, io->buffer_id,
-				impl->transport->outputs[p->port_id].status,
-				impl->transport->outputs[p->port_id].buffer_id);
-	}
-
-      done:
-	pw_client_node_transport_add_message(impl->transport,
-			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_PROCESS_OUTPUT));
-	do_flush(this);
+	send_message(impl, &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_PROCESS_OUTPUT));
 
 	return SPA_STATUS_OK;
 }
 
-static int handle_node_message(struct node *this, struct pw_client_node_message *message)
+static int handle_node_message(struct node *this, struct pw_client_node_transport *trans,
+			       struct pw_client_node_message *message)
 {
 	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, node);
 	struct spa_graph_node *n;
@@ -916,8 +983,11 @@ static int handle_node_message(struct node *this, struct pw_client_node_message
 
 	switch (PW_CLIENT_NODE_MESSAGE_TYPE(message)) {
 	case PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT:
+		/* the io of the ports is in the transport, only the messages that
+		 * were still sent on an old transport need a copy */
 		spa_list_for_each(p, &n->ports[SPA_DIRECTION_OUTPUT], link) {
-			*p->io = impl->transport->outputs[p->port_id];
+			if (trans != impl->transport)
+				*p->io = trans->outputs[p->port_id];
 			pw_log_trace("have output %d %d", p->io->status, p->io->buffer_id);
 		}
 		impl->out_pending = false;
@@ -926,7 +996,8 @@ static int handle_node_message(struct node *this, struct pw_client_node_message
 
 	case PW_CLIENT_NODE_MESSAGE_NEED_INPUT:
 		spa_list_for_each(p, &n->ports[SPA_DIRECTION_INPUT], link) {
-			*p->io = impl->transport->inputs[p->port_id];
+			if (trans != impl->transport)
+				*p->io = trans->inputs[p->port_id];
 			pw_log_trace("need input %d %d", p->io->status, p->io->buffer_id);
 		}
 		impl->input_ready++;
@@ -942,6 +1013,17 @@ static int handle_node_message(struct node *this, struct pw_client_node_message
 		}
 		break;
 
+	case PW_CLIENT_NODE_MESSAGE_TRANSPORT_SWITCHED:
+		if (trans != impl->transport || impl->old_transport == NULL)
+			break;
+		/* the client does not use the old transport anymore, let the main
+		 * loop free it and grow again when the new one overflowed too */
+		__atomic_store_n(&impl->dead_transport, impl->old_transport, __ATOMIC_RELEASE);
+		__atomic_store_n(&impl->old_transport, NULL, __ATOMIC_RELEASE);
+		__atomic_store_n(&impl->grow_pending, impl->overflow_size > 0, __ATOMIC_RELEASE);
+		pw_loop_signal_event(impl->core->main_loop, impl->grow_event);
+		break;
+
 	default:
 		pw_log_warn("unhandled message %d", PW_CLIENT_NODE_MESSAGE_TYPE(message));
 		return -ENOTSUP;
@@ -949,15 +1031,163 @@ static int handle_node_message(struct node *this, struct pw_client_node_message
 	return 0;
 }
 
-static void setup_transport(struct impl *impl)
+static void use_transport_io(struct impl *impl, struct pw_client_node_transport *trans)
+{
+	struct pw_node *node = impl->this.node;
+	struct pw_port *port;
+
+	spa_list_for_each(port, &node->input_ports, link)
+		port_use_transport_io(trans, port);
+	spa_list_for_each(port, &node->output_ports, link)
+		port_use_transport_io(trans, port);
+}
+
+static struct pw_client_node_transport *make_transport(struct impl *impl)
 {
+	struct pw_client_node_transport *trans;
 	uint32_t max_inputs = 0, max_outputs = 0, n_inputs = 0, n_outputs = 0;
 
 	spa_node_get_n_ports(&impl->node.node, &n_inputs, &max_inputs, &n_outputs, &max_outputs);
 
-	impl->transport = pw_client_node_transport_new(max_inputs, max_outputs);
-	impl->transport->area->n_input_ports = n_inputs;
-	impl->transport->area->n_output_ports = n_outputs;
+	trans = pw_client_node_transport_new(impl->transport_version,
+					     max_inputs, max_outputs, impl->buffer_size);
+	if (trans == NULL)
+		return NULL;
+
+	trans->area->n_input_ports = n_inputs;
+	trans->area->n_output_ports = n_outputs;
+	trans->stats = &impl->stats;
+	impl->buffer_size = trans->buffer_size;
+
+	return trans;
+}
+
+static void setup_transport(struct impl *impl)
+{
+	if ((impl->transport = make_transport(impl)) != NULL)
+		use_transport_io(impl, impl->transport);
+}
+
+static int do_swap_transport(struct spa_loop *loop,
+			     bool async,
+			     uint32_t seq,
+			     const void *data,
+			     size_t size,
+			     void *user_data)
+{
+	struct impl *impl = user_data;
+	struct pw_client_node_transport *trans = *(struct pw_client_node_transport **) data;
+	struct pw_client_node_area *a = trans->area;
+
+	memcpy(trans->inputs, impl->transport->inputs,
+	       a->max_input_ports * sizeof(struct spa_io_buffers));
+	memcpy(trans->outputs, impl->transport->outputs,
+	       a->max_output_ports * sizeof(struct spa_io_buffers));
+	use_transport_io(impl, trans);
+
+	/* keep reading the old transport until the client switches */
+	do_flush(&impl->node);
+	__atomic_store_n(&impl->old_transport, impl->transport, __ATOMIC_RELEASE);
+	impl->transport = trans;
+
+	send_overflow(impl);
+	do_flush(&impl->node);
+
+	return 0;
+}
+
+static int do_drop_overflow(struct spa_loop *loop,
+			    bool async,
+			    uint32_t seq,
+			    const void *data,
+			    size_t size,
+			    void *user_data)
+{
+	struct impl *impl = user_data;
+	uint32_t offset, n_dropped = 0;
+
+	for (offset = 0; offset < impl->overflow_size; n_dropped++)
+		offset += SPA_POD_SIZE(&impl->overflow[offset]);
+	__atomic_fetch_add(&impl->stats.overflows, n_dropped, __ATOMIC_RELAXED);
+	impl->overflow_size = 0;
+	__atomic_store_n(&impl->grow_pending, false, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/* publish the transport statistics in the node properties, done from the
+ * main loop when the state changes and when the transport overflows */
+static void update_stats(struct impl *impl)
+{
+	struct pw_client_node_transport_stats s;
+	char sent[32], flushes[32], signals[32], wakeups[32], received[32], overflows[32];
+	struct spa_dict_item items[6];
+
+	if (impl->transport == NULL)
+		return;
+
+	pw_client_node_transport_get_stats(impl->transport, &s);
+
+	snprintf(sent, sizeof(sent), "%"PRIu64, s.sent);
+	snprintf(flushes, sizeof(flushes), "%"PRIu64, s.flushes);
+	snprintf(signals, sizeof(signals), "%"PRIu64, s.signals);
+	snprintf(wakeups, sizeof(wakeups), "%"PRIu64, s.wakeups);
+	snprintf(received, sizeof(received), "%"PRIu64, s.received);
+	snprintf(overflows, sizeof(overflows), "%"PRIu64, s.overflows);
+
+	items[0] = SPA_DICT_ITEM_INIT("client-node.transport.sent", sent);
+	items[1] = SPA_DICT_ITEM_INIT("client-node.transport.flushes", flushes);
+	items[2] = SPA_DICT_ITEM_INIT("client-node.transport.signals", signals);
+	items[3] = SPA_DICT_ITEM_INIT("client-node.transport.wakeups", wakeups);
+	items[4] = SPA_DICT_ITEM_INIT("client-node.transport.received", received);
+	items[5] = SPA_DICT_ITEM_INIT("client-node.transport.overflows", overflows);
+
+	pw_node_update_properties(impl->this.node, &SPA_DICT_INIT(items, 6));
+}
+
+/* Replace the transport with one with bigger ringbuffers. The client gets
+ * the new transport with the transport event and maps it in place of the
+ * old one. */
+static void on_grow_transport(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	struct pw_client_node *this = &impl->this;
+	struct pw_client_node_transport *trans;
+	uint32_t buffer_size = impl->buffer_size;
+
+	if ((trans = __atomic_exchange_n(&impl->dead_transport, NULL, __ATOMIC_ACQ_REL)) != NULL) {
+		pw_log_debug("client-node %p: free old transport %p", impl, trans);
+		pw_client_node_transport_destroy(trans);
+	}
+
+	/* only grow again after the client switched to the last transport */
+	if (impl->transport == NULL || this->resource == NULL ||
+	    !__atomic_load_n(&impl->grow_pending, __ATOMIC_ACQUIRE) ||
+	    __atomic_load_n(&impl->old_transport, __ATOMIC_ACQUIRE) != NULL)
+		return;
+
+	impl->buffer_size = buffer_size * 2;
+	if (buffer_size >= pw_client_node_transport_buffer_size(0, 0, UINT32_MAX) ||
+	    (trans = make_transport(impl)) == NULL) {
+		impl->buffer_size = buffer_size;
+		pw_log_warn("client-node %p: transport overflow, dropping messages", impl);
+		spa_loop_invoke(impl->node.data_loop,
+				do_drop_overflow, SPA_ID_INVALID, NULL, 0, true, impl);
+		update_stats(impl);
+		return;
+	}
+
+	pw_log_warn("client-node %p: transport overflow, grow to %u", impl, impl->buffer_size);
+
+	spa_loop_invoke(impl->node.data_loop,
+			do_swap_transport, SPA_ID_INVALID, &trans, sizeof(trans), true, impl);
+	update_stats(impl);
+
+	pw_client_node_resource_transport(this->resource,
+					  pw_global_get_id(pw_node_get_global(this->node)),
+					  impl->other_fds[0],
+					  impl->other_fds[1],
+					  impl->transport);
 }
 
 static void
@@ -998,6 +1228,10 @@ client_node_update(void *data,
 
 		for (i = 0; i < this->n_params; i++)
 			this->params[i] = pw_spa_pod_copy(params[i]);
+
+		/* drop the cached port params */
+		if (impl->this.node)
+			impl->this.node->param_serial++;
 	}
 	spa_log_info(this->log, "node %p: got node update max_in %u, max_out %u", this,
 		     this->max_inputs, this->max_outputs);
@@ -1025,11 +1259,17 @@ client_node_port_update(void *data,
 	if (remove) {
 		do_uninit_port(this, direction, port_id);
 	} else {
+		struct pw_port *port;
+
 		do_update_port(this,
 			       direction,
 			       port_id,
 			       change_mask,
 			       n_params, params, info);
+
+		if ((change_mask & PW_CLIENT_NODE_PORT_UPDATE_PARAMS) &&
+		    (port = pw_node_find_port(impl->this.node, direction, port_id)) != NULL)
+			pw_port_params_changed(port);
 	}
 	pw_node_update_ports(impl->this.node);
 }
@@ -1063,6 +1303,19 @@ static struct pw_client_node_proxy_methods client_node_methods = {
 	.destroy = client_node_destroy,
 };
 
+static void handle_node_messages(struct node *this, struct pw_client_node_transport *trans)
+{
+	struct pw_client_node_message message;
+
+	pw_client_node_transport_acknowledge(trans);
+
+	while (pw_client_node_transport_next_message(trans, &message) == 1) {
+		struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+		pw_client_node_transport_parse_message(trans, msg);
+		handle_node_message(this, trans, msg);
+	}
+}
+
 static void node_on_data_fd_events(struct spa_source *source)
 {
 	struct node *this = source->data;
@@ -1074,21 +1327,34 @@ static void node_on_data_fd_events(struct spa_source *source)
 	}
 
 	if (source->rmask & SPA_IO_IN) {
-		struct pw_client_node_message message;
 		uint64_t cmd;
 
 		if (read(this->data_source.fd, &cmd, sizeof(uint64_t)) != sizeof(uint64_t))
 			spa_log_warn(this->log, "node %p: error reading message: %s",
 					this, strerror(errno));
 
-		while (pw_client_node_transport_next_message(impl->transport, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(impl->transport, msg);
-			handle_node_message(this, msg);
-		}
+		if (impl->old_transport)
+			handle_node_messages(this, impl->old_transport);
+		handle_node_messages(this, impl->transport);
 	}
 }
 
+/* the messages of a cycle are flushed with one wakeup when the data loop
+ * goes back to sleep. This can also be called from a thread that does a
+ * blocking invoke on the data loop. */
+static void on_loop_before(void *data)
+{
+	struct impl *impl = data;
+
+	if (impl->transport)
+		do_flush(&impl->node);
+}
+
+static const struct spa_loop_control_hooks loop_hooks = {
+	SPA_VERSION_LOOP_CONTROL_HOOKS,
+	.before = on_loop_before,
+};
+
 static const struct spa_node impl_node = {
 	SPA_VERSION_NODE,
 	NULL,
@@ -1166,6 +1432,18 @@ static int node_clear(struct node *this)
 	return 0;
 }
 
+static int do_add_hook(struct spa_loop *loop,
+		       bool async,
+		       uint32_t seq,
+		       const void *data,
+		       size_t size,
+		       void *user_data)
+{
+	struct impl *impl = user_data;
+	pw_loop_add_hook(impl->this.node->data_loop, &impl->loop_hook, &loop_hooks, impl);
+	return 0;
+}
+
 static int do_remove_source(struct spa_loop *loop,
 			    bool async,
 			    uint32_t seq,
@@ -1173,8 +1451,10 @@ static int do_remove_source(struct spa_loop *loop,
 			    size_t size,
 			    void *user_data)
 {
-	struct spa_source *source = user_data;
-	spa_loop_remove_source(loop, source);
+	struct impl *impl = user_data;
+	spa_loop_remove_source(loop, &impl->node.data_source);
+	spa_hook_remove(&impl->loop_hook);
+	on_loop_before(impl);
 	return 0;
 }
 
@@ -1196,11 +1476,17 @@ static void client_node_resource_destroy(void *data)
 				NULL,
 				0,
 				true,
-				&node->data_source);
+				impl);
 	}
 	pw_node_destroy(this->node);
 }
 
+static void node_state_changed(void *data, enum pw_node_state old,
+			       enum pw_node_state state, const char *error)
+{
+	update_stats(data);
+}
+
 static void node_initialized(void *data)
 {
 	struct impl *impl = data;
@@ -1218,6 +1504,7 @@ static void node_initialized(void *data)
 	impl->other_fds[1] = impl->fds[0];
 
 	spa_loop_add_source(impl->node.data_loop, &impl->node.data_source);
+	spa_loop_invoke(impl->node.data_loop, do_add_hook, SPA_ID_INVALID, NULL, 0, false, impl);
 	pw_log_debug("client-node %p: transport fd %d %d", node, impl->fds[0], impl->fds[1]);
 
 	pw_client_node_resource_transport(this->resource,
@@ -1234,8 +1521,22 @@ static void node_free(void *data)
 	pw_log_debug("client-node %p: free", &impl->this);
 	node_clear(&impl->node);
 
-	if (impl->transport)
+	if (impl->transport) {
+		struct pw_client_node_transport_stats s;
+
+		pw_client_node_transport_get_stats(impl->transport, &s);
+		pw_log_info("client-node %p: sent %"PRIu64" messages in %"PRIu64" wakeups, "
+			    "received %"PRIu64" messages in %"PRIu64" wakeups, "
+			    "%"PRIu64" overflows", &impl->this,
+			    s.sent, s.signals, s.received, s.wakeups, s.overflows);
 		pw_client_node_transport_destroy(impl->transport);
+	}
+	if (impl->old_transport)
+		pw_client_node_transport_destroy(impl->old_transport);
+	if (impl->dead_transport)
+		pw_client_node_transport_destroy(impl->dead_transport);
+	if (impl->grow_event)
+		pw_loop_destroy_source(impl->core->main_loop, impl->grow_event);
 
 	spa_hook_remove(&impl->node_listener);
 
@@ -1252,6 +1553,7 @@ static const struct pw_node_events node_events = {
 	PW_VERSION_NODE_EVENTS,
 	.free = node_free,
 	.initialized = node_initialized,
+	.state_changed = node_state_changed,
 };
 
 static const struct pw_resource_events resource_events = {
@@ -1293,7 +1595,8 @@ struct pw_client_node *pw_client_node_new(struct pw_resource *resource,
 	impl->fds[0] = impl->fds[1] = -1;
 	pw_log_debug("client-node %p: new", impl);
 
-	support = pw_core_get_support(impl->core, &n_support);
+	support = pw_core_get_node_support(impl->core,
+					   properties ? &properties->dict : NULL, &n_support);
 
 	node_init(&impl->node, NULL, support, n_support);
 	impl->node.impl = impl;
@@ -1318,6 +1621,14 @@ struct pw_client_node *pw_client_node_new(struct pw_resource *resource,
 	str = pw_properties_get(properties, "pipewire.client.reuse");
 	impl->client_reuse = str && pw_properties_parse_bool(str);
 
+	str = pw_properties_get(properties, PW_CLIENT_NODE_PROP_TRANSPORT_VERSION);
+	impl->transport_version = str ? atoi(str) : 0;
+
+	str = pw_properties_get(properties, "pipewire.client.transport-size");
+	impl->buffer_size = str ? atoi(str) : 0;
+
+	impl->grow_event = pw_loop_add_event(core->main_loop, on_grow_transport, impl);
+
 	pw_resource_add_listener(this->resource,
 				 &impl->resource_listener,
 				 &resource_events,
@@ -190,7 +190,7 @@ static int client_node_demarshal_transport(void *object, void *data, size_t size
 	struct spa_pod_parser prs;
 	uint32_t node_id, ridx, widx, memfd_idx;
 	int readfd, writefd;
-	struct pw_client_node_transport_info info;
+	struct pw_client_node_transport_info info = { 0, };
 	struct pw_client_node_transport *transport;
 
 	spa_pod_parser_init(&prs, data, size, 0);
@@ -201,7 +201,9 @@ static int client_node_demarshal_transport(void *object, void *data, size_t size
 			"i", &widx,
 			"i", &memfd_idx,
 			"i", &info.offset,
-			"i", &info.size, NULL) < 0)
+			"i", &info.size,
+			/* older servers don't send the version */
+			"?i", &info.version, NULL) < 0)
 		return -EINVAL;
 
 	readfd = pw_protocol_native_get_proxy_fd(proxy, ridx);
@@ -476,7 +478,8 @@ static void client_node_marshal_transport(void *object, uint32_t node_id, int re
 			       "i", pw_protocol_native_add_resource_fd(resource, writefd),
 			       "i", pw_protocol_native_add_resource_fd(resource, info.memfd),
 			       "i", info.offset,
-			       "i", info.size);
+			       "i", info.size,
+			       "i", info.version);
 
 	pw_protocol_native_end_resource(resource, b);
 }
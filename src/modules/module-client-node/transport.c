@@ -20,6 +20,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <spa/utils/ringbuffer.h>
 #include <spa/node/io.h>
@@ -30,8 +32,10 @@
 
 /** \cond */
 
-#define INPUT_BUFFER_SIZE       (1<<12)
-#define OUTPUT_BUFFER_SIZE      (1<<12)
+#define MIN_BUFFER_SIZE		(1<<12)	/* and the size of version 0 ringbuffers */
+#define MAX_BUFFER_SIZE		(1<<20)
+/* space for the messages of each port in a cycle */
+#define PORT_BUFFER_SIZE	(8 * sizeof(struct pw_client_node_message_port_reuse_buffer))
 
 struct transport {
 	struct pw_client_node_transport trans;
@@ -41,28 +45,46 @@ struct transport {
 
 	struct pw_client_node_message current;
 	uint32_t current_index;
+
+	struct pw_client_node_transport_stats stats;	/**< used when the stats are not shared */
+	struct pw_client_node_activation activation[2];	/**< not shared in version 0 */
 };
 /** \endcond */
 
-static size_t area_get_size(struct pw_client_node_area *area)
+/* version 0 transports have the layout of the first transports, the
+ * version 1 area_ext goes between the area and the port io */
+static size_t area_get_size(struct pw_client_node_area *area, uint32_t version,
+			    uint32_t buffer_size)
 {
 	size_t size;
 	size = sizeof(struct pw_client_node_area);
+	if (version >= 1)
+		size += sizeof(struct pw_client_node_area_ext);
 	size += area->max_input_ports * sizeof(struct spa_io_buffers);
 	size += area->max_output_ports * sizeof(struct spa_io_buffers);
 	size += sizeof(struct spa_ringbuffer);
-	size += INPUT_BUFFER_SIZE;
+	size += buffer_size;
 	size += sizeof(struct spa_ringbuffer);
-	size += OUTPUT_BUFFER_SIZE;
+	size += buffer_size;
 	return size;
 }
 
-static void transport_setup_area(void *p, struct pw_client_node_transport *trans)
+static void transport_setup_area(void *p, struct transport *impl)
 {
+	struct pw_client_node_transport *trans = &impl->trans;
 	struct pw_client_node_area *a;
+	struct pw_client_node_activation *activation = impl->activation;
 
 	trans->area = a = p;
-	p = SPA_MEMBER(p, sizeof(struct pw_client_node_area), struct spa_io_buffers);
+	p = SPA_MEMBER(p, sizeof(struct pw_client_node_area), void);
+
+	if (trans->version >= 1) {
+		struct pw_client_node_area_ext *ext = p;
+		activation = ext->activation;
+		p = SPA_MEMBER(p, sizeof(struct pw_client_node_area_ext), void);
+	}
+	trans->input_activation = &activation[0];
+	trans->output_activation = &activation[1];
 
 	trans->inputs = p;
 	p = SPA_MEMBER(p, a->max_input_ports * sizeof(struct spa_io_buffers), void);
@@ -74,13 +96,13 @@ static void transport_setup_area(void *p, struct pw_client_node_transport *trans
 	p = SPA_MEMBER(p, sizeof(struct spa_ringbuffer), void);
 
 	trans->input_data = p;
-	p = SPA_MEMBER(p, INPUT_BUFFER_SIZE, void);
+	p = SPA_MEMBER(p, trans->buffer_size, void);
 
 	trans->output_buffer = p;
 	p = SPA_MEMBER(p, sizeof(struct spa_ringbuffer), void);
 
 	trans->output_data = p;
-	p = SPA_MEMBER(p, OUTPUT_BUFFER_SIZE, void);
+	p = SPA_MEMBER(p, trans->buffer_size, void);
 }
 
 static void transport_reset_area(struct pw_client_node_transport *trans)
@@ -98,6 +120,8 @@ static void transport_reset_area(struct pw_client_node_transport *trans)
 	}
 	spa_ringbuffer_init(trans->input_buffer);
 	spa_ringbuffer_init(trans->output_buffer);
+	spa_zero(*trans->input_activation);
+	spa_zero(*trans->output_activation);
 }
 
 static void destroy(struct pw_client_node_transport *trans)
@@ -120,16 +144,21 @@ static int add_message(struct pw_client_node_transport *trans, struct pw_client_
 		return -EINVAL;
 
 	filled = spa_ringbuffer_get_write_index(trans->output_buffer, &index);
-	avail = OUTPUT_BUFFER_SIZE - filled;
+	avail = trans->buffer_size - filled;
 	size = SPA_POD_SIZE(message);
-	if (avail < size)
+	if (avail < size) {
+		__atomic_fetch_add(&trans->stats->overflows, 1, __ATOMIC_RELAXED);
 		return -ENOSPC;
+	}
 
 	spa_ringbuffer_write_data(trans->output_buffer,
-				  trans->output_data, OUTPUT_BUFFER_SIZE,
-				  index & (OUTPUT_BUFFER_SIZE - 1), message, size);
+				  trans->output_data, trans->buffer_size,
+				  index & (trans->buffer_size - 1), message, size);
 	spa_ringbuffer_write_update(trans->output_buffer, index + size);
 
+	__atomic_add_fetch(&trans->queued, 1, __ATOMIC_SEQ_CST);
+	__atomic_fetch_add(&trans->stats->sent, 1, __ATOMIC_RELAXED);
+
 	return 0;
 }
 
@@ -146,8 +175,8 @@ static int next_message(struct pw_client_node_transport *trans, struct pw_client
 		return 0;
 
 	spa_ringbuffer_read_data(trans->input_buffer,
-				 trans->input_data, INPUT_BUFFER_SIZE,
-				 impl->current_index & (INPUT_BUFFER_SIZE - 1),
+				 trans->input_data, trans->buffer_size,
+				 impl->current_index & (trans->buffer_size - 1),
 				 &impl->current, sizeof(struct pw_client_node_message));
 
 	if (avail < SPA_POD_SIZE(&impl->current))
@@ -169,21 +198,100 @@ static int parse_message(struct pw_client_node_transport *trans, void *message)
 	size = SPA_POD_SIZE(&impl->current);
 
 	spa_ringbuffer_read_data(trans->input_buffer,
-				 trans->input_data, INPUT_BUFFER_SIZE,
-				 impl->current_index & (INPUT_BUFFER_SIZE - 1), message, size);
+				 trans->input_data, trans->buffer_size,
+				 impl->current_index & (trans->buffer_size - 1), message, size);
 	spa_ringbuffer_read_update(trans->input_buffer, impl->current_index + size);
+	__atomic_fetch_add(&trans->stats->received, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+static int do_signal(struct pw_client_node_transport *trans, int fd)
+{
+	struct pw_client_node_activation *a = trans->output_activation;
+	uint64_t cmd = 1;
+
+	/* a version 0 peer does not acknowledge, always write the eventfd */
+	if (trans->version >= 1 &&
+	    __atomic_fetch_add(&a->status, 1, __ATOMIC_SEQ_CST) != 0)
+		return 0;
+
+	__atomic_fetch_add(&trans->stats->signals, 1, __ATOMIC_RELAXED);
+
+	if (trans->version >= 1 && __atomic_load_n(&a->waiting, __ATOMIC_SEQ_CST)) {
+		if (syscall(SYS_futex, &a->status, FUTEX_WAKE, 1, NULL, NULL, 0) < 0)
+			return -errno;
+	}
+	else if (write(fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		return -errno;
 
 	return 0;
 }
 
+static int do_wait(struct pw_client_node_transport *trans, const struct timespec *timeout)
+{
+	struct pw_client_node_activation *a = trans->input_activation;
+	uint32_t status;
+	int res = 0;
+
+	if (trans->version < 1)
+		return -ENOTSUP;
+
+	__atomic_store_n(&a->waiting, 1, __ATOMIC_SEQ_CST);
+	while ((status = __atomic_exchange_n(&a->status, 0, __ATOMIC_SEQ_CST)) == 0) {
+		if (syscall(SYS_futex, &a->status, FUTEX_WAIT, 0, timeout, NULL, 0) < 0 &&
+		    errno != EAGAIN && errno != EINTR) {
+			res = -errno;
+			break;
+		}
+	}
+	__atomic_store_n(&a->waiting, 0, __ATOMIC_SEQ_CST);
+
+	/* the peer might have seen us waiting and woken up the futex after
+	 * the timeout, it will not write to the eventfd then */
+	if (status == 0)
+		status = __atomic_exchange_n(&a->status, 0, __ATOMIC_SEQ_CST);
+	if (status > 0)
+		__atomic_fetch_add(&trans->stats->wakeups, 1, __ATOMIC_RELAXED);
+
+	return status > 0 ? (int) status : res;
+}
+
+/** Get the size of the message ringbuffers for a transport
+ * \param max_input_ports maximum number of input_ports
+ * \param max_output_ports maximum number of output_ports
+ * \param buffer_size minimum size of the ringbuffers or 0
+ * \return the size of the ringbuffers, a power of 2 that can hold the
+ *	messages of all ports in a cycle
+ * \memberof pw_client_node_transport
+ */
+uint32_t
+pw_client_node_transport_buffer_size(uint32_t max_input_ports, uint32_t max_output_ports,
+				     uint32_t buffer_size)
+{
+	uint32_t size;
+
+	buffer_size = SPA_MAX(buffer_size, (max_input_ports + max_output_ports) * PORT_BUFFER_SIZE);
+	buffer_size = SPA_MIN(buffer_size, MAX_BUFFER_SIZE);
+
+	for (size = MIN_BUFFER_SIZE; size < buffer_size; size <<= 1);
+
+	return size;
+}
+
 /** Create a new transport
+ * \param version the transport version of the client
  * \param max_input_ports maximum number of input_ports
  * \param max_output_ports maximum number of output_ports
+ * \param buffer_size minimum size of the message ringbuffers or 0, ignored
+ *	for version 0 clients, they only know ringbuffers of 4096 bytes
  * \return a newly allocated \ref pw_client_node_transport
  * \memberof pw_client_node_transport
  */
 struct pw_client_node_transport *
-pw_client_node_transport_new(uint32_t max_input_ports, uint32_t max_output_ports)
+pw_client_node_transport_new(uint32_t version,
+			     uint32_t max_input_ports, uint32_t max_output_ports,
+			     uint32_t buffer_size)
 {
 	struct transport *impl;
 	struct pw_client_node_transport *trans;
@@ -194,30 +302,50 @@ pw_client_node_transport_new(uint32_t max_input_ports, uint32_t max_output_ports
 	area.max_output_ports = max_output_ports;
 	area.n_output_ports = 0;
 
+	version = SPA_MIN(version, PW_VERSION_CLIENT_NODE_TRANSPORT);
+	if (version >= 1)
+		buffer_size = pw_client_node_transport_buffer_size(max_input_ports,
+								   max_output_ports, buffer_size);
+	else
+		buffer_size = MIN_BUFFER_SIZE;
+
 	impl = calloc(1, sizeof(struct transport));
 	if (impl == NULL)
 		return NULL;
 
-	pw_log_debug("transport %p: new %d %d", impl, max_input_ports, max_output_ports);
+	pw_log_debug("transport %p: new %d %d %d %d", impl, version,
+		     max_input_ports, max_output_ports, buffer_size);
 
 	trans = &impl->trans;
+	trans->version = version;
+	trans->buffer_size = buffer_size;
+	trans->stats = &impl->stats;
 	impl->offset = 0;
 
 	if (pw_memblock_alloc(PW_MEMBLOCK_FLAG_WITH_FD |
 			  PW_MEMBLOCK_FLAG_MAP_READWRITE |
 			  PW_MEMBLOCK_FLAG_SEAL,
-			  area_get_size(&area),
-			  &impl->mem) < 0)
+			  area_get_size(&area, version, buffer_size),
+			  &impl->mem) < 0) {
+		free(impl);
 		return NULL;
+	}
 
 	memcpy(impl->mem->ptr, &area, sizeof(struct pw_client_node_area));
-	transport_setup_area(impl->mem->ptr, trans);
+	transport_setup_area(impl->mem->ptr, impl);
+	if (version >= 1) {
+		struct pw_client_node_area_ext *ext =
+			SPA_MEMBER(impl->mem->ptr, sizeof(struct pw_client_node_area), void);
+		ext->buffer_size = buffer_size;
+	}
 	transport_reset_area(trans);
 
 	trans->destroy = destroy;
 	trans->add_message = add_message;
 	trans->next_message = next_message;
 	trans->parse_message = parse_message;
+	trans->signal = do_signal;
+	trans->wait = do_wait;
 
 	return trans;
 }
@@ -227,6 +355,7 @@ pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *inf
 {
 	struct transport *impl;
 	struct pw_client_node_transport *trans;
+	struct pw_client_node_area *area;
 	void *tmp;
 	int res;
 
@@ -235,6 +364,7 @@ pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *inf
 		return NULL;
 
 	trans = &impl->trans;
+	trans->stats = &impl->stats;
 	pw_log_debug("transport %p: new from info", impl);
 
 	if ((res = pw_memblock_import(PW_MEMBLOCK_FLAG_MAP_READWRITE |
@@ -249,7 +379,34 @@ pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *inf
 
 	impl->offset = info->offset;
 
-	transport_setup_area(impl->mem->ptr, trans);
+	/* older servers don't send a version and use the version 0 layout */
+	trans->version = SPA_MIN(info->version, PW_VERSION_CLIENT_NODE_TRANSPORT);
+
+	if (info->size < sizeof(struct pw_client_node_area) +
+	    (trans->version >= 1 ? sizeof(struct pw_client_node_area_ext) : 0)) {
+		pw_log_warn("transport %p: area too small", impl);
+		res = -EINVAL;
+		goto invalid_area;
+	}
+
+	area = impl->mem->ptr;
+	if (trans->version >= 1) {
+		struct pw_client_node_area_ext *ext =
+			SPA_MEMBER(area, sizeof(struct pw_client_node_area), void);
+		trans->buffer_size = ext->buffer_size;
+	}
+	else
+		trans->buffer_size = MIN_BUFFER_SIZE;
+
+	if (trans->buffer_size < sizeof(struct pw_client_node_message) ||
+	    (trans->buffer_size & (trans->buffer_size - 1)) != 0 ||
+	    area_get_size(area, trans->version, trans->buffer_size) > info->size) {
+		pw_log_warn("transport %p: invalid area", impl);
+		res = -EINVAL;
+		goto invalid_area;
+	}
+
+	transport_setup_area(impl->mem->ptr, impl);
 
 	tmp = trans->output_buffer;
 	trans->output_buffer = trans->input_buffer;
@@ -259,13 +416,21 @@ pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *inf
 	trans->output_data = trans->input_data;
 	trans->input_data = tmp;
 
+	tmp = trans->output_activation;
+	trans->output_activation = trans->input_activation;
+	trans->input_activation = tmp;
+
 	trans->destroy = destroy;
 	trans->add_message = add_message;
 	trans->next_message = next_message;
 	trans->parse_message = parse_message;
+	trans->signal = do_signal;
+	trans->wait = do_wait;
 
 	return trans;
 
+      invalid_area:
+	pw_memblock_free(impl->mem);
       mmap_failed:
 	free(impl);
 	errno = -res;
@@ -287,6 +452,7 @@ int pw_client_node_transport_get_info(struct pw_client_node_transport *trans,
 {
 	struct transport *impl = (struct transport *) trans;
 
+	info->version = trans->version;
 	info->memfd = impl->mem->fd;
 	info->offset = impl->offset;
 	info->size = impl->mem->size;
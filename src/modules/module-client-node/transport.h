@@ -32,13 +32,20 @@ extern "C" {
 
 /** information about the transport region \memberof pw_client_node */
 struct pw_client_node_transport_info {
+	uint32_t version;	/**< version of the transport */
 	int memfd;		/**< the memfd of the transport area */
 	uint32_t offset;	/**< offset to map \a memfd at */
 	uint32_t size;		/**< size of memfd mapping */
 };
 
+uint32_t
+pw_client_node_transport_buffer_size(uint32_t max_input_ports, uint32_t max_output_ports,
+				     uint32_t buffer_size);
+
 struct pw_client_node_transport *
-pw_client_node_transport_new(uint32_t max_input_ports, uint32_t max_output_ports);
+pw_client_node_transport_new(uint32_t version,
+			     uint32_t max_input_ports, uint32_t max_output_ports,
+			     uint32_t buffer_size);
 
 struct pw_client_node_transport *
 pw_client_node_transport_new_from_info(struct pw_client_node_transport_info *info);
@@ -102,24 +102,31 @@ struct client_data {
 	bool busy;
 };
 
-static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_map *types)
+static inline uint32_t remap_id(const struct pw_type_remap *types, uint32_t id)
 {
-	void *t;
+	if (!pw_array_check_index(&types->ids, id, uint32_t))
+		return SPA_ID_INVALID;
+	return *pw_array_get_unchecked(&types->ids, id, uint32_t);
+}
+
+static bool pod_remap_data(uint32_t type, void *body, uint32_t size, const struct pw_type_remap *types)
+{
+	uint32_t t;
 
 	switch (type) {
 	case SPA_POD_TYPE_ID:
-		if ((t = pw_map_lookup(types, *(int32_t *) body)) == NULL)
+		if ((t = remap_id(types, *(uint32_t *) body)) == SPA_ID_INVALID)
 			return false;
-		*(int32_t *) body = PW_MAP_PTR_TO_ID(t);
+		*(uint32_t *) body = t;
 		break;
 
 	case SPA_POD_TYPE_PROP:
 	{
 		struct spa_pod_prop_body *b = body;
 
-		if ((t = pw_map_lookup(types, b->key)) == NULL)
+		if ((t = remap_id(types, b->key)) == SPA_ID_INVALID)
 			return false;
-		b->key = PW_MAP_PTR_TO_ID(t);
+		b->key = t;
 
 		if (b->value.type == SPA_POD_TYPE_ID) {
 			void *alt;
@@ -138,14 +145,11 @@ static bool pod_remap_data(uint32_t type, void *body, uint32_t size, struct pw_m
 		struct spa_pod_object_body *b = body;
 		struct spa_pod *p;
 
-		if ((t = pw_map_lookup(types, b->id)) != NULL)
-			b->id = PW_MAP_PTR_TO_ID(t);
-		else
-			b->id = SPA_ID_INVALID;
+		b->id = remap_id(types, b->id);
 
-		if ((t = pw_map_lookup(types, b->type)) == NULL)
+		if ((t = remap_id(types, b->type)) == SPA_ID_INVALID)
 			return false;
-		b->type = PW_MAP_PTR_TO_ID(t);
+		b->type = t;
 
 		SPA_POD_OBJECT_BODY_FOREACH(b, size, p)
 			if (!pod_remap_data(p->type, SPA_POD_BODY(p), p->size, types))
@@ -221,7 +225,8 @@ process_messages(struct client_data *data)
 			continue;
 		}
 
-		if (demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP)
+		/* no need to remap when the client uses the same type ids */
+		if ((demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) && !client->types.identity)
 			if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size, &client->types))
 				goto invalid_message;
 
@@ -551,7 +556,7 @@ on_remote_data(void *data, int fd, enum spa_io mask)
 				continue;
 			}
 
-			if (demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) {
+			if ((demarshal[opcode].flags & PW_PROTOCOL_NATIVE_REMAP) && !this->types.identity) {
 				if (!pod_remap_data(SPA_POD_TYPE_STRUCT, message, size, &this->types)) {
                                         pw_log_error
                                             ("protocol-native %p: invalid message received %u for %u", this,
@@ -748,7 +748,10 @@ static void node_marshal_info(void *object, struct pw_node_info *info)
 				    "s", info->props->items[i].key,
 				    "s", info->props->items[i].value, NULL);
 	}
-	spa_pod_builder_add(b, "]", NULL);
+	spa_pod_builder_add(b,
+			    "i", info->n_xruns,
+			    "l", info->xrun_time,
+			    "]", NULL);
 
 	pw_protocol_native_end_resource(resource, b);
 }
@@ -784,6 +787,14 @@ static int node_demarshal_info(void *object, void *data, size_t size)
 				       "s", &props.items[i].value, NULL) < 0)
 			return -EINVAL;
 	}
+	/* the xruns were added in version 1 */
+	info.n_xruns = 0;
+	info.xrun_time = 0;
+	if (spa_pod_parser_get(&prs,
+			"?i", &info.n_xruns,
+			"?l", &info.xrun_time, NULL) < 0)
+		return -EINVAL;
+
 	pw_proxy_notify(proxy, struct pw_node_proxy_events, info, 0, &info);
 	return 0;
 }
@@ -878,7 +889,10 @@ static void port_marshal_info(void *object, struct pw_port_info *info)
 				    "s", info->props->items[i].key,
 				    "s", info->props->items[i].value, NULL);
 	}
-	spa_pod_builder_add(b, "]", NULL);
+	spa_pod_builder_add(b,
+			    "i", info->n_xruns,
+			    "l", info->xrun_time,
+			    "]", NULL);
 
 	pw_protocol_native_end_resource(resource, b);
 }
@@ -908,6 +922,14 @@ static int port_demarshal_info(void *object, void *data, size_t size)
 				       "s", &props.items[i].value, NULL) < 0)
 			return -EINVAL;
 	}
+	/* the xruns were added in version 1 */
+	info.n_xruns = 0;
+	info.xrun_time = 0;
+	if (spa_pod_parser_get(&prs,
+			"?i", &info.n_xruns,
+			"?l", &info.xrun_time, NULL) < 0)
+		return -EINVAL;
+
 	pw_proxy_notify(proxy, struct pw_port_proxy_events, info, 0, &info);
 	return 0;
 }
@@ -35,19 +35,28 @@
 #include <spa/support/dbus.h>
 
 #include "pipewire/core.h"
+#include "pipewire/data-loop.h"
 #include "pipewire/interfaces.h"
 #include "pipewire/link.h"
 #include "pipewire/log.h"
 #include "pipewire/module.h"
 #include "pipewire/utils.h"
+#include "pipewire/private.h"
+
+struct rt_loop {
+	struct spa_list link;
+	struct pw_data_loop *data_loop;
+	struct spa_loop *loop;
+	struct spa_source source;
+	int rt_prio;
+};
 
 struct impl {
 	struct pw_core *core;
 	struct pw_type *type;
 	struct pw_properties *properties;
 
-	struct spa_loop *loop;
-	struct spa_source source;
+	struct spa_list loops;
 
 	struct spa_hook module_listener;
 };
@@ -377,12 +386,28 @@ int pw_rtkit_make_high_priority(struct pw_rtkit_bus *connection, pid_t thread, i
 	return ret;
 }
 
+static int
+do_remove_source(struct spa_loop *loop,
+		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct rt_loop *l = user_data;
+	spa_loop_remove_source(loop, &l->source);
+	return 0;
+}
+
 static void module_destroy(void *data)
 {
 	struct impl *impl = data;
+	struct rt_loop *l, *t;
 
 	spa_hook_remove(&impl->module_listener);
 
+	spa_list_for_each_safe(l, t, &impl->loops, link) {
+		spa_loop_invoke(l->loop, do_remove_source, 0, NULL, 0, true, l);
+		close(l->source.fd);
+		free(l);
+	}
+
 	if (impl->properties)
 		pw_properties_free(impl->properties);
 
@@ -396,15 +421,22 @@ static const struct pw_module_events module_events = {
 
 static void idle_func(struct spa_source *source)
 {
-	struct impl *impl = source->data;
+	struct rt_loop *l = source->data;
 	struct sched_param sp;
 	struct pw_rtkit_bus *system_bus;
 	struct rlimit rl;
-	int r, rtprio;
+	int r, rtprio, max_prio;
 	long long rttime;
 	uint64_t count;
 
-	rtprio = 20;
+	if (read(l->source.fd, &count, sizeof(uint64_t)) != sizeof(uint64_t)) {
+		if (errno != EAGAIN)
+			pw_log_warn("rtkit %p: failed to read event fd: %s",
+				    l, strerror(errno));
+		return;
+	}
+
+	rtprio = l->rt_prio;
 	rttime = 20000;
 
 	spa_zero(sp);
@@ -431,29 +463,54 @@ static void idle_func(struct spa_source *source)
 		}
 	}
 
+	max_prio = pw_rtkit_get_max_realtime_priority(system_bus);
+	if (max_prio > 0 && rtprio > max_prio) {
+		pw_log_debug("Clamping realtime priority to %d for RealtimeKit", max_prio);
+		rtprio = max_prio;
+	}
+
 	if ((r = pw_rtkit_make_realtime(system_bus, 0, rtprio)) < 0) {
-		pw_log_debug("could not make thread realtime: %s", strerror(r));
+		pw_log_debug("could not make thread of loop %s realtime: %s",
+			     pw_data_loop_get_name(l->data_loop), strerror(r));
 	} else {
-		pw_log_debug("thread made realtime");
+		pw_log_debug("thread of loop %s made realtime with priority %d",
+			     pw_data_loop_get_name(l->data_loop), rtprio);
 	}
 	pw_rtkit_bus_free(system_bus);
+}
+
+static int add_loop(struct impl *impl, struct pw_data_loop *data_loop)
+{
+	struct rt_loop *l;
+
+	l = calloc(1, sizeof(struct rt_loop));
+	if (l == NULL)
+		return -ENOMEM;
 
-	read(impl->source.fd, &count, sizeof(uint64_t));
+	l->data_loop = data_loop;
+	l->loop = pw_data_loop_get_loop(data_loop)->loop;
+	l->rt_prio = pw_data_loop_get_rt_prio(data_loop);
+
+	l->source.loop = l->loop;
+	l->source.func = idle_func;
+	l->source.data = l;
+	l->source.fd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+	l->source.mask = SPA_IO_IN;
+	spa_loop_add_source(l->loop, &l->source);
+
+	spa_list_append(&impl->loops, &l->link);
+
+	return 0;
 }
 
 static int module_init(struct pw_module *module, struct pw_properties *properties)
 {
 	struct pw_core *core = pw_module_get_core(module);
+	struct pw_data_loop *data_loop;
 	struct impl *impl;
-	struct spa_loop *loop;
-	const struct spa_support *support;
-	uint32_t n_support;
-
-	support = pw_core_get_support(core, &n_support);
 
-	loop = spa_support_find(support, n_support, SPA_TYPE_LOOP__DataLoop);
-        if (loop == NULL)
-                return -ENOTSUP;
+	if (spa_list_is_empty(&core->data_loop_list))
+		return -ENOTSUP;
 
 	impl = calloc(1, sizeof(struct impl));
 	if (impl == NULL)
@@ -464,14 +521,16 @@ static int module_init(struct pw_module *module, struct pw_properties *propertie
 	impl->core = core;
 	impl->type = pw_core_get_type(core);
 	impl->properties = properties;
-	impl->loop = loop;
-
-	impl->source.loop = loop;
-	impl->source.func = idle_func;
-	impl->source.data = impl;
-	impl->source.fd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
-	impl->source.mask = SPA_IO_IN;
-	spa_loop_add_source(impl->loop, &impl->source);
+	spa_list_init(&impl->loops);
+
+	/* every data loop runs in its own thread with its own priority */
+	spa_list_for_each(data_loop, &core->data_loop_list, link) {
+		if (pw_data_loop_get_rt_prio(data_loop) <= 0)
+			continue;
+		if (add_loop(impl, data_loop) < 0)
+			pw_log_warn("module %p: can't make loop %s realtime", impl,
+				    pw_data_loop_get_name(data_loop));
+	}
 
 	pw_module_add_listener(module, &impl->module_listener, &module_events, impl);
 
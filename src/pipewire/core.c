@@ -17,6 +17,8 @@
  * Boston, MA 02110-1301, USA.
  */
 #include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <unistd.h>
 #include <time.h>
 #include <stdio.h>
@@ -24,6 +26,7 @@
 #include <pipewire/log.h>
 
 #include <spa/support/dbus.h>
+#include <spa/param/format.h>
 #include <spa/debug/format.h>
 
 #include <pipewire/pipewire.h>
@@ -35,9 +38,13 @@
 
 #undef spa_debug
 #define spa_debug pw_log_trace
-#include <spa/graph/graph-scheduler6.h>
+#include <spa/graph/graph-scheduler7.h>
 
 /** \cond */
+/* size of the plan, bigger graphs use the recursive scheduler */
+#define PLAN_MAX_NODES	1024
+#define PLAN_MAX_EDGES	(PLAN_MAX_NODES * 8)
+
 struct resource_data {
 	struct spa_hook resource_listener;
 };
@@ -274,9 +281,12 @@ static void core_update_types(void *object, uint32_t first_id, const char **type
 
 	for (i = 0; i < n_types; i++, first_id++) {
 		uint32_t this_id = spa_type_map_get_id(this->type.map, types[i]);
-		if (!pw_map_insert_at(&client->types, first_id, PW_MAP_ID_TO_PTR(this_id)))
+		if (!pw_type_remap_insert(&client->types, first_id, this_id))
 			pw_log_error("can't add type %d->%d for client", first_id, this_id);
 	}
+	pw_log_debug("core %p: client %p has %zd types, %s", this, client,
+		     pw_array_get_len(&client->types.ids, uint32_t),
+		     client->types.identity ? "same" : "remapped");
 }
 
 static const struct pw_core_proxy_methods core_methods = {
@@ -352,6 +362,134 @@ static const struct pw_global_events global_events = {
 	.bind = global_bind,
 };
 
+void pw_core_report_xruns(struct pw_core *core)
+{
+	struct pw_node *node;
+	struct timespec now;
+	uint64_t now_nsec, wait, next = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	now_nsec = SPA_TIMESPEC_TO_TIME(&now);
+
+	spa_list_for_each(node, &core->node_list, link) {
+		wait = pw_node_report_xruns(node, now_nsec);
+		if (wait != 0 && (next == 0 || wait < next))
+			next = wait;
+	}
+	if (next != 0) {
+		struct timespec value;
+
+		value.tv_sec = next / SPA_NSEC_PER_SEC;
+		value.tv_nsec = next % SPA_NSEC_PER_SEC;
+		pw_loop_update_timer(core->main_loop, core->xrun_timer, &value, NULL, false);
+	}
+}
+
+static void on_xrun_event(void *data, uint64_t count)
+{
+	pw_core_report_xruns(data);
+}
+
+static void on_xrun_timeout(void *data, uint64_t expirations)
+{
+	pw_core_report_xruns(data);
+}
+
+static struct pw_data_loop *find_data_loop(struct pw_core *core, const char *name)
+{
+	struct pw_data_loop *loop;
+
+	spa_list_for_each(loop, &core->data_loop_list, link) {
+		if (strcmp(loop->name, name) == 0)
+			return loop;
+	}
+	return NULL;
+}
+
+struct pw_data_loop *pw_core_find_data_loop(struct pw_core *core, const char *name)
+{
+	struct pw_data_loop *loop;
+
+	if (name == NULL)
+		return core->data_loop_impl;
+
+	if ((loop = find_data_loop(core, name)) == NULL) {
+		pw_log_warn("core %p: unknown data loop %s, using default", core, name);
+		loop = core->data_loop_impl;
+	}
+	return loop;
+}
+
+const struct spa_support *pw_core_get_node_support(struct pw_core *core,
+						   const struct spa_dict *props,
+						   uint32_t *n_support)
+{
+	struct pw_data_loop *loop;
+
+	loop = pw_core_find_data_loop(core,
+			props ? spa_dict_lookup(props, PW_NODE_PROP_LOOP_NAME) : NULL);
+
+	*n_support = loop->n_support;
+	return loop->support;
+}
+
+/* make the data loops from PW_CORE_PROP_DATA_LOOPS, the default loop is
+ * made when it is not in the list and is always the first loop */
+static int make_data_loops(struct pw_core *core, struct pw_properties *properties)
+{
+	struct pw_data_loop *loop;
+	struct pw_properties *props;
+	const char *str;
+	char **loops = NULL;
+	int i, n_loops = 0, res = 0;
+
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_DATA_LOOPS)) != NULL)
+		loops = pw_split_strv(str, " \t", INT_MAX, &n_loops);
+
+	for (i = 0; i < n_loops; i++) {
+		char *name = loops[i], *cpus, *prio = NULL;
+
+		if ((cpus = strchr(name, ':')) != NULL) {
+			*cpus++ = '\0';
+			if ((prio = strchr(cpus, ':')) != NULL)
+				*prio++ = '\0';
+		}
+		if (find_data_loop(core, name) != NULL) {
+			pw_log_warn("core %p: data loop %s defined twice", core, name);
+			continue;
+		}
+
+		props = pw_properties_copy(properties);
+		pw_properties_set(props, PW_DATA_LOOP_PROP_NAME, name);
+		if (cpus && *cpus)
+			pw_properties_set(props, PW_DATA_LOOP_PROP_CPUS, cpus);
+		if (prio && *prio)
+			pw_properties_set(props, PW_DATA_LOOP_PROP_RT_PRIO, prio);
+
+		loop = pw_data_loop_new(props);
+		pw_properties_free(props);
+		if (loop == NULL) {
+			res = -errno;
+			goto done;
+		}
+		if (strcmp(name, PW_DATA_LOOP_DEFAULT_NAME) == 0)
+			spa_list_prepend(&core->data_loop_list, &loop->link);
+		else
+			spa_list_append(&core->data_loop_list, &loop->link);
+	}
+	if (find_data_loop(core, PW_DATA_LOOP_DEFAULT_NAME) == NULL) {
+		if ((loop = pw_data_loop_new(properties)) == NULL) {
+			res = -errno;
+			goto done;
+		}
+		spa_list_prepend(&core->data_loop_list, &loop->link);
+	}
+      done:
+	if (loops)
+		pw_free_strv(loops);
+	return res;
+}
+
 /** Create a new core object
  *
  * \param main_loop the main loop to use
@@ -363,12 +501,17 @@ static const struct pw_global_events global_events = {
 struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *properties)
 {
 	struct pw_core *this;
-	const char *name;
+	struct pw_data_loop *loop, *tl;
+	const char *name, *str;
+	uint32_t n_workers = 1, max_blocks;
+	size_t max_size;
 
 	this = calloc(1, sizeof(struct pw_core));
 	if (this == NULL)
 		return NULL;
 
+	spa_list_init(&this->data_loop_list);
+
 	pw_log_debug("core %p: new", this);
 
 	if (properties == NULL)
@@ -378,18 +521,58 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 
 	this->properties = properties;
 
-	this->data_loop_impl = pw_data_loop_new(properties);
-	if (this->data_loop_impl == NULL)
+	if (make_data_loops(this, properties) < 0)
 		goto no_data_loop;
 
+	this->data_loop_impl = spa_list_first(&this->data_loop_list, struct pw_data_loop, link);
 	this->data_loop = pw_data_loop_get_loop(this->data_loop_impl);
 	this->main_loop = main_loop;
 
 	pw_type_init(&this->type);
 	pw_map_init(&this->globals, 128, 32);
 
-	spa_graph_init(&this->rt.graph);
-	spa_graph_set_callbacks(&this->rt.graph, &spa_graph_impl_default, NULL);
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_QUANTUM)) != NULL)
+		this->quantum = atoi(str);
+	this->rate = 48000;
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_RATE)) != NULL &&
+	    atoi(str) > 0)
+		this->rate = atoi(str);
+
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_WORKERS)) != NULL)
+		n_workers = SPA_MAX(atoi(str), 1);
+
+	pw_memblock_pool_get_limits(&max_size, &max_blocks);
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_MEMPOOL_SIZE)) != NULL)
+		max_size = strtoul(str, NULL, 0);
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_MEMPOOL_BLOCKS)) != NULL)
+		max_blocks = atoi(str);
+	pw_memblock_pool_set_limits(max_size, max_blocks);
+
+	/* the plan scheduler and the workers are only used for the default loop */
+	spa_list_for_each(loop, &this->data_loop_list, link)
+		spa_graph_set_callbacks(&loop->graph, &spa_graph_impl_default, NULL);
+
+	if (n_workers > 1 ||
+	    ((str = pw_properties_get(properties, PW_CORE_PROP_SCHEDULER)) != NULL &&
+	     strcmp(str, "plan") == 0)) {
+		struct spa_graph *graph = &this->data_loop_impl->graph;
+
+		/* the memory of the plan is after the plan */
+		this->rt.plan = calloc(1, sizeof(struct spa_graph_plan) +
+				       SPA_GRAPH_PLAN_MEM_SIZE(PLAN_MAX_NODES, PLAN_MAX_EDGES));
+		if (this->rt.plan == NULL)
+			goto no_mem;
+		spa_graph_plan_init(this->rt.plan, graph,
+				    SPA_MEMBER(this->rt.plan, sizeof(struct spa_graph_plan), void),
+				    PLAN_MAX_NODES, PLAN_MAX_EDGES);
+		spa_graph_set_callbacks(graph, &spa_graph_impl_plan, this->rt.plan);
+
+		/* the workers run the graph of the data loop, give them its priority */
+		if (n_workers > 1 &&
+		    (this->rt.executor = pw_executor_new(this->rt.plan, n_workers,
+				pw_data_loop_get_rt_prio(this->data_loop_impl))) == NULL)
+			pw_log_warn("core %p: can't create executor, running single threaded", this);
+	}
 
 	this->support[0] = SPA_SUPPORT_INIT(SPA_TYPE__TypeMap, this->type.map);
 	this->support[1] = SPA_SUPPORT_INIT(SPA_TYPE_LOOP__DataLoop, this->data_loop->loop);
@@ -401,7 +584,13 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 
 	pw_log_debug("%p", this->support[5].data);
 
-	pw_data_loop_start(this->data_loop_impl);
+	spa_list_for_each(loop, &this->data_loop_list, link) {
+		memcpy(loop->support, this->support, this->n_support * sizeof(struct spa_support));
+		loop->support[1] = SPA_SUPPORT_INIT(SPA_TYPE_LOOP__DataLoop, loop->loop->loop);
+		loop->n_support = this->n_support;
+
+		pw_data_loop_start(loop);
+	}
 
 	spa_list_init(&this->protocol_list);
 	spa_list_init(&this->remote_list);
@@ -411,6 +600,7 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 	spa_list_init(&this->module_list);
 	spa_list_init(&this->client_list);
 	spa_list_init(&this->node_list);
+	spa_list_init(&this->node_class_list);
 	spa_list_init(&this->factory_list);
 	spa_list_init(&this->link_list);
 	spa_list_init(&this->control_list[0]);
@@ -433,6 +623,14 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 	this->info.props = &properties->dict;
 	this->info.name = name;
 
+	if ((str = pw_properties_get(properties, PW_CORE_PROP_PROFILER)) != NULL &&
+	    atoi(str) > 0 &&
+	    (this->profiler = pw_profiler_new(name, atoi(str))) == NULL)
+		pw_log_warn("core %p: can't create profiler: %m", this);
+
+	this->xrun_event = pw_loop_add_event(main_loop, on_xrun_event, this);
+	this->xrun_timer = pw_loop_add_timer(main_loop, on_xrun_timeout, this);
+
 	this->sc_pagesize = sysconf(_SC_PAGESIZE);
 
 	this->global = pw_global_new(this,
@@ -452,10 +650,23 @@ struct pw_core *pw_core_new(struct pw_loop *main_loop, struct pw_properties *pro
 	pw_global_register(this->global, NULL, NULL);
 	this->info.id = this->global->id;
 
+	if (this->quantum > 0) {
+		spa_list_for_each(loop, &this->data_loop_list, link) {
+			if ((loop->driver = pw_driver_new(this, loop)) == NULL)
+				pw_log_warn("core %p: can't make driver for loop %s: %m",
+					    this, pw_data_loop_get_name(loop));
+		}
+	}
+
 	return this;
 
       no_mem:
+	if (this->rt.executor)
+		pw_executor_destroy(this->rt.executor);
+	free(this->rt.plan);
       no_data_loop:
+	spa_list_for_each_safe(loop, tl, &this->data_loop_list, link)
+		pw_data_loop_destroy(loop);
 	free(this);
 	return NULL;
 }
@@ -472,6 +683,8 @@ void pw_core_destroy(struct pw_core *core)
 	struct pw_module *module, *tm;
 	struct pw_remote *remote, *tr;
 	struct pw_node *node, *tn;
+	struct pw_data_loop *loop, *tl;
+	struct pw_memblock_pool_stats stats;
 
 	pw_log_debug("core %p: destroy", core);
 	pw_core_events_destroy(core);
@@ -492,7 +705,28 @@ void pw_core_destroy(struct pw_core *core)
 
 	pw_core_events_free(core);
 
-	pw_data_loop_destroy(core->data_loop_impl);
+	spa_list_for_each_safe(loop, tl, &core->data_loop_list, link) {
+		if (loop->driver)
+			pw_driver_destroy(loop->driver);
+		pw_data_loop_destroy(loop);
+	}
+
+	pw_loop_destroy_source(core->main_loop, core->xrun_event);
+	pw_loop_destroy_source(core->main_loop, core->xrun_timer);
+
+	pw_memblock_pool_get_stats(&stats);
+	pw_log_debug("core %p: mempool %"PRIu64" hits %"PRIu64" misses %"PRIu64" drops",
+		     core, stats.hits, stats.misses, stats.drops);
+	pw_memblock_pool_clear();
+
+	if (core->rt.executor)
+		pw_executor_destroy(core->rt.executor);
+	if (core->rt.plan) {
+		spa_graph_plan_clear(core->rt.plan);
+		free(core->rt.plan);
+	}
+	if (core->profiler)
+		pw_profiler_destroy(core->profiler);
 
 	pw_properties_free(core->properties);
 
@@ -603,6 +837,249 @@ struct pw_global *pw_core_find_global(struct pw_core *core, uint32_t id)
 	return global;
 }
 
+static inline bool class_equal(const char *a, const char *b)
+{
+	return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static struct pw_node_class *ensure_node_class(struct pw_core *core, const char *media_class)
+{
+	struct pw_node_class *c;
+
+	spa_list_for_each(c, &core->node_class_list, link) {
+		if (class_equal(c->media_class, media_class))
+			return c;
+	}
+
+	c = calloc(1, sizeof(struct pw_node_class));
+	if (c == NULL)
+		return NULL;
+
+	c->media_class = media_class ? strdup(media_class) : NULL;
+	spa_list_init(&c->nodes[SPA_DIRECTION_INPUT]);
+	spa_list_init(&c->nodes[SPA_DIRECTION_OUTPUT]);
+	spa_list_append(&core->node_class_list, &c->link);
+
+	pw_log_debug("core %p: new node class \"%s\"", core, media_class);
+
+	return c;
+}
+
+static void class_add_node(struct pw_core *core, struct pw_node_class *c,
+			   struct pw_node *node, enum pw_direction direction)
+{
+	struct pw_node *n;
+
+	if (!spa_list_is_empty(&node->class_link[direction]))
+		return;
+
+	/* keep the nodes of the class in registration order */
+	spa_list_for_each_next(n, &core->node_list, &node->link, link) {
+		if (n->node_class == c && !spa_list_is_empty(&n->class_link[direction])) {
+			spa_list_insert(n->class_link[direction].prev,
+					&node->class_link[direction]);
+			return;
+		}
+	}
+	spa_list_append(&c->nodes[direction], &node->class_link[direction]);
+}
+
+static void class_remove_node(struct pw_node *node, enum pw_direction direction)
+{
+	spa_list_remove(&node->class_link[direction]);
+	spa_list_init(&node->class_link[direction]);
+}
+
+/** Index a node
+ *
+ * \param core a core
+ * \param node a registered node
+ *
+ * Add \a node to the index of nodes by media class and the direction of
+ * its ports. This needs to be called again when the media class or the
+ * max number of ports of the node changes.
+ *
+ * \memberof pw_core
+ */
+void pw_core_index_node(struct pw_core *core, struct pw_node *node)
+{
+	const char *media_class = pw_properties_get(node->properties, "media.class");
+	struct pw_node_class *c = node->node_class;
+
+	if (c == NULL || !class_equal(c->media_class, media_class)) {
+		pw_core_unindex_node(core, node);
+
+		if ((c = ensure_node_class(core, media_class)) == NULL) {
+			pw_log_error("core %p: can't index node %p", core, node);
+			return;
+		}
+		node->node_class = c;
+		c->n_nodes++;
+	}
+
+	if (node->info.max_input_ports > 0)
+		class_add_node(core, c, node, PW_DIRECTION_INPUT);
+	else
+		class_remove_node(node, PW_DIRECTION_INPUT);
+
+	if (node->info.max_output_ports > 0)
+		class_add_node(core, c, node, PW_DIRECTION_OUTPUT);
+	else
+		class_remove_node(node, PW_DIRECTION_OUTPUT);
+}
+
+/** Remove a node from the index
+ *
+ * \param core a core
+ * \param node a node
+ *
+ * \memberof pw_core
+ */
+void pw_core_unindex_node(struct pw_core *core, struct pw_node *node)
+{
+	struct pw_node_class *c = node->node_class;
+
+	if (c == NULL)
+		return;
+
+	class_remove_node(node, PW_DIRECTION_INPUT);
+	class_remove_node(node, PW_DIRECTION_OUTPUT);
+	node->node_class = NULL;
+
+	if (--c->n_nodes == 0) {
+		pw_log_debug("core %p: free node class \"%s\"", core, c->media_class);
+		spa_list_remove(&c->link);
+		free(c->media_class);
+		free(c);
+	}
+}
+
+/** \cond */
+#define MAX_MEDIA_TYPES	8
+
+struct media_types {
+	uint32_t n_types;
+	struct {
+		uint32_t type;
+		uint32_t subtype;
+	} types[MAX_MEDIA_TYPES];
+};
+/** \endcond */
+
+/* collect the media types and subtypes of the formats of a port. Returns
+ * false when they can't be used to filter candidates, like when the port
+ * has no formats to enumerate or too many different types. */
+static bool collect_media_types(struct pw_core *core, struct pw_port *port,
+				struct media_types *types)
+{
+	uint32_t i, index = 0, type, subtype;
+	uint8_t buf[4096];
+	struct spa_pod_builder b;
+	struct spa_pod *param;
+
+	types->n_types = 0;
+
+	while (true) {
+		spa_pod_builder_init(&b, buf, sizeof(buf));
+		if (pw_port_enum_params(port, core->type.param.idEnumFormat, &index,
+					NULL, &param, &b) <= 0)
+			break;
+
+		if (spa_pod_object_parse(param, "I", &type, "I", &subtype) < 0)
+			return false;
+
+		for (i = 0; i < types->n_types; i++) {
+			if (types->types[i].type == type && types->types[i].subtype == subtype)
+				break;
+		}
+		if (i < types->n_types)
+			continue;
+
+		if (types->n_types == MAX_MEDIA_TYPES)
+			return false;
+
+		types->types[types->n_types].type = type;
+		types->types[types->n_types].subtype = subtype;
+		types->n_types++;
+	}
+	return types->n_types > 0;
+}
+
+/* check if one of the formats of a port has a media type and subtype of
+ * \a types. Ports without formats to enumerate are not filtered. */
+static bool has_media_type(struct pw_core *core, struct pw_port *port,
+			   const struct media_types *types)
+{
+	uint32_t i, index = 0, type, subtype;
+	uint8_t buf[4096];
+	struct spa_pod_builder b;
+	struct spa_pod *param;
+
+	while (true) {
+		spa_pod_builder_init(&b, buf, sizeof(buf));
+		if (pw_port_enum_params(port, core->type.param.idEnumFormat, &index,
+					NULL, &param, &b) <= 0)
+			break;
+
+		if (spa_pod_object_parse(param, "I", &type, "I", &subtype) < 0)
+			return true;
+
+		for (i = 0; i < types->n_types; i++) {
+			if (types->types[i].type == type && types->types[i].subtype == subtype)
+				return true;
+		}
+	}
+	return index == 0;
+}
+
+/* media classes are like "Audio/Sink", a class that names a media type
+ * can only have nodes with ports of that media type */
+static bool class_has_media_type(struct pw_core *core, struct pw_node_class *c,
+				 const struct media_types *types)
+{
+	static const struct {
+		const char *class;
+		const char *type;
+	} class_types[] = {
+		{ "Audio", SPA_TYPE_MEDIA_TYPE__audio },
+		{ "Video", SPA_TYPE_MEDIA_TYPE__video },
+	};
+	uint32_t i, j;
+	bool named = false;
+
+	if (c->media_class == NULL)
+		return true;
+
+	for (i = 0; i < SPA_N_ELEMENTS(class_types); i++) {
+		if (strstr(c->media_class, class_types[i].class) == NULL)
+			continue;
+
+		named = true;
+		for (j = 0; j < types->n_types; j++) {
+			const char *name = spa_type_map_get_type(core->type.map,
+								 types->types[j].type);
+			if (name && strcmp(name, class_types[i].type) == 0)
+				return true;
+		}
+	}
+	return !named;
+}
+
+static bool can_link_node(struct pw_core *core, struct pw_port *other_port, struct pw_node *n)
+{
+	if (n->global == NULL)
+		return false;
+
+	if (other_port->node == n)
+		return false;
+
+	if (core->current_client &&
+	    !PW_PERM_IS_R(pw_global_get_permissions(n->global, core->current_client)))
+		return false;
+
+	return n->enabled;
+}
+
 /** Find a port to link with
  *
  * \param core a core
@@ -614,6 +1091,11 @@ struct pw_global *pw_core_find_global(struct pw_core *core, uint32_t id)
  * \param[out] error an error when something is wrong
  * \return a port that can be used to link to \a otherport or NULL on error
  *
+ * Without an \a id, the nodes with ports in the opposite direction are
+ * tried from the media class index. Classes that name another media type
+ * and ports without a matching media type and subtype are skipped before the formats are intersected and the
+ * first port with a common format is returned.
+ *
  * \memberof pw_core
  */
 struct pw_port *pw_core_find_port(struct pw_core *core,
@@ -625,50 +1107,58 @@ struct pw_port *pw_core_find_port(struct pw_core *core,
 				  char **error)
 {
 	struct pw_port *best = NULL;
-	bool have_id;
+	enum pw_direction direction = pw_direction_reverse(other_port->direction);
+	struct pw_node_class *c;
 	struct pw_node *n;
+	struct media_types types;
+	bool filter;
 
-	have_id = id != SPA_ID_INVALID;
+	pw_log_debug("id \"%u\", %d", id, id != SPA_ID_INVALID);
 
-	pw_log_debug("id \"%u\", %d", id, have_id);
+	if (id != SPA_ID_INVALID) {
+		struct pw_global *global = pw_core_find_global(core, id);
 
-	spa_list_for_each(n, &core->node_list, link) {
-		if (n->global == NULL)
-			continue;
+		if (global == NULL || global->type != core->type.node)
+			goto done;
 
-		if (other_port->node == n)
-			continue;
+		n = global->object;
+		if (!can_link_node(core, other_port, n))
+			goto done;
 
-		if (core->current_client &&
-		    !PW_PERM_IS_R(pw_global_get_permissions(n->global, core->current_client)))
-			continue;
-
-		if (!n->enabled)
-			continue;
+		pw_log_debug("id \"%u\" matches node %p", id, n);
+		best = pw_node_get_free_port(n, direction);
+		goto done;
+	}
 
-		pw_log_debug("node id \"%d\"", n->global->id);
+	filter = collect_media_types(core, other_port, &types);
 
-		if (have_id) {
-			if (n->global->id == id) {
-				pw_log_debug("id \"%u\" matches node %p", id, n);
+	spa_list_for_each(c, &core->node_class_list, link) {
+		if (filter && !class_has_media_type(core, c, &types)) {
+			pw_log_debug("node class \"%s\" has no matching media type",
+				     c->media_class);
+			continue;
+		}
 
-				best =
-				    pw_node_get_free_port(n,
-							  pw_direction_reverse(other_port->
-									       direction));
-				if (best)
-					break;
-			}
-		} else {
+		spa_list_for_each(n, &c->nodes[direction], class_link[direction]) {
 			struct pw_port *p, *pin, *pout;
 			uint8_t buf[4096];
 			struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buf, sizeof(buf));
 			struct spa_pod *dummy;
 
-			p = pw_node_get_free_port(n, pw_direction_reverse(other_port->direction));
+			if (!can_link_node(core, other_port, n))
+				continue;
+
+			pw_log_debug("node id \"%d\"", n->global->id);
+
+			p = pw_node_get_free_port(n, direction);
 			if (p == NULL)
 				continue;
 
+			if (filter && !has_media_type(core, p, &types)) {
+				pw_log_debug("node %p: port %p has no matching media type", n, p);
+				continue;
+			}
+
 			if (p->direction == PW_DIRECTION_OUTPUT) {
 				pin = other_port;
 				pout = p;
@@ -690,8 +1180,10 @@ struct pw_port *pw_core_find_port(struct pw_core *core,
 				continue;
 			}
 			best = p;
+			goto done;
 		}
 	}
+      done:
 	if (best == NULL) {
 		asprintf(error, "No matching Node found");
 	}
@@ -766,14 +1258,23 @@ int pw_core_find_format(struct pw_core *core,
 		struct spa_pod_builder fb = { 0 };
 		uint8_t fbuf[4096];
 		struct spa_pod *filter;
+		const struct spa_pod *memo;
+
+		/* the same ports were negotiated before */
+		if ((memo = pw_port_get_format_memo(output, input)) != NULL) {
+			*format = spa_pod_builder_deref(builder,
+					spa_pod_builder_raw_padded(builder, memo, SPA_POD_SIZE(memo)));
+			if (*format != NULL) {
+				pw_log_debug("core %p: reuse format", core);
+				return 1;
+			}
+		}
 	      again:
 		/* both ports need a format */
 		pw_log_debug("core %p: do enum input %d", core, iidx);
 		spa_pod_builder_init(&fb, fbuf, sizeof(fbuf));
-		if ((res = spa_node_port_enum_params(input->node->node,
-						     input->direction, input->port_id,
-						     t->param.idEnumFormat, &iidx,
-						     NULL, &filter, &fb)) <= 0) {
+		if ((res = pw_port_enum_params(input, t->param.idEnumFormat, &iidx,
+					       NULL, &filter, &fb)) <= 0) {
 			if (res == 0 && iidx == 0) {
 				asprintf(error, "error input enum formats: %s", spa_strerror(res));
 				goto error;
@@ -785,10 +1286,8 @@ int pw_core_find_format(struct pw_core *core,
 		if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
 			spa_debug_format(2, core->type.map, filter);
 
-		if ((res = spa_node_port_enum_params(output->node->node,
-						     output->direction, output->port_id,
-						     t->param.idEnumFormat, &oidx,
-						     filter, format, builder)) <= 0) {
+		if ((res = pw_port_enum_params(output, t->param.idEnumFormat, &oidx,
+					       filter, format, builder)) <= 0) {
 			if (res == 0) {
 				oidx = 0;
 				goto again;
@@ -800,6 +1299,8 @@ int pw_core_find_format(struct pw_core *core,
 		pw_log_debug("Got filtered:");
 		if (pw_log_level_enabled(SPA_LOG_LEVEL_DEBUG))
 			spa_debug_format(2, core->type.map, *format);
+
+		pw_port_set_format_memo(output, input, *format);
 	} else {
 		res = -EBADF;
 		asprintf(error, "error node state");
@@ -110,6 +110,31 @@ struct pw_core_events {
 #define PW_CORE_PROP_VERSION	"pipewire.core.version"
 /** If the core should listen for connections, boolean default false */
 #define PW_CORE_PROP_DAEMON	"pipewire.daemon"
+/** The graph scheduler to use, "default" or "plan". The plan scheduler
+ * precompiles the graph into a flat execution plan when it changes */
+#define PW_CORE_PROP_SCHEDULER	"pipewire.core.scheduler"
+/** The number of threads that execute the graph, including the data loop.
+ * Default 1, more than 1 selects the plan scheduler */
+#define PW_CORE_PROP_WORKERS	"pipewire.core.workers"
+/** Max size in bytes of the free buffer memory that is kept for reuse,
+ * 0 disables the pool */
+#define PW_CORE_PROP_MEMPOOL_SIZE	"pipewire.core.mempool.size"
+/** Max number of free buffer memory blocks that are kept for reuse */
+#define PW_CORE_PROP_MEMPOOL_BLOCKS	"pipewire.core.mempool.blocks"
+/** Number of nodes to keep the timing of in the profiler file, default 0
+ * disables the profiler */
+#define PW_CORE_PROP_PROFILER	"pipewire.core.profiler"
+/** The data loops, a space separated list of name[:cpus[:rt-prio]] like
+ * "audio:2:88 video:3:40". Nodes select a loop with the node.loop.name
+ * property, the "data" loop is the default loop */
+#define PW_CORE_PROP_DATA_LOOPS	"pipewire.core.data-loops"
+/** The number of samples in a cycle of the graph. When set, every data
+ * loop has a driver that starts a cycle once per quantum, see
+ * PW_NODE_PROP_DRIVER. When not set, the graph is only scheduled by the
+ * nodes */
+#define PW_CORE_PROP_QUANTUM	"pipewire.core.quantum"
+/** The sample rate of the quantum, default 48000 */
+#define PW_CORE_PROP_RATE	"pipewire.core.rate"
 
 /** Make a new core object for a given main_loop. Ownership of the properties is taken */
 struct pw_core * pw_core_new(struct pw_loop *main_loop, struct pw_properties *props);
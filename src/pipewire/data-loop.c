@@ -18,6 +18,8 @@
  */
 
 #include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
 #include <errno.h>
 #include <sys/resource.h>
 
@@ -44,6 +46,55 @@ static void *do_loop(void *user_data)
 }
 
 
+/* parse a list of CPU numbers and ranges like "0,2-3" */
+static int parse_cpus(const char *str, cpu_set_t *cpus)
+{
+	char *end;
+	long first, last;
+
+	CPU_ZERO(cpus);
+	while (*str) {
+		first = last = strtol(str, &end, 10);
+		if (end == str || first < 0)
+			return -EINVAL;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtol(str, &end, 10);
+			if (end == str || last < first)
+				return -EINVAL;
+		}
+		for (; first <= last && first < CPU_SETSIZE; first++)
+			CPU_SET(first, cpus);
+		if (*end == ',')
+			end++;
+		else if (*end != '\0')
+			return -EINVAL;
+		str = end;
+	}
+	return CPU_COUNT(cpus) > 0 ? 0 : -EINVAL;
+}
+
+static void setup_thread(struct pw_data_loop *this)
+{
+	char name[16];
+	cpu_set_t cpus;
+	int err;
+
+	snprintf(name, sizeof(name), "pw-%s", this->name);
+	pthread_setname_np(this->thread, name);
+
+	if (this->cpus == NULL)
+		return;
+
+	if (parse_cpus(this->cpus, &cpus) < 0)
+		pw_log_warn("data-loop %p: invalid cpus \"%s\"", this, this->cpus);
+	else if ((err = pthread_setaffinity_np(this->thread, sizeof(cpus), &cpus)) != 0)
+		pw_log_warn("data-loop %p: can't set affinity %s: %s", this, this->cpus,
+			    strerror(err));
+	else
+		pw_log_debug("data-loop %p: %s running on cpus %s", this, this->name, this->cpus);
+}
+
 static void do_stop(void *data, uint64_t count)
 {
 	struct pw_data_loop *this = data;
@@ -59,18 +110,29 @@ static void do_stop(void *data, uint64_t count)
 struct pw_data_loop *pw_data_loop_new(struct pw_properties *properties)
 {
 	struct pw_data_loop *this;
+	const char *str;
 
 	this = calloc(1, sizeof(struct pw_data_loop));
 	if (this == NULL)
 		return NULL;
 
-	pw_log_debug("data-loop %p: new", this);
-
 	this->loop = pw_loop_new(properties);
 	if (this->loop == NULL)
 		goto no_loop;
 
+	str = properties ? pw_properties_get(properties, PW_DATA_LOOP_PROP_NAME) : NULL;
+	this->name = strdup(str ? str : PW_DATA_LOOP_DEFAULT_NAME);
+
+	str = properties ? pw_properties_get(properties, PW_DATA_LOOP_PROP_CPUS) : NULL;
+	this->cpus = str ? strdup(str) : NULL;
+
+	str = properties ? pw_properties_get(properties, PW_DATA_LOOP_PROP_RT_PRIO) : NULL;
+	this->rt_prio = str ? atoi(str) : PW_DATA_LOOP_DEFAULT_RT_PRIO;
+
+	pw_log_debug("data-loop %p: new %s", this, this->name);
+
 	spa_hook_list_init(&this->listener_list);
+	spa_graph_init(&this->graph);
 
 	this->event = pw_loop_add_event(this->loop, do_stop, this);
 
@@ -95,6 +157,8 @@ void pw_data_loop_destroy(struct pw_data_loop *loop)
 
 	pw_loop_destroy_source(loop->loop, loop->event);
 	pw_loop_destroy(loop->loop);
+	free(loop->name);
+	free(loop->cpus);
 	free(loop);
 }
 
@@ -112,6 +176,16 @@ pw_data_loop_get_loop(struct pw_data_loop *loop)
 	return loop->loop;
 }
 
+const char *pw_data_loop_get_name(struct pw_data_loop *loop)
+{
+	return loop->name;
+}
+
+int pw_data_loop_get_rt_prio(struct pw_data_loop *loop)
+{
+	return loop->rt_prio;
+}
+
 /** Start a data loop
  * \param loop the data loop to start
  * \return 0 if ok, -1 on error
@@ -131,6 +205,7 @@ int pw_data_loop_start(struct pw_data_loop *loop)
 			loop->running = false;
 			return -err;
 		}
+		setup_thread(loop);
 	}
 	return 0;
 }
@@ -44,6 +44,18 @@ struct pw_data_loop_events {
 	void (*destroy) (void *data);
 };
 
+/** The name of the loop, default "data" */
+#define PW_DATA_LOOP_PROP_NAME		"loop.name"
+/** The CPUs the thread of the loop runs on, a list of CPU numbers and
+ * ranges like "0,2-3". Default is all CPUs */
+#define PW_DATA_LOOP_PROP_CPUS		"loop.cpus"
+/** The realtime priority of the thread of the loop, 0 is not realtime.
+ * Applied by module-rtkit, default 20 */
+#define PW_DATA_LOOP_PROP_RT_PRIO	"loop.rt-prio"
+
+#define PW_DATA_LOOP_DEFAULT_NAME	"data"
+#define PW_DATA_LOOP_DEFAULT_RT_PRIO	20
+
 /** Make a new loop */
 struct pw_data_loop *
 pw_data_loop_new(struct pw_properties *properties);
@@ -58,6 +70,12 @@ void pw_data_loop_add_listener(struct pw_data_loop *loop,
 struct pw_loop *
 pw_data_loop_get_loop(struct pw_data_loop *loop);
 
+/** Get the name of the data loop */
+const char *pw_data_loop_get_name(struct pw_data_loop *loop);
+
+/** Get the realtime priority of the data loop */
+int pw_data_loop_get_rt_prio(struct pw_data_loop *loop);
+
 /** Destroy the loop */
 void pw_data_loop_destroy(struct pw_data_loop *loop);
 
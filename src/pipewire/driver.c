@@ -0,0 +1,293 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pipewire/log.h"
+#include "pipewire/data-loop.h"
+#include "pipewire/profiler.h"
+#include "pipewire/private.h"
+
+/*
+ * The driver starts a cycle of the graph of a data loop once per quantum.
+ *
+ * A node with the node.driver property drives the cycles with its own
+ * timing, when it asks for input or has output. Without such a node, a
+ * free running system timer starts the cycles.
+ *
+ * In a cycle, all the followers that are at the end of the graph are pulled.
+ * Nodes that schedule themselves and the nodes linked after them follow
+ * their own timing and are left alone.
+ */
+
+/* how far upstream self scheduling nodes are searched, also stops at loops */
+#define MAX_SCHEDULED_DEPTH	16
+
+/* the node has linked inputs and no linked outputs */
+static bool is_sink(struct pw_node *node)
+{
+	struct spa_graph_port *p, *lp;
+
+	/* the links are on the mix node of the ports */
+	spa_list_for_each(p, &node->rt.node.ports[SPA_DIRECTION_OUTPUT], link) {
+		if (p->peer == NULL)
+			continue;
+		spa_list_for_each(lp, &p->peer->node->ports[SPA_DIRECTION_OUTPUT], link)
+			if (lp->peer && !(lp->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+				return false;
+	}
+	spa_list_for_each(p, &node->rt.node.ports[SPA_DIRECTION_INPUT], link) {
+		if (p->peer == NULL)
+			continue;
+		spa_list_for_each(lp, &p->peer->node->ports[SPA_DIRECTION_INPUT], link)
+			if (lp->peer && !(lp->flags & SPA_GRAPH_PORT_FLAG_DISABLED))
+				return true;
+	}
+	return false;
+}
+
+/* live, clock and device nodes ask for input or have output with their
+ * own timing */
+static inline bool schedules_self(struct pw_node *node)
+{
+	return node->live || node->driving || node->clock != NULL;
+}
+
+/* the node or a node upstream schedules itself */
+static bool is_scheduled(struct pw_node *node, int depth)
+{
+	struct spa_graph_port *p, *lp;
+
+	if (schedules_self(node))
+		return true;
+	if (depth == MAX_SCHEDULED_DEPTH)
+		return false;
+
+	/* the input mix node of a port has the input side of the links */
+	spa_list_for_each(p, &node->rt.node.ports[SPA_DIRECTION_INPUT], link) {
+		if (p->peer == NULL)
+			continue;
+		spa_list_for_each(lp, &p->peer->node->ports[SPA_DIRECTION_INPUT], link) {
+			struct pw_link *l = lp->scheduler_data;
+
+			if (lp->peer == NULL || (lp->flags & SPA_GRAPH_PORT_FLAG_DISABLED) ||
+			    l == NULL || l->output == NULL)
+				continue;
+			if (is_scheduled(l->output->node, depth + 1))
+				return true;
+		}
+	}
+	return false;
+}
+
+static void run_followers(struct pw_driver *driver)
+{
+	struct pw_node *n;
+
+	spa_list_for_each(n, &driver->rt.nodes, rt.driver_link) {
+		if (n == driver->rt.node || !is_sink(n) || is_scheduled(n, 0))
+			continue;
+		pw_log_trace("driver %p: pull %p", driver, n);
+		spa_graph_need_input(n->rt.graph, &n->rt.node);
+	}
+}
+
+static void finish_cycle(struct pw_driver *driver, uint64_t signal, uint64_t start, bool xrun)
+{
+	uint64_t finish = spa_graph_get_time();
+
+	if (finish - start > driver->period)
+		xrun = true;
+	if (xrun)
+		pw_log_trace("driver %p: cycle took %"PRIu64" ns", driver, finish - start);
+
+	spa_graph_node_timing_update(driver->rt.timing, signal, start, finish, xrun);
+}
+
+void pw_driver_cycle(struct pw_driver *driver, struct pw_node *node, enum spa_direction direction)
+{
+	uint64_t start = spa_graph_get_time(), signal;
+
+	signal = driver->rt.next ? driver->rt.next : start;
+	driver->rt.next = start + driver->period;
+
+	if (direction == SPA_DIRECTION_INPUT)
+		spa_graph_need_input(node->rt.graph, &node->rt.node);
+	else
+		spa_graph_have_output(node->rt.graph, &node->rt.node);
+
+	run_followers(driver);
+
+	finish_cycle(driver, signal, start, false);
+}
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct pw_driver *driver = data;
+	uint64_t start = spa_graph_get_time(), signal;
+
+	signal = driver->rt.next;
+	driver->rt.next += expirations * driver->period;
+
+	run_followers(driver);
+
+	/* more than one expiration means that we missed cycles */
+	finish_cycle(driver, signal, start, expirations > 1);
+}
+
+static void update_timer(struct pw_driver *driver)
+{
+	struct timespec value;
+	bool running;
+
+	running = driver->rt.node == NULL && !spa_list_is_empty(&driver->rt.nodes);
+	if (running == driver->rt.timer_running)
+		return;
+
+	pw_log_debug("driver %p: %s timer", driver, running ? "start" : "stop");
+
+	if (running) {
+		value.tv_sec = driver->period / SPA_NSEC_PER_SEC;
+		value.tv_nsec = driver->period % SPA_NSEC_PER_SEC;
+		driver->rt.next = spa_graph_get_time() + driver->period;
+	} else {
+		value.tv_sec = value.tv_nsec = 0;
+		driver->rt.next = 0;
+	}
+	pw_loop_update_timer(driver->loop->loop, driver->rt.timer, &value, &value, false);
+	driver->rt.timer_running = running;
+}
+
+static void select_node(struct pw_driver *driver)
+{
+	struct pw_node *n;
+
+	driver->rt.node = NULL;
+	spa_list_for_each(n, &driver->rt.nodes, rt.driver_link) {
+		if (n->driving) {
+			driver->rt.node = n;
+			break;
+		}
+	}
+	pw_log_debug("driver %p: driven by %s", driver,
+		     driver->rt.node ? driver->rt.node->info.name : "timer");
+	driver->rt.next = 0;
+}
+
+void pw_driver_add_node(struct pw_driver *driver, struct pw_node *node)
+{
+	spa_list_append(&driver->rt.nodes, &node->rt.driver_link);
+
+	if (node->driving && driver->rt.node == NULL)
+		select_node(driver);
+
+	update_timer(driver);
+}
+
+void pw_driver_remove_node(struct pw_driver *driver, struct pw_node *node)
+{
+	spa_list_remove(&node->rt.driver_link);
+
+	if (driver->rt.node == node)
+		select_node(driver);
+
+	update_timer(driver);
+}
+
+static int
+do_add_timer(struct spa_loop *loop,
+	     bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_driver *driver = user_data;
+
+	driver->rt.timer = pw_loop_add_precise_timer(driver->loop->loop, on_timeout, driver);
+
+	return driver->rt.timer ? 0 : -errno;
+}
+
+static int
+do_remove_timer(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_driver *driver = user_data;
+
+	pw_loop_destroy_source(driver->loop->loop, driver->rt.timer);
+
+	return 0;
+}
+
+/** Make a driver for the graph of \a loop
+ * \param core the core with the quantum and rate
+ * \param loop a data loop
+ * \return a new driver or NULL with errno set
+ */
+struct pw_driver *pw_driver_new(struct pw_core *core, struct pw_data_loop *loop)
+{
+	struct pw_driver *this;
+	char name[PW_PROFILER_NAME_SIZE];
+	int res;
+
+	this = calloc(1, sizeof(struct pw_driver));
+	if (this == NULL)
+		return NULL;
+
+	this->core = core;
+	this->loop = loop;
+	this->period = core->quantum * SPA_NSEC_PER_SEC / core->rate;
+
+	spa_list_init(&this->rt.nodes);
+	this->rt.timing = &this->timing;
+
+	/* the cycles are in the profiler with the id of the core */
+	snprintf(name, sizeof(name), "cycle.%s", pw_data_loop_get_name(loop));
+	if (core->profiler &&
+	    (this->profile = pw_profiler_add_node(core->profiler, name)) != NULL) {
+		this->rt.timing = &this->profile->timing;
+		__atomic_store_n(&this->profile->id, core->info.id, __ATOMIC_RELEASE);
+	}
+
+	if ((res = pw_loop_invoke(loop->loop, do_add_timer, 1, NULL, 0, true, this)) < 0) {
+		if (this->profile)
+			pw_profiler_remove_node(core->profiler, this->profile);
+		free(this);
+		errno = -res;
+		return NULL;
+	}
+
+	pw_log_debug("driver %p: new for loop %s, quantum %u rate %u, period %"PRIu64" ns",
+		     this, name, core->quantum, core->rate, this->period);
+
+	return this;
+}
+
+/** Destroy a driver, the nodes of the loop must be removed */
+void pw_driver_destroy(struct pw_driver *driver)
+{
+	pw_log_debug("driver %p: destroy", driver);
+
+	pw_loop_invoke(driver->loop->loop, do_remove_timer, 1, NULL, 0, true, driver);
+
+	if (driver->profile)
+		pw_profiler_remove_node(driver->core->profiler, driver->profile);
+
+	free(driver);
+}
@@ -0,0 +1,471 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "pipewire/log.h"
+#include "pipewire/private.h"
+
+#undef spa_debug
+#define spa_debug pw_log_trace
+#include <spa/graph/graph-scheduler7.h>
+
+/** \cond */
+#define MAX_WORKERS	64
+#define MAX_SPINS	256	/**< tries to find work before going to sleep */
+
+/* Chase-Lev work stealing deque of plan indexes. The owner pushes and pops
+ * at the bottom, the other workers steal from the top. The deques are reset
+ * before each sweep and a sweep pushes every node at most once so the
+ * buffer never wraps around. */
+struct deque {
+	int64_t top;
+	int64_t bottom;
+	uint32_t *items;
+	uint32_t size;
+};
+
+struct worker {
+	struct pw_executor *executor;
+	uint32_t id;
+	pthread_t thread;
+	sem_t sem;
+	struct deque deque;
+};
+
+struct pw_executor {
+	struct spa_graph_plan *plan;
+	struct spa_graph_plan_executor impl;
+
+	bool running;
+	int rt_prio;
+
+	uint32_t n_workers;		/**< number of workers, worker 0 is the caller */
+	struct worker workers[MAX_WORKERS];
+
+	/* the current sweep */
+	int direction;
+	uint32_t sweep;
+	int32_t remaining;		/**< nodes to visit */
+	int32_t busy;			/**< threads still in the sweep, futex */
+	int32_t seq;			/**< bumped when work is added, futex */
+	int32_t sleepers;		/**< threads waiting on seq */
+};
+/** \endcond */
+
+static inline void futex_wait(int32_t *addr, int32_t val)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static inline void futex_wake(int32_t *addr, int32_t n)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* wake up n sleeping threads after adding work or when the sweep is done */
+static inline void wake_workers(struct pw_executor *this, int32_t n)
+{
+	__atomic_add_fetch(&this->seq, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&this->sleepers, __ATOMIC_SEQ_CST) > 0)
+		futex_wake(&this->seq, n);
+}
+
+static inline void deque_push(struct deque *d, uint32_t item)
+{
+	int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&d->items[b & (d->size - 1)], item, __ATOMIC_RELAXED);
+	__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+static inline bool deque_pop(struct deque *d, uint32_t *item)
+{
+	int64_t t, b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+	bool res = true;
+
+	__atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+	if (t > b) {
+		__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+	*item = __atomic_load_n(&d->items[b & (d->size - 1)], __ATOMIC_RELAXED);
+	if (t == b) {
+		/* last item, race against the thieves */
+		res = __atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+						  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+		__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return res;
+}
+
+static inline bool deque_steal(struct deque *d, uint32_t *item)
+{
+	int64_t b, t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return false;
+
+	*item = __atomic_load_n(&d->items[t & (d->size - 1)], __ATOMIC_RELAXED);
+	return __atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline bool next_item(struct pw_executor *this, struct worker *w, uint32_t *item)
+{
+	uint32_t i;
+
+	if (deque_pop(&w->deque, item))
+		return true;
+
+	for (i = 1; i < this->n_workers; i++) {
+		struct worker *victim = &this->workers[(w->id + i) % this->n_workers];
+		if (deque_steal(&victim->deque, item))
+			return true;
+	}
+	return false;
+}
+
+/* get the next node to visit, spin a little and then sleep until work is added.
+ * Returns false when all the nodes of the sweep were visited. */
+static bool wait_item(struct pw_executor *this, struct worker *w, uint32_t *item)
+{
+	uint32_t spins;
+	int32_t seq;
+
+	while (true) {
+		for (spins = 0; spins < MAX_SPINS; spins++) {
+			if (next_item(this, w, item))
+				return true;
+			if (__atomic_load_n(&this->remaining, __ATOMIC_ACQUIRE) <= 0)
+				return false;
+		}
+
+		/* read seq before checking again so that we don't miss a wakeup */
+		seq = __atomic_load_n(&this->seq, __ATOMIC_SEQ_CST);
+		if (next_item(this, w, item))
+			return true;
+		if (__atomic_load_n(&this->remaining, __ATOMIC_ACQUIRE) <= 0)
+			return false;
+
+		__atomic_add_fetch(&this->sleepers, 1, __ATOMIC_SEQ_CST);
+		futex_wait(&this->seq, seq);
+		__atomic_sub_fetch(&this->sleepers, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void do_sweep(struct pw_executor *this, struct worker *w)
+{
+	struct spa_graph_plan *plan = this->plan;
+	int direction = this->direction;
+	uint32_t i, index, sweep = this->sweep;
+
+	while (wait_item(this, w, &index)) {
+		struct spa_graph_plan_node *pn;
+		struct spa_graph_plan_edge *e;
+		uint32_t n_edges;
+		int32_t n_ready = 0;
+
+		spa_graph_plan_visit(plan, index, direction, sweep);
+		plan->nodes[index].node->signal_time = 0;
+
+		/* push makes the nodes after the outputs ready, pull the ones
+		 * before the inputs */
+		pn = &plan->nodes[index];
+		if (direction == SPA_GRAPH_PLAN_PUSH) {
+			e = &plan->edges[pn->edges[SPA_DIRECTION_OUTPUT]];
+			n_edges = pn->n_edges[SPA_DIRECTION_OUTPUT];
+		} else {
+			e = &plan->edges[pn->edges[SPA_DIRECTION_INPUT]];
+			n_edges = pn->n_edges[SPA_DIRECTION_INPUT];
+		}
+		for (i = 0; i < n_edges; i++) {
+			if (e[i].peer == SPA_ID_INVALID)
+				continue;
+			if (__atomic_sub_fetch(&plan->nodes[e[i].peer].pending, 1, __ATOMIC_ACQ_REL) == 0) {
+				spa_graph_node_signal(plan->nodes[e[i].peer].node);
+				deque_push(&w->deque, e[i].peer);
+				n_ready++;
+			}
+		}
+		/* we take one of the nodes ourselves, the others can be stolen */
+		if (n_ready > 1)
+			wake_workers(this, n_ready - 1);
+
+		if (__atomic_sub_fetch(&this->remaining, 1, __ATOMIC_ACQ_REL) == 0)
+			wake_workers(this, INT_MAX);
+	}
+}
+
+static void *worker_thread(void *data)
+{
+	struct worker *w = data;
+	struct pw_executor *this = w->executor;
+	struct sched_param sp;
+	cpu_set_t cpuset;
+	long n_cpus;
+	int res;
+
+	if ((n_cpus = sysconf(_SC_NPROCESSORS_ONLN)) > 0) {
+		CPU_ZERO(&cpuset);
+		CPU_SET(w->id % n_cpus, &cpuset);
+		if ((res = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) != 0)
+			pw_log_warn("executor %p: worker %d can't set affinity: %s", this,
+				    w->id, strerror(res));
+	}
+	if (this->rt_prio > 0) {
+		spa_zero(sp);
+		sp.sched_priority = this->rt_prio;
+		if ((res = pthread_setschedparam(pthread_self(), SCHED_FIFO | SCHED_RESET_ON_FORK, &sp)) != 0)
+			pw_log_debug("executor %p: worker %d can't be made realtime: %s", this,
+				     w->id, strerror(res));
+	}
+
+	pw_log_debug("executor %p: worker %d started", this, w->id);
+
+	while (true) {
+		while (sem_wait(&w->sem) < 0 && errno == EINTR);
+
+		if (!__atomic_load_n(&this->running, __ATOMIC_ACQUIRE))
+			break;
+
+		do_sweep(this, w);
+		if (__atomic_sub_fetch(&this->busy, 1, __ATOMIC_ACQ_REL) == 0)
+			futex_wake(&this->busy, 1);
+	}
+	pw_log_debug("executor %p: worker %d stopped", this, w->id);
+
+	return NULL;
+}
+
+static int ensure_size(struct pw_executor *this, uint32_t n_nodes)
+{
+	uint32_t i, size;
+
+	if (this->workers[0].deque.size >= n_nodes)
+		return 0;
+
+	for (size = 64; size < n_nodes; size <<= 1);
+
+	for (i = 0; i < this->n_workers; i++) {
+		struct deque *d = &this->workers[i].deque;
+		uint32_t *items;
+
+		if ((items = realloc(d->items, size * sizeof(uint32_t))) == NULL)
+			return -ENOMEM;
+		d->items = items;
+		d->size = size;
+	}
+	return 0;
+}
+
+static int impl_sweep(void *data, struct spa_graph_plan *plan, int direction,
+		      uint32_t sweep, uint32_t first)
+{
+	struct pw_executor *this = data;
+	uint32_t i, j, n_nodes, n_roots, n_reached, index;
+	int32_t busy;
+
+	/* not worth waking up the workers */
+	if (plan->n_nodes < this->n_workers || first >= plan->n_nodes)
+		return -ENOTSUP;
+
+	if (ensure_size(this, plan->n_nodes) < 0)
+		return -ENOMEM;
+
+	for (i = 0; i < this->n_workers; i++) {
+		struct deque *d = &this->workers[i].deque;
+		d->top = d->bottom = 0;
+	}
+
+	/* push goes forward from first, pull backwards. Nothing before first
+	 * can be reached and the plan is sorted so we only need one pass to
+	 * find the nodes that can be reached from the nodes that start the
+	 * sweep and to count their dependencies. */
+	n_nodes = direction == SPA_GRAPH_PLAN_PUSH ? plan->n_nodes - first : first + 1;
+	for (i = 0; i < n_nodes; i++) {
+		index = direction == SPA_GRAPH_PLAN_PUSH ? first + i : first - i;
+		plan->nodes[index].pending = -1;
+	}
+	for (i = 0, n_roots = 0, n_reached = 0; i < n_nodes; i++) {
+		struct spa_graph_plan_node *pn;
+		struct spa_graph_plan_edge *e;
+		uint32_t n_edges;
+
+		index = direction == SPA_GRAPH_PLAN_PUSH ? first + i : first - i;
+		pn = &plan->nodes[index];
+
+		if (pn->pending < 0) {
+			if (pn->start[direction] != sweep)
+				continue;
+			pn->pending = 0;
+		}
+		n_reached++;
+
+		if (pn->pending == 0)
+			deque_push(&this->workers[n_roots++ % this->n_workers].deque, index);
+
+		if (direction == SPA_GRAPH_PLAN_PUSH) {
+			e = &plan->edges[pn->edges[SPA_DIRECTION_OUTPUT]];
+			n_edges = pn->n_edges[SPA_DIRECTION_OUTPUT];
+		} else {
+			e = &plan->edges[pn->edges[SPA_DIRECTION_INPUT]];
+			n_edges = pn->n_edges[SPA_DIRECTION_INPUT];
+		}
+		for (j = 0; j < n_edges; j++) {
+			struct spa_graph_plan_node *ppn;
+
+			if (e[j].peer == SPA_ID_INVALID)
+				continue;
+			ppn = &plan->nodes[e[j].peer];
+			ppn->pending = ppn->pending < 0 ? 1 : ppn->pending + 1;
+		}
+	}
+
+	if (n_reached < this->n_workers)
+		return -ENOTSUP;
+
+	for (i = 0; i < this->n_workers; i++) {
+		struct deque *d = &this->workers[i].deque;
+		for (j = 0; j < (uint32_t) d->bottom; j++)
+			spa_graph_node_signal(plan->nodes[d->items[j]].node);
+	}
+
+	this->direction = direction;
+	this->sweep = sweep;
+	this->remaining = n_reached;
+	__atomic_store_n(&this->busy, this->n_workers - 1, __ATOMIC_RELEASE);
+
+	for (i = 1; i < this->n_workers; i++)
+		sem_post(&this->workers[i].sem);
+
+	do_sweep(this, &this->workers[0]);
+
+	/* wait for the others to leave the sweep before the deques can be
+	 * reused */
+	for (i = 0; i < MAX_SPINS; i++)
+		if (__atomic_load_n(&this->busy, __ATOMIC_ACQUIRE) == 0)
+			return 0;
+	while ((busy = __atomic_load_n(&this->busy, __ATOMIC_ACQUIRE)) > 0)
+		futex_wait(&this->busy, busy);
+
+	return 0;
+}
+
+static const struct spa_graph_plan_executor executor_impl = {
+	SPA_VERSION_GRAPH_PLAN_EXECUTOR,
+	.sweep = impl_sweep,
+};
+
+/** Create a new executor for \a plan
+ * \param plan the plan to execute
+ * \param n_workers number of threads that run the plan, including
+ *		the thread that calls the scheduler
+ * \param rt_prio the realtime priority of the workers or 0
+ * \return a new executor or NULL on error
+ *
+ * The executor runs independent nodes of the plan in parallel on a
+ * pool of worker threads, each pinned to a CPU.
+ */
+struct pw_executor *pw_executor_new(struct spa_graph_plan *plan, uint32_t n_workers, int rt_prio)
+{
+	struct pw_executor *this;
+	uint32_t i;
+	int res;
+
+	if (n_workers < 2 || n_workers > MAX_WORKERS)
+		return NULL;
+
+	this = calloc(1, sizeof(struct pw_executor));
+	if (this == NULL)
+		return NULL;
+
+	pw_log_debug("executor %p: new %d workers", this, n_workers);
+
+	this->plan = plan;
+	this->impl = executor_impl;
+	this->n_workers = n_workers;
+	this->rt_prio = rt_prio;
+	this->running = true;
+
+	if (ensure_size(this, plan->max_nodes) < 0)
+		goto no_mem;
+
+	this->workers[0].executor = this;
+	for (i = 1; i < n_workers; i++) {
+		struct worker *w = &this->workers[i];
+
+		w->executor = this;
+		w->id = i;
+		sem_init(&w->sem, 0, 0);
+		if ((res = pthread_create(&w->thread, NULL, worker_thread, w)) != 0) {
+			pw_log_warn("executor %p: can't create thread: %s", this, strerror(res));
+			sem_destroy(&w->sem);
+			this->n_workers = i;
+			break;
+		}
+	}
+	spa_graph_plan_set_executor(plan, &this->impl, this);
+
+	return this;
+
+      no_mem:
+	for (i = 0; i < n_workers; i++)
+		free(this->workers[i].deque.items);
+	free(this);
+	return NULL;
+}
+
+/** Destroy an executor, must not be called while the plan is running */
+void pw_executor_destroy(struct pw_executor *executor)
+{
+	uint32_t i;
+
+	pw_log_debug("executor %p: destroy", executor);
+
+	spa_graph_plan_set_executor(executor->plan, NULL, NULL);
+
+	__atomic_store_n(&executor->running, false, __ATOMIC_RELEASE);
+	for (i = 1; i < executor->n_workers; i++) {
+		struct worker *w = &executor->workers[i];
+
+		sem_post(&w->sem);
+		pthread_join(w->thread, NULL);
+		sem_destroy(&w->sem);
+	}
+	for (i = 0; i < MAX_WORKERS; i++)
+		free(executor->workers[i].deque.items);
+
+	free(executor);
+}
@@ -481,7 +481,7 @@ pw_module_proxy_add_listener(struct pw_module_proxy *module,
 
 #define pw_module_resource_info(r,...)	pw_resource_notify(r,struct pw_module_proxy_events,info,__VA_ARGS__)
 
-#define PW_VERSION_NODE			0
+#define PW_VERSION_NODE			1
 
 #define PW_NODE_PROXY_EVENT_INFO	0
 #define PW_NODE_PROXY_EVENT_PARAM	1
@@ -555,7 +555,7 @@ pw_node_proxy_enum_params(struct pw_node_proxy *node, uint32_t id, uint32_t inde
 			id, index, num, filter);
 }
 
-#define PW_VERSION_PORT			0
+#define PW_VERSION_PORT			1
 
 #define PW_PORT_PROXY_EVENT_INFO	0
 #define PW_PORT_PROXY_EVENT_PARAM	1
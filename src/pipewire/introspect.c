@@ -214,6 +214,10 @@ struct pw_node_info *pw_node_info_update(struct pw_node_info *info,
 			pw_spa_dict_destroy(info->props);
 		info->props = pw_spa_dict_copy(update->props);
 	}
+	if (update->change_mask & PW_NODE_CHANGE_MASK_XRUNS) {
+		info->n_xruns = update->n_xruns;
+		info->xrun_time = update->xrun_time;
+	}
 	return info;
 }
 
@@ -254,6 +258,10 @@ struct pw_port_info *pw_port_info_update(struct pw_port_info *info,
 			pw_spa_dict_destroy(info->props);
 		info->props = pw_spa_dict_copy(update->props);
 	}
+	if (update->change_mask & PW_PORT_CHANGE_MASK_XRUNS) {
+		info->n_xruns = update->n_xruns;
+		info->xrun_time = update->xrun_time;
+	}
 	return info;
 }
 
@@ -147,6 +147,7 @@ struct pw_node_info {
 #define PW_NODE_CHANGE_MASK_STATE		(1 << 3)
 #define PW_NODE_CHANGE_MASK_PROPS		(1 << 4)
 #define PW_NODE_CHANGE_MASK_ENUM_PARAMS		(1 << 5)
+#define PW_NODE_CHANGE_MASK_XRUNS		(1 << 6)
 	uint64_t change_mask;			/**< bitfield of changed fields since last call */
 	const char *name;                       /**< name the node, suitable for display */
 	uint32_t max_input_ports;		/**< maximum number of inputs */
@@ -156,6 +157,8 @@ struct pw_node_info {
 	enum pw_node_state state;		/**< the current state of the node */
 	const char *error;			/**< an error reason if \a state is error */
 	struct spa_dict *props;			/**< the properties of the node */
+	uint32_t n_xruns;			/**< number of xruns of the node */
+	uint64_t xrun_time;			/**< CLOCK_MONOTONIC time of the last xrun */
 };
 
 struct pw_node_info *
@@ -170,9 +173,12 @@ struct pw_port_info {
 #define PW_PORT_CHANGE_MASK_NAME		(1 << 0)
 #define PW_PORT_CHANGE_MASK_PROPS		(1 << 1)
 #define PW_PORT_CHANGE_MASK_ENUM_PARAMS		(1 << 2)
+#define PW_PORT_CHANGE_MASK_XRUNS		(1 << 3)
 	uint64_t change_mask;			/**< bitfield of changed fields since last call */
 	const char *name;                       /**< name the port, suitable for display */
 	struct spa_dict *props;			/**< the properties of the port */
+	uint32_t n_xruns;			/**< number of xruns of the port */
+	uint64_t xrun_time;			/**< CLOCK_MONOTONIC time of the last xrun */
 };
 
 struct pw_port_info *
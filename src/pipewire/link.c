@@ -39,10 +39,39 @@
 #define MAX_BUFFERS     16
 
 /** \cond */
+
+/* Links between nodes in different data loops go through a bridge. On the
+ * loop of the output node, the output port is linked to the input of
+ * in_node. When it gets data, the loop of the input node is woken up with
+ * a non-blocking invoke to push the data out of out_node, which is linked
+ * to the input port. Pulling works the other way around.
+ *
+ * Both loops use the io area of the link. The loop that hands over
+ * publishes the status with a release store after the buffer_id and the
+ * other loop loads it with acquire before it looks at the buffer_id. */
+struct bridge {
+	struct spa_io_buffers *io;
+
+	struct pw_loop *out_loop;
+	struct spa_graph *out_graph;
+	struct spa_node in_node_impl;
+	struct spa_graph_node in_node;
+	struct spa_graph_port in_port;
+
+	struct pw_loop *in_loop;
+	struct spa_graph *in_graph;
+	struct spa_node out_node_impl;
+	struct spa_graph_node out_node;
+	struct spa_graph_port out_port;
+};
+
 struct impl {
 	struct pw_link this;
 
 	bool active;
+	bool bridged;
+
+	struct bridge bridge;
 
 	struct pw_work_queue *work;
 
@@ -81,6 +110,10 @@ static void pw_link_update_state(struct pw_link *link, enum pw_link_state state,
 static void complete_ready(void *obj, void *data, int res, uint32_t id)
 {
 	struct pw_port *port = data;
+
+	/* the async format completed, enumerations can change again */
+	port->node->param_serial++;
+
 	if (SPA_RESULT_IS_OK(res)) {
 		port->state = PW_PORT_STATE_READY;
 		pw_log_debug("port %p: state READY", port);
@@ -314,6 +347,17 @@ static struct spa_pod *find_param(struct spa_pod **params, uint32_t n_params, ui
  * The shared memory block should not contain any types or structure,
  * just the actual metadata contents.
  */
+/* the client that sees the buffer memory of the port */
+static uint32_t get_owner(struct pw_port *port)
+{
+	struct pw_global *global = port->node->global;
+
+	if (global == NULL || global->owner == NULL || global->owner->global == NULL)
+		return SPA_ID_INVALID;
+
+	return global->owner->global->id;
+}
+
 static int alloc_buffers(struct pw_link *this,
 			 uint32_t n_buffers,
 			 uint32_t n_params,
@@ -372,9 +416,12 @@ static int alloc_buffers(struct pw_link *this,
 	/* pointer to buffer structures */
 	bp = SPA_MEMBER(buffers, n_buffers * sizeof(struct spa_buffer *), struct spa_buffer);
 
-	if ((res = pw_memblock_alloc(PW_MEMBLOCK_FLAG_WITH_FD |
-				     PW_MEMBLOCK_FLAG_MAP_READWRITE |
-				     PW_MEMBLOCK_FLAG_SEAL, n_buffers * data_size, &m)) < 0)
+	/* the memory can be reused for links between the same clients */
+	if ((res = pw_memblock_alloc_pooled(PW_MEMBLOCK_FLAG_WITH_FD |
+					    PW_MEMBLOCK_FLAG_MAP_READWRITE |
+					    PW_MEMBLOCK_FLAG_SEAL, n_buffers * data_size,
+					    get_owner(this->output), get_owner(this->input),
+					    &m)) < 0)
 		return res;
 
 	for (i = 0; i < n_buffers; i++) {
@@ -389,6 +436,7 @@ static int alloc_buffers(struct pw_link *this,
 		b->id = i;
 		b->n_metas = n_metas;
 		b->metas = SPA_MEMBER(b, sizeof(struct spa_buffer), struct spa_meta);
+		memset(p, 0, meta_size);
 		for (j = 0; j < n_metas; j++) {
 			struct spa_meta *m = &b->metas[j];
 
@@ -623,6 +671,9 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 			pw_log_warn("no buffers param");
 			minsize = 1024;
 		}
+		/* make room for a quantum of data */
+		if (this->core->quantum > 0 && stride > 0)
+			minsize = SPA_MAX(minsize, (size_t) this->core->quantum * stride);
 
 		/* when one of the ports can allocate buffer memory, set the minsize to
 		 * 0 to make sure we don't allocate memory in the shared memory */
@@ -719,12 +770,24 @@ static int do_allocation(struct pw_link *this, uint32_t in_state, uint32_t out_s
 }
 
 static int
-do_activate_link(struct spa_loop *loop,
-		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+do_activate_output(struct spa_loop *loop,
+		   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
-        struct pw_link *this = user_data;
-	SPA_FLAG_UNSET(this->rt.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
-	SPA_FLAG_UNSET(this->rt.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+        struct impl *impl = user_data;
+	SPA_FLAG_UNSET(impl->this.rt.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	if (impl->bridged)
+		SPA_FLAG_UNSET(impl->bridge.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	return 0;
+}
+
+static int
+do_activate_input(struct spa_loop *loop,
+		  bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+        struct impl *impl = user_data;
+	SPA_FLAG_UNSET(impl->this.rt.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	if (impl->bridged)
+		SPA_FLAG_UNSET(impl->bridge.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
 	return 0;
 }
 
@@ -744,7 +807,9 @@ static int do_start(struct pw_link *this, uint32_t in_state, uint32_t out_state)
 	output = this->output;
 
 	pw_loop_invoke(output->node->data_loop,
-		       do_activate_link, SPA_ID_INVALID, NULL, 0, false, this);
+		       do_activate_output, SPA_ID_INVALID, NULL, 0, false, impl);
+	pw_loop_invoke(input->node->data_loop,
+		       do_activate_input, SPA_ID_INVALID, NULL, 0, false, impl);
 
 	if (in_state == PW_PORT_STATE_PAUSED) {
 		if  ((res = pw_node_set_state(input->node, PW_NODE_STATE_RUNNING)) < 0) {
@@ -859,8 +924,10 @@ static int
 do_remove_input(struct spa_loop *loop,
 	        bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
-	struct pw_link *this = user_data;
-	spa_graph_port_remove(&this->rt.in_port);
+	struct impl *impl = user_data;
+	spa_graph_port_remove(&impl->this.rt.in_port);
+	if (impl->bridged)
+		spa_graph_port_unlink(&impl->bridge.out_port);
 	return 0;
 }
 
@@ -873,7 +940,7 @@ static void input_remove(struct pw_link *this, struct pw_port *port)
 	spa_hook_remove(&impl->input_node_listener);
 
 	pw_loop_invoke(port->node->data_loop,
-		       do_remove_input, 1, NULL, 0, true, this);
+		       do_remove_input, 1, NULL, 0, true, impl);
 
 	pw_map_remove(&port->mix_port_map, this->rt.in_port.port_id);
 
@@ -888,8 +955,10 @@ static int
 do_remove_output(struct spa_loop *loop,
 	         bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
-	struct pw_link *this = user_data;
-	spa_graph_port_remove(&this->rt.out_port);
+	struct impl *impl = user_data;
+	spa_graph_port_remove(&impl->this.rt.out_port);
+	if (impl->bridged)
+		spa_graph_port_unlink(&impl->bridge.in_port);
 	return 0;
 }
 
@@ -902,7 +971,7 @@ static void output_remove(struct pw_link *this, struct pw_port *port)
 	spa_hook_remove(&impl->output_node_listener);
 
 	pw_loop_invoke(port->node->data_loop,
-		       do_remove_output, 1, NULL, 0, true, this);
+		       do_remove_output, 1, NULL, 0, true, impl);
 
 	pw_map_remove(&port->mix_port_map, this->rt.out_port.port_id);
 
@@ -953,13 +1022,26 @@ int pw_link_activate(struct pw_link *this)
 }
 
 static int
-do_deactivate_link(struct spa_loop *loop,
-		   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+do_deactivate_output(struct spa_loop *loop,
+		     bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
-        struct pw_link *this = user_data;
-	pw_log_trace("link %p: disable %p and %p", this, &this->rt.out_port, &this->rt.in_port);
-	SPA_FLAG_SET(this->rt.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
-	SPA_FLAG_SET(this->rt.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+        struct impl *impl = user_data;
+	pw_log_trace("link %p: disable %p", impl, &impl->this.rt.out_port);
+	SPA_FLAG_SET(impl->this.rt.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	if (impl->bridged)
+		SPA_FLAG_SET(impl->bridge.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	return 0;
+}
+
+static int
+do_deactivate_input(struct spa_loop *loop,
+		    bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+        struct impl *impl = user_data;
+	pw_log_trace("link %p: disable %p", impl, &impl->this.rt.in_port);
+	SPA_FLAG_SET(impl->this.rt.in_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
+	if (impl->bridged)
+		SPA_FLAG_SET(impl->bridge.out_port.flags, SPA_GRAPH_PORT_FLAG_DISABLED);
 	return 0;
 }
 
@@ -974,7 +1056,9 @@ int pw_link_deactivate(struct pw_link *this)
 	impl->active = false;
 	pw_log_debug("link %p: deactivate", this);
 	pw_loop_invoke(this->output->node->data_loop,
-		       do_deactivate_link, SPA_ID_INVALID, NULL, 0, true, this);
+		       do_deactivate_output, SPA_ID_INVALID, NULL, 0, true, impl);
+	pw_loop_invoke(this->input->node->data_loop,
+		       do_deactivate_input, SPA_ID_INVALID, NULL, 0, true, impl);
 
 	input_node = this->input->node;
 	output_node = this->output->node;
@@ -1053,6 +1137,97 @@ global_bind(void *_data, struct pw_client *client, uint32_t permissions,
 	return;
 }
 
+static int
+do_bridge_push(struct spa_loop *loop,
+	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct bridge *b = user_data;
+	/* pairs with the release of the other loop */
+	int32_t status = __atomic_load_n(&b->io->status, __ATOMIC_ACQUIRE);
+
+	pw_log_trace("bridge %p: push status %d", b, status);
+	spa_graph_have_output(b->in_graph, &b->out_node);
+	return 0;
+}
+
+static int
+do_bridge_pull(struct spa_loop *loop,
+	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct bridge *b = user_data;
+	/* pairs with the release of the other loop */
+	int32_t status = __atomic_load_n(&b->io->status, __ATOMIC_ACQUIRE);
+
+	pw_log_trace("bridge %p: pull status %d", b, status);
+	spa_graph_need_input(b->out_graph, &b->in_node);
+	return 0;
+}
+
+static int bridge_process_input(struct spa_node *node)
+{
+	struct bridge *b = SPA_CONTAINER_OF(node, struct bridge, in_node_impl);
+	pw_log_trace("bridge %p: push", b);
+	/* publish the buffer_id that was written before the status */
+	__atomic_store_n(&b->io->status, b->io->status, __ATOMIC_RELEASE);
+	pw_loop_invoke(b->in_loop, do_bridge_push, SPA_ID_INVALID, NULL, 0, false, b);
+	return SPA_STATUS_OK;
+}
+
+static int bridge_process_output(struct spa_node *node)
+{
+	struct bridge *b = SPA_CONTAINER_OF(node, struct bridge, out_node_impl);
+	pw_log_trace("bridge %p: pull", b);
+	/* publish the buffer_id that was written before the status */
+	__atomic_store_n(&b->io->status, b->io->status, __ATOMIC_RELEASE);
+	pw_loop_invoke(b->out_loop, do_bridge_pull, SPA_ID_INVALID, NULL, 0, false, b);
+	return SPA_STATUS_OK;
+}
+
+static const struct spa_node bridge_impl = {
+	SPA_VERSION_NODE,
+	NULL,
+	.process_input = bridge_process_input,
+	.process_output = bridge_process_output,
+};
+
+static void bridge_init(struct bridge *b, struct pw_link *link,
+			struct pw_node *output_node, struct pw_node *input_node)
+{
+	b->io = &link->io;
+	b->out_loop = output_node->data_loop;
+	b->out_graph = output_node->rt.graph;
+	b->in_loop = input_node->data_loop;
+	b->in_graph = input_node->rt.graph;
+
+	b->in_node_impl = bridge_impl;
+	spa_graph_node_init(&b->in_node);
+	spa_graph_node_set_implementation(&b->in_node, &b->in_node_impl);
+	b->in_node.graph = b->out_graph;
+	b->in_node.flags = SPA_GRAPH_NODE_FLAG_ASYNC;
+	spa_graph_port_init(&b->in_port, PW_DIRECTION_INPUT, 0,
+			    SPA_GRAPH_PORT_FLAG_DISABLED, &link->io);
+	spa_graph_port_add(&b->in_node, &b->in_port);
+
+	b->out_node_impl = bridge_impl;
+	spa_graph_node_init(&b->out_node);
+	spa_graph_node_set_implementation(&b->out_node, &b->out_node_impl);
+	b->out_node.graph = b->in_graph;
+	b->out_node.flags = SPA_GRAPH_NODE_FLAG_ASYNC;
+	spa_graph_port_init(&b->out_port, PW_DIRECTION_OUTPUT, 0,
+			    SPA_GRAPH_PORT_FLAG_DISABLED, &link->io);
+	spa_graph_port_add(&b->out_node, &b->out_port);
+
+	spa_graph_port_link(&link->rt.out_port, &b->in_port);
+	spa_graph_port_link(&b->out_port, &link->rt.in_port);
+}
+
+static int
+do_bridge_sync(struct spa_loop *loop,
+	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	return 0;
+}
+
 static int
 do_add_link(struct spa_loop *loop,
             bool async, uint32_t seq, const void *data, size_t size, void *user_data)
@@ -1182,7 +1357,14 @@ struct pw_link *pw_link_new(struct pw_core *core,
 			    this->rt.in_port.port_id,
 			    SPA_GRAPH_PORT_FLAG_DISABLED,
 			    &this->io);
-	spa_graph_port_link(&this->rt.out_port, &this->rt.in_port);
+	if (output_node->data_loop != input_node->data_loop) {
+		pw_log_debug("link %p: bridge data loops %p and %p", this,
+			     output_node->data_loop, input_node->data_loop);
+		impl->bridged = true;
+		bridge_init(&impl->bridge, this, output_node, input_node);
+	}
+	else
+		spa_graph_port_link(&this->rt.out_port, &this->rt.in_port);
 
 	this->rt.in_port.scheduler_data = this;
 	this->rt.out_port.scheduler_data = this;
@@ -1292,6 +1474,14 @@ void pw_link_destroy(struct pw_link *link)
 
 	output_remove(link, link->output);
 
+	if (impl->bridged) {
+		/* flush the handoffs that are still queued on the loops */
+		pw_loop_invoke(impl->bridge.in_loop,
+			       do_bridge_sync, SPA_ID_INVALID, NULL, 0, true, impl);
+		pw_loop_invoke(impl->bridge.out_loop,
+			       do_bridge_sync, SPA_ID_INVALID, NULL, 0, true, impl);
+	}
+
 	if (link->global) {
 		spa_hook_remove(&link->global_listener);
 		pw_global_destroy(link->global);
@@ -17,6 +17,7 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <errno.h>
 #include <stdio.h>
 
 #include <spa/support/loop.h>
@@ -51,6 +52,7 @@ struct pw_loop *pw_loop_new(struct pw_properties *properties)
 	void *iface;
 	const struct spa_support *support;
 	uint32_t n_support;
+	const char *name;
 
 	support = pw_get_support(&n_support);
 	if (support == NULL)
@@ -60,9 +62,20 @@ struct pw_loop *pw_loop_new(struct pw_properties *properties)
 	if (map == NULL)
 		return NULL;
 
-	factory = pw_get_support_factory("loop");
-	if (factory == NULL)
+	if (properties == NULL ||
+	    (name = pw_properties_get(properties, PW_LOOP_PROP_FACTORY)) == NULL)
+		name = "loop";
+
+      again:
+	factory = pw_get_support_factory(name);
+	if (factory == NULL) {
+		if (strcmp(name, "loop") != 0) {
+			pw_log_warn("loop factory \"%s\" not found, using default", name);
+			name = "loop";
+			goto again;
+		}
 		return NULL;
+	}
 
 	impl = calloc(1, sizeof(struct impl) + factory->size);
 	if (impl == NULL)
@@ -77,6 +90,13 @@ struct pw_loop *pw_loop_new(struct pw_properties *properties)
 					   NULL,
 					   support,
 					   n_support)) < 0) {
+		if (strcmp(name, "loop") != 0) {
+			pw_log_warn("can't make %s instance: %s, using default",
+				    name, spa_strerror(res));
+			free(impl);
+			name = "loop";
+			goto again;
+		}
 		fprintf(stderr, "can't make factory instance: %d\n", res);
 		goto failed;
 	}
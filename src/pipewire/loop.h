@@ -40,6 +40,10 @@ struct pw_loop {
 	struct spa_loop_utils *utils;		/**< loop utils */
 };
 
+/** The name of the spa loop factory to use, "loop" for the epoll loop,
+ * the default, or "loop-uring" for the io_uring loop */
+#define PW_LOOP_PROP_FACTORY	"loop.factory"
+
 struct pw_loop *
 pw_loop_new(struct pw_properties *properties);
 
@@ -67,6 +71,7 @@ pw_loop_destroy(struct pw_loop *loop);
 #define pw_loop_update_timer(l,...)	spa_loop_utils_update_timer((l)->utils,__VA_ARGS__)
 #define pw_loop_add_signal(l,...)	spa_loop_utils_add_signal((l)->utils,__VA_ARGS__)
 #define pw_loop_destroy_source(l,...)	spa_loop_utils_destroy_source((l)->utils,__VA_ARGS__)
+#define pw_loop_add_precise_timer(l,...)	spa_loop_utils_add_precise_timer((l)->utils,__VA_ARGS__)
 
 #ifdef __cplusplus
 }
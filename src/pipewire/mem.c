@@ -82,12 +82,106 @@ static inline int memfd_create(const char *name, unsigned int flags)
 struct memblock {
 	struct pw_memblock mem;
 	struct spa_list link;
+	bool indexed;			/**< in the address index */
+	bool pooled;			/**< return to the pool when freed */
+	uint32_t owner[2];		/**< global ids of the clients that can
+					  *  reuse the memory or SPA_ID_INVALID */
 };
 
-static struct spa_list _memblocks = SPA_LIST_INIT(&_memblocks);
+/* mapped blocks, sorted on address */
+static struct {
+	struct memblock **blocks;
+	uint32_t n_blocks;
+	uint32_t max_blocks;
+} _index;
+
+#define POOL_DEFAULT_MAX_SIZE	(32 * 1024 * 1024)
+#define POOL_DEFAULT_MAX_BLOCKS	64
+
+/* free memfds, most recently freed first, and the pooled memfds in use */
+static struct {
+	struct spa_list free;
+	struct spa_list used;
+	size_t max_size;
+	uint32_t max_blocks;
+	struct pw_memblock_pool_stats stats;
+} _pool = {
+	{ &_pool.free, &_pool.free },
+	{ &_pool.used, &_pool.used },
+	POOL_DEFAULT_MAX_SIZE,
+	POOL_DEFAULT_MAX_BLOCKS,
+};
 
 #define USE_MEMFD
 
+/* position of the first block that starts after ptr */
+static uint32_t index_upper_bound(const void *ptr)
+{
+	uint32_t lo = 0, hi = _index.n_blocks;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if ((const uint8_t *) _index.blocks[mid]->mem.ptr <= (const uint8_t *) ptr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int index_add(struct memblock *m)
+{
+	uint32_t pos;
+
+	if (m->mem.ptr == NULL || m->indexed)
+		return 0;
+
+	if (_index.n_blocks == _index.max_blocks) {
+		uint32_t max_blocks = SPA_MAX(_index.max_blocks * 2, 64u);
+		struct memblock **blocks;
+
+		blocks = realloc(_index.blocks, max_blocks * sizeof(struct memblock *));
+		if (blocks == NULL)
+			return -ENOMEM;
+		_index.blocks = blocks;
+		_index.max_blocks = max_blocks;
+	}
+	pos = index_upper_bound(m->mem.ptr);
+	memmove(&_index.blocks[pos + 1], &_index.blocks[pos],
+		(_index.n_blocks - pos) * sizeof(struct memblock *));
+	_index.blocks[pos] = m;
+	_index.n_blocks++;
+	m->indexed = true;
+
+	return 0;
+}
+
+static void index_remove(struct memblock *m)
+{
+	uint32_t pos;
+
+	if (!m->indexed)
+		return;
+
+	/* blocks don't overlap, the one before the upper bound is m */
+	pos = index_upper_bound(m->mem.ptr) - 1;
+	if (_index.blocks[pos] != m) {
+		pw_log_error("mem %p: not found in index", &m->mem);
+		return;
+	}
+
+	memmove(&_index.blocks[pos], &_index.blocks[pos + 1],
+		(_index.n_blocks - pos - 1) * sizeof(struct memblock *));
+	_index.n_blocks--;
+	m->indexed = false;
+
+	if (_index.n_blocks == 0) {
+		free(_index.blocks);
+		_index.blocks = NULL;
+		_index.max_blocks = 0;
+	}
+}
+
 /** Map a memblock
  * \param mem a memblock
  * \return 0 on success, < 0 on error
@@ -212,8 +306,13 @@ int pw_memblock_alloc(enum pw_memblock_flags flags, size_t size, struct pw_membl
 	}
 
 	p = calloc(1, sizeof(struct memblock));
-	*p = tmp;
-	spa_list_append(&_memblocks, &p->link);
+	if (p == NULL)
+		goto no_mem;
+	p->mem = tmp.mem;
+	if (index_add(p) < 0) {
+		free(p);
+		goto no_mem;
+	}
 	*mem = &p->mem;
 	pw_log_debug("mem %p: alloc", *mem);
 
@@ -222,6 +321,15 @@ int pw_memblock_alloc(enum pw_memblock_flags flags, size_t size, struct pw_membl
       mmap_failed:
 	close(m->fd);
 	return -ENOMEM;
+      no_mem:
+	if (m->fd != -1) {
+		if (m->ptr)
+			munmap(m->ptr, (flags & PW_MEMBLOCK_FLAG_MAP_TWICE) ? m->size << 1 : m->size);
+		close(m->fd);
+	} else {
+		free(m->ptr);
+	}
+	return -ENOMEM;
 }
 
 int
@@ -241,7 +349,58 @@ pw_memblock_import(enum pw_memblock_flags flags,
 
 	pw_log_debug("mem %p: import", *mem);
 
-	return pw_memblock_map(*mem);
+	if ((res = pw_memblock_map(*mem)) < 0)
+		return res;
+
+	return index_add((struct memblock *) *mem);
+}
+
+static void memblock_free(struct memblock *m)
+{
+	struct pw_memblock *mem = &m->mem;
+
+	pw_log_debug("mem %p: free", mem);
+	index_remove(m);
+	if (mem->flags & PW_MEMBLOCK_FLAG_WITH_FD) {
+		if (mem->ptr)
+			munmap(mem->ptr, mem->size);
+		if (mem->fd != -1)
+			close(mem->fd);
+	} else {
+		free(mem->ptr);
+	}
+	free(m);
+}
+
+/* round up to a size class, there are 4 classes for each power of 2 */
+static size_t pool_class_size(size_t size)
+{
+	size_t base, step;
+
+	size = SPA_MAX(size, (size_t) 4096);
+	for (base = 4096; base * 2 < size; base <<= 1);
+	step = base / 4;
+
+	return SPA_ROUND_UP_N(size, step);
+}
+
+static void pool_release(struct memblock *m)
+{
+	_pool.stats.n_free--;
+	_pool.stats.free_size -= m->mem.size;
+	spa_list_remove(&m->link);
+	memblock_free(m);
+}
+
+static void pool_trim(size_t max_size, uint32_t max_blocks)
+{
+	struct memblock *m;
+
+	while (!spa_list_is_empty(&_pool.free) &&
+	       (_pool.stats.free_size > max_size || _pool.stats.n_free > max_blocks)) {
+		m = spa_list_last(&_pool.free, struct memblock, link);
+		pool_release(m);
+	}
 }
 
 /** Free a memblock
@@ -255,26 +414,203 @@ void pw_memblock_free(struct pw_memblock *mem)
 	if (mem == NULL)
 		return;
 
-	pw_log_debug("mem %p: free", mem);
-	if (mem->flags & PW_MEMBLOCK_FLAG_WITH_FD) {
-		if (mem->ptr)
-			munmap(mem->ptr, mem->size);
-		if (mem->fd != -1)
-			close(mem->fd);
-	} else {
-		free(mem->ptr);
+	if (m->pooled) {
+		spa_list_remove(&m->link);
+		if (mem->size <= _pool.max_size && _pool.max_blocks > 0) {
+			pw_log_debug("mem %p: release to pool", mem);
+			index_remove(m);
+			spa_list_prepend(&_pool.free, &m->link);
+			_pool.stats.n_free++;
+			_pool.stats.free_size += mem->size;
+			pool_trim(_pool.max_size, _pool.max_blocks);
+			return;
+		}
+		_pool.stats.drops++;
 	}
+
+	memblock_free(m);
+}
+
+static inline bool pool_is_private(struct memblock *m)
+{
+	return m->owner[0] == SPA_ID_INVALID && m->owner[1] == SPA_ID_INVALID;
+}
+
+static void pool_take(struct memblock *m, uint32_t owner, uint32_t peer)
+{
+	_pool.stats.hits++;
+	_pool.stats.n_free--;
+	_pool.stats.free_size -= m->mem.size;
 	spa_list_remove(&m->link);
-	free(mem);
+	spa_list_append(&_pool.used, &m->link);
+
+	/* nobody else has seen the memory yet, don't give the new owners what
+	 * was left in it */
+	if (m->owner[0] != owner || m->owner[1] != peer) {
+		memset(m->mem.ptr, 0, m->mem.size);
+		m->owner[0] = owner;
+		m->owner[1] = peer;
+	}
+}
+
+/** Allocate a memblock from the pool
+ * \param flags memblock flags
+ * \param size size to allocate
+ * \param owner global id of the first client that sees the memory or
+ *	SPA_ID_INVALID
+ * \param peer global id of the second client that sees the memory or
+ *	SPA_ID_INVALID
+ * \param[out] mem memblock structure to fill
+ * \return 0 on success, < 0 on error
+ *
+ * Allocate a memfd backed memblock. When the block is freed, the memfd is
+ * kept mapped in a pool and it is reused for a block of the same size class
+ * and the same \a owner and \a peer, who might still have it mapped. Blocks
+ * that were not seen by any client are cleared and reused for any owner.
+ * The size of the block is rounded up to the size class.
+ *
+ * Use pw_memblock_pool_purge() when a client goes away.
+ *
+ * \memberof pw_memblock
+ */
+int pw_memblock_alloc_pooled(enum pw_memblock_flags flags, size_t size,
+			     uint32_t owner, uint32_t peer,
+			     struct pw_memblock **mem)
+{
+	struct memblock *m, *found = NULL;
+	int res;
+
+	if (mem == NULL)
+		return -EINVAL;
+
+	if ((flags & PW_MEMBLOCK_FLAG_MAP_TWICE) || !(flags & PW_MEMBLOCK_FLAG_WITH_FD) ||
+	    (flags & PW_MEMBLOCK_FLAG_MAP_READWRITE) != PW_MEMBLOCK_FLAG_MAP_READWRITE)
+		return pw_memblock_alloc(flags, size, mem);
+
+	size = pool_class_size(size);
+
+	spa_list_for_each(m, &_pool.free, link) {
+		if (m->mem.size != size || m->mem.flags != flags)
+			continue;
+
+		if (m->owner[0] == owner && m->owner[1] == peer) {
+			found = m;
+			break;
+		}
+		if (found == NULL && pool_is_private(m))
+			found = m;
+	}
+	if (found != NULL) {
+		if (index_add(found) < 0)
+			return -ENOMEM;
+
+		pool_take(found, owner, peer);
+		*mem = &found->mem;
+		pw_log_debug("mem %p: reuse %zd", *mem, size);
+		return 0;
+	}
+
+	_pool.stats.misses++;
+	if ((res = pw_memblock_alloc(flags, size, mem)) < 0)
+		return res;
+
+	m = (struct memblock *) *mem;
+	m->pooled = true;
+	m->owner[0] = owner;
+	m->owner[1] = peer;
+	spa_list_append(&_pool.used, &m->link);
+
+	return 0;
+}
+
+/** Remove the memory of a client from the pool
+ * \param owner the global id of the client
+ *
+ * The free blocks that \a owner has seen are freed, the blocks in use are
+ * freed instead of going back to the pool. Call this when the client is
+ * destroyed, before its global id can be reused.
+ *
+ * \memberof pw_memblock
+ */
+void pw_memblock_pool_purge(uint32_t owner)
+{
+	struct memblock *m, *t;
+
+	if (owner == SPA_ID_INVALID)
+		return;
+
+	spa_list_for_each_safe(m, t, &_pool.free, link) {
+		if (m->owner[0] == owner || m->owner[1] == owner)
+			pool_release(m);
+	}
+	spa_list_for_each_safe(m, t, &_pool.used, link) {
+		if (m->owner[0] == owner || m->owner[1] == owner) {
+			m->pooled = false;
+			spa_list_remove(&m->link);
+		}
+	}
 }
 
+/** Set the limits of the memblock pool
+ * \param max_size max size of the free memory kept in the pool
+ * \param max_blocks max number of free blocks kept in the pool
+ *
+ * Use 0 to disable the pool.
+ * \memberof pw_memblock
+ */
+void pw_memblock_pool_set_limits(size_t max_size, uint32_t max_blocks)
+{
+	_pool.max_size = max_size;
+	_pool.max_blocks = max_blocks;
+	pool_trim(max_size, max_blocks);
+}
+
+/** Get the limits of the memblock pool
+ * \param[out] max_size max size of the free memory kept in the pool
+ * \param[out] max_blocks max number of free blocks kept in the pool
+ * \memberof pw_memblock
+ */
+void pw_memblock_pool_get_limits(size_t *max_size, uint32_t *max_blocks)
+{
+	*max_size = _pool.max_size;
+	*max_blocks = _pool.max_blocks;
+}
+
+/** Get the statistics of the memblock pool
+ * \param[out] stats the statistics
+ * \memberof pw_memblock
+ */
+void pw_memblock_pool_get_stats(struct pw_memblock_pool_stats *stats)
+{
+	*stats = _pool.stats;
+}
+
+/** Free all blocks in the memblock pool
+ * \memberof pw_memblock
+ */
+void pw_memblock_pool_clear(void)
+{
+	pool_trim(0, 0);
+}
+
+/** Find the memblock that contains \a ptr
+ * \param ptr a pointer into a mapped memblock
+ * \return the memblock or NULL when \a ptr is not in a memblock
+ *
+ * The lookup is a binary search on the mapped blocks.
+ * \memberof pw_memblock
+ */
 struct pw_memblock * pw_memblock_find(const void *ptr)
 {
 	struct memblock *m;
+	uint32_t pos;
+
+	if ((pos = index_upper_bound(ptr)) == 0)
+		return NULL;
+
+	m = _index.blocks[pos - 1];
+	if ((const uint8_t *) ptr < (const uint8_t *) m->mem.ptr + m->mem.size)
+		return &m->mem;
 
-	spa_list_for_each(m, &_memblocks, link) {
-		if (ptr >= m->mem.ptr && ptr < m->mem.ptr + m->mem.size)
-			return &m->mem;
-	}
 	return NULL;
 }
@@ -62,6 +62,30 @@ pw_memblock_map(struct pw_memblock *mem);
 void
 pw_memblock_free(struct pw_memblock *mem);
 
+int
+pw_memblock_alloc_pooled(enum pw_memblock_flags flags, size_t size,
+			 uint32_t owner, uint32_t peer,
+			 struct pw_memblock **mem);
+
+/** Statistics of the memblock pool \memberof pw_memblock */
+struct pw_memblock_pool_stats {
+	uint64_t hits;		/**< allocations that reused a block */
+	uint64_t misses;	/**< allocations that made a new block */
+	uint64_t drops;		/**< freed blocks that did not fit in the pool */
+	uint32_t n_free;	/**< number of free blocks in the pool */
+	size_t free_size;	/**< size of the free blocks in the pool */
+};
+
+void pw_memblock_pool_set_limits(size_t max_size, uint32_t max_blocks);
+
+void pw_memblock_pool_get_limits(size_t *max_size, uint32_t *max_blocks);
+
+void pw_memblock_pool_get_stats(struct pw_memblock_pool_stats *stats);
+
+void pw_memblock_pool_clear(void);
+
+void pw_memblock_pool_purge(uint32_t owner);
+
 /** Find memblock for given \a ptr */
 struct pw_memblock * pw_memblock_find(const void *ptr);
 
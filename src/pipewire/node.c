@@ -192,6 +192,7 @@ int pw_node_update_ports(struct pw_node *node)
 {
 	uint32_t *input_port_ids, *output_port_ids;
 	uint32_t n_input_ports, n_output_ports, max_input_ports, max_output_ports;
+	bool changed = false;
 	int res;
 
 	res = spa_node_get_n_ports(node->node,
@@ -205,11 +206,15 @@ int pw_node_update_ports(struct pw_node *node)
 	if (node->info.max_input_ports != max_input_ports) {
 		node->info.max_input_ports = max_input_ports;
 		node->info.change_mask |= PW_NODE_CHANGE_MASK_INPUT_PORTS;
+		changed = true;
 	}
 	if (node->info.max_output_ports != max_output_ports) {
 		node->info.max_output_ports = max_output_ports;
 		node->info.change_mask |= PW_NODE_CHANGE_MASK_OUTPUT_PORTS;
+		changed = true;
 	}
+	if (node->registered && changed)
+		pw_core_index_node(node->core, node);
 
 	input_port_ids = alloca(sizeof(uint32_t) * n_input_ports);
 	output_port_ids = alloca(sizeof(uint32_t) * n_output_ports);
@@ -307,6 +312,8 @@ do_node_add(struct spa_loop *loop,
 	struct pw_node *this = user_data;
 
 	spa_graph_node_add(this->rt.graph, &this->rt.node);
+	if (this->rt.driver)
+		pw_driver_add_node(this->rt.driver, this);
 
 	return 0;
 }
@@ -346,6 +353,13 @@ int pw_node_register(struct pw_node *this,
 
 	pw_node_update_ports(this);
 
+	if (core->profiler &&
+	    (this->profile = pw_profiler_add_node(core->profiler, this->info.name)) != NULL)
+		this->rt.node.timing = &this->profile->timing;
+
+	if ((str = pw_properties_get(this->properties, PW_NODE_PROP_DRIVER)) != NULL)
+		this->driving = pw_properties_parse_bool(str);
+
 	pw_loop_invoke(this->data_loop, do_node_add, 1, NULL, 0, false, this);
 
 	if ((str = pw_properties_get(this->properties, "media.class")) != NULL)
@@ -354,6 +368,7 @@ int pw_node_register(struct pw_node *this,
 
 	spa_list_append(&core->node_list, &this->link);
 	this->registered = true;
+	pw_core_index_node(core, this);
 
 	this->global = pw_global_new(core,
 				     core->type.node, PW_VERSION_NODE,
@@ -367,6 +382,9 @@ int pw_node_register(struct pw_node *this,
 	pw_global_register(this->global, owner, parent);
 	this->info.id = this->global->id;
 
+	if (this->profile)
+		__atomic_store_n(&this->profile->id, this->info.id, __ATOMIC_RELEASE);
+
 	spa_list_for_each(port, &this->input_ports, link)
 		pw_port_register(port, owner, this->global,
 				 pw_properties_copy(port->properties));
@@ -399,6 +417,7 @@ struct pw_node *pw_node_new(struct pw_core *core,
 {
 	struct impl *impl;
 	struct pw_node *this;
+	struct pw_data_loop *loop;
 
 	impl = calloc(1, sizeof(struct impl) + user_data_size);
 	if (impl == NULL)
@@ -424,9 +443,12 @@ struct pw_node *pw_node_new(struct pw_core *core,
 	impl->work = pw_work_queue_new(this->core->main_loop);
 	this->info.name = strdup(name);
 
-	this->data_loop = core->data_loop;
+	loop = pw_core_find_data_loop(core,
+			pw_properties_get(properties, PW_NODE_PROP_LOOP_NAME));
+	this->data_loop = loop->loop;
 
-	this->rt.graph = &core->rt.graph;
+	this->rt.graph = &loop->graph;
+	this->rt.driver = loop->driver;
 
 	spa_list_init(&this->resource_list);
 
@@ -435,6 +457,9 @@ struct pw_node *pw_node_new(struct pw_core *core,
 	this->info.state = PW_NODE_STATE_CREATING;
 	this->info.props = &this->properties->dict;
 
+	spa_list_init(&this->class_link[SPA_DIRECTION_INPUT]);
+	spa_list_init(&this->class_link[SPA_DIRECTION_OUTPUT]);
+
 	spa_list_init(&this->input_ports);
 	pw_map_init(&this->input_port_map, 64, 64);
 	spa_list_init(&this->output_ports);
@@ -484,6 +509,9 @@ int pw_node_update_properties(struct pw_node *node, const struct spa_dict *dict)
 
 	check_properties(node);
 
+	if (node->registered)
+		pw_core_index_node(node->core, node);
+
 	node->info.props = &node->properties->dict;
 
 	node->info.change_mask |= PW_NODE_CHANGE_MASK_PROPS;
@@ -507,6 +535,91 @@ static void node_done(void *data, int seq, int res)
 	pw_node_events_async_complete(node, seq, res);
 }
 
+/* called from the data thread, count the xrun and let the main thread
+ * report it and emit the event */
+static void node_xrun(struct pw_node *node, struct spa_event_node_xrun *xrun)
+{
+	struct spa_graph_port *p;
+	uint32_t direction = xrun->body.direction.value;
+	uint32_t port_id = xrun->body.port_id.value;
+	uint64_t time = xrun->body.time.value;
+
+	pw_log_trace("node %p: xrun on port %d:%d delay %"PRIu64, node,
+		     direction, port_id, xrun->body.delay.value);
+
+	if (direction <= SPA_DIRECTION_OUTPUT) {
+		spa_list_for_each(p, &node->rt.node.ports[direction], link) {
+			struct pw_port *port = p->scheduler_data;
+
+			if (p->port_id != port_id)
+				continue;
+
+			__atomic_store_n(&port->rt.xrun_time, time, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&port->rt.xruns, 1, __ATOMIC_RELAXED);
+			break;
+		}
+	}
+	__atomic_store_n(&node->rt.xrun_time, time, __ATOMIC_RELAXED);
+	__atomic_store_n(&node->rt.xrun_direction, direction, __ATOMIC_RELAXED);
+	__atomic_store_n(&node->rt.xrun_port_id, port_id, __ATOMIC_RELAXED);
+	__atomic_store_n(&node->rt.xrun_delay, xrun->body.delay.value, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&node->rt.xruns, 1, __ATOMIC_RELAXED);
+
+	if (node->rt.node.timing)
+		spa_graph_node_timing_xrun(node->rt.node.timing);
+
+	/* only wake up the main thread when it saw the previous xruns */
+	if (!__atomic_exchange_n(&node->rt.xrun_pending, true, __ATOMIC_ACQ_REL))
+		pw_loop_signal_event(node->core->main_loop, node->core->xrun_event);
+}
+
+uint64_t pw_node_report_xruns(struct pw_node *node, uint64_t now)
+{
+	struct pw_resource *resource;
+	struct pw_port *port;
+	struct spa_event_node_xrun xrun;
+
+	if (!__atomic_load_n(&node->rt.xrun_pending, __ATOMIC_ACQUIRE))
+		return 0;
+
+	if (node->xrun_report_time != 0 &&
+	    now < node->xrun_report_time + PW_NODE_XRUN_REPORT_INTERVAL)
+		return node->xrun_report_time + PW_NODE_XRUN_REPORT_INTERVAL - now;
+
+	/* clear before reading the counters so that new xruns are not missed */
+	__atomic_store_n(&node->rt.xrun_pending, false, __ATOMIC_SEQ_CST);
+	node->xrun_report_time = now;
+
+	spa_list_for_each(port, &node->input_ports, link)
+		pw_port_report_xruns(port);
+	spa_list_for_each(port, &node->output_ports, link)
+		pw_port_report_xruns(port);
+
+	node->info.n_xruns = __atomic_load_n(&node->rt.xruns, __ATOMIC_RELAXED);
+	node->info.xrun_time = __atomic_load_n(&node->rt.xrun_time, __ATOMIC_RELAXED);
+
+	pw_log_debug("node %p: %u xruns, last at %"PRIu64, node,
+		     node->info.n_xruns, node->info.xrun_time);
+
+	node->info.change_mask |= PW_NODE_CHANGE_MASK_XRUNS;
+	pw_node_events_info_changed(node, &node->info);
+
+	spa_list_for_each(resource, &node->resource_list, link)
+		pw_node_resource_info(resource, &node->info);
+
+	node->info.change_mask = 0;
+
+	/* the last xrun, the listeners run in the main thread */
+	xrun = SPA_EVENT_NODE_XRUN_INIT(node->core->type.event_node.Xrun,
+			__atomic_load_n(&node->rt.xrun_direction, __ATOMIC_RELAXED),
+			__atomic_load_n(&node->rt.xrun_port_id, __ATOMIC_RELAXED),
+			node->info.xrun_time,
+			__atomic_load_n(&node->rt.xrun_delay, __ATOMIC_RELAXED));
+	pw_node_events_event(node, (struct spa_event *) &xrun);
+
+	return 0;
+}
+
 static void node_event(void *data, struct spa_event *event)
 {
 	struct pw_node *node = data;
@@ -515,6 +628,12 @@ static void node_event(void *data, struct spa_event *event)
         if (SPA_EVENT_TYPE(event) == node->core->type.event_node.RequestClockUpdate) {
                 send_clock_update(node);
         }
+	else if (SPA_EVENT_TYPE(event) == node->core->type.event_node.Xrun) {
+		/* emitted from the data thread, pw_node_report_xruns() emits
+		 * it from the main thread */
+		node_xrun(node, (struct spa_event_node_xrun *) event);
+		return;
+	}
 	pw_node_events_event(node, event);
 }
 
@@ -523,14 +642,20 @@ static void node_need_input(void *data)
 	struct pw_node *node = data;
 	pw_log_trace("node %p: need input", node);
 	pw_node_events_need_input(node);
-	spa_graph_need_input(node->rt.graph, &node->rt.node);
+	if (node->rt.driver && node->rt.driver->rt.node == node)
+		pw_driver_cycle(node->rt.driver, node, SPA_DIRECTION_INPUT);
+	else
+		spa_graph_need_input(node->rt.graph, &node->rt.node);
 }
 
 static void node_have_output(void *data)
 {
 	struct pw_node *node = data;
 	pw_log_trace("node %p: have output", node);
-	spa_graph_have_output(node->rt.graph, &node->rt.node);
+	if (node->rt.driver && node->rt.driver->rt.node == node)
+		pw_driver_cycle(node->rt.driver, node, SPA_DIRECTION_OUTPUT);
+	else
+		spa_graph_have_output(node->rt.graph, &node->rt.node);
 	pw_node_events_have_output(node);
 }
 
@@ -592,6 +717,8 @@ do_node_remove(struct spa_loop *loop,
 
 	pause_node(this);
 
+	if (this->rt.driver)
+		pw_driver_remove_node(this->rt.driver, this);
 	spa_graph_node_remove(&this->rt.node);
 
 	return 0;
@@ -617,6 +744,13 @@ void pw_node_destroy(struct pw_node *node)
 	if (node->registered) {
 		pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
 		spa_list_remove(&node->link);
+		pw_core_unindex_node(node->core, node);
+
+		if (node->profile) {
+			pw_profiler_remove_node(node->core->profiler, node->profile);
+			node->profile = NULL;
+			node->rt.node.timing = NULL;
+		}
 	}
 
 	pw_log_debug("node %p: unlink ports", node);
@@ -104,6 +104,11 @@ struct pw_node_events {
 #define PW_NODE_PROP_AUTOCONNECT	"pipewire.autoconnect"
 /** Try to connect the node to this node id */
 #define PW_NODE_PROP_TARGET_NODE	"pipewire.target.node"
+/** The name of the data loop of the node, see PW_CORE_PROP_DATA_LOOPS */
+#define PW_NODE_PROP_LOOP_NAME		"node.loop.name"
+/** The node drives the cycles of its data loop with its own timing instead
+ * of the system timer, see PW_CORE_PROP_QUANTUM */
+#define PW_NODE_PROP_DRIVER		"node.driver"
 
 /** Create a new node \memberof pw_node */
 struct pw_node *
@@ -95,7 +95,8 @@ static const struct spa_handle_factory *get_factory(struct support_info *info, c
 static void *
 load_interface(struct support_info *info,
 	       const char *factory_name,
-	       const char *type)
+	       const char *type,
+	       const struct spa_dict *props)
 {
         int res;
         struct spa_handle *handle;
@@ -110,7 +111,7 @@ load_interface(struct support_info *info,
 
         handle = calloc(1, factory->size);
         if ((res = spa_handle_factory_init(factory,
-                                           handle, NULL, info->support, info->n_support)) < 0) {
+                                           handle, props, info->support, info->n_support)) < 0) {
                 fprintf(stderr, "can't make factory instance: %d\n", res);
                 goto init_failed;
         }
@@ -187,7 +188,7 @@ void *pw_get_spa_dbus(struct pw_loop *loop)
 		str = PLUGINDIR;
 
 	if (open_support(str, "support/libspa-dbus", &dbus_support_info))
-		return load_interface(&dbus_support_info, "dbus", SPA_TYPE__DBus);
+		return load_interface(&dbus_support_info, "dbus", SPA_TYPE__DBus, NULL);
 
 	return NULL;
 }
@@ -200,7 +201,9 @@ void *pw_get_spa_dbus(struct pw_loop *loop)
  * Initialize the PipeWire system, parse and modify any parameters given
  * by \a argc and \a argv and set up debugging.
  *
- * The environment variable \a PIPEWIRE_DEBUG
+ * The environment variable \a PIPEWIRE_DEBUG configures the log level
+ * and the debug categories. Setting \a PIPEWIRE_TRACE to "binary" records
+ * trace messages without formatting them in the calling thread.
  *
  * \memberof pw_pipewire
  */
@@ -209,6 +212,8 @@ void pw_init(int *argc, char **argv[])
 	const char *str;
 	void *iface;
 	struct support_info *info = &support_info;
+	struct spa_dict_item items[1];
+	struct spa_dict log_props = SPA_DICT_INIT(items, 0);
 
 	if ((str = getenv("PIPEWIRE_DEBUG")))
 		configure_debug(str);
@@ -220,11 +225,14 @@ void pw_init(int *argc, char **argv[])
 		return;
 
 	if (open_support(str, "support/libspa-support", info)) {
-		iface = load_interface(info, "mapper", SPA_TYPE__TypeMap);
+		iface = load_interface(info, "mapper", SPA_TYPE__TypeMap, NULL);
 		if (iface != NULL)
 			info->support[info->n_support++] = SPA_SUPPORT_INIT(SPA_TYPE__TypeMap, iface);
 
-		iface = load_interface(info, "logger", SPA_TYPE__Log);
+		if ((str = getenv("PIPEWIRE_TRACE")))
+			items[log_props.n_items++] = SPA_DICT_ITEM_INIT(SPA_LOG_PROP_TRACE, str);
+
+		iface = load_interface(info, "logger", SPA_TYPE__Log, &log_props);
 		if (iface != NULL) {
 			info->support[info->n_support++] = SPA_SUPPORT_INIT(SPA_TYPE__Log, iface);
 			pw_log_set(iface);
@@ -22,14 +22,39 @@
 #include <errno.h>
 
 #include <spa/pod/parser.h>
+#include <spa/pod/filter.h>
 
 #include "pipewire/pipewire.h"
 #include "pipewire/private.h"
 #include "pipewire/port.h"
 
 /** \cond */
+#define MAX_PARAM_CACHE	2
+
+/** all params of one id, enumerated without filter */
+struct param_cache {
+	uint32_t id;
+	uint32_t node_serial;		/**< param_serial of the node when filled */
+	uint32_t n_params;
+	struct spa_pod **params;
+};
+
 struct impl {
 	struct pw_port this;
+
+	uint32_t serial;		/**< changes when the cached params change */
+	uint32_t n_caches;
+	struct param_cache caches[MAX_PARAM_CACHE];
+
+	/* last format negotiated with an input port, only on output ports */
+	struct {
+		struct pw_port *input;
+		uint32_t out_serial;
+		uint32_t in_serial;
+		uint32_t out_node_serial;
+		uint32_t in_node_serial;
+		struct spa_pod *format;
+	} memo;
 };
 
 struct resource_data {
@@ -49,6 +74,33 @@ static void port_update_state(struct pw_port *port, enum pw_port_state state)
 	}
 }
 
+static uint32_t param_serial;
+
+static void free_param_cache(struct param_cache *c)
+{
+	uint32_t i;
+
+	for (i = 0; i < c->n_params; i++)
+		free(c->params[i]);
+	free(c->params);
+	c->n_params = 0;
+	c->params = NULL;
+}
+
+static void clear_param_cache(struct impl *impl)
+{
+	uint32_t i;
+
+	for (i = 0; i < impl->n_caches; i++)
+		free_param_cache(&impl->caches[i]);
+	impl->n_caches = 0;
+
+	free(impl->memo.format);
+	spa_zero(impl->memo);
+
+	impl->serial = ++param_serial;
+}
+
 static int schedule_tee_input(struct spa_node *data)
 {
 	struct pw_port *this = SPA_CONTAINER_OF(data, struct pw_port, mix_node);
@@ -181,6 +233,8 @@ struct pw_port *pw_port_new(enum pw_direction direction,
 	if (properties == NULL)
 		goto no_mem;
 
+	impl->serial = ++param_serial;
+
 	this->direction = direction;
 	this->port_id = port_id;
 	this->properties = properties;
@@ -530,6 +584,7 @@ static void pw_port_remove(struct pw_port *port)
 
 void pw_port_destroy(struct pw_port *port)
 {
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
 	struct pw_node *node = port->node;
 	struct pw_control *control, *ctemp;
 	struct pw_resource *resource, *tmp;
@@ -556,6 +611,7 @@ void pw_port_destroy(struct pw_port *port)
 	pw_log_debug("port %p: free", port);
 	pw_port_events_free(port);
 
+	clear_param_cache(impl);
 	free_allocation(&port->allocation);
 
 	pw_map_clear(&port->mix_port_map);
@@ -581,6 +637,177 @@ int pw_port_send_command(struct pw_port *port, bool block, const struct spa_comm
 			command, SPA_POD_SIZE(command), block, port);
 }
 
+static bool param_is_cached(struct pw_port *port, uint32_t id)
+{
+	struct pw_type *t = &port->node->core->type;
+	return id == t->param.idEnumFormat || id == t->param.idList;
+}
+
+static struct param_cache *get_param_cache(struct impl *impl, uint32_t id)
+{
+	struct pw_port *port = &impl->this;
+	struct param_cache *c;
+	uint8_t buf[4096];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *param;
+	uint32_t i, index = 0;
+	int res;
+
+	for (i = 0; i < impl->n_caches; i++) {
+		c = &impl->caches[i];
+		if (c->id != id)
+			continue;
+		if (c->node_serial == port->node->param_serial)
+			return c;
+		/* a format was set on the node, the enumeration can be
+		 * different now, refill the cache */
+		free_param_cache(c);
+		goto fill;
+	}
+	if (impl->n_caches == MAX_PARAM_CACHE)
+		return NULL;
+
+	c = &impl->caches[impl->n_caches++];
+	c->id = id;
+	c->n_params = 0;
+	c->params = NULL;
+
+      fill:
+	c->node_serial = port->node->param_serial;
+
+	while (true) {
+		struct spa_pod **params;
+
+		spa_pod_builder_init(&b, buf, sizeof(buf));
+		if ((res = spa_node_port_enum_params(port->node->node,
+						     port->direction, port->port_id,
+						     id, &index, NULL, &param, &b)) <= 0)
+			break;
+
+		if ((params = realloc(c->params, (c->n_params + 1) * sizeof(struct spa_pod *))) == NULL) {
+			res = -ENOMEM;
+			break;
+		}
+		c->params = params;
+		c->params[c->n_params++] = pw_spa_pod_copy(param);
+	}
+	if (res < 0) {
+		free_param_cache(c);
+		/* keep the slot, it's filled again on the next call */
+		c->node_serial = port->node->param_serial - 1;
+		return NULL;
+	}
+	pw_log_debug("port %p: cached %d params of %s", port, c->n_params,
+		     spa_type_map_get_type(port->node->core->type.map, id));
+
+	return c;
+}
+
+/** Enumerate the params of a port
+ *
+ * Like spa_node_port_enum_params() but the enumerations that don't change
+ * when the port is configured, like EnumFormat, are cached in the port
+ * and filtered with spa_pod_filter(). The cache is cleared with
+ * pw_port_params_changed() and refilled when the param_serial of the
+ * node changed, which happens when a format is set on any port of the
+ * node or when the node params change.
+ */
+int pw_port_enum_params(struct pw_port *port, uint32_t id, uint32_t *index,
+			const struct spa_pod *filter, struct spa_pod **param,
+			struct spa_pod_builder *builder)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+	struct param_cache *c;
+
+	if (!param_is_cached(port, id) || (c = get_param_cache(impl, id)) == NULL)
+		return spa_node_port_enum_params(port->node->node,
+						 port->direction, port->port_id,
+						 id, index, filter, param, builder);
+
+	while (*index < c->n_params) {
+		struct spa_pod *p = c->params[(*index)++];
+
+		if (spa_pod_filter(builder, param, p, filter) >= 0)
+			return 1;
+	}
+	return 0;
+}
+
+/** The enumerated params of a port changed
+ *
+ * Clears the cached params and the negotiated format and notifies the
+ * listeners with the PW_PORT_CHANGE_MASK_ENUM_PARAMS change flag.
+ */
+void pw_port_params_changed(struct pw_port *port)
+{
+	struct impl *impl = SPA_CONTAINER_OF(port, struct impl, this);
+	struct pw_resource *resource;
+
+	pw_log_debug("port %p: params changed", port);
+
+	clear_param_cache(impl);
+
+	port->info.change_mask |= PW_PORT_CHANGE_MASK_ENUM_PARAMS;
+	pw_port_events_info_changed(port, &port->info);
+
+	spa_list_for_each(resource, &port->resource_list, link)
+		pw_port_resource_info(resource, &port->info);
+
+	port->info.change_mask = 0;
+}
+
+void pw_port_report_xruns(struct pw_port *port)
+{
+	struct pw_resource *resource;
+	uint32_t xruns = __atomic_load_n(&port->rt.xruns, __ATOMIC_RELAXED);
+
+	if (xruns == port->info.n_xruns)
+		return;
+
+	port->info.n_xruns = xruns;
+	port->info.xrun_time = __atomic_load_n(&port->rt.xrun_time, __ATOMIC_RELAXED);
+
+	port->info.change_mask |= PW_PORT_CHANGE_MASK_XRUNS;
+	pw_port_events_info_changed(port, &port->info);
+
+	spa_list_for_each(resource, &port->resource_list, link)
+		pw_port_resource_info(resource, &port->info);
+
+	port->info.change_mask = 0;
+}
+
+/** Get the format that was last negotiated between \a output and \a input
+ * when the params of both ports didn't change since then */
+const struct spa_pod *pw_port_get_format_memo(struct pw_port *output, struct pw_port *input)
+{
+	struct impl *out = SPA_CONTAINER_OF(output, struct impl, this);
+	struct impl *in = SPA_CONTAINER_OF(input, struct impl, this);
+
+	if (out->memo.format == NULL || out->memo.input != input ||
+	    out->memo.out_serial != out->serial || out->memo.in_serial != in->serial ||
+	    out->memo.out_node_serial != output->node->param_serial ||
+	    out->memo.in_node_serial != input->node->param_serial)
+		return NULL;
+
+	return out->memo.format;
+}
+
+/** Remember the format negotiated between \a output and \a input */
+void pw_port_set_format_memo(struct pw_port *output, struct pw_port *input,
+			     const struct spa_pod *format)
+{
+	struct impl *out = SPA_CONTAINER_OF(output, struct impl, this);
+	struct impl *in = SPA_CONTAINER_OF(input, struct impl, this);
+
+	free(out->memo.format);
+	out->memo.input = input;
+	out->memo.out_serial = out->serial;
+	out->memo.in_serial = in->serial;
+	out->memo.out_node_serial = output->node->param_serial;
+	out->memo.in_node_serial = input->node->param_serial;
+	out->memo.format = pw_spa_pod_copy(format);
+}
+
 int pw_port_for_each_param(struct pw_port *port,
 			   uint32_t param_id,
 			   uint32_t index, uint32_t max,
@@ -594,7 +821,6 @@ int pw_port_for_each_param(struct pw_port *port,
 	uint8_t buf[4096];
 	struct spa_pod_builder b = { 0 };
 	uint32_t idx, count;
-	struct pw_node *node = port->node;
 	struct spa_pod *param;
 
 	if (max == 0)
@@ -603,10 +829,8 @@ int pw_port_for_each_param(struct pw_port *port,
 	for (count = 0; count < max; count++) {
 		spa_pod_builder_init(&b, buf, sizeof(buf));
 		idx = index;
-		if ((res = spa_node_port_enum_params(node->node,
-						     port->direction, port->port_id,
-						     param_id, &index,
-						     filter, &param, &b)) <= 0)
+		if ((res = pw_port_enum_params(port, param_id, &index,
+					       filter, &param, &b)) <= 0)
 			break;
 
 		if ((res = callback(data, param_id, idx, index, param)) != 0)
@@ -666,6 +890,9 @@ int pw_port_set_param(struct pw_port *port, uint32_t id, uint32_t flags,
 			spa_type_map_get_type(t->map, id), res, spa_strerror(res));
 
 	if (id == t->param.idFormat) {
+		/* the enumerated params of all ports can depend on the format */
+		node->param_serial++;
+
 		if (param == NULL || res < 0) {
 			free_allocation(&port->allocation);
 			port->allocated = false;
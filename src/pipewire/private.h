@@ -51,6 +51,44 @@ struct pw_command {
         int n_args;
 };
 
+/** Translation of the type ids of a peer to local type ids */
+struct pw_type_remap {
+	struct pw_array ids;		/**< local type id for each peer type id */
+	bool identity;			/**< the peer type ids are the local ids, only
+					  *  after the peer sent its types */
+};
+
+static inline void pw_type_remap_init(struct pw_type_remap *remap)
+{
+	pw_array_init(&remap->ids, 64 * sizeof(uint32_t));
+	remap->identity = false;
+}
+
+static inline void pw_type_remap_clear(struct pw_type_remap *remap)
+{
+	pw_array_clear(&remap->ids);
+	pw_type_remap_init(remap);
+}
+
+static inline bool pw_type_remap_insert(struct pw_type_remap *remap, uint32_t id, uint32_t local_id)
+{
+	uint32_t *p, n_ids = pw_array_get_len(&remap->ids, uint32_t);
+
+	if (id > n_ids)
+		return false;
+	else if (id == n_ids) {
+		if ((p = pw_array_add(&remap->ids, sizeof(uint32_t))) == NULL)
+			return false;
+	}
+	else
+		p = pw_array_get_unchecked(&remap->ids, id, uint32_t);
+
+	*p = local_id;
+	/* nothing can be used as is until the first type is known */
+	remap->identity = (remap->identity || n_ids == 0) && id == local_id;
+	return true;
+}
+
 #define pw_protocol_events_destroy(p) spa_hook_list_call(&p->listener_list, struct pw_protocol_events, destroy, 0)
 
 struct pw_protocol {
@@ -106,7 +144,7 @@ struct pw_client {
 
 	struct pw_map objects;		/**< list of resource objects */
 	uint32_t n_types;		/**< number of client types */
-	struct pw_map types;		/**< map of client types */
+	struct pw_type_remap types;	/**< client types to core types */
 
 	struct spa_list resource_list;	/**< The list of resources of this client */
 
@@ -173,6 +211,7 @@ struct pw_core {
 	struct spa_list global_list;		/**< list of globals */
 	struct spa_list client_list;		/**< list of clients */
 	struct spa_list node_list;		/**< list of nodes */
+	struct spa_list node_class_list;	/**< index of nodes by media class */
 	struct spa_list factory_list;		/**< list of factories */
 	struct spa_list link_list;		/**< list of links */
 	struct spa_list control_list[2];	/**< list of controls, indexed by direction */
@@ -182,6 +221,7 @@ struct pw_core {
 	struct pw_loop *main_loop;	/**< main loop for control */
 	struct pw_loop *data_loop;	/**< data loop for data passing */
         struct pw_data_loop *data_loop_impl;
+	struct spa_list data_loop_list;	/**< list of data loops, the default loop first */
 
 	struct spa_support support[16];	/**< support for spa plugins */
 	uint32_t n_support;		/**< number of support items */
@@ -191,8 +231,17 @@ struct pw_core {
 	long sc_pagesize;
 
 	struct {
-		struct spa_graph graph;
+		struct spa_graph_plan *plan;	/**< execution plan when using the plan scheduler */
+		struct pw_executor *executor;	/**< runs the plan on worker threads */
 	} rt;
+
+	struct pw_profiler *profiler;	/**< timing of the nodes or NULL */
+
+	uint32_t quantum;		/**< samples per cycle, 0 without drivers */
+	uint32_t rate;			/**< sample rate of the quantum */
+
+	struct spa_source *xrun_event;	/**< signaled by the data thread on xruns */
+	struct spa_source *xrun_timer;	/**< for delayed xrun reports */
 };
 
 #define pw_data_loop_events_emit(o,m,v,...) spa_hook_list_call(&o->listener_list, struct pw_data_loop_events, m, v, ##__VA_ARGS__)
@@ -200,6 +249,11 @@ struct pw_core {
 
 struct pw_data_loop {
         struct pw_loop *loop;
+	struct spa_list link;		/**< link in core data_loop_list */
+
+	char *name;			/**< name of the loop */
+	char *cpus;			/**< list of CPUs to run on or NULL */
+	int rt_prio;			/**< realtime priority */
 
 	struct spa_hook_list listener_list;
 
@@ -207,11 +261,37 @@ struct pw_data_loop {
 
         bool running;
         pthread_t thread;
+
+	struct spa_graph graph;		/**< graph of the nodes in this loop */
+	struct pw_driver *driver;	/**< starts the cycles of the graph or NULL */
+
+	struct spa_support support[16];	/**< support for plugins that run in this loop */
+	uint32_t n_support;
 };
 
 #define pw_main_loop_events_emit(o,m,v,...) spa_hook_list_call(&o->listener_list, struct pw_main_loop_events, m, v, ##__VA_ARGS__)
 #define pw_main_loop_events_destroy(o) pw_main_loop_events_emit(o, destroy, 0)
 
+/** the driver of a data loop, starts a cycle of the graph every quantum */
+struct pw_driver {
+	struct pw_core *core;
+	struct pw_data_loop *loop;
+
+	uint64_t period;		/**< duration of a quantum in nanoseconds */
+
+	struct pw_profiler_node *profile;	/**< slot in the profiler of the core */
+	struct spa_graph_node_timing timing;	/**< cycle timing without profiler */
+
+	struct {
+		struct spa_list nodes;		/**< nodes in the loop */
+		struct pw_node *node;		/**< driver node or NULL for the timer */
+		struct spa_source *timer;	/**< system timer */
+		bool timer_running;
+		uint64_t next;			/**< expected start of the next cycle */
+		struct spa_graph_node_timing *timing;
+	} rt;
+};
+
 struct pw_main_loop {
         struct pw_loop *loop;
 
@@ -321,9 +401,19 @@ struct pw_module {
 #define pw_node_events_reuse_buffer(n,p,b)	pw_node_events_emit(n, reuse_buffer, 0, p, b)
 #define pw_node_events_finish(n)		pw_node_events_emit(n, finish, 0)
 
+/** the registered nodes with the same media class */
+struct pw_node_class {
+	struct spa_list link;		/**< link in core node_class_list */
+	char *media_class;		/**< the media class or NULL */
+	uint32_t n_nodes;		/**< number of nodes with this class */
+	struct spa_list nodes[2];	/**< nodes with ports, indexed by direction */
+};
+
 struct pw_node {
 	struct pw_core *core;		/**< core object */
 	struct spa_list link;		/**< link in core node_list */
+	struct pw_node_class *node_class;	/**< media class index entry */
+	struct spa_list class_link[2];	/**< link in node_class nodes */
 	struct pw_global *global;	/**< global for this node */
 	struct spa_hook global_listener;
 	bool registered;
@@ -335,6 +425,7 @@ struct pw_node {
 	bool enabled;			/**< if the node is enabled */
 	bool active;			/**< if the node is active */
 	bool live;			/**< if the node is live */
+	bool driving;			/**< if the node can drive its data loop */
 	struct spa_clock *clock;	/**< handle to SPA clock if any */
 	struct spa_node *node;		/**< SPA node implementation */
 
@@ -350,6 +441,9 @@ struct pw_node {
 	uint32_t n_used_output_links;		/**< number of active output links */
 	uint32_t idle_used_output_links;	/**< number of active output to be idle */
 
+	uint32_t param_serial;			/**< changes when a format is set on a port
+						  *  or when the node params change */
+
 	struct spa_hook_list listener_list;
 
 	struct pw_loop *data_loop;		/**< the data loop for this node */
@@ -357,8 +451,20 @@ struct pw_node {
 	struct {
 		struct spa_graph *graph;
 		struct spa_graph_node node;
+		struct pw_driver *driver;	/**< driver of the data loop or NULL */
+		struct spa_list driver_link;	/**< link in the nodes of the driver */
+		uint32_t xruns;			/**< number of xruns */
+		uint64_t xrun_time;		/**< time of the last xrun */
+		uint32_t xrun_direction;	/**< port direction of the last xrun */
+		uint32_t xrun_port_id;		/**< port of the last xrun */
+		uint64_t xrun_delay;		/**< delay of the last xrun */
+		bool xrun_pending;		/**< xruns not reported yet */
 	} rt;
 
+	uint64_t xrun_report_time;		/**< when the xruns were last reported */
+
+	struct pw_profiler_node *profile;	/**< slot in the profiler of the core */
+
         void *user_data;                /**< extra user data */
 };
 
@@ -411,6 +517,8 @@ struct pw_port {
 		struct spa_graph_port port;	/**< this graph port, linked to mix_port */
 		struct spa_graph_port mix_port;	/**< port from the mixer */
 		struct spa_graph_node mix_node;	/**< mixer node */
+		uint32_t xruns;			/**< number of xruns, read atomically */
+		uint64_t xrun_time;		/**< time of the last xrun */
 	} rt;					/**< data only accessed from the data thread */
 
         void *user_data;                /**< extra user data */
@@ -476,7 +584,7 @@ struct pw_remote {
         struct pw_core_info *info;		/**< info about the remote core */
 
 	uint32_t n_types;			/**< number of client types */
-	struct pw_map types;			/**< client types */
+	struct pw_type_remap types;		/**< core types to client types */
 
 	struct spa_list proxy_list;		/**< list of \ref pw_proxy objects */
 	struct spa_list stream_list;		/**< list of \ref pw_stream objects */
@@ -583,6 +691,25 @@ int pw_core_find_format(struct pw_core *core,
 			struct spa_pod_builder *builder,
 			char **error);
 
+/** Add or update \a node in the media class index \memberof pw_core */
+void pw_core_index_node(struct pw_core *core, struct pw_node *node);
+
+/** Remove \a node from the media class index \memberof pw_core */
+void pw_core_unindex_node(struct pw_core *core, struct pw_node *node);
+
+/** Report the xruns of the nodes, called from the main thread \memberof pw_core */
+void pw_core_report_xruns(struct pw_core *core);
+
+/** Find the data loop with \a name, the default loop when \a name is NULL
+ * or unknown \memberof pw_core */
+struct pw_data_loop *pw_core_find_data_loop(struct pw_core *core, const char *name);
+
+/** Get the support for a plugin that runs in the data loop that is
+ * selected by the node.loop.name in \a props \memberof pw_core */
+const struct spa_support *pw_core_get_node_support(struct pw_core *core,
+						   const struct spa_dict *props,
+						   uint32_t *n_support);
+
 /** Find a ports compatible with \a other_port and the format filters */
 struct pw_port *
 pw_core_find_port(struct pw_core *core,
@@ -639,6 +766,24 @@ int pw_port_for_each_filtered_param(struct pw_port *in_port,
 						     struct spa_pod *param),
 				    void *data);
 
+/** Enumerate params of a port, using the cached params when possible \memberof pw_port */
+int pw_port_enum_params(struct pw_port *port, uint32_t id, uint32_t *index,
+			const struct spa_pod *filter, struct spa_pod **param,
+			struct spa_pod_builder *builder);
+
+/** Clear the cached params of a port \memberof pw_port */
+void pw_port_params_changed(struct pw_port *port);
+
+/** Update the info of a port with the xruns counted by the data thread \memberof pw_port */
+void pw_port_report_xruns(struct pw_port *port);
+
+/** Get the last negotiated format between two ports or NULL \memberof pw_port */
+const struct spa_pod *pw_port_get_format_memo(struct pw_port *output, struct pw_port *input);
+
+/** Remember the format negotiated between two ports \memberof pw_port */
+void pw_port_set_format_memo(struct pw_port *output, struct pw_port *input,
+			     const struct spa_pod *format);
+
 /** Set a param on a port \memberof pw_port */
 int pw_port_set_param(struct pw_port *port, uint32_t id, uint32_t flags,
 		      const struct spa_pod *param);
@@ -662,6 +807,14 @@ void pw_node_update_state(struct pw_node *node, enum pw_node_state state, char *
 
 int pw_node_update_ports(struct pw_node *node);
 
+/** Minimum time between two xrun reports of a node */
+#define PW_NODE_XRUN_REPORT_INTERVAL	(1 * SPA_NSEC_PER_SEC)
+
+/** Update the info of a node and its ports with the xruns counted by the
+ * data thread, at most once every PW_NODE_XRUN_REPORT_INTERVAL
+ * \return 0 or the time to wait before the xruns can be reported */
+uint64_t pw_node_report_xruns(struct pw_node *node, uint64_t now);
+
 /** Activate a link \memberof pw_link
   * Starts the negotiation of formats and buffers on \a link and then
   * starts data streaming */
@@ -678,6 +831,32 @@ pw_control_new(struct pw_core *core,
 
 void pw_control_destroy(struct pw_control *control);
 
+struct pw_executor *
+pw_executor_new(struct spa_graph_plan *plan, uint32_t n_workers, int rt_prio);
+
+void pw_executor_destroy(struct pw_executor *executor);
+
+struct pw_profiler *pw_profiler_new(const char *name, uint32_t n_nodes);
+
+void pw_profiler_destroy(struct pw_profiler *profiler);
+
+struct pw_profiler_node *pw_profiler_add_node(struct pw_profiler *profiler, const char *name);
+
+void pw_profiler_remove_node(struct pw_profiler *profiler, struct pw_profiler_node *node);
+
+struct pw_driver *pw_driver_new(struct pw_core *core, struct pw_data_loop *loop);
+
+void pw_driver_destroy(struct pw_driver *driver);
+
+/** Add \a node to the nodes of the driver, called from the data loop */
+void pw_driver_add_node(struct pw_driver *driver, struct pw_node *node);
+
+/** Remove \a node from the nodes of the driver, called from the data loop */
+void pw_driver_remove_node(struct pw_driver *driver, struct pw_node *node);
+
+/** Run a cycle of the driver node \a node, called from the data loop */
+void pw_driver_cycle(struct pw_driver *driver, struct pw_node *node, enum spa_direction direction);
+
 /** \endcond */
 
 #ifdef __cplusplus
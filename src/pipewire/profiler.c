@@ -0,0 +1,160 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "pipewire/log.h"
+#include "pipewire/profiler.h"
+#include "pipewire/private.h"
+
+/** \cond */
+struct pw_profiler {
+	char *path;
+	struct pw_profiler_area *area;
+	size_t size;
+
+	uint32_t *free_slots;		/**< stack of free slot indexes */
+	uint32_t n_free;
+};
+/** \endcond */
+
+int pw_profiler_get_path(const char *name, char *path, size_t size)
+{
+	const char *runtime_dir;
+	int res;
+
+	if ((runtime_dir = getenv("XDG_RUNTIME_DIR")) == NULL)
+		return -EIO;
+
+	res = snprintf(path, size, "%s/%s.profiler", runtime_dir, name);
+	if (res < 0 || (size_t) res >= size)
+		return -ENAMETOOLONG;
+
+	return res;
+}
+
+struct pw_profiler *pw_profiler_new(const char *name, uint32_t n_nodes)
+{
+	struct pw_profiler *this;
+	char path[PATH_MAX];
+	uint32_t i;
+	int fd, res;
+
+	if ((res = pw_profiler_get_path(name, path, sizeof(path))) < 0) {
+		errno = -res;
+		return NULL;
+	}
+
+	if ((this = calloc(1, sizeof(struct pw_profiler))) == NULL)
+		return NULL;
+
+	this->size = sizeof(struct pw_profiler_area) + n_nodes * sizeof(struct pw_profiler_node);
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0) {
+		pw_log_error("profiler %p: can't create %s: %m", this, path);
+		goto no_file;
+	}
+	if (ftruncate(fd, this->size) < 0) {
+		pw_log_error("profiler %p: can't resize %s: %m", this, path);
+		goto no_map;
+	}
+	this->area = mmap(NULL, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (this->area == MAP_FAILED) {
+		pw_log_error("profiler %p: can't map %s: %m", this, path);
+		goto no_map;
+	}
+	close(fd);
+
+	if ((this->free_slots = malloc(n_nodes * sizeof(uint32_t))) == NULL)
+		goto no_slots;
+
+	this->path = strdup(path);
+	this->area->version = PW_VERSION_PROFILER_AREA;
+	this->area->n_nodes = n_nodes;
+	for (i = 0; i < n_nodes; i++) {
+		this->area->nodes[i].id = SPA_ID_INVALID;
+		/* hand out the first slots first */
+		this->free_slots[i] = n_nodes - 1 - i;
+	}
+	this->n_free = n_nodes;
+
+	pw_log_debug("profiler %p: %u nodes in %s", this, n_nodes, path);
+
+	return this;
+
+      no_slots:
+	munmap(this->area, this->size);
+	goto no_file;
+      no_map:
+	close(fd);
+	unlink(path);
+      no_file:
+	free(this);
+	return NULL;
+}
+
+void pw_profiler_destroy(struct pw_profiler *profiler)
+{
+	pw_log_debug("profiler %p: destroy", profiler);
+
+	unlink(profiler->path);
+	munmap(profiler->area, profiler->size);
+	free(profiler->free_slots);
+	free(profiler->path);
+	free(profiler);
+}
+
+/** Get a slot for a node, the id is set when the node has one */
+struct pw_profiler_node *pw_profiler_add_node(struct pw_profiler *profiler, const char *name)
+{
+	struct pw_profiler_node *node;
+	struct spa_graph_node_timing *t;
+	uint32_t seq;
+
+	if (profiler->n_free == 0) {
+		pw_log_warn("profiler %p: no free slot for node %s", profiler, name);
+		return NULL;
+	}
+	node = &profiler->area->nodes[profiler->free_slots[--profiler->n_free]];
+
+	snprintf(node->name, sizeof(node->name), "%s", name ? name : "");
+
+	/* readers can still look at the slot, clear it like an update */
+	t = &node->timing;
+	seq = t->seq;
+	__atomic_store_n(&t->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memset(SPA_MEMBER(t, sizeof(t->seq), void), 0, sizeof(*t) - sizeof(t->seq));
+	__atomic_store_n(&t->seq, seq + 2, __ATOMIC_RELEASE);
+
+	return node;
+}
+
+void pw_profiler_remove_node(struct pw_profiler *profiler, struct pw_profiler_node *node)
+{
+	__atomic_store_n(&node->id, SPA_ID_INVALID, __ATOMIC_RELEASE);
+	profiler->free_slots[profiler->n_free++] = node - profiler->area->nodes;
+}
@@ -0,0 +1,66 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PIPEWIRE_PROFILER_H__
+#define __PIPEWIRE_PROFILER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/graph/graph.h>
+
+/** \class pw_profiler
+ *
+ * The timing of the nodes of a core in a file in the runtime directory.
+ * The data loop updates the timing of a node every time the node processes,
+ * other processes can map the file and read the timing at any time.
+ *
+ * When the core has a quantum, the cycles of the drivers of the data loops
+ * are in the file too, with the id of the core and the name cycle.<loop>.
+ */
+
+#define PW_PROFILER_NAME_SIZE	64
+
+/** the timing of one node */
+struct pw_profiler_node {
+	uint32_t id;				/**< global id of the node or
+						  *  SPA_ID_INVALID for a free slot */
+	char name[PW_PROFILER_NAME_SIZE];	/**< name of the node */
+	struct spa_graph_node_timing timing;	/**< timing, use
+						  *  spa_graph_node_timing_read() */
+};
+
+/** the layout of the profiler file */
+struct pw_profiler_area {
+#define PW_VERSION_PROFILER_AREA	0
+	uint32_t version;		/**< version of the layout */
+	uint32_t n_nodes;		/**< number of node slots */
+	struct pw_profiler_node nodes[0];
+};
+
+/** Get the path of the profiler file of the core with \a name
+ * \return the length of the path or a negative errno */
+int pw_profiler_get_path(const char *name, char *path, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PIPEWIRE_PROFILER_H__ */
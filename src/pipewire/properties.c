@@ -18,35 +18,209 @@
  */
 
 #include <stdio.h>
+#include <pthread.h>
+
+#include <spa/utils/hash.h>
 
 #include "pipewire/pipewire.h"
 #include "pipewire/properties.h"
+#include "pipewire/core.h"
+#include "pipewire/client.h"
+#include "pipewire/link.h"
+#include "pipewire/module.h"
+#include "pipewire/node.h"
 
 /** \cond */
+/* build a hash index when there are this many items */
+#define INDEX_THRESHOLD	16
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	uint32_t *index;		/**< item index + 1, 0 is an empty slot */
+	uint32_t index_size;		/**< power of 2 */
 };
+
+/* Common keys, these are stored once for the whole process so that they
+ * don't need to be copied and can be compared by pointer. */
+static const char common_keys[] =
+	"media.class\0"
+	"media.name\0"
+	"node.name\0"
+	"node.pause-on-idle\0"
+	"port.name\0"
+	"port.direction\0"
+	"port.physical\0"
+	"port.terminal\0"
+	"port.dsp\0"
+	"link.input\0"
+	"link.output\0"
+	"link.input_node.id\0"
+	"link.input_port.id\0"
+	"link.output_node.id\0"
+	"link.output_port.id\0"
+	"factory.name\0"
+	"factory.author\0"
+	"factory.description\0"
+	"spa.library.name\0"
+	"spa.factory.name\0"
+	"application.name\0"
+	"application.prgname\0"
+	"application.language\0"
+	"application.process.id\0"
+	"application.process.user\0"
+	"application.process.host\0"
+	"application.process.session_id\0"
+	"device.api\0"
+	"device.name\0"
+	"device.path\0"
+	"device.class\0"
+	"device.icon\0"
+	"device.bus\0"
+	"device.bus_path\0"
+	"device.serial\0"
+	"device.subsystem\0"
+	"device.form_factor\0"
+	"device.capabilities\0"
+	"device.vendor.id\0"
+	"device.vendor.name\0"
+	"device.product.id\0"
+	"device.product.name\0"
+	"alsa.card\0"
+	"alsa.card.id\0"
+	"alsa.card.name\0"
+	"alsa.card.longname\0"
+	"alsa.card.driver\0"
+	"alsa.card.mixername\0"
+	"alsa.card.components\0"
+	"alsa.device\0"
+	"alsa.pcm.id\0"
+	"alsa.pcm.name\0"
+	"alsa.pcm.subname\0"
+	"udev.id\0"
+	PW_CORE_PROP_NAME "\0"
+	PW_CLIENT_PROP_PROTOCOL "\0"
+	PW_CLIENT_PROP_UCRED_PID "\0"
+	PW_CLIENT_PROP_UCRED_UID "\0"
+	PW_CLIENT_PROP_UCRED_GID "\0"
+	PW_LINK_PROP_PASSIVE "\0"
+	PW_MODULE_PROP_NAME "\0"
+	PW_NODE_PROP_MEDIA "\0"
+	PW_NODE_PROP_CATEGORY "\0"
+	PW_NODE_PROP_ROLE "\0"
+	PW_NODE_PROP_EXCLUSIVE "\0"
+	PW_NODE_PROP_AUTOCONNECT "\0"
+	PW_NODE_PROP_TARGET_NODE "\0";
+
+#define COMMON_INDEX_SIZE	256
+
+static struct {
+	pthread_once_t once;
+	uint16_t index[COMMON_INDEX_SIZE];	/**< offset + 1 in common_keys */
+} common = { PTHREAD_ONCE_INIT, };
 /** \endcond */
 
+static void common_init(void)
+{
+	const char *key;
+
+	for (key = common_keys; key < common_keys + sizeof(common_keys) - 1; key += strlen(key) + 1) {
+		uint32_t i = spa_hash_string(key) & (COMMON_INDEX_SIZE - 1);
+
+		while (common.index[i] != 0)
+			i = (i + 1) & (COMMON_INDEX_SIZE - 1);
+		common.index[i] = key - common_keys + 1;
+	}
+}
+
+static inline bool is_common(const char *key)
+{
+	return key >= common_keys && key < common_keys + sizeof(common_keys);
+}
+
+/* the common key that is equal to key or NULL */
+static const char *find_common(const char *key)
+{
+	uint32_t i;
+
+	pthread_once(&common.once, common_init);
+
+	for (i = spa_hash_string(key) & (COMMON_INDEX_SIZE - 1); common.index[i] != 0;
+	     i = (i + 1) & (COMMON_INDEX_SIZE - 1)) {
+		const char *k = common_keys + common.index[i] - 1;
+		if (strcmp(k, key) == 0)
+			return k;
+	}
+	return NULL;
+}
+
+static char *copy_key(const char *key)
+{
+	const char *k;
+
+	if (is_common(key))
+		return (char *) key;
+	if ((k = find_common(key)) != NULL)
+		return (char *) k;
+	return strdup(key);
+}
+
+static void index_insert(struct properties *impl, uint32_t idx)
+{
+	const char *key = pw_array_get_unchecked(&impl->items, idx, struct spa_dict_item)->key;
+	uint32_t i, mask = impl->index_size - 1;
+
+	for (i = spa_hash_string(key) & mask; impl->index[i] != 0; i = (i + 1) & mask);
+	impl->index[i] = idx + 1;
+}
+
+static void index_build(struct properties *impl)
+{
+	uint32_t i, size, len = pw_array_get_len(&impl->items, struct spa_dict_item);
+
+	for (size = 32; size < len * 2; size <<= 1);
+
+	free(impl->index);
+	if ((impl->index = calloc(size, sizeof(uint32_t))) == NULL) {
+		impl->index_size = 0;
+		return;
+	}
+	impl->index_size = size;
+
+	for (i = 0; i < len; i++)
+		index_insert(impl, i);
+}
+
 static int add_func(struct pw_properties *this, char *key, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
+	uint32_t len;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
 	item->key = key;
 	item->value = value;
 
 	this->dict.items = impl->items.data;
-	this->dict.n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
+	this->dict.n_items = len = pw_array_get_len(&impl->items, struct spa_dict_item);
+
+	if (impl->index == NULL) {
+		if (len >= INDEX_THRESHOLD)
+			index_build(impl);
+	} else if (len * 2 > impl->index_size)
+		index_build(impl);
+	else
+		index_insert(impl, len - 1);
+
 	return 0;
 }
 
 static void clear_item(struct spa_dict_item *item)
 {
-	free((char *) item->key);
+	if (!is_common(item->key))
+		free((char *) item->key);
 	free((char *) item->value);
 }
 
@@ -55,10 +229,22 @@ static int find_index(const struct pw_properties *this, const char *key)
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	int i, len = pw_array_get_len(&impl->items, struct spa_dict_item);
 
+	if (impl->index) {
+		uint32_t j, mask = impl->index_size - 1;
+
+		for (j = spa_hash_string(key) & mask; (i = impl->index[j]) != 0; j = (j + 1) & mask) {
+			struct spa_dict_item *item =
+			    pw_array_get_unchecked(&impl->items, i - 1, struct spa_dict_item);
+			if (item->key == key || strcmp(item->key, key) == 0)
+				return i - 1;
+		}
+		return -1;
+	}
+
 	for (i = 0; i < len; i++) {
 		struct spa_dict_item *item =
 		    pw_array_get_unchecked(&impl->items, i, struct spa_dict_item);
-		if (strcmp(item->key, key) == 0)
+		if (item->key == key || strcmp(item->key, key) == 0)
 			return i;
 	}
 	return -1;
@@ -98,7 +284,7 @@ struct pw_properties *pw_properties_new(const char *key, ...)
 	va_start(varargs, key);
 	while (key != NULL) {
 		value = va_arg(varargs, char *);
-		add_func(&impl->this, strdup(key), value ? strdup(value) : NULL);
+		add_func(&impl->this, copy_key(key), value ? strdup(value) : NULL);
 		key = va_arg(varargs, char *);
 	}
 	va_end(varargs);
@@ -124,7 +310,7 @@ struct pw_properties *pw_properties_new_dict(const struct spa_dict *dict)
 
 	for (i = 0; i < dict->n_items; i++) {
 		if (dict->items[i].key != NULL)
-			add_func(&impl->this, strdup(dict->items[i].key),
+			add_func(&impl->this, copy_key(dict->items[i].key),
 				 dict->items[i].value ? strdup(dict->items[i].value) : NULL);
 	}
 
@@ -161,8 +347,9 @@ pw_properties_new_string(const char *str)
 		eq = strchr(val, '=');
 		if (eq) {
 			*eq = '\0';
-			add_func(&impl->this, val, strdup(eq+1));
+			add_func(&impl->this, copy_key(val), strdup(eq+1));
 		}
+		free(val);
 		s = pw_split_walk(str, " \t\n\r", &len, &state);
 	}
 	return &impl->this;
@@ -186,7 +373,7 @@ struct pw_properties *pw_properties_copy(const struct pw_properties *properties)
 		return NULL;
 
 	pw_array_for_each(item, &impl->items)
-	    add_func(copy, strdup(item->key), item->value ? strdup(item->value) : NULL);
+	    add_func(copy, copy_key(item->key), item->value ? strdup(item->value) : NULL);
 
 	return copy;
 }
@@ -244,6 +431,7 @@ void pw_properties_free(struct pw_properties *properties)
 	    clear_item(item);
 
 	pw_array_clear(&impl->items);
+	free(impl->index);
 	free(impl);
 }
 
@@ -263,9 +451,15 @@ static int do_replace(struct pw_properties *properties, char *key, char *value)
 			struct spa_dict_item *other = pw_array_get_unchecked(&impl->items,
 						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
 						     struct spa_dict_item);
+			if (!is_common(key))
+				free(key);
 			item->key = other->key;
 			item->value = other->value;
 			impl->items.size -= sizeof(struct spa_dict_item);
+			properties->dict.n_items--;
+			/* the last item moved */
+			if (impl->index)
+				index_build(impl);
 		} else {
 			item->key = key;
 			item->value = value;
@@ -288,7 +482,7 @@ static int do_replace(struct pw_properties *properties, char *key, char *value)
  */
 int pw_properties_set(struct pw_properties *properties, const char *key, const char *value)
 {
-	return do_replace(properties, strdup(key), value ? strdup(value) : NULL);
+	return do_replace(properties, copy_key(key), value ? strdup(value) : NULL);
 }
 
 /** Set a property value by format
@@ -312,7 +506,7 @@ int pw_properties_setf(struct pw_properties *properties, const char *key, const
 	vasprintf(&value, format, varargs);
 	va_end(varargs);
 
-	return do_replace(properties, strdup(key), value);
+	return do_replace(properties, copy_key(key), value);
 }
 
 /** Get a property
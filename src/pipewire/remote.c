@@ -83,6 +83,8 @@ struct node_data {
 	int rtwritefd;
 	struct spa_source *rtsocket_source;
         struct pw_client_node_transport *trans;
+	bool batching;		/**< handling the messages of a wakeup, the
+				  *  replies are flushed when all are handled */
 
 	struct spa_node out_node_impl;
 	struct spa_graph_node out_node;
@@ -196,7 +198,7 @@ core_event_update_types(void *data, uint32_t first_id, const char **types, uint3
 
 	for (i = 0; i < n_types; i++, first_id++) {
 		uint32_t this_id = spa_type_map_get_id(this->core->type.map, types[i]);
-		if (!pw_map_insert_at(&this->types, first_id, PW_MAP_ID_TO_PTR(this_id)))
+		if (!pw_type_remap_insert(&this->types, first_id, this_id))
 			pw_log_error("can't add type for client");
 	}
 }
@@ -243,7 +245,7 @@ struct pw_remote *pw_remote_new(struct pw_core *core,
 	this->state = PW_REMOTE_STATE_UNCONNECTED;
 
 	pw_map_init(&this->objects, 64, 32);
-	pw_map_init(&this->types, 64, 32);
+	pw_type_remap_init(&this->types);
 
 	spa_list_init(&this->proxy_list);
 	spa_list_init(&this->stream_list);
@@ -449,7 +451,7 @@ int pw_remote_disconnect(struct pw_remote *remote)
 	remote->core_proxy = NULL;
 
 	pw_map_clear(&remote->objects);
-	pw_map_clear(&remote->types);
+	pw_type_remap_clear(&remote->types);
 	remote->n_types = 0;
 
 	if (remote->info) {
@@ -468,7 +470,7 @@ do_remove_source(struct spa_loop *loop,
 	struct node_data *d = user_data;
 
 	if (d->rtsocket_source) {
-		pw_loop_destroy_source(d->core->data_loop, d->rtsocket_source);
+		pw_loop_destroy_source(d->node->data_loop, d->rtsocket_source);
 		d->rtsocket_source = NULL;
 	}
         return 0;
@@ -479,7 +481,7 @@ static void unhandle_socket(struct pw_proxy *proxy)
 {
 	struct node_data *data = proxy->user_data;
 
-        pw_loop_invoke(data->core->data_loop,
+        pw_loop_invoke(data->node->data_loop,
                        do_remove_source, 1, NULL, 0, true, data);
 }
 
@@ -522,11 +524,37 @@ static void handle_rtnode_message(struct pw_proxy *proxy, struct pw_client_node_
 	}
 }
 
+/* messages added from other threads while batching is set are flushed
+ * by the flush at the end of handle_rtnode_messages() */
+static inline void flush_messages(struct node_data *data)
+{
+	if (!__atomic_load_n(&data->batching, __ATOMIC_SEQ_CST))
+		pw_client_node_transport_flush(data->trans, data->rtwritefd);
+}
+
+static void handle_rtnode_messages(struct pw_proxy *proxy)
+{
+	struct node_data *data = proxy->user_data;
+	struct pw_client_node_message message;
+
+	pw_client_node_transport_acknowledge(data->trans);
+
+	__atomic_store_n(&data->batching, true, __ATOMIC_SEQ_CST);
+	while (pw_client_node_transport_next_message(data->trans, &message) == 1) {
+		struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+		pw_client_node_transport_parse_message(data->trans, msg);
+		handle_rtnode_message(proxy, msg);
+	}
+	__atomic_store_n(&data->batching, false, __ATOMIC_SEQ_CST);
+
+	/* send everything the messages produced with one wakeup */
+	pw_client_node_transport_flush(data->trans, data->rtwritefd);
+}
+
 static void
 on_rtsocket_condition(void *user_data, int fd, enum spa_io mask)
 {
 	struct pw_proxy *proxy = user_data;
-	struct node_data *data = proxy->user_data;
 
 	if (mask & (SPA_IO_ERR | SPA_IO_HUP)) {
 		pw_log_warn("got error");
@@ -535,7 +563,6 @@ on_rtsocket_condition(void *user_data, int fd, enum spa_io mask)
 	}
 
 	if (mask & SPA_IO_IN) {
-		struct pw_client_node_message message;
 		uint64_t cmd;
 
 		if (read(fd, &cmd, sizeof(uint64_t)) != sizeof(uint64_t))
@@ -544,12 +571,7 @@ on_rtsocket_condition(void *user_data, int fd, enum spa_io mask)
 		if (cmd > 1)
 			pw_log_warn("proxy %p: %ld messages", proxy, cmd);
 
-
-		while (pw_client_node_transport_next_message(data->trans, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(data->trans, msg);
-			handle_rtnode_message(proxy, msg);
-		}
+		handle_rtnode_messages(proxy);
 	}
 }
 
@@ -692,6 +714,56 @@ static void client_node_add_mem(void *object,
 	m->ptr = NULL;
 }
 
+static int
+do_remap_transport(struct spa_loop *loop,
+		   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_proxy *proxy = user_data;
+	struct node_data *d = proxy->user_data;
+	struct pw_client_node_transport *trans = *(struct pw_client_node_transport **) data;
+	int i;
+
+	/* finish what was sent on the old transport before switching */
+	handle_rtnode_messages(proxy);
+
+	for (i = 0; i < trans->area->max_input_ports; i++) {
+		d->in_ports[i].input.io = &trans->inputs[i];
+		d->in_ports[i].output.io = &trans->inputs[i];
+	}
+	for (i = 0; i < trans->area->max_output_ports; i++) {
+		d->out_ports[i].input.io = &trans->outputs[i];
+		d->out_ports[i].output.io = &trans->outputs[i];
+	}
+	d->trans = trans;
+
+	/* tell the server it can free the old transport */
+	pw_client_node_transport_add_message(d->trans,
+			&PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_TRANSPORT_SWITCHED));
+	flush_messages(d);
+
+	handle_rtnode_messages(proxy);
+
+	return 0;
+}
+
+/* the server replaced the transport with one with bigger ringbuffers,
+ * map it in place of the old one and keep everything else */
+static void remap_transport(struct pw_proxy *proxy, int readfd, int writefd,
+			    struct pw_client_node_transport *transport)
+{
+	struct node_data *data = proxy->user_data;
+	struct pw_client_node_transport *old = data->trans;
+
+	pw_log_info("remote-node %p: remap transport %p -> %p", proxy, old, transport);
+
+	pw_loop_invoke(data->node->data_loop,
+		       do_remap_transport, 1, &transport, sizeof(transport), true, proxy);
+
+	pw_client_node_transport_destroy(old);
+	close(readfd);
+	close(writefd);
+}
+
 static void client_node_transport(void *object, uint32_t node_id,
                                   int readfd, int writefd,
 				  struct pw_client_node_transport *transport)
@@ -701,6 +773,13 @@ static void client_node_transport(void *object, uint32_t node_id,
 	struct pw_port *port;
 	int i;
 
+	if (data->trans && data->rtsocket_source &&
+	    data->trans->area->max_input_ports == transport->area->max_input_ports &&
+	    data->trans->area->max_output_ports == transport->area->max_output_ports) {
+		remap_transport(proxy, readfd, writefd, transport);
+		return;
+	}
+
 	clean_transport(proxy);
 
 	data->node_id = node_id;
@@ -759,7 +838,7 @@ static void client_node_transport(void *object, uint32_t node_id,
 	}
 
         data->rtwritefd = writefd;
-        data->rtsocket_source = pw_loop_add_io(proxy->remote->core->data_loop,
+        data->rtsocket_source = pw_loop_add_io(data->node->data_loop,
                                                readfd,
                                                SPA_IO_ERR | SPA_IO_HUP,
                                                true, on_rtsocket_condition, proxy);
@@ -842,19 +921,17 @@ static void client_node_event(void *object, const struct spa_event *event)
 static void node_need_input(void *data)
 {
 	struct node_data *d = data;
-        uint64_t cmd = 1;
 	pw_client_node_transport_add_message(d->trans,
 				&PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_NEED_INPUT));
-        write(d->rtwritefd, &cmd, 8);
+	flush_messages(d);
 }
 
 static void node_have_output(void *data)
 {
 	struct node_data *d = data;
-        uint64_t cmd = 1;
         pw_client_node_transport_add_message(d->trans,
                                &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT));
-        write(d->rtwritefd, &cmd, 8);
+	flush_messages(d);
 }
 
 static void client_node_command(void *object, uint32_t seq, const struct spa_command *command)
@@ -867,7 +944,7 @@ static void client_node_command(void *object, uint32_t seq, const struct spa_com
 	if (SPA_COMMAND_TYPE(command) == remote->core->type.command_node.Pause) {
 		pw_log_debug("node %p: pause %d", proxy, seq);
 
-		pw_loop_update_io(remote->core->data_loop,
+		pw_loop_update_io(data->node->data_loop,
 				  data->rtsocket_source,
 				  SPA_IO_ERR | SPA_IO_HUP);
 
@@ -881,7 +958,7 @@ static void client_node_command(void *object, uint32_t seq, const struct spa_com
 
 		pw_log_debug("node %p: start %d", proxy, seq);
 
-		pw_loop_update_io(remote->core->data_loop,
+		pw_loop_update_io(data->node->data_loop,
 				  data->rtsocket_source,
 				  SPA_IO_IN | SPA_IO_ERR | SPA_IO_HUP);
 
@@ -1325,13 +1402,20 @@ struct pw_proxy *pw_remote_export(struct pw_remote *remote,
 	struct remote *impl = SPA_CONTAINER_OF(remote, struct remote, this);
 	struct pw_proxy *proxy;
 	struct node_data *data;
+	struct pw_properties *props;
+
+	if ((props = pw_properties_copy(node->properties)) == NULL)
+		return NULL;
+	pw_properties_setf(props, PW_CLIENT_NODE_PROP_TRANSPORT_VERSION,
+			   "%d", PW_VERSION_CLIENT_NODE_TRANSPORT);
 
 	proxy = pw_core_proxy_create_object(remote->core_proxy,
 					    "client-node",
 					    impl->type_client_node,
 					    PW_VERSION_CLIENT_NODE,
-					    &node->properties->dict,
+					    &props->dict,
 					    sizeof(struct node_data));
+	pw_properties_free(props);
         if (proxy == NULL)
                 return NULL;
 
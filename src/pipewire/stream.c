@@ -91,7 +91,10 @@ struct stream {
 	enum pw_stream_flags flags;
 
 	int rtwritefd;
+	struct pw_loop *data_loop;	/**< the data loop of the stream */
 	struct spa_source *rtsocket_source;
+	bool batching;			/**< handling the messages of a wakeup, the
+					  *  replies are flushed when all are handled */
 
 	struct pw_client_node_proxy *node_proxy;
 	bool disconnecting;
@@ -398,6 +401,8 @@ struct pw_stream *pw_stream_new(struct pw_remote *remote,
 	this->name = strdup(name);
 	impl->type_client_node = spa_type_map_get_id(remote->core->type.map, PW_TYPE_INTERFACE__ClientNode);
 	impl->rtwritefd = -1;
+	impl->data_loop = pw_core_find_data_loop(remote->core,
+			pw_properties_get(props, PW_NODE_PROP_LOOP_NAME))->loop;
 
 	str = pw_properties_get(props, "pipewire.client.reuse");
 	impl->client_reuse = str && pw_properties_parse_bool(str);
@@ -460,10 +465,9 @@ do_remove_sources(struct spa_loop *loop,
                   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct stream *impl = user_data;
-	struct pw_stream *stream = &impl->this;
 
 	if (impl->rtsocket_source) {
-		pw_loop_destroy_source(stream->remote->core->data_loop, impl->rtsocket_source);
+		pw_loop_destroy_source(impl->data_loop, impl->rtsocket_source);
 		impl->rtsocket_source = NULL;
 	}
 	if (impl->rtwritefd != -1) {
@@ -481,7 +485,7 @@ static void unhandle_socket(struct pw_stream *stream)
 		pw_loop_destroy_source(stream->remote->core->main_loop, impl->timeout_source);
 		impl->timeout_source = NULL;
 	}
-        pw_loop_invoke(stream->remote->core->data_loop,
+        pw_loop_invoke(impl->data_loop,
                        do_remove_sources, 1, NULL, 0, true, impl);
 }
 
@@ -609,37 +613,42 @@ static void add_port_update(struct pw_stream *stream, uint32_t change_mask)
 					 &impl->port_info);
 }
 
+/* messages added from other threads while batching is set are flushed
+ * by the flush at the end of handle_rtnode_messages() */
+static inline void flush_messages(struct stream *impl)
+{
+	if (!__atomic_load_n(&impl->batching, __ATOMIC_SEQ_CST))
+		pw_client_node_transport_flush(impl->trans, impl->rtwritefd);
+}
+
 static inline void send_need_input(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans,
 			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_NEED_INPUT));
-	write(impl->rtwritefd, &cmd, 8);
+	flush_messages(impl);
 }
 
 static inline void send_have_output(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans,
 			       &PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_HAVE_OUTPUT));
-	write(impl->rtwritefd, &cmd, 8);
+	flush_messages(impl);
 }
 
 static inline void send_reuse_buffer(struct pw_stream *stream, uint32_t id)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint64_t cmd = 1;
 
 	pw_log_trace("send");
 	pw_client_node_transport_add_message(impl->trans, (struct pw_client_node_message*)
 			       &PW_CLIENT_NODE_MESSAGE_PORT_REUSE_BUFFER_INIT(impl->port_id, id));
-	write(impl->rtwritefd, &cmd, 8);
+	flush_messages(impl);
 }
 
 static void add_async_complete(struct pw_stream *stream, uint32_t seq, int res)
@@ -813,6 +822,25 @@ static void handle_rtnode_message(struct pw_stream *stream, struct pw_client_nod
 	}
 }
 
+static void handle_rtnode_messages(struct pw_stream *stream)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct pw_client_node_message message;
+
+	pw_client_node_transport_acknowledge(impl->trans);
+
+	__atomic_store_n(&impl->batching, true, __ATOMIC_SEQ_CST);
+	while (pw_client_node_transport_next_message(impl->trans, &message) == 1) {
+		struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
+		pw_client_node_transport_parse_message(impl->trans, msg);
+		handle_rtnode_message(stream, msg);
+	}
+	__atomic_store_n(&impl->batching, false, __ATOMIC_SEQ_CST);
+
+	/* send everything the messages produced with one wakeup */
+	pw_client_node_transport_flush(impl->trans, impl->rtwritefd);
+}
+
 static void
 on_rtsocket_condition(void *data, int fd, enum spa_io mask)
 {
@@ -826,17 +854,12 @@ on_rtsocket_condition(void *data, int fd, enum spa_io mask)
 	}
 
 	if (mask & SPA_IO_IN) {
-		struct pw_client_node_message message;
 		uint64_t cmd;
 
 		if (read(fd, &cmd, sizeof(uint64_t)) != sizeof(uint64_t))
 			pw_log_warn("stream %p: read failed %m", impl);
 
-		while (pw_client_node_transport_next_message(impl->trans, &message) == 1) {
-			struct pw_client_node_message *msg = alloca(SPA_POD_SIZE(&message));
-			pw_client_node_transport_parse_message(impl->trans, msg);
-			handle_rtnode_message(stream, msg);
-		}
+		handle_rtnode_messages(stream);
 	}
 }
 
@@ -846,7 +869,7 @@ static void handle_socket(struct pw_stream *stream, int rtreadfd, int rtwritefd)
 	struct timespec interval;
 
 	impl->rtwritefd = rtwritefd;
-	impl->rtsocket_source = pw_loop_add_io(stream->remote->core->data_loop,
+	impl->rtsocket_source = pw_loop_add_io(impl->data_loop,
 					       rtreadfd,
 					       SPA_IO_ERR | SPA_IO_HUP,
 					       true, on_rtsocket_condition, stream);
@@ -883,7 +906,7 @@ static void client_node_command(void *data, uint32_t seq, const struct spa_comma
 		if (stream->state == PW_STREAM_STATE_STREAMING) {
 			pw_log_debug("stream %p: pause %d", stream, seq);
 
-			pw_loop_update_io(stream->remote->core->data_loop,
+			pw_loop_update_io(impl->data_loop,
 					  impl->rtsocket_source, SPA_IO_ERR | SPA_IO_HUP);
 
 			stream_set_state(stream, PW_STREAM_STATE_PAUSED, NULL);
@@ -896,7 +919,7 @@ static void client_node_command(void *data, uint32_t seq, const struct spa_comma
 
 			pw_log_debug("stream %p: start %d %d", stream, seq, impl->direction);
 
-			pw_loop_update_io(stream->remote->core->data_loop,
+			pw_loop_update_io(impl->data_loop,
 					  impl->rtsocket_source,
 					  SPA_IO_IN | SPA_IO_ERR | SPA_IO_HUP);
 
@@ -1152,12 +1175,45 @@ client_node_port_command(void *data,
 	pw_log_warn("port command not supported");
 }
 
+static int
+do_remap_transport(struct spa_loop *loop,
+		   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct stream *impl = user_data;
+
+	/* finish what was sent on the old transport before switching */
+	handle_rtnode_messages(&impl->this);
+	impl->trans = *(struct pw_client_node_transport **) data;
+
+	/* tell the server it can free the old transport */
+	pw_client_node_transport_add_message(impl->trans,
+			&PW_CLIENT_NODE_MESSAGE_INIT(PW_CLIENT_NODE_MESSAGE_TRANSPORT_SWITCHED));
+	flush_messages(impl);
+
+	handle_rtnode_messages(&impl->this);
+
+	return 0;
+}
+
 static void client_node_transport(void *data, uint32_t node_id,
 				  int readfd, int writefd,
 				  struct pw_client_node_transport *transport)
 {
 	struct stream *impl = data;
 	struct pw_stream *stream = &impl->this;
+	struct pw_client_node_transport *old = impl->trans;
+
+	if (old && impl->rtsocket_source && stream->node_id == node_id) {
+		/* the server replaced the transport with one with bigger
+		 * ringbuffers, map it in place of the old one */
+		pw_log_info("stream %p: remap transport %p -> %p", stream, old, transport);
+		pw_loop_invoke(impl->data_loop,
+			       do_remap_transport, 1, &transport, sizeof(transport), true, impl);
+		pw_client_node_transport_destroy(old);
+		close(readfd);
+		close(writefd);
+		return;
+	}
 
 	stream->node_id = node_id;
 
@@ -1274,6 +1330,8 @@ pw_stream_connect(struct pw_stream *stream,
 		pw_properties_set(stream->properties, PW_NODE_PROP_TARGET_NODE, port_path);
 	if (flags & PW_STREAM_FLAG_AUTOCONNECT)
 		pw_properties_set(stream->properties, PW_NODE_PROP_AUTOCONNECT, "1");
+	pw_properties_setf(stream->properties, PW_CLIENT_NODE_PROP_TRANSPORT_VERSION,
+			   "%d", PW_VERSION_CLIENT_NODE_TRANSPORT);
 
 	impl->node_proxy = pw_core_proxy_create_object(stream->remote->core_proxy,
 			       "client-node",
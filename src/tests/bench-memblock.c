@@ -0,0 +1,90 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include <spa/utils/defs.h>
+
+#include <pipewire/mem.h>
+
+#define DEFAULT_BLOCKS		10000
+#define DEFAULT_LOOKUPS		1000000
+#define BLOCK_SIZE		256
+
+static int64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_TIME(&now);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_memblock **mem;
+	int i, res, n_blocks = DEFAULT_BLOCKS, n_lookups = DEFAULT_LOOKUPS, misses = 0;
+	int64_t start, stop;
+
+	if (argc > 1)
+		n_blocks = atoi(argv[1]);
+	if (argc > 2)
+		n_lookups = atoi(argv[2]);
+	if (n_blocks <= 0 || n_lookups <= 0) {
+		printf("usage: %s [n_blocks] [n_lookups]\n", argv[0]);
+		return -1;
+	}
+
+	mem = calloc(n_blocks, sizeof(struct pw_memblock *));
+
+	start = get_time();
+	for (i = 0; i < n_blocks; i++) {
+		if ((res = pw_memblock_alloc(0, BLOCK_SIZE, &mem[i])) < 0) {
+			printf("can't alloc block %d: %d\n", i, res);
+			return -1;
+		}
+	}
+	stop = get_time();
+	printf("alloc %d blocks: %" PRIi64 " ns/block\n", n_blocks, (stop - start) / n_blocks);
+
+	srand(0);
+	start = get_time();
+	for (i = 0; i < n_lookups; i++) {
+		struct pw_memblock *m = mem[rand() % n_blocks];
+		const uint8_t *ptr = (const uint8_t *) m->ptr + (rand() % BLOCK_SIZE);
+
+		if (pw_memblock_find(ptr) != m)
+			misses++;
+	}
+	stop = get_time();
+	printf("find in %d blocks: %" PRIi64 " ns/lookup, %d misses\n",
+	       n_blocks, (stop - start) / n_lookups, misses);
+
+	start = get_time();
+	for (i = 0; i < n_blocks; i++)
+		pw_memblock_free(mem[i]);
+	stop = get_time();
+	printf("free %d blocks: %" PRIi64 " ns/block\n", n_blocks, (stop - start) / n_blocks);
+
+	free(mem);
+
+	return misses == 0 ? 0 : -1;
+}
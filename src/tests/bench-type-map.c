@@ -0,0 +1,110 @@
+/* PipeWire
+ * Copyright (C) 2018 Wim Taymans <wim.taymans@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include <spa/support/type-map.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/map.h>
+
+#define DEFAULT_TYPES		2000
+#define DEFAULT_CLIENTS		100
+
+static int64_t get_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_TIME(&now);
+}
+
+/* what the core does with the types of a new client */
+static void update_types(struct spa_type_map *map, struct pw_map *types,
+			 uint32_t first_id, char **names, uint32_t n_types)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_types; i++, first_id++) {
+		uint32_t id = spa_type_map_get_id(map, names[i]);
+		pw_map_insert_at(types, first_id, PW_MAP_ID_TO_PTR(id));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_type_map *map;
+	char **names;
+	int i, n_types = DEFAULT_TYPES, n_clients = DEFAULT_CLIENTS;
+	int64_t start, stop;
+
+	pw_init(&argc, &argv);
+
+	if (argc > 1)
+		n_types = atoi(argv[1]);
+	if (argc > 2)
+		n_clients = atoi(argv[2]);
+	if (n_types <= 0 || n_clients <= 0) {
+		printf("usage: %s [n_types] [n_clients]\n", argv[0]);
+		return -1;
+	}
+
+	if ((map = pw_get_support_interface(SPA_TYPE__TypeMap)) == NULL) {
+		printf("can't get the type map\n");
+		return -1;
+	}
+
+	if ((names = calloc(n_types, sizeof(char *))) == NULL) {
+		printf("can't allocate %d types\n", n_types);
+		return -1;
+	}
+	for (i = 0; i < n_types; i++) {
+		if (asprintf(&names[i], SPA_TYPE_BASE "Bench:Type:%d", i) < 0) {
+			printf("can't allocate type name\n");
+			return -1;
+		}
+	}
+
+	start = get_time();
+	for (i = 0; i < n_types; i++)
+		spa_type_map_get_id(map, names[i]);
+	stop = get_time();
+	printf("register %d types: %" PRIi64 " ns/type\n", n_types, (stop - start) / n_types);
+
+	start = get_time();
+	for (i = 0; i < n_clients; i++) {
+		struct pw_map types;
+
+		pw_map_init(&types, n_types, 64);
+		update_types(map, &types, 0, names, n_types);
+		pw_map_clear(&types);
+	}
+	stop = get_time();
+	printf("connect %d clients with %zd types: %" PRIi64 " ns/client\n",
+	       n_clients, spa_type_map_get_size(map), (stop - start) / n_clients);
+
+	for (i = 0; i < n_types; i++)
+		free(names[i]);
+	free(names);
+
+	return 0;
+}
@@ -18,7 +18,14 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <spa/debug/pod.h>
 #include <spa/debug/format.h>
@@ -45,6 +52,12 @@ struct data {
 
 	uint32_t seq;
 	struct spa_list pending_list;
+
+	struct pw_profiler_area *area;		/**< mapped profiler file for top */
+	size_t area_size;
+	struct spa_graph_node_timing *prev;	/**< timing at the previous update */
+	uint32_t *prev_id;
+	uint64_t prev_time;
 };
 
 struct proxy_data {
@@ -232,8 +245,10 @@ static void print_node(struct proxy_data *data)
 		else
 			printf("\n");
 		print_properties(info->props, MARK_CHANGE(4));
-
-
+		printf("%c\txruns: %u", MARK_CHANGE(6), info->n_xruns);
+		if (info->n_xruns)
+			printf(" (last at %"PRIu64")", info->xrun_time);
+		printf("\n");
 	}
 }
 
@@ -300,6 +315,10 @@ static void print_port(struct proxy_data *data)
 				spa_debug_pod(2, t->map, data->params[i]);
 		}
 		print_properties(info->props, MARK_CHANGE(1));
+		printf("%c\txruns: %u", MARK_CHANGE(3), info->n_xruns);
+		if (info->n_xruns)
+			printf(" (last at %"PRIu64")", info->xrun_time);
+		printf("\n");
 	}
 }
 
@@ -606,14 +625,174 @@ static void do_quit(void *data, int signal_number)
 	pw_main_loop_quit(d->loop);
 }
 
+struct top_entry {
+	struct pw_profiler_node *node;
+	struct spa_graph_node_timing now;
+	struct spa_graph_node_timing *prev;
+	uint64_t busy;
+};
+
+static int compare_top_entry(const void *a, const void *b)
+{
+	const struct top_entry *ea = a, *eb = b;
+	return ea->busy < eb->busy ? 1 : ea->busy > eb->busy ? -1 : 0;
+}
+
+static void on_top_timeout(void *_data, uint64_t expirations)
+{
+	struct data *data = _data;
+	struct pw_profiler_area *area = data->area;
+	struct top_entry *entries;
+	uint64_t now, elapsed;
+	uint32_t i, n_entries = 0;
+
+	entries = alloca(area->n_nodes * sizeof(struct top_entry));
+
+	now = spa_graph_get_time();
+	elapsed = data->prev_time ? now - data->prev_time : 0;
+	data->prev_time = now;
+
+	for (i = 0; i < area->n_nodes; i++) {
+		struct pw_profiler_node *node = &area->nodes[i];
+		struct top_entry *e = &entries[n_entries];
+		uint32_t id = __atomic_load_n(&node->id, __ATOMIC_ACQUIRE);
+
+		if (id != data->prev_id[i]) {
+			/* new node in the slot, start counting from now */
+			memset(&data->prev[i], 0, sizeof(struct spa_graph_node_timing));
+			data->prev_id[i] = id;
+		}
+		if (id == SPA_ID_INVALID)
+			continue;
+
+		/* skip nodes that are stuck in an update */
+		if (spa_graph_node_timing_read(&node->timing, &e->now) < 0)
+			continue;
+
+		e->node = node;
+		e->prev = &data->prev[i];
+		e->busy = e->now.total_time - e->prev->total_time;
+		n_entries++;
+	}
+	qsort(entries, n_entries, sizeof(struct top_entry), compare_top_entry);
+
+	printf("\033[H\033[2J");
+	printf("%5s %10s %8s %8s %8s %8s %8s %6s %7s  %s\n",
+	       "ID", "CYCLES/s", "WAIT", "AVG", "MIN", "MAX", "LAST", "BUSY%", "XRUNS", "NAME");
+
+	for (i = 0; i < n_entries; i++) {
+		struct top_entry *e = &entries[i];
+		uint64_t cycles = e->now.cycles - e->prev->cycles;
+
+		printf("%5u %10.1f %8.1f %8.1f %8.1f %8.1f %8.1f %6.1f %7u  %s\n",
+		       e->node->id,
+		       elapsed ? cycles * 1e9 / elapsed : 0.0,
+		       (e->now.awake_time - e->now.signal_time) / 1e3,
+		       cycles ? e->busy / 1e3 / cycles : 0.0,
+		       e->now.min_time / 1e3,
+		       e->now.max_time / 1e3,
+		       (e->now.finish_time - e->now.awake_time) / 1e3,
+		       elapsed ? e->busy * 100.0 / elapsed : 0.0,
+		       e->now.xruns,
+		       e->node->name);
+
+		*e->prev = e->now;
+	}
+	printf("\ntimes in microseconds\n");
+	fflush(stdout);
+}
+
+/* show the timing of the nodes from the profiler file of the daemon,
+ * this does not need a connection */
+static int run_top(struct data *data, struct pw_loop *l, const char *name)
+{
+	struct pw_profiler_area header;
+	struct spa_source *timer;
+	struct timespec value, interval;
+	char path[PATH_MAX];
+	int fd, res;
+
+	if ((res = pw_profiler_get_path(name, path, sizeof(path))) < 0) {
+		fprintf(stderr, "can't get profiler path: %s\n", spa_strerror(res));
+		return -1;
+	}
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+		fprintf(stderr, "can't open %s: %m, is the profiler enabled?\n", path);
+		return -1;
+	}
+	if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+	    header.version != PW_VERSION_PROFILER_AREA) {
+		fprintf(stderr, "invalid profiler file %s\n", path);
+		close(fd);
+		return -1;
+	}
+	data->area_size = sizeof(struct pw_profiler_area) +
+		header.n_nodes * sizeof(struct pw_profiler_node);
+	data->area = mmap(NULL, data->area_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data->area == MAP_FAILED) {
+		fprintf(stderr, "can't map %s: %m\n", path);
+		return -1;
+	}
+
+	data->prev = calloc(header.n_nodes, sizeof(struct spa_graph_node_timing));
+	data->prev_id = malloc(header.n_nodes * sizeof(uint32_t));
+	memset(data->prev_id, 0xff, header.n_nodes * sizeof(uint32_t));
+
+	timer = pw_loop_add_timer(l, on_top_timeout, data);
+	value.tv_sec = interval.tv_sec = 1;
+	value.tv_nsec = interval.tv_nsec = 0;
+	pw_loop_update_timer(l, timer, &value, &interval, false);
+	on_top_timeout(data, 0);
+
+	pw_main_loop_run(data->loop);
+
+	pw_loop_destroy_source(l, timer);
+	free(data->prev_id);
+	free(data->prev);
+	munmap(data->area, data->area_size);
+
+	return 0;
+}
+
+static void show_help(const char *name)
+{
+	fprintf(stdout, "%s [options] [remote]\n"
+             "  -h, --help                            Show this help\n"
+             "  -t, --top                             Show the timing of the nodes\n",
+	     name);
+}
+
 int main(int argc, char *argv[])
 {
 	struct data data = { 0 };
 	struct pw_loop *l;
 	struct pw_properties *props = NULL;
+	const char *remote_name;
+	bool top = false;
+	static const struct option long_options[] = {
+		{"help",	0, NULL, 'h'},
+		{"top",		0, NULL, 't'},
+		{NULL,		0, NULL, 0}
+	};
+	int c;
 
 	pw_init(&argc, &argv);
 
+	while ((c = getopt_long(argc, argv, "ht", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'h':
+			show_help(argv[0]);
+			return 0;
+		case 't':
+			top = true;
+			break;
+		default:
+			return -1;
+		}
+	}
+	remote_name = optind < argc ? argv[optind] : NULL;
+
 	data.loop = pw_main_loop_new(NULL);
 	if (data.loop == NULL)
 		return -1;
@@ -622,12 +801,20 @@ int main(int argc, char *argv[])
 	pw_loop_add_signal(l, SIGINT, do_quit, &data);
 	pw_loop_add_signal(l, SIGTERM, do_quit, &data);
 
+	if (top) {
+		if (remote_name == NULL && (remote_name = getenv("PIPEWIRE_REMOTE")) == NULL)
+			remote_name = "pipewire-0";
+		c = run_top(&data, l, remote_name);
+		pw_main_loop_destroy(data.loop);
+		return c;
+	}
+
 	data.core = pw_core_new(l, NULL);
 	if (data.core == NULL)
 		return -1;
 
-	if (argc > 1)
-		props = pw_properties_new(PW_REMOTE_PROP_REMOTE_NAME, argv[1], NULL);
+	if (remote_name)
+		props = pw_properties_new(PW_REMOTE_PROP_REMOTE_NAME, remote_name, NULL);
 
 	data.remote = pw_remote_new(data.core, props, 0);
 	if (data.remote == NULL)